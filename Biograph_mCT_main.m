@@ -78,6 +78,18 @@ options.machine_name = 'Biograph_mCT';
 % 3 = Use 32-bit list-mode data
 options.use_machine = 3;
 
+%%% Save the 32-bit list-mode prompts also in a packed format
+% Applicable only when use_machine = 3. If true, the (TOF) sinogram
+% indices of the prompts are saved, in temporal order, in the mat-files
+% folder. The file begins with the number of time steps (uint64) followed
+% by the number of prompts in each time step (uint64) and the sinogram
+% indices (uint32). Requires the source version of the 32-bit list-mode
+% loader (petlink_list2sinogram, built by install_mex). The source version
+% is used only with the native mCT sinogram properties (Ndist = 400, Nang
+% = 168, span = 11, ring_difference = 49, ndist_side = 1 and TOF_bins = 1
+% or 13), otherwise list2sinogram is used.
+options.save_packed_listmode = false;
+
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -1614,6 +1614,19 @@ options.beta_custom_OSL_RBI = 0.1;
 options.beta_custom_OSL_COSEM = 1;
 %%% Regularization parameter for custom prior with PKMA
 options.beta_custom_PKMA = 0.1;
+
+%%% Custom prior kernel (implementation 2 only)
+% OpenCL source file containing the kernel customPrior that computes the
+% gradient of your prior (see source/custom_prior_example.cl for the
+% required inputs). When set, the gradient is computed on the device inside
+% the reconstruction and all the iterations of each time step are computed
+% with a single call, i.e. the MATLAB gradients (options.grad_*) below are
+% not used. Only the final iteration is stored. Leave empty to use the
+% MATLAB gradients.
+options.custom_prior_kernel = '';
+%%% Custom prior kernel parameters
+% Vector of parameters input to the kernel (param), can be empty
+options.custom_prior_param = [];
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
  
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -1741,36 +1754,46 @@ end
 
 for t = 1 : options.partitions
     
-    for iter = 1 : options.Niter
-        
-        for osa_iter = 1 : options.subsets
-            %%% Your custom prior here
-            %%% Replace custom_prior with your own function and uncomment the
-            %%% methods that have been selected above
-            %%% OSL-OSEM
-%             options.grad_OSL_OSEM = custom_prior(options.im_vectors.custom_OSL_apu);
-            options.grad_OSL_OSEM = MRP(options.im_vectors.custom_OSL_apu, options.medx, options.medy, options.medz, options.Nx, options.Ny, options.Nz, options.epps, options.tr_offsets, options.med_no_norm);
-            %%% OSL-MLEM (implementation 2 only)
-            % options.grad_OSL_MLEM = custom_prior(options.im_vectors.custom_MLEM_apu);
-            %%% MBSREM
-            % options.grad_MBSREM = custom_prior(options.im_vectors.custom_MBSREM_apu);
-            %%% RBI-OSL
-            % options.grad_RBI = custom_prior(options.im_vectors.custom_RBI_apu);
-            %%% OSL-COSEM
-            % options.grad_COSEM = custom_prior(options.im_vectors.custom_COSEM_apu);
-            
-            % Reconstruction
-            options = custom_prior_reconstruction(options, t, iter, osa_iter);
-        end
-        %%% BSREM
-        % options.grad_BSREM = custom_prior(options.im_vectors.custom_BSREM_apu);
-        %%% ROSEM-MAP
-        % options.grad_ROSEM = custom_prior(options.im_vectors.custom_ROSEM_apu);
-        options.im_vectors = init_next_iter(options.im_vectors, options, iter);
-        % PSF deblurring
+    if ~isempty(options.custom_prior_kernel)
+        % All the iterations with the custom prior kernel
+        options = custom_prior_reconstruction(options, t, 1, 1);
+        options.im_vectors = init_next_iter(options.im_vectors, options, options.Niter);
         if options.use_psf && options.deblurring
             [gaussK, options.g_dim_x, options.g_dim_y, options.g_dim_z] = PSFKernel(options.Nx, options.Ny, options.Nz, options.FOVa_x, options.FOVa_y, options.axial_fov, options.FWHM, options.implementation);
-            options.im_vectors = computeDeblur(options.im_vectors, options, iter, gaussK, options.Nx, options.Ny, options.Nz);
+            options.im_vectors = computeDeblur(options.im_vectors, options, options.Niter, gaussK, options.Nx, options.Ny, options.Nz);
+        end
+    else
+        for iter = 1 : options.Niter
+        
+            for osa_iter = 1 : options.subsets
+                %%% Your custom prior here
+                %%% Replace custom_prior with your own function and uncomment the
+                %%% methods that have been selected above
+                %%% OSL-OSEM
+    %             options.grad_OSL_OSEM = custom_prior(options.im_vectors.custom_OSL_apu);
+                options.grad_OSL_OSEM = MRP(options.im_vectors.custom_OSL_apu, options.medx, options.medy, options.medz, options.Nx, options.Ny, options.Nz, options.epps, options.tr_offsets, options.med_no_norm);
+                %%% OSL-MLEM (implementation 2 only)
+                % options.grad_OSL_MLEM = custom_prior(options.im_vectors.custom_MLEM_apu);
+                %%% MBSREM
+                % options.grad_MBSREM = custom_prior(options.im_vectors.custom_MBSREM_apu);
+                %%% RBI-OSL
+                % options.grad_RBI = custom_prior(options.im_vectors.custom_RBI_apu);
+                %%% OSL-COSEM
+                % options.grad_COSEM = custom_prior(options.im_vectors.custom_COSEM_apu);
+            
+                % Reconstruction
+                options = custom_prior_reconstruction(options, t, iter, osa_iter);
+            end
+            %%% BSREM
+            % options.grad_BSREM = custom_prior(options.im_vectors.custom_BSREM_apu);
+            %%% ROSEM-MAP
+            % options.grad_ROSEM = custom_prior(options.im_vectors.custom_ROSEM_apu);
+            options.im_vectors = init_next_iter(options.im_vectors, options, iter);
+            % PSF deblurring
+            if options.use_psf && options.deblurring
+                [gaussK, options.g_dim_x, options.g_dim_y, options.g_dim_z] = PSFKernel(options.Nx, options.Ny, options.Nz, options.FOVa_x, options.FOVa_y, options.axial_fov, options.FWHM, options.implementation);
+                options.im_vectors = computeDeblur(options.im_vectors, options, iter, gaussK, options.Nx, options.Ny, options.Nz);
+            end
         end
     end
     % Output is contained in pz, just like in gate_main.m
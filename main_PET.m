@@ -319,6 +319,16 @@ options.attenuation_correction = false;
 % NOTE: the attenuation data must be the only variable in the file and
 % have the dimensions of the final reconstructed image.
 options.attenuation_datafile = '';
+
+%%% Precompute the attenuation correction factors
+% If true, the attenuation image is integrated along each LOR only once
+% before the reconstruction and the resulting attenuation correction
+% factors are included in the normalization coefficients. This removes the
+% attenuation computations from every forward and backward projection. The
+% factors are saved in the mat-files folder and reused as long as the
+% attenuation image and the LORs (subsets) stay the same. The factors are
+% always computed with the improved Siddon's algorithm (single ray).
+options.precompute_attenuation_factors = false;
  
 %%%%%%%%%%%%%%%%%%%%%%%% Normalization correction %%%%%%%%%%%%%%%%%%%%%%%%%
 %%% Compute the normalization coefficients
@@ -645,6 +655,138 @@ options.use_32bit_atomics = false;
 % Siddon as the orthogonal/volume-based ray tracer are slower in CUDA.
 options.use_CUDA = false;
 
+% Implementation 2 ONLY
+%%% Local size (work-group size)
+% The number of LORs in each OpenCL work-group. 0 uses the default value
+% (32 on NVIDIA with the improved Siddon, 64 otherwise). Overwritten by
+% the autotuner below.
+options.local_size = 0;
+
+% Implementation 2 ONLY
+%%% Autotune the local size and the atomic functions
+% If true, one iteration of OSEM with synthetic measurement data (ones) is
+% timed for each local size in autotune_local_sizes with float and 64-bit
+% integer atomics (and 32-bit integer atomics if use_32bit_atomics =
+% true). The fastest combination (the median OS kernel time per subset) is
+% used, i.e. it overwrites local_size, use_64bit_atomics and
+% use_32bit_atomics. The result is saved in the mat-files folder and the
+% same device, driver, geometry and projector settings reuse the saved
+% values without new timings. Not supported with CUDA.
+options.autotune = false;
+
+%%% Candidate local sizes for the autotuning
+% Sizes larger than the maximum work-group size of the device/kernel are
+% skipped automatically. Smaller sizes are often faster with CPUs.
+options.autotune_local_sizes = [16 32 64 128 256];
+
+% Implementation 2 ONLY
+%%% Use work-group aggregated backprojection
+% If true, the backprojection and sensitivity image values are first summed
+% in the local memory of each work-group and only then added to the global
+% memory. This reduces the number of (slow) global atomic operations when
+% the LORs of a work-group cross the same voxels. Applies only to the
+% improved Siddon (projector_type = 1) with a single ray or with
+% precomputed_lor = true. Can also be a vector, in which case each element
+% corresponds to the device number (options.use_device), e.g. [true false]
+% uses the aggregation only on device 0.
+options.aggregate_backprojection = false;
+
+% Implementation 2 ONLY
+%%% Store the measurement data in compact form on the device
+% If true, the measurements are stored as 16-bit unsigned integers and the
+% normalization, scatter and randoms data as half precision floats on the
+% device, halving the device memory use and the transfer volume of this
+% data. The measurements are stored in uint16 only if all the values are
+% integer counts between 0 and 65535 and the corrections only if the
+% values fit into the half precision range, otherwise single precision is
+% used. Not used with MRAMLA, MBSREM or ACOSEM.
+options.compact_storage = false;
+
+% Implementations 2, 3 and 4 ONLY
+%%% Cache the sensitivity images
+% If true, the sensitivity image of each subset is computed once (with
+% implementation 4) and saved in the mat-files folder. Later
+% reconstructions with the same geometry, subsets, projector,
+% normalization, attenuation and (multiplicative) scatter data load the
+% saved images instead of computing them during the first iteration. Not
+% supported with TOF, list-mode or CT data, out-of-core reconstruction or
+% the custom prior reconstruction.
+options.cache_sensitivity = false;
+
+% Implementation 2 ONLY
+%%% Store the cached sensitivity images in compact form
+% Applies only when cache_sensitivity = true. If true, only the sum of the
+% subset sensitivity images is stored in single precision on the device
+% and each subset image is stored as its ratio to the sum in half
+% precision. This reduces the device memory use of the sensitivity images
+% from 4 * subsets to 4 + 2 * subsets bytes per voxel. The compact form is
+% used automatically if there is not enough device memory for all the
+% subset images. Not used with MRAMLA, MBSREM, COSEM-type methods, RBI or
+% PKMA.
+options.compact_sensitivity = false;
+
+% Implementations 2 and 4 ONLY
+%%% Nesterov momentum acceleration
+% If true, the estimate of each full iteration is extrapolated with a
+% FISTA-type momentum, x = x_k + (t_k - 1)/t_(k+1) * (x_k - x_(k-1)), before
+% the next iteration. Negative values are set to epps. Supported only with
+% OSEM, OSL-OSEM, BSREM, ROSEM-MAP and PKMA. Selecting any other algorithm
+% (MLEM, OSL-MLEM, MRAMLA, MBSREM, RAMLA, ROSEM, RBI, OSL-RBI, DRAMA or the
+% COSEM-type algorithms) at the same time is an error. The saved estimates
+% are the unextrapolated ones. Not supported with CUDA.
+options.momentum = false;
+
+%%% Restart the momentum
+% If true, the momentum is reset whenever the log-likelihood (computed as
+% below) decreases between iterations. Setting this to true automatically
+% sets compute_objective = true (this does not enable the profiling). With
+% implementation 4, only the improved Siddon (projector_type = 1) is
+% supported. Has no effect if momentum = false.
+options.momentum_restart = false;
+
+%%% Compute the log-likelihood
+% If true, the Poisson log-likelihood is computed during the forward
+% projection of each subset and accumulated over the subsets of each
+% iteration. The values are saved in pz{end}.objective. The values are
+% computed from the estimate before each subset update and include the
+% randoms (if corrected during the reconstruction) in the expected counts.
+% With implementation 4, only the improved Siddon (projector_type = 1) is
+% supported, other projectors return NaN. Not supported with CT data.
+options.compute_objective = false;
+
+% Implementation 4 ONLY
+%%% Out-of-core reconstruction
+% If true, the measurements, the corrections (normalization, randoms and
+% scatter) and the subset indices are first written into files in a
+% subset-contiguous order and then read one subset at a time through
+% memory mapping, while the next subset is read in the background. This
+% way only about one subset of this data needs to be in memory during the
+% reconstruction. Requires subsets > 1. Not supported with MLEM, OSL-MLEM,
+% CT or list-mode data.
+options.out_of_core = false;
+
+% Implementation 4 ONLY
+%%% The folder where the out-of-core files are written
+% If empty, the temporary folder of the system is used. The files are
+% deleted once the reconstruction is complete.
+options.out_of_core_folder = '';
+
+% Implementations 2 (OpenCL) and 4 ONLY
+%%% Profiling
+% If true, the time spent in each stage of the reconstruction (e.g. data
+% upload, projector kernels/threads, image estimates and priors) and
+% counters such as the number of LORs traced are recorded. The results are
+% saved as a Chrome trace JSON file, which can be viewed with Perfetto
+% (ui.perfetto.dev) or chrome://tracing, and the per-iteration times of
+% each stage are displayed if verbose is true. Profiling synchronizes the
+% device after each stage, so the total reconstruction time can increase.
+options.profile = false;
+
+% Implementations 2 (OpenCL) and 4 ONLY
+%%% The name of the profiling trace file
+% If empty, machine_name_name_trace.json is used.
+options.profile_file = '';
+
 % Implementation 3 ONLY
 %%% How many times more measurements/LORs are in the GPU part (applicable if
 % heterogeneous computing (CPU + GPU) is used).
@@ -693,6 +835,14 @@ options.tube_width_xy = options.cr_p;
 % value is non-zero then the above value is IGNORED.
 options.tube_width_z = options.cr_pz;
 
+% Orthogonal ray tracer (projector_type = 2) only
+%%% Use a lookup table for the orthogonal distances
+% If true, the normalized orthogonal distances are interpolated from a
+% precomputed table instead of computing a square root for each voxel. The
+% maximum difference to the exact weights is about 2e-4. Applies only to
+% implementation 4.
+options.orthogonal_lookup_table = false;
+
 % Volume ray tracer (projector_type = 3) only
 %%% Radius of the tube-of-response (cylinder)
 % The radius of the cylinder that approximates the tube-of-response.
@@ -717,6 +867,17 @@ options.n_rays_transaxial = 1;
 % Number of rays in axial direction
 options.n_rays_axial = 1;
 
+% Improved Siddon (projector_type = 1) only
+% Implementation 4 ONLY
+%%% Voxel-driven backprojection
+% If true, the backprojection is computed by gathering the contributions
+% of the LORs to each voxel (image tile) instead of scattering the LOR
+% values to the voxels. The weights are identical to the ray-driven case,
+% but no atomic operations are needed and the results are deterministic
+% (do not depend on the number of threads). Requires precompute_lor = true
+% and non-TOF data.
+options.voxel_driven_backprojection = false;
+
 % Orthogonal and volume ray tracers (projector_type = 2 and 3) only
 % Implementations 2 and 3 ONLY
 %%% Apply acceleration
@@ -756,9 +917,49 @@ options.subset_type = 1;
 % combined to the same subset, 2 and 3, etc.
 options.n_angles = 2;
 
+%%% Order of the LORs inside each subset
+% 0 = The order given by the subset type
+% 1 = Sort the LORs by their angle, then by the radial offset and then by
+% the axial position
+% 2 = Sort the LORs by the Morton (Z-curve) order of their midpoints
+% Sorting does not change the subsets, but neighboring threads then
+% compute LORs that go through nearby voxels, which can speed up the
+% projections. Not applicable with list-mode data, CT data or when
+% subsets = 1.
+options.lor_ordering = 0;
+
 %%% Initial value for the reconstruction
 options.x0 = ones(options.Nx, options.Ny, options.Nz);
 
+%%% Multi-resolution (coarse-to-fine) reconstruction
+% The downsampling factors of the coarse image grids, e.g. [4 2] first
+% computes options.multi_resolution_iterations iterations with a grid of
+% size [Nx Ny Nz]/4, then with [Nx Ny Nz]/2 and finally options.Niter
+% iterations with the original grid. The estimate of each level is
+% interpolated to the next grid and used as its initial value. The FOV
+% does not change. Leave empty to use only the original grid. Requires
+% that only one algorithm is selected. Not supported with dynamic data or
+% with anatomical priors.
+options.multi_resolution_factor = [];
+%%% Number of iterations on each coarse grid
+% Either a scalar (same for all) or one value for each coarse grid.
+options.multi_resolution_iterations = 1;
+
+%%% Image mask
+% Logical (or numeric) Nx x Ny x Nz volume of the voxels that are
+% reconstructed. The voxels outside the mask are kept at zero in every
+% algorithm and the LORs that do not intersect the bounding box of the
+% mask are removed before the reconstruction (only with subsets > 1 or
+% with options.precompute_lor = true, not with list-mode or CT data). Leave
+% empty to reconstruct the whole FOV.
+options.mask = [];
+%%% Attenuation threshold of the image mask
+% If options.mask is empty and this value is larger than zero, the mask is
+% formed from the attenuation image as the voxels with a larger
+% attenuation coefficient (1/mm) than this, e.g. 0.002 excludes the air.
+% Requires attenuation correction.
+options.mask_threshold = 0;
+
 %%% Epsilon value 
 % A small value to prevent division by zero and square root of zero. Should
 % not be smaller than eps.
@@ -1361,6 +1562,13 @@ options.alphaTGV = 2;
 
 %%% Number of TGV iterations
 options.NiterTGV = 30;
+
+%%% Store the TGV variables in reduced precision
+% With implementation 2 (OpenCL) the variables are stored in half precision,
+% with implementations 1 and 4 in single precision (requires the compiled
+% TGV files, see install_mex). Reduces the memory use, but also the
+% accuracy, of TGV.
+options.TGV_half = false;
  
  
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%% NLM PROPERTIES %%%%%%%%%%%%%%%%%%%%%%%%%%%%%
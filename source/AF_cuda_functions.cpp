@@ -1205,9 +1205,19 @@ nvrtcResult createProgramCUDA(const bool verbose, const char* k_path, const char
 		options[uu] = buffer1;
 		uu++;
 	}
-	if (MethodList.MRP) {
-		options[uu] = "-DMEDIAN";
-		uu++;
+	if (MethodList.MRP || MethodList.L || MethodList.FMH) {
+		if (MethodList.MRP) {
+			options[uu] = "-DMEDIAN";
+			uu++;
+		}
+		if (MethodList.L) {
+			options[uu] = "-DL_FILTER";
+			uu++;
+		}
+		if (MethodList.FMH) {
+			options[uu] = "-DFMH_";
+			uu++;
+		}
 
 //#if (defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__) || defined(_WIN64)) && defined(_MSC_VER)
 //		sprintf_s(buffer4, 30, "-DSEARCH_WINDOW_X=%u", w_vec.Ndx);
@@ -1456,7 +1466,7 @@ nvrtcResult buildProgramCUDA(const bool verbose, const char* k_path, nvrtcProgra
 }
 
 nvrtcResult createKernelsCUDA(const bool verbose, nvrtcProgram& program_os, nvrtcProgram& program_ml, nvrtcProgram& program_mbsrem, CUfunction& kernel_os, CUfunction& kernel_ml,
-	CUfunction& kernel_mbsrem, CUfunction& kernelNLM, CUfunction& kernelMed, const bool osem_bool, const bool mlem_bool, const RecMethods& MethodList, const Weighting& w_vec, const bool precompute, const uint32_t projector_type,
+	CUfunction& kernel_mbsrem, CUfunction& kernelNLM, CUfunction& kernelMed, CUfunction& kernelL, CUfunction& kernelFMH, const bool osem_bool, const bool mlem_bool, const RecMethods& MethodList, const Weighting& w_vec, const bool precompute, const uint32_t projector_type,
 	const uint16_t n_rays, const uint16_t n_rays3D, CUmodule& moduleOS, CUmodule& moduleML, CUmodule& moduleMB) {
 
 	nvrtcResult status = NVRTC_SUCCESS;
@@ -1515,6 +1525,22 @@ nvrtcResult createKernelsCUDA(const bool verbose, nvrtcProgram& program_os, nvrt
 				return NVRTC_ERROR_PROGRAM_CREATION_FAILURE;
 			}
 		}
+		if (MethodList.L) {
+			status2 = cuModuleGetFunction(&kernelL, moduleOS, "lFilter3D");
+			if (status2 != CUDA_SUCCESS) {
+				std::cerr << getErrorString(status2) << std::endl;
+				mexPrintf("Unable to find the L-filter kernel function\n");
+				return NVRTC_ERROR_PROGRAM_CREATION_FAILURE;
+			}
+		}
+		if (MethodList.FMH) {
+			status2 = cuModuleGetFunction(&kernelFMH, moduleOS, "fmhFilter3D");
+			if (status2 != CUDA_SUCCESS) {
+				std::cerr << getErrorString(status2) << std::endl;
+				mexPrintf("Unable to find the FMH kernel function\n");
+				return NVRTC_ERROR_PROGRAM_CREATION_FAILURE;
+			}
+		}
 		delete[] ptx;
 	}
 
@@ -1566,6 +1592,22 @@ nvrtcResult createKernelsCUDA(const bool verbose, nvrtcProgram& program_os, nvrt
 				return NVRTC_ERROR_PROGRAM_CREATION_FAILURE;
 			}
 		}
+		if (MethodList.L && !osem_bool) {
+			status2 = cuModuleGetFunction(&kernelL, moduleML, "lFilter3D");
+			if (status2 != CUDA_SUCCESS) {
+				std::cerr << getErrorString(status2) << std::endl;
+				mexPrintf("Unable to find the L-filter kernel function\n");
+				return NVRTC_ERROR_PROGRAM_CREATION_FAILURE;
+			}
+		}
+		if (MethodList.FMH && !osem_bool) {
+			status2 = cuModuleGetFunction(&kernelFMH, moduleML, "fmhFilter3D");
+			if (status2 != CUDA_SUCCESS) {
+				std::cerr << getErrorString(status2) << std::endl;
+				mexPrintf("Unable to find the FMH kernel function\n");
+				return NVRTC_ERROR_PROGRAM_CREATION_FAILURE;
+			}
+		}
 		delete[] ptx;
 	}
 	if ((MethodList.MRAMLA || MethodList.MBSREM || MethodList.RBIOSL) && w_vec.MBSREM_prepass ||
@@ -1702,4 +1744,11 @@ af::array NLM(const af::array& im, Weighting& w_vec, const float epps, const uin
 		grad = W;
 	af::sync();
 	return grad;
-}
\ No newline at end of file
+}
+
+// The custom prior kernels (options.custom_prior_kernel) are OpenCL only
+af::array customPrior(const af::array& im, const float epps, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const kernelStruct& CUDAStruct)
+{
+	mexPrintf("Custom prior kernels are not supported with CUDA\n");
+	return af::constant(0.f, im.dims(0), 1);
+}
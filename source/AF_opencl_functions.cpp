@@ -17,6 +17,109 @@
 * along with this program. If not, see <https://www.gnu.org/licenses/>.
 ***************************************************************************/
 #include "AF_opencl_functions.hpp"
+#include <cstring>
+
+// Convert a single precision float to IEEE half precision (round to nearest even)
+static uint16_t floatToHalf(const float arvo) {
+	uint32_t x;
+	std::memcpy(&x, &arvo, sizeof(float));
+	const uint32_t sign = (x >> 16) & 0x8000U;
+	const int32_t e = static_cast<int32_t>((x >> 23) & 0xFFU) - 112;
+	uint32_t m = x & 0x7FFFFFU;
+	if (((x >> 23) & 0xFFU) == 0xFFU)
+		return static_cast<uint16_t>(sign | 0x7C00U | (m ? 0x200U : 0U));
+	if (e >= 31)
+		return static_cast<uint16_t>(sign | 0x7C00U);
+	if (e <= 0) {
+		// Subnormal half
+		if (e < -10)
+			return static_cast<uint16_t>(sign);
+		m |= 0x800000U;
+		const uint32_t shift = static_cast<uint32_t>(14 - e);
+		uint32_t h = m >> shift;
+		const uint32_t loput = m & ((1U << shift) - 1U);
+		const uint32_t puolet = 1U << (shift - 1U);
+		if (loput > puolet || (loput == puolet && (h & 1U)))
+			h++;
+		return static_cast<uint16_t>(sign | h);
+	}
+	uint32_t h = (static_cast<uint32_t>(e) << 10) | (m >> 13);
+	const uint32_t loput = m & 0x1FFFU;
+	// A carry to the exponent is the correct rounding
+	if (loput > 0x1000U || (loput == 0x1000U && (h & 1U)))
+		h++;
+	return static_cast<uint16_t>(sign | h);
+}
+
+size_t formatBytes(const uint8_t format) {
+	return format == FORMAT_FLOAT ? sizeof(float) : sizeof(uint16_t);
+}
+
+// Can the data be stored as uint16 without any loss (non-negative integer counts)
+bool fitsUint16(const float* data, const size_t n) {
+	for (size_t ii = 0; ii < n; ii++) {
+		if (!(data[ii] >= 0.f && data[ii] <= 65535.f && data[ii] == std::floor(data[ii])))
+			return false;
+	}
+	return true;
+}
+
+// Are the values inside the (finite) half precision range
+bool fitsHalf(const float* data, const size_t n) {
+	for (size_t ii = 0; ii < n; ii++) {
+		if (!(std::fabs(data[ii]) <= 65504.f))
+			return false;
+	}
+	return true;
+}
+
+// The subset sensitivity images (im_dim x subsets) are stored as their sum in single precision and as the
+// ratio of each subset image to the sum in half precision. The ratios are between 0 and 1.
+void compactSensitivity(const float* Summ, const uint32_t im_dim, const uint32_t subsets, af::array& sensFull, af::array& sensRatio) {
+	std::vector<float> summa(im_dim, 0.f);
+	for (uint32_t osa_iter = 0U; osa_iter < subsets; osa_iter++) {
+		const size_t alku = static_cast<size_t>(osa_iter) * static_cast<size_t>(im_dim);
+		for (size_t ii = 0; ii < im_dim; ii++)
+			summa[ii] += Summ[alku + ii];
+	}
+	std::vector<uint16_t> suhde(static_cast<size_t>(im_dim) * static_cast<size_t>(subsets));
+	for (uint32_t osa_iter = 0U; osa_iter < subsets; osa_iter++) {
+		const size_t alku = static_cast<size_t>(osa_iter) * static_cast<size_t>(im_dim);
+		for (size_t ii = 0; ii < im_dim; ii++)
+			suhde[alku + ii] = floatToHalf(summa[ii] > 0.f ? Summ[alku + ii] / summa[ii] : 0.f);
+	}
+	sensFull = af::array(im_dim, 1, summa.data());
+	sensRatio = af::array(im_dim, subsets, suhde.data());
+}
+
+// Only non-negative values are supported, the uint16 values are exact in single precision
+af::array halfToFloat(const af::array& h) {
+	const af::array apu = h.as(f32);
+	const af::array e = af::floor(apu / 1024.f);
+	const af::array m = apu - e * 1024.f;
+	// Normal numbers (e > 0) and subnormals (e = 0)
+	return af::select(e > 0.f, (1.f + m / 1024.f) * af::pow(2.f, e - 15.f), m * 5.9604645e-8f);
+}
+
+// Write n elements of data to the buffer, starting from the element offset.
+// The compact formats are converted on the host and the write is always
+// blocking in that case since the converted data is temporary.
+cl_int writeData(cl::CommandQueue& af_queue, cl::Buffer& buffer, const float* data, const size_t n, const size_t offset, const uint8_t format,
+	const cl_bool blocking) {
+	profiler().count("bytes uploaded", static_cast<double>(n * formatBytes(format)));
+	if (format == FORMAT_FLOAT)
+		return af_queue.enqueueWriteBuffer(buffer, blocking, sizeof(float) * offset, sizeof(float) * n, data);
+	std::vector<uint16_t> apu(n);
+	if (format == FORMAT_UINT16) {
+		for (size_t ii = 0; ii < n; ii++)
+			apu[ii] = static_cast<uint16_t>(data[ii]);
+	}
+	else {
+		for (size_t ii = 0; ii < n; ii++)
+			apu[ii] = floatToHalf(data[ii]);
+	}
+	return af_queue.enqueueWriteBuffer(buffer, CL_TRUE, sizeof(uint16_t) * offset, sizeof(uint16_t) * n, apu.data());
+}
 
 
 // Update the OpenCL kernel inputs for the current iteration/subset
@@ -93,7 +196,8 @@ void OpenCLRecMethods(const RecMethods &MethodList, RecMethodsOpenCL &MethodList
 	MethodListOpenCL.PKMA = static_cast<cl_char>(MethodList.PKMA);
 }
 
-cl_int createKernels(cl::Kernel& kernel_ml, cl::Kernel & kernel, cl::Kernel& kernel_mramla, cl::Kernel& kernelNLM, cl::Kernel& kernelMed, const bool osem_bool, const cl::Program &program_os, const cl::Program& program_ml,
+cl_int createKernels(cl::Kernel& kernel_ml, cl::Kernel & kernel, cl::Kernel& kernel_mramla, cl::Kernel& kernelNLM, cl::Kernel& kernelMed, cl::Kernel& kernelL, cl::Kernel& kernelFMH, cl::Kernel& kernelTGVDual, cl::Kernel& kernelTGVPrimal, 
+	const bool osem_bool, const cl::Program &program_os, const cl::Program& program_ml,
 	const cl::Program& program_mbsrem, const RecMethods MethodList, const Weighting w_vec, const uint32_t projector_type, const bool mlem_bool, const bool precompute,
 	const uint16_t n_rays, const uint16_t n_rays3D)
 {
@@ -190,6 +294,54 @@ cl_int createKernels(cl::Kernel& kernel_ml, cl::Kernel & kernel, cl::Kernel& ker
 			mexEvalString("pause(.0001);");
 		}
 	}
+	if (MethodList.L) {
+		if (osem_bool)
+			kernelL = cl::Kernel(program_os, "lFilter3D", &status);
+		else if (mlem_bool)
+			kernelL = cl::Kernel(program_ml, "lFilter3D", &status);
+
+		if (status != CL_SUCCESS) {
+			getErrorString(status);
+			mexPrintf("Failed to create L-filter kernel\n");
+			return status;
+		}
+		else if (DEBUG) {
+			mexPrintf("L-filter kernel successfully created\n");
+			mexEvalString("pause(.0001);");
+		}
+	}
+	if (MethodList.FMH) {
+		if (osem_bool)
+			kernelFMH = cl::Kernel(program_os, "fmhFilter3D", &status);
+		else if (mlem_bool)
+			kernelFMH = cl::Kernel(program_ml, "fmhFilter3D", &status);
+
+		if (status != CL_SUCCESS) {
+			getErrorString(status);
+			mexPrintf("Failed to create FMH kernel\n");
+			return status;
+		}
+		else if (DEBUG) {
+			mexPrintf("FMH kernel successfully created\n");
+			mexEvalString("pause(.0001);");
+		}
+	}
+	if (MethodList.TGV) {
+		const cl::Program& program = osem_bool ? program_os : program_ml;
+		kernelTGVDual = cl::Kernel(program, "TGVDual", &status);
+		if (status == CL_SUCCESS)
+			kernelTGVPrimal = cl::Kernel(program, "TGVPrimal", &status);
+
+		if (status != CL_SUCCESS) {
+			getErrorString(status);
+			mexPrintf("Failed to create TGV kernels\n");
+			return status;
+		}
+		else if (DEBUG) {
+			mexPrintf("TGV kernels successfully created\n");
+			mexEvalString("pause(.0001);");
+		}
+	}
 	return status;
 }
 
@@ -204,9 +356,13 @@ cl_int createAndWriteBuffers(cl::Buffer& d_x, cl::Buffer& d_y, cl::Buffer& d_z,
 	cl::Buffer& d_lor_mlem, cl::Buffer& d_L_mlem, cl::Buffer& d_zindex_mlem, cl::Buffer& d_xyindex_mlem, cl::Buffer& d_Sino_mlem, cl::Buffer& d_sc_ra_mlem, cl::Buffer& d_reko_type, 
 	cl::Buffer& d_reko_type_mlem, const bool osem_bool,	const bool mlem_bool, const size_t koko, const uint8_t* reko_type, const uint8_t* reko_type_mlem, const uint32_t n_rekos, 
 	const uint32_t n_rekos_mlem, cl::Buffer& d_norm_mlem, cl::Buffer& d_scat_mlem, const float* angles, const bool TOF, const int64_t nBins, const bool loadTOF, cl::Buffer& d_TOFCenter, 
-	const float* TOFCenter, const uint32_t subsetsUsed, const uint32_t osa_iter0, const uint8_t listmode, const bool CT)
+	const float* TOFCenter, const uint32_t subsetsUsed, const uint32_t osa_iter0, const uint8_t listmode, const bool CT, const uint8_t sino_format,
+	const uint8_t corr_format)
 {
 	cl_int status = CL_SUCCESS;
+	// Bytes per element of the measurement and correction data on the device
+	const size_t sino_bytes = formatBytes(sino_format);
+	const size_t corr_bytes = formatBytes(corr_format);
 	// Create the necessary buffers
 	// Detector coordinates
 	d_V = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * size_V, NULL, &status);
@@ -286,20 +442,20 @@ cl_int createAndWriteBuffers(cl::Buffer& d_x, cl::Buffer& d_y, cl::Buffer& d_z,
 				return status;
 			}
 			if (size_norm > 1) {
-				d_norm[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * length[kk], NULL, &status);
+				d_norm[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, corr_bytes * length[kk], NULL, &status);
 			}
 			else {
-				d_norm[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float), NULL, &status);
+				d_norm[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, corr_bytes, NULL, &status);
 			}
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return status;
 			}
 			if (size_scat > 1) {
-				d_scat[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * length[kk], NULL, &status);
+				d_scat[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, corr_bytes * length[kk], NULL, &status);
 			}
 			else {
-				d_scat[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float), NULL, &status);
+				d_scat[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, corr_bytes, NULL, &status);
 			}
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
@@ -308,23 +464,23 @@ cl_int createAndWriteBuffers(cl::Buffer& d_x, cl::Buffer& d_y, cl::Buffer& d_z,
 			// Measurement data
 			if (TOF) {
 				if (loadTOF) {
-					d_Sino[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * length[kk] * nBins, NULL, &status);
+					d_Sino[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sino_bytes * length[kk] * nBins, NULL, &status);
 				}
 				else {
 					if (kk == 0)
-						d_Sino[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * length[kk] * nBins, NULL, &status);
+						d_Sino[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sino_bytes * length[kk] * nBins, NULL, &status);
 				}
 			}
 			else
-				d_Sino[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * length[kk], NULL, &status);
+				d_Sino[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sino_bytes * length[kk], NULL, &status);
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return status;
 			}
 			if (randoms_correction == 1u)
-				d_sc_ra[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * length[kk], NULL, &status);
+				d_sc_ra[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, corr_bytes * length[kk], NULL, &status);
 			else
-				d_sc_ra[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float), NULL, &status);
+				d_sc_ra[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, corr_bytes, NULL, &status);
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return status;
@@ -399,29 +555,29 @@ cl_int createAndWriteBuffers(cl::Buffer& d_x, cl::Buffer& d_y, cl::Buffer& d_z,
 		}
 		// Measurement data
 		if (TOF && listmode != 2)
-			d_Sino_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * koko * nBins, NULL, &status);
+			d_Sino_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, sino_bytes * koko * nBins, NULL, &status);
 		else if (listmode != 2)
-			d_Sino_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * koko, NULL, &status);
+			d_Sino_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, sino_bytes * koko, NULL, &status);
 		else
-			d_Sino_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float), NULL, &status);
+			d_Sino_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, sino_bytes, NULL, &status);
 		if (status != CL_SUCCESS) {
 			getErrorString(status);
 			return status;
 		}
-		d_norm_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * size_norm, NULL, &status);
+		d_norm_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, corr_bytes * size_norm, NULL, &status);
 		if (status != CL_SUCCESS) {
 			getErrorString(status);
 			return status;
 		}
-		d_scat_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * size_scat, NULL, &status);
+		d_scat_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, corr_bytes * size_scat, NULL, &status);
 		if (status != CL_SUCCESS) {
 			getErrorString(status);
 			return status;
 		}
 		if (randoms_correction == 1u)
-			d_sc_ra_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * koko, NULL, &status);
+			d_sc_ra_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, corr_bytes * koko, NULL, &status);
 		else
-			d_sc_ra_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float), NULL, &status);
+			d_sc_ra_mlem = cl::Buffer(af_context, CL_MEM_READ_ONLY, corr_bytes, NULL, &status);
 		if (status != CL_SUCCESS) {
 			getErrorString(status);
 			return status;
@@ -619,20 +775,20 @@ cl_int createAndWriteBuffers(cl::Buffer& d_x, cl::Buffer& d_y, cl::Buffer& d_z,
 				return status;
 			}
 			if (size_norm > 1ULL) {
-				status = af_queue.enqueueWriteBuffer(d_norm[kk], CL_FALSE, 0, sizeof(float) * length[kk], &norm[pituus[kk]]);
+				status = writeData(af_queue, d_norm[kk], &norm[pituus[kk]], length[kk], 0, corr_format);
 			}
 			else {
-				status = af_queue.enqueueWriteBuffer(d_norm[kk], CL_FALSE, 0, sizeof(float) * size_norm, norm);
+				status = writeData(af_queue, d_norm[kk], norm, size_norm, 0, corr_format);
 			}
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return status;
 			}
 			if (size_scat > 1ULL) {
-				status = af_queue.enqueueWriteBuffer(d_scat[kk], CL_FALSE, 0, sizeof(float) * length[kk], &scat[pituus[kk]]);
+				status = writeData(af_queue, d_scat[kk], &scat[pituus[kk]], length[kk], 0, corr_format);
 			}
 			else {
-				status = af_queue.enqueueWriteBuffer(d_scat[kk], CL_FALSE, 0, sizeof(float) * size_scat, scat);
+				status = writeData(af_queue, d_scat[kk], scat, size_scat, 0, corr_format);
 			}
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
@@ -648,17 +804,17 @@ cl_int createAndWriteBuffers(cl::Buffer& d_x, cl::Buffer& d_y, cl::Buffer& d_z,
 			if (TOF) {
 				if (loadTOF) {
 					for (int64_t to = 0LL; to < nBins; to++)
-						status = af_queue.enqueueWriteBuffer(d_Sino[kk], CL_FALSE, sizeof(float) * length[kk] * to, sizeof(float) * length[kk], &Sin[pituus[kk] + koko * to]);
+						status = writeData(af_queue, d_Sino[kk], &Sin[pituus[kk] + koko * to], length[kk], length[kk] * to, sino_format);
 				}
 				else {
 					if (kk == osa_iter0) {
 						for (int64_t to = 0LL; to < nBins; to++)
-							status = af_queue.enqueueWriteBuffer(d_Sino[kk], CL_FALSE, sizeof(float) * length[kk] * to, sizeof(float) * length[kk], &Sin[pituus[kk] + koko * to]);
+							status = writeData(af_queue, d_Sino[kk], &Sin[pituus[kk] + koko * to], length[kk], length[kk] * to, sino_format);
 					}
 				}
 			}
 			else if (listmode != 2)
-				status = af_queue.enqueueWriteBuffer(d_Sino[kk], CL_FALSE, 0, sizeof(float) * length[kk], &Sin[pituus[kk]]);
+				status = writeData(af_queue, d_Sino[kk], &Sin[pituus[kk]], length[kk], 0, sino_format);
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return status;
@@ -669,9 +825,9 @@ cl_int createAndWriteBuffers(cl::Buffer& d_x, cl::Buffer& d_y, cl::Buffer& d_z,
 			float* apu = (float*)mxGetData(mxGetCell(sc_ra, 0));
 #endif
 			if (randoms_correction)
-				status = af_queue.enqueueWriteBuffer(d_sc_ra[kk], CL_FALSE, 0, sizeof(float) * length[kk], &apu[pituus[kk]]);
+				status = writeData(af_queue, d_sc_ra[kk], &apu[pituus[kk]], length[kk], 0, corr_format);
 			else
-				status = af_queue.enqueueWriteBuffer(d_sc_ra[kk], CL_FALSE, 0, sizeof(float), apu);
+				status = writeData(af_queue, d_sc_ra[kk], apu, 1, 0, corr_format);
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return status;
@@ -703,19 +859,19 @@ cl_int createAndWriteBuffers(cl::Buffer& d_x, cl::Buffer& d_y, cl::Buffer& d_z,
 			return status;
 		}
 		if (TOF)
-			status = af_queue.enqueueWriteBuffer(d_Sino_mlem, CL_FALSE, 0, sizeof(float) * koko * nBins, Sin);
+			status = writeData(af_queue, d_Sino_mlem, Sin, koko * nBins, 0, sino_format);
 		else if (listmode != 2)
-			status = af_queue.enqueueWriteBuffer(d_Sino_mlem, CL_FALSE, 0, sizeof(float) * koko, Sin);
+			status = writeData(af_queue, d_Sino_mlem, Sin, koko, 0, sino_format);
 		if (status != CL_SUCCESS) {
 			getErrorString(status);
 			return status;
 		}
-		status = af_queue.enqueueWriteBuffer(d_norm_mlem, CL_FALSE, 0, sizeof(float) * size_norm, norm);
+		status = writeData(af_queue, d_norm_mlem, norm, size_norm, 0, corr_format);
 		if (status != CL_SUCCESS) {
 			getErrorString(status);
 			return status;
 		}
-		status = af_queue.enqueueWriteBuffer(d_scat_mlem, CL_FALSE, 0, sizeof(float) * size_scat, scat);
+		status = writeData(af_queue, d_scat_mlem, scat, size_scat, 0, corr_format);
 		if (status != CL_SUCCESS) {
 			getErrorString(status);
 			return status;
@@ -726,9 +882,9 @@ cl_int createAndWriteBuffers(cl::Buffer& d_x, cl::Buffer& d_y, cl::Buffer& d_z,
 		float* apu = (float*)mxGetData(mxGetCell(sc_ra, 0));
 #endif
 		if (randoms_correction)
-			status = af_queue.enqueueWriteBuffer(d_sc_ra_mlem, CL_FALSE, 0, sizeof(float) * koko, apu);
+			status = writeData(af_queue, d_sc_ra_mlem, apu, koko, 0, corr_format);
 		else
-			status = af_queue.enqueueWriteBuffer(d_sc_ra_mlem, CL_FALSE, 0, sizeof(float), apu);
+			status = writeData(af_queue, d_sc_ra_mlem, apu, 1, 0, corr_format);
 		if (status != CL_SUCCESS) {
 			getErrorString(status);
 			return status;
@@ -1367,7 +1523,8 @@ cl_int createProgram(const bool verbose, const char* k_path, cl::Context& af_con
 	const uint32_t normalization_correction, const int32_t dec, const size_t local_size, const uint16_t n_rays, const uint16_t n_rays3D, 
 	const bool find_lors, const RecMethods MethodList, const bool osem_bool, const bool mlem_bool, const uint32_t n_rekos, const uint32_t n_rekos_mlem, 
 	const Weighting& w_vec, const uint32_t osa_iter0, const float cr_pz, const float dx, const bool use_psf, const uint32_t scatter, const uint32_t randoms_correction, 
-	const bool TOF, const int64_t nBins, const uint8_t listmode, const bool CT) {
+	const bool TOF, const int64_t nBins, const uint8_t listmode, const bool CT, const uint32_t local_bins, const uint8_t sino_format,
+	const uint8_t corr_format, const bool logl) {
 
 	cl_int status = CL_SUCCESS;
 
@@ -1442,6 +1599,10 @@ cl_int createProgram(const bool verbose, const char* k_path, cl::Context& af_con
 	else if (listmode == 2)
 		options += " -DLISTMODE2";
 	options += " -DFP";
+	if (sino_format == FORMAT_UINT16)
+		options += " -DCOMPACT_SINO";
+	if (corr_format == FORMAT_HALF)
+		options += " -DCOMPACT_CORR";
 	if (projector_type == 1u && !precompute && (n_rays * n_rays3D) > 1) {
 		options += (" -DN_RAYS=" + std::to_string(n_rays * n_rays3D));
 		options += (" -DN_RAYS2D=" + std::to_string(n_rays));
@@ -1449,12 +1610,22 @@ cl_int createProgram(const bool verbose, const char* k_path, cl::Context& af_con
 	}
 	if (find_lors)
 		options += " -DFIND_LORS";
-	if (MethodList.MRP) {
-		options += " -DMEDIAN";
+	if (MethodList.MRP || MethodList.L || MethodList.FMH) {
+		if (MethodList.MRP)
+			options += " -DMEDIAN";
+		if (MethodList.L)
+			options += " -DL_FILTER";
+		if (MethodList.FMH)
+			options += " -DFMH_";
 		options += (" -DSEARCH_WINDOW_X=" + std::to_string(w_vec.Ndx));
 		options += (" -DSEARCH_WINDOW_Y=" + std::to_string(w_vec.Ndy));
 		options += (" -DSEARCH_WINDOW_Z=" + std::to_string(w_vec.Ndz));
 	}
+	if (MethodList.TGV) {
+		options += " -DTGV_";
+		if (w_vec.TGVHalf)
+			options += " -DTGV_HALF";
+	}
 	//if (projector_type == 1u && use_psf && (precompute || (n_rays * n_rays3D) == 1)) {
 	//	options += " -DORTH";
 	//	options += " -DCRYSTZ";
@@ -1467,9 +1638,15 @@ cl_int createProgram(const bool verbose, const char* k_path, cl::Context& af_con
 	if (MethodList.NLM) {
 		options += " -DNLM_";
 	}
+	// Work-group aggregated backprojection (not used with the prepass phase program)
+	std::string lbp_options = "";
+	if (local_bins > 0U) {
+		lbp_options += " -DLOCAL_BP";
+		lbp_options += (" -DLOCAL_BINS=" + std::to_string(local_bins));
+	}
 	// Build subset-based program
 	if (osem_bool) {
-		std::string os_options = options;
+		std::string os_options = options + lbp_options;
 		if ((projector_type == 2 || projector_type == 3u || TOF) && dec > 0)
 			os_options += (" -DDEC=" + std::to_string(dec));
 		os_options += (" -DN_REKOS=" + std::to_string(n_rekos));
@@ -1482,13 +1659,16 @@ cl_int createProgram(const bool verbose, const char* k_path, cl::Context& af_con
 			os_options += " -DMRAMLA";
 		if (MethodList.COSEM || MethodList.ACOSEM || MethodList.OSLCOSEM > 0u || MethodList.ECOSEM)
 			os_options += " -DCOSEM";
+		// Log-likelihood of each LOR, output as the last kernel argument
+		if (logl)
+			os_options += " -DLOGL";
 
 		//status = buildProgram(verbose, k_path, af_context, af_device_id, program_os, atomic_64bit, os_options);
 		status = buildProgram(verbose, content, af_context, af_device_id, program_os, atomic_64bit, atomic_32bit, os_options);
 	}
 	// Build MLEM (non subset) program
 	if (mlem_bool) {
-		std::string ml_options = options;
+		std::string ml_options = options + lbp_options;
 		if ((projector_type == 2 || projector_type == 3u || TOF) && dec > 0)
 			ml_options += (" -DDEC=" + std::to_string(dec));
 		ml_options += (" -DN_REKOS=" + std::to_string(n_rekos_mlem));
@@ -1741,4 +1921,105 @@ af::array NLM(const af::array& im, Weighting& w_vec, const float epps, const uin
 		grad = W;
 	af::sync();
 	return grad;
-}
\ No newline at end of file
+}
+
+// Builds the custom prior kernel from the user's OpenCL source file. The
+// file needs to contain the kernel
+// __kernel void customPrior(__global float* grad, const __global float* im, const uint Nx, const uint Ny, const uint Nz,
+//	const float epps, __constant float* param, const uint nParam)
+// which is run with a global size of Nx x Ny x Nz and stores the gradient of
+// the prior at the image im into grad
+cl_int createCustomPriorKernel(const bool verbose, const char* fileName, const float* param, const uint32_t nParam, cl::Context& af_context,
+	kernelStruct& OpenCLStruct) {
+	cl_int status = CL_SUCCESS;
+	std::ifstream sourceFile(fileName);
+	if (!sourceFile.good()) {
+		mexPrintf("Could not open the custom prior kernel file %s\n", fileName);
+		return -1;
+	}
+	std::string content((std::istreambuf_iterator<char>(sourceFile)), std::istreambuf_iterator<char>());
+	std::vector<std::string> testi;
+	testi.push_back(content);
+	cl::Program::Sources source(testi);
+	cl::Program program(af_context, source);
+	status = program.build("-cl-single-precision-constant");
+	if (status != CL_SUCCESS) {
+		mexPrintf("Failed to build the custom prior program.\n");
+		std::vector<cl::Device> dev;
+		af_context.getInfo(CL_CONTEXT_DEVICES, &dev);
+		for (int ll = 0; ll < dev.size(); ll++) {
+			cl_build_status status = program.getBuildInfo<CL_PROGRAM_BUILD_STATUS>(dev[ll]);
+			if (status != CL_BUILD_ERROR)
+				continue;
+			std::string name = dev[ll].getInfo<CL_DEVICE_NAME>();
+			std::string buildlog = program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(dev[ll]);
+			mexPrintf("Build log for %s:\n %s", name.c_str(), buildlog.c_str());
+		}
+		return status;
+	}
+	else if (verbose) {
+		mexPrintf("Custom prior program built\n");
+		mexEvalString("pause(.0001);");
+	}
+	OpenCLStruct.kernelCustom = cl::Kernel(program, "customPrior", &status);
+	if (status != CL_SUCCESS) {
+		getErrorString(status);
+		mexPrintf("Failed to create the customPrior kernel\n");
+		return status;
+	}
+	// The parameter buffer always contains at least one element
+	OpenCLStruct.nCustomParam = nParam;
+	OpenCLStruct.d_customParam = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * std::max(nParam, 1U), NULL, &status);
+	if (status != CL_SUCCESS) {
+		getErrorString(status);
+		return status;
+	}
+	if (nParam > 0U)
+		status = (*OpenCLStruct.af_queue).enqueueWriteBuffer(OpenCLStruct.d_customParam, CL_TRUE, 0, sizeof(float) * nParam, param);
+	else
+		status = (*OpenCLStruct.af_queue).enqueueFillBuffer(OpenCLStruct.d_customParam, 0.f, 0, sizeof(float));
+	if (status != CL_SUCCESS) {
+		getErrorString(status);
+		mexPrintf("Failed to write the custom prior parameters\n");
+	}
+	return status;
+}
+
+// Gradient of the custom prior, computed with the kernel built by
+// createCustomPriorKernel
+af::array customPrior(const af::array& im, const float epps, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const kernelStruct& OpenCLStruct)
+{
+	cl_int status = CL_SUCCESS;
+	af::array grad = af::constant(0.f, Nx * Ny * Nz, 1);
+	af::array input = im.copy();
+	cl::Buffer d_grad = cl::Buffer(*grad.device<cl_mem>(), true);
+	cl::Buffer d_input = cl::Buffer(*input.device<cl_mem>(), true);
+	af::sync();
+	cl::Kernel kernelCustom(OpenCLStruct.kernelCustom);
+	cl_uint kernelIndCustom = 0U;
+	kernelCustom.setArg(kernelIndCustom++, d_grad);
+	kernelCustom.setArg(kernelIndCustom++, d_input);
+	kernelCustom.setArg(kernelIndCustom++, Nx);
+	kernelCustom.setArg(kernelIndCustom++, Ny);
+	kernelCustom.setArg(kernelIndCustom++, Nz);
+	kernelCustom.setArg(kernelIndCustom++, epps);
+	kernelCustom.setArg(kernelIndCustom++, OpenCLStruct.d_customParam);
+	kernelCustom.setArg(kernelIndCustom++, OpenCLStruct.nCustomParam);
+	status = (*OpenCLStruct.af_queue).enqueueNDRangeKernel(kernelCustom, cl::NullRange, cl::NDRange(Nx, Ny, Nz));
+	if (status != CL_SUCCESS) {
+		getErrorString(status);
+		mexPrintf("Failed to launch the custom prior kernel\n");
+		mexEvalString("pause(.0001);");
+	}
+
+	status = (*OpenCLStruct.af_queue).finish();
+	if (status != CL_SUCCESS) {
+		getErrorString(status);
+		mexPrintf("Queue finish failed after kernel\n");
+		mexEvalString("pause(.0001);");
+	}
+	grad.unlock();
+	input.unlock();
+	af::sync();
+	return grad;
+}
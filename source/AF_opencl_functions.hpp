@@ -18,6 +18,7 @@
 ***************************************************************************/
 #pragma once
 #include "functions.hpp"
+#include "profiler.h"
 
 #pragma pack(1)
 
@@ -37,6 +38,30 @@ typedef struct _RecMethodsOpenCL {
 	cl_char OSLMLEM, OSLOSEM, MBSREM, BSREM, ROSEMMAP, RBIOSL, OSLCOSEM, PKMA;
 } RecMethodsOpenCL;
 
+// Device storage formats of the measurement and correction data
+#define FORMAT_FLOAT 0U
+#define FORMAT_UINT16 1U
+#define FORMAT_HALF 2U
+
+// Bytes per element in the selected storage format
+size_t formatBytes(const uint8_t format);
+
+// Can the data be stored as uint16 counts without any loss
+bool fitsUint16(const float* data, const size_t n);
+
+// Are the values inside the half precision range
+bool fitsHalf(const float* data, const size_t n);
+
+// Compact form of the subset sensitivity images, the sum image and the subset ratios (half precision bits)
+void compactSensitivity(const float* Summ, const uint32_t im_dim, const uint32_t subsets, af::array& sensFull, af::array& sensRatio);
+
+// Convert half precision values stored as uint16 to single precision
+af::array halfToFloat(const af::array& h);
+
+// Write float data to a device buffer in the selected storage format
+cl_int writeData(cl::CommandQueue& af_queue, cl::Buffer& buffer, const float* data, const size_t n, const size_t offset, const uint8_t format,
+	const cl_bool blocking = CL_FALSE);
+
 // Update the OpenCL inputs for the current iteration/subset
 void update_opencl_inputs(AF_im_vectors& vec, OpenCL_im_vectors& vec_opencl, const bool mlem, const uint32_t im_dim, const uint32_t n_rekos,
 	const uint32_t n_rekos_mlem, const RecMethods MethodList, const bool atomic_64bit, const bool atomic_32bit, const bool use_psf, const uint32_t nMAPOS);
@@ -52,7 +77,8 @@ void OpenCLRecMethods(const RecMethods &MethodList, RecMethodsOpenCL &MethodList
 // Load the OpenCL binary and create an OpenCL program from it
 //cl_int CreateProgramFromBinary(cl_context af_context, cl_device_id af_device_id, FILE *fp, cl_program &program);
 
-cl_int createKernels(cl::Kernel& kernel_ml, cl::Kernel& kernel, cl::Kernel& kernel_mramla, cl::Kernel& kernelNLM, cl::Kernel& kernelMed, const bool osem_bool, const cl::Program& program_os, const cl::Program& program_ml,
+cl_int createKernels(cl::Kernel& kernel_ml, cl::Kernel& kernel, cl::Kernel& kernel_mramla, cl::Kernel& kernelNLM, cl::Kernel& kernelMed, cl::Kernel& kernelL, cl::Kernel& kernelFMH, cl::Kernel& kernelTGVDual, cl::Kernel& kernelTGVPrimal, 
+	const bool osem_bool, const cl::Program& program_os, const cl::Program& program_ml,
 	const cl::Program& program_mbsrem, const RecMethods MethodList, const Weighting w_vec, const uint32_t projector_type, const bool mlem_bool, const bool precompute,
 	const uint16_t n_rays, const uint16_t n_rays3D);
 
@@ -67,7 +93,8 @@ cl_int createAndWriteBuffers(cl::Buffer& d_x, cl::Buffer& d_y, cl::Buffer& d_z,
 	cl::Buffer& d_lor_mlem,	cl::Buffer& d_L_mlem, cl::Buffer& d_zindex_mlem, cl::Buffer& d_xyindex_mlem, cl::Buffer& d_Sino_mlem, cl::Buffer& d_sc_ra_mlem, cl::Buffer& d_reko_type, 
 	cl::Buffer& d_reko_type_mlem, const bool osem_bool,	const bool mlem_bool, const size_t koko, const uint8_t* reko_type, const uint8_t* reko_type_mlem, const uint32_t n_rekos, 
 	const uint32_t n_rekos_mlem, cl::Buffer& d_norm_mlem, cl::Buffer& d_scat_mlem, const float* angles, const bool TOF, const int64_t nBins, const bool loadTOF, cl::Buffer& d_TOFCenter, 
-	const float* TOFCenter, const uint32_t subsetsUsed, const uint32_t osa_iter0, const uint8_t listmode = 0, const bool CT = false);
+	const float* TOFCenter, const uint32_t subsetsUsed, const uint32_t osa_iter0, const uint8_t listmode = 0, const bool CT = false,
+	const uint8_t sino_format = FORMAT_FLOAT, const uint8_t corr_format = FORMAT_FLOAT);
 
 // Prepass phase for MRAMLA, MBSREM, COSEM, ACOSEM, ECOSEM, RBI
 void MRAMLA_prepass(const uint32_t subsets, const uint32_t im_dim, const int64_t* pituus, const std::vector<cl::Buffer>& lor, const std::vector<cl::Buffer>& zindex,
@@ -91,10 +118,14 @@ cl_int createProgram(const bool verbose, const char* k_path, cl::Context& af_con
 	const uint32_t normalization_correction, const int32_t dec, const size_t local_size, const uint16_t n_rays, const uint16_t n_rays3D,
 	const bool find_lors, const RecMethods MethodList, const bool osem_bool, const bool mlem_bool, const uint32_t n_rekos, const uint32_t n_rekos_mlem,
 	const Weighting& w_vec, const uint32_t osa_iter0, const float cr_pz, const float dx, const bool use_psf, const uint32_t scatter, const uint32_t randoms_correction,
-	const bool TOF, const int64_t nBins, const uint8_t listmode = 0, const bool CT = false);
+	const bool TOF, const int64_t nBins, const uint8_t listmode = 0, const bool CT = false, const uint32_t local_bins = 0U,
+	const uint8_t sino_format = FORMAT_FLOAT, const uint8_t corr_format = FORMAT_FLOAT, const bool logl = false);
 
 cl_int buildProgram(const bool verbose, std::string content, cl::Context& af_context, cl::Device& af_device_id, cl::Program& program,
 	bool& atomic_64bit, const bool atomic_32bit, std::string options);
+
+cl_int createCustomPriorKernel(const bool verbose, const char* fileName, const float* param, const uint32_t nParam, cl::Context& af_context,
+	kernelStruct& OpenCLStruct);
 //cl_int buildProgram(const bool verbose, const char* k_path, cl::Context& af_context, cl::Device& af_device_id, cl::Program& program,
 //	bool& atomic_64bit, std::string options);
 
@@ -24,6 +24,7 @@
 * along with this program. If not, see <https://www.gnu.org/licenses/>.
 ***************************************************************************/
 #include "AF_opencl_functions.hpp"
+#include "profilerMex.h"
 
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray*prhs[]) {
@@ -33,8 +34,8 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray*prhs[]) {
 	else if (nrhs > 75)
 		mexErrMsgTxt("Too many input arguments.  There can be at most 75.");
 
-	if (nlhs != 1)
-		mexErrMsgTxt("Invalid number of output arguments.  There must be exactly one.");
+	if (nlhs < 1 || nlhs > 2)
+		mexErrMsgTxt("Invalid number of output arguments.  There must be one or two.");
 
 	int ind = 0;
 	// Load the input arguments
@@ -434,6 +435,10 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray*prhs[]) {
 		//		mexEvalString("pause(.0001);");
 		//	}
 		//}
+		// The profiling events are output as the second output
+		if (nlhs > 1)
+			profiler().start();
+
 		try {
 
 			reconstruction_AF_matrixfree(koko, lor1, z_det, x, y, Sin, sc_ra, Nx, Ny, Nz, Niter, options, dx, dy, dz, bx, by, bz, bzb, maxxx, maxyy, zmax,
@@ -446,12 +451,17 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray*prhs[]) {
 
 
 			plhs[0] = cell_array_ptr;
+			if (nlhs > 1) {
+				plhs[1] = profilerOutput();
+				profiler().stop();
+			}
 
 			// Clear ArrayFire memory
 			af::deviceGC();
 		}
 		catch (const std::exception& e) {
 			af::deviceGC();
+			profiler().stop();
 			mexErrMsgTxt(e.what());
 		}
 	}
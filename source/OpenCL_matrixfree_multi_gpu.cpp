@@ -32,6 +32,13 @@
 
 
 void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]) {
+	// The forward/backward projection session is released when the MEX-file
+	// is cleared or when called without any input arguments
+	mexAtExit(releaseFBSession);
+	if (nrhs == 0) {
+		releaseFBSession();
+		return;
+	}
 	// Check for the number of input and output arguments
 	if (nrhs < 38)
 		mexErrMsgTxt("Too few input arguments.  There must be at least 38.");
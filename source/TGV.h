@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static void setThreads() {
+#ifdef _OPENMP
+	if (omp_get_max_threads() == 1) {
+		int n_threads = std::thread::hardware_concurrency();
+		omp_set_num_threads(n_threads);
+	}
+#endif
+}
+
+// TGV prior with fused primal-dual iterations (same as TGV.m). Each iteration is two passes over the image, the dual
+// variables (p, q) are updated and projected in the first and the primal variables (grad, v) and their leading points
+// in the second. All the state is updated in place. T is the storage type of the state (double or float), the
+// computations are done in double precision
+template <typename T>
+void TGV(double* grad, const double* im, const uint32_t maxits, const double alpha, const double beta, const uint32_t Nx, const uint32_t Ny,
+	const uint32_t Nz) {
+
+	setThreads();
+
+	const int64_t NX = static_cast<int64_t>(Nx);
+	const int64_t NY = static_cast<int64_t>(Ny);
+	const int64_t NZ = static_cast<int64_t>(Nz);
+	const int64_t Nxy = NX * NY;
+	const int64_t N = Nxy * NZ;
+	const bool is3D = Nz > 1;
+	// Weight of the off-diagonal element of the symmetrized derivative
+	const double c4 = is3D ? 3. : 2.;
+	const double d4 = is3D ? 6. : 2.;
+	const double sigma = 1. / 16.;
+	const double tau = 1. / 8.;
+
+	std::vector<T> ub(N, 0), p1(N, 0), p2(N, 0), p3(N, 0), q1(N, 0), q2(N, 0), q3(N, 0), q4(N, 0), v1(N, 0), v2(N, 0), v3(N, 0),
+		vb1(N, 0), vb2(N, 0), vb3(N, 0);
+	std::fill(grad, grad + N, 0.);
+
+	for (uint32_t iter = 0; iter < maxits; iter++) {
+		// Dual update, forward differences with periodic boundaries
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (int64_t n = 0; n < N; n++) {
+			const int64_t z = n / Nxy;
+			const int64_t y = (n - z * Nxy) / NX;
+			const int64_t x = n - z * Nxy - y * NX;
+			const int64_t nx = n + (x == NX - 1 ? -x : 1);
+			const int64_t ny = n + (y == NY - 1 ? -y * NX : NX);
+			const int64_t nz = n + (z == NZ - 1 ? -z * Nxy : Nxy);
+			const double u = static_cast<double>(ub[n]) + im[n];
+			const double vb1n = static_cast<double>(vb1[n]);
+			const double vb2n = static_cast<double>(vb2[n]);
+			const double vb3n = static_cast<double>(vb3[n]);
+			const double y1 = static_cast<double>(p1[n]) + sigma * (static_cast<double>(ub[nx]) + im[nx] - u - vb1n);
+			const double y2 = static_cast<double>(p2[n]) + sigma * (static_cast<double>(ub[ny]) + im[ny] - u - vb2n);
+			// In 2D the third components are not used
+			const double y3 = is3D ? static_cast<double>(p3[n]) + sigma * (static_cast<double>(ub[nz]) + im[nz] - u - vb3n) : 0.;
+			const double my = (std::max)(1., std::sqrt(y1 * y1 + y2 * y2 + y3 * y3) / beta);
+			p1[n] = static_cast<T>(y1 / my);
+			p2[n] = static_cast<T>(y2 / my);
+			p3[n] = static_cast<T>(y3 / my);
+			const double z1 = static_cast<double>(q1[n]) + sigma * (static_cast<double>(vb1[nx]) - vb1n);
+			const double z2 = static_cast<double>(q2[n]) + sigma * (static_cast<double>(vb2[ny]) - vb2n);
+			const double z3 = is3D ? static_cast<double>(q3[n]) + sigma * (static_cast<double>(vb3[nz]) - vb3n) : 0.;
+			double zeta4 = (static_cast<double>(vb1[ny]) - vb1n) + (static_cast<double>(vb2[nx]) - vb2n);
+			if (is3D)
+				zeta4 += (static_cast<double>(vb3[ny]) - vb3n) + (static_cast<double>(vb3[nx]) - vb3n) + (static_cast<double>(vb1[nz]) - vb1n) +
+					(static_cast<double>(vb2[nz]) - vb2n);
+			const double z4 = static_cast<double>(q4[n]) + sigma * zeta4 / d4;
+			const double mz = (std::max)(1., std::sqrt(z1 * z1 + z2 * z2 + z3 * z3 + c4 * z4 * z4) / alpha);
+			q1[n] = static_cast<T>(z1 / mz);
+			q2[n] = static_cast<T>(z2 / mz);
+			q3[n] = static_cast<T>(z3 / mz);
+			q4[n] = static_cast<T>(z4 / mz);
+		}
+		// Primal update, transposed differences with periodic boundaries
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+		for (int64_t n = 0; n < N; n++) {
+			const int64_t z = n / Nxy;
+			const int64_t y = (n - z * Nxy) / NX;
+			const int64_t x = n - z * Nxy - y * NX;
+			const int64_t mx = n - (x == 0 ? -(NX - 1) : 1);
+			const int64_t my = n - (y == 0 ? -(NY - 1) * NX : NX);
+			const int64_t mz = n - (z == 0 ? -(NZ - 1) * Nxy : Nxy);
+			const double p1n = static_cast<double>(p1[n]);
+			const double p2n = static_cast<double>(p2[n]);
+			const double p3n = static_cast<double>(p3[n]);
+			const double q1n = static_cast<double>(q1[n]);
+			const double q2n = static_cast<double>(q2[n]);
+			const double q3n = static_cast<double>(q3[n]);
+			const double q4n = static_cast<double>(q4[n]);
+			const double uold = grad[n];
+			const double unew = uold - tau * ((static_cast<double>(p1[mx]) - p1n) + (static_cast<double>(p2[my]) - p2n) + (static_cast<double>(p3[mz]) - p3n));
+			grad[n] = unew;
+			ub[n] = static_cast<T>(2. * unew - uold);
+			const double dxq4 = static_cast<double>(q4[mx]) - q4n;
+			const double dyq4 = static_cast<double>(q4[my]) - q4n;
+			const double dzq4 = static_cast<double>(q4[mz]) - q4n;
+			const double v1old = static_cast<double>(v1[n]);
+			const double v2old = static_cast<double>(v2[n]);
+			const double v3old = static_cast<double>(v3[n]);
+			const double v1new = v1old - tau * ((static_cast<double>(q1[mx]) - q1n) + dyq4 + dzq4 - p1n);
+			const double v2new = v2old - tau * (dxq4 + (static_cast<double>(q2[my]) - q2n) + dzq4 - p2n);
+			const double v3new = is3D ? v3old - tau * (dxq4 + dyq4 + (static_cast<double>(q3[mz]) - q3n) - p3n) : 0.;
+			v1[n] = static_cast<T>(v1new);
+			v2[n] = static_cast<T>(v2new);
+			v3[n] = static_cast<T>(v3new);
+			vb1[n] = static_cast<T>(2. * v1new - v1old);
+			vb2[n] = static_cast<T>(2. * v2new - v2old);
+			vb3[n] = static_cast<T>(2. * v3new - v3old);
+		}
+	}
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+	for (int64_t n = 0; n < N; n++)
+		grad[n] = -grad[n];
+}
@@ -1,8 +1,9 @@
-function grad = TGV(im,maxits,alpha,beta, Nx, Ny, Nz)
+function grad = TGV(im,maxits,alpha,beta, Nx, Ny, Nz, lowPrecision)
 %TGV Total Generalized Variation prior (TGV)
 %
 % Example:
 %   grad = TGV(im, maxits, alpha, beta, Nx, Ny, Nz)
+%   grad = TGV(im, maxits, alpha, beta, Nx, Ny, Nz, lowPrecision)
 % INPUTS:
 %   im = The current estimate
 %   maxits = Number of TGV iterations
@@ -11,6 +12,8 @@ function grad = TGV(im,maxits,alpha,beta, Nx, Ny, Nz)
 %   Nx = Image (estimate) size in X-direction
 %   Ny = Image (estimate) size in Y-direction
 %   Nz = Image (estimate) size in Z-direction
+%   lowPrecision = (optional) If true, the compiled version stores the TGV
+%   variables in single precision (default is false)
 %
 % OUTPUTS:
 %   grad = The gradient of TGV
@@ -38,6 +41,22 @@ function grad = TGV(im,maxits,alpha,beta, Nx, Ny, Nz)
 % along with this program. If not, see <https://www.gnu.org/licenses/>.
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
+if nargin < 8 || isempty(lowPrecision)
+    lowPrecision = false;
+end
+
+% Use the compiled (OpenMP) version if available, it computes the same
+% iterations with two fused passes per iteration
+if exist('OCTAVE_VERSION','builtin') == 0 && exist('TGV_func','file') == 3
+    grad = TGV_func(double(im(:)), uint32(maxits), double(alpha), double(beta), uint32(Nx), uint32(Ny), uint32(Nz), logical(lowPrecision));
+    grad = cast(grad, class(im));
+    return
+elseif exist('OCTAVE_VERSION','builtin') == 5 && exist('TGV_oct','file') == 3
+    grad = TGV_oct(double(im(:)), uint32(maxits), double(alpha), double(beta), uint32(Nx), uint32(Ny), uint32(Nz), logical(lowPrecision));
+    grad = cast(grad, class(im));
+    return
+end
+
 im = reshape(im, Nx, Ny, Nz);
 
 [n,m,c] = size(im);
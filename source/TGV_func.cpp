@@ -0,0 +1,68 @@
+#include "TGV.h"
+#include "mexFunktio.h"
+
+using namespace std;
+
+
+void mexFunction(int nlhs, mxArray* plhs[],
+	int nrhs, const mxArray* prhs[])
+
+{
+	// Check for the number of input and output arguments
+	if (nrhs < 8)
+		mexErrMsgTxt("Too few input arguments. There must be at least 8.");
+	else if (nrhs > 8)
+		mexErrMsgTxt("Too many input arguments. There can be at most 8.");
+
+	if (nlhs > 1 || nlhs < 1)
+		mexErrMsgTxt("Invalid number of output arguments. There can be at most one.");
+
+	int ind = 0;
+	// Load the input arguments
+
+#ifdef MX_HAS_INTERLEAVED_COMPLEX
+	const double* im = (double*)mxGetDoubles(prhs[ind]);
+#else
+	const double* im = (double*)mxGetData(prhs[ind]);
+#endif
+	ind++;
+
+	const uint32_t maxits = getScalarUInt32(prhs[ind], ind);
+	ind++;
+
+	const double alpha = getScalarDouble(prhs[ind], ind);
+	ind++;
+
+	const double beta = getScalarDouble(prhs[ind], ind);
+	ind++;
+
+	const uint32_t Nx = getScalarUInt32(prhs[ind], ind);
+	ind++;
+
+	const uint32_t Ny = getScalarUInt32(prhs[ind], ind);
+	ind++;
+
+	const uint32_t Nz = getScalarUInt32(prhs[ind], ind);
+	ind++;
+
+	// Store the TGV state in single precision
+	const bool lowPrecision = getScalarBool(prhs[ind], ind);
+	ind++;
+
+	const size_t N = static_cast<size_t>(Nx) * static_cast<size_t>(Ny) * static_cast<size_t>(Nz);
+
+	plhs[0] = mxCreateNumericMatrix(N, 1, mxDOUBLE_CLASS, mxREAL);
+
+#ifdef MX_HAS_INTERLEAVED_COMPLEX
+	double* grad = (double*)mxGetDoubles(plhs[0]);
+#else
+	double* grad = (double*)mxGetData(plhs[0]);
+#endif
+
+	if (lowPrecision)
+		TGV<float>(grad, im, maxits, alpha, beta, Nx, Ny, Nz);
+	else
+		TGV<double>(grad, im, maxits, alpha, beta, Nx, Ny, Nz);
+
+	return;
+}
@@ -0,0 +1,56 @@
+#include "TGV.h"
+#include <octave/oct.h>
+
+using namespace std;
+
+
+DEFUN_DLD(TGV_oct, prhs, nargout, "TGV") {
+
+	int ind = 0;
+	// Load the input arguments
+
+	const NDArray im_ = prhs(ind).array_value();
+	ind++;
+
+	const uint32_t maxits = prhs(ind).uint32_scalar_value();
+	ind++;
+
+	const double alpha = prhs(ind).scalar_value();
+	ind++;
+
+	const double beta = prhs(ind).scalar_value();
+	ind++;
+
+	const uint32_t Nx = prhs(ind).uint32_scalar_value();
+	ind++;
+
+	const uint32_t Ny = prhs(ind).uint32_scalar_value();
+	ind++;
+
+	const uint32_t Nz = prhs(ind).uint32_scalar_value();
+	ind++;
+
+	// Store the TGV state in single precision
+	const bool lowPrecision = prhs(ind).bool_value();
+	ind++;
+
+	const size_t N = static_cast<size_t>(Nx) * static_cast<size_t>(Ny) * static_cast<size_t>(Nz);
+
+	NDArray grad_(dim_vector(N, 1));
+
+	double* grad = grad_.fortran_vec();
+
+	const double* im = im_.fortran_vec();
+
+	if (lowPrecision)
+		TGV<float>(grad, im, maxits, alpha, beta, Nx, Ny, Nz);
+	else
+		TGV<double>(grad, im, maxits, alpha, beta, Nx, Ny, Nz);
+
+
+	octave_value_list retval(nargout);
+
+	retval(0) = octave_value(grad_);
+
+	return retval;
+}
@@ -9,12 +9,13 @@ function [bp, varargout] = backproject(options, index, n_meas, rhs, nn, iternn,
 %   index = The indices (LORs) used to compute the system matrix (you can
 %   use index_maker to produce the indices)
 %   n_meas = Number of measurements used
-%   rhs = The right hand side of the input (i.e. bp = A' * rhs)
+%   rhs = The right hand side of the input (i.e. bp = A' * rhs). Several
+%   vectors can be backprojected at once by storing one vector per column
 %   nn = The interval from where the measurements are taken (current
 %   subset)
 %
 % OUTPUTS:
-%   bp = The backprojection (bp = A' * rhs)
+%   bp = The backprojection (bp = A' * rhs), one column per input vector
 %   norm = The (optional) normalization constant (norm = sum(A,1))
 %
 % See also index_maker, forward_project
@@ -77,6 +78,49 @@ end
 if ~isfield(options,'CT')
     options.CT = false;
 end
+% The key of the cached geometry data, computed before the geometry
+% parameters are modified (an earlier key is discarded)
+options.geometry_key = '';
+options.geometry_key = geometryHash(options);
+
+% Several measurement vectors can be backprojected at once by storing one
+% vector per column of rhs. Implementation 1 handles these through the
+% (sparse) matrix product, implementations 3 and 4 use the batched
+% projectors when the projector supports them. Otherwise the vectors are
+% backprojected one at a time.
+nBatch = 1;
+if ismatrix(rhs) && size(rhs,2) > 1 && size(rhs,1) == n_meas(end) * options.TOF_bins
+    nBatch = size(rhs,2);
+    if ~isfield(options,'precompute_lor')
+        options.precompute_lor = false;
+    end
+    if ~isfield(options,'n_rays_transaxial')
+        options.n_rays_transaxial = 1;
+    end
+    if ~isfield(options,'n_rays_axial')
+        options.n_rays_axial = 1;
+    end
+    batch = options.implementation == 1 || (options.projector_type == 1 && ~TOF && ~options.listmode && ~options.CT && ...
+        ((options.implementation == 4 && ~options.precompute_lor) || ((options.implementation == 2 || options.implementation == 3) && ...
+        (options.precompute_lor || options.n_rays_transaxial * options.n_rays_axial == 1))));
+    if ~batch
+        if nargout >= 2
+            [apu, varargout{1}] = backproject(options, index, n_meas, rhs(:,1), nn, iternn, varargin{:});
+        else
+            apu = backproject(options, index, n_meas, rhs(:,1), nn, iternn, varargin{:});
+        end
+        bp = zeros(numel(apu), nBatch, class(apu));
+        bp(:,1) = apu;
+        for kk = 2 : nBatch
+            bp(:,kk) = backproject(options, index, n_meas, rhs(:,kk), nn, iternn, varargin{:});
+        end
+        return
+    end
+    if options.implementation ~= 1
+        % Measurement-interleaved layout
+        rhs = reshape(rhs.', [], 1);
+    end
+end
 
 rings = options.rings;
 Nx = options.Nx;
@@ -607,23 +651,37 @@ elseif options.implementation == 4
         LL = uint16(0);
         TOFSize = int64(numel(xy_index));
     end
-    if numel(rhs) ~= n_meas(end) * options.TOF_bins
+    if numel(rhs) ~= n_meas(end) * options.TOF_bins * nBatch
         error('Size mismatch between input vector and current measurement dimension')
     end
+    if nBatch > 1
+        Sino = ones(n_meas(end),1,'single');
+    else
+        Sino = single(rhs);
+    end
+    options.nBatch = nBatch;
     [Summ, bp] = computeImplementation4(options,use_raw_data,randoms_correction, n_meas(end),0, normalization_correction,...
         Nx, Ny, Nz, dx, dy, dz, bx, by, bz, x, y, z_det, xx, yy, size_x, NSinos, NSlices, zmax, attenuation_correction, pseudot, det_per_ring, ...
-        TOF, TOFSize, sigma_x, TOFCenter, dec, nCores, LL, lor_a, xy_index, z_index, epps, single(rhs), double(rhs), no_norm, ...
+        TOF, TOFSize, sigma_x, TOFCenter, dec, nCores, LL, lor_a, xy_index, z_index, epps, Sino, double(rhs), no_norm, ...
         x_center, y_center, z_center, bmin, bmax, Vmax, V, scatter_input, normalization, single(0), dc_z, uint8(2));
+    if nBatch > 1
+        bp = reshape(bp, nBatch, []).';
+    end
     if nargout >= 2
         varargout{1} = Summ;
     end
 else
     %     options = double_to_single(options);
-    SinM = {single(rhs)};
-    if numel(SinM{1}) ~= n_meas(end) * options.TOF_bins
+    if nBatch > 1
+        SinM = {ones(n_meas(end) * options.TOF_bins,1,'single')};
+    else
+        SinM = {single(rhs)};
+    end
+    if numel(rhs) ~= n_meas(end) * options.TOF_bins * nBatch
         error('Size mismatch between input vector and current measurement dimension')
     end
     options.implementation = 3;
+    options.nBatch = nBatch;
     [output] = computeImplementation23(options, Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx, NSinos, NSlices, size_x, zmax, ...
     LL, pseudot, det_per_ring, TOF, sigma_x, TOFCenter, dec, options.use_device, use_raw_data, normalization, n_meas, attenuation_correction, ...
     normalization_correction, 1, 1, 1e-8, lor_a, xy_index, z_index, x_center, y_center, z_center, SinDelayed, ...
@@ -633,6 +691,9 @@ else
     else
         bp = output{1};
     end
+    if nBatch > 1
+        bp = reshape(bp, nBatch, []).';
+    end
     if nargout >= 2
         if isa(output{2},'int64')
             varargout{1} = single(output{2}) / 100000000000;
@@ -0,0 +1,128 @@
+function acf = computeACF(options, pituus, lor_a, xy_index, z_index, LL, pseudot, det_per_ring, x, y, z_det, xx, yy, Nx, Ny, Nz, ...
+    dx, dy, dz, bx, by, bz, size_x, NSinos, NSlices, zmax, nCores, use_raw_data)
+%COMPUTEACF Computes the attenuation correction factors of all the LORs
+%   Computes the attenuation correction factor (ACF) sinogram (or ACF
+%   vector for raw data) by integrating the attenuation map once along
+%   each LOR with the improved Siddon's algorithm (implementation 4). The
+%   ACFs are in the same (subset) order as the measurement data and can be
+%   used as multiplicative normalization coefficients, i.e. the attenuation
+%   map is not needed in the projectors anymore.
+%
+%   The ACFs are saved in the mat-files folder. The filename includes a
+%   hash computed from the attenuation map and the LOR indices, thus the
+%   ACFs are recomputed only when either of these changes.
+%
+% See also set_up_corrections, attenuation_correction_factors, md5Hash
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+folder = fileparts(which('computeACF.m'));
+folder = [folder(1:end-6), 'mat-files/'];
+folder = strrep(folder, '\','/');
+
+vaimennus = double(options.vaimennus(:));
+
+% The cache key, any change in the attenuation map, image size or the
+% LOR ordering (subsets) results in a new file
+if use_raw_data
+    avain = md5Hash(vaimennus, LL, pseudot, [double(Nx) double(Ny) double(Nz) options.FOVa_x options.FOVa_y options.axial_fov ...
+        double(det_per_ring) double(options.precompute_lor)]);
+    acf_file = [folder options.machine_name '_ACF_listmode_' avain '.mat'];
+else
+    avain = md5Hash(vaimennus, xy_index, z_index, [double(Nx) double(Ny) double(Nz) options.FOVa_x options.FOVa_y options.axial_fov ...
+        double(options.precompute_lor)]);
+    acf_file = [folder options.machine_name '_ACF_' num2str(options.Ndist) 'x' num2str(options.Nang) 'x' num2str(NSinos) '_' avain '.mat'];
+end
+
+if exist(acf_file, 'file') == 2
+    acf = loadStructFromFile(acf_file, 'acf');
+    if options.verbose
+        disp(['Attenuation correction factors loaded from ' acf_file])
+    end
+    return
+end
+
+if options.verbose
+    tStart = tic;
+end
+
+koko = pituus(end);
+if options.subset_type >= 8 && options.subsets > 1
+    koko = koko * options.Nang * options.Ndist;
+end
+
+% Always use the improved Siddon (single ray) without any other corrections
+options.projector_type = 1;
+options.scatter = false;
+options.TOF_bins = 1;
+options.voxel_driven_backprojection = false;
+options.vaimennus = vaimennus;
+options.n_rays_transaxial = uint16(1);
+options.n_rays_axial = uint16(1);
+if use_raw_data
+    L_input = LL;
+    xy_index = uint32(0);
+    z_index = uint32(0);
+    TOFSize = int64(size(L_input,1));
+else
+    L_input = uint16(0);
+    if isempty(pseudot)
+        pseudot = uint32(0);
+    end
+    TOFSize = int64(numel(xy_index));
+end
+if ~options.precompute_lor
+    lor_a = uint16(0);
+end
+% Implementation 4 requires double precision
+x = double(x);
+y = double(y);
+z_det = double(z_det);
+xx = double(xx);
+yy = double(yy);
+dx = double(dx);
+dy = double(dy);
+dz = double(dz);
+bx = double(bx);
+by = double(by);
+bz = double(bz);
+zmax = double(zmax);
+if options.rings > 1
+    dc_z = z_det(2,1) - z_det(1,1);
+else
+    dc_z = options.cr_pz;
+end
+
+[~, acf] = computeImplementation4(options, use_raw_data, false, pituus(end), 0, false, Nx, Ny, Nz, dx, dy, dz, bx, by, bz, x, y, z_det, xx, yy, ...
+    size_x, NSinos, NSlices, zmax, true, pseudot, det_per_ring, false, TOFSize, 0, 0, uint32(0), nCores, L_input, lor_a, xy_index, ...
+    z_index, options.epps, zeros(koko, 1, 'single'), zeros(double(Nx) * double(Ny) * double(Nz), 1), false, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ...
+    dc_z, uint8(3));
+% LORs that do not intersect the FOV
+acf(acf == 0) = 1;
+acf = single(acf);
+
+if options.verbose
+    disp(['Attenuation correction factors computed in ' num2str(toc(tStart)) ' seconds'])
+end
+
+if exist('OCTAVE_VERSION','builtin') == 0
+    save(acf_file, 'acf', '-v7.3')
+else
+    save(acf_file, 'acf', '-v7')
+end
+end
@@ -62,7 +62,7 @@ if numel(varPrior) > 0
     elseif strcmp(varPrior{1},'APLS') && ~strcmp(varList{1},'BSREM') && ~strcmp(varList{1},'ROSEM_MAP')
         grad = TVpriorFinal(im_vectors.OSEM_apu, [], options.Nx, options.Ny, options.Nz, true, options, 5);
     elseif strcmp(varPrior{1},'TGV') && ~strcmp(varList{1},'BSREM') && ~strcmp(varList{1},'ROSEM_MAP')
-        grad = TGV(im_vectors.OSEM_apu,options.NiterTGV,options.alphaTGV,options.betaTGV, options.Nx, options.Ny, options.Nz);
+        grad = TGV(im_vectors.OSEM_apu,options.NiterTGV,options.alphaTGV,options.betaTGV, options.Nx, options.Ny, options.Nz, options.TGV_half);
     elseif strcmp(varPrior{1},'NLM') && ~strcmp(varList{1},'BSREM') && ~strcmp(varList{1},'ROSEM_MAP')
         grad = NLM(im_vectors.OSEM_apu, options.Ndx, options.Ndy, options.Ndz, options.Nlx, options.Nly, options.Nlz, ...
             options.sigma, options.epps, options.Nx, options.Ny, options.Nz, options);
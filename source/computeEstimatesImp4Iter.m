@@ -81,7 +81,7 @@ if numel(varPrior) > 0 && (strcmp(varList{1},'BSREM') || strcmp(varList{1},'ROSE
     elseif strcmp(varPrior{1},'APLS')
         grad = TVpriorFinal(im_vectors.([varApu '_apu']), [], options.Nx, options.Ny, options.Nz, true, options, 5);
     elseif strcmp(varPrior{1},'TGV')
-        grad = TGV(im_vectors.([varApu '_apu']),options.NiterTGV,options.alphaTGV,options.betaTGV, options.Nx, options.Ny, options.Nz);
+        grad = TGV(im_vectors.([varApu '_apu']),options.NiterTGV,options.alphaTGV,options.betaTGV, options.Nx, options.Ny, options.Nz, options.TGV_half);
     elseif strcmp(varPrior{1},'NLM')
         grad = NLM(im_vectors.([varApu '_apu']), options.Ndx, options.Ndy, options.Ndz, options.Nlx, options.Nly, options.Nlz, ...
             options.sigma, options.epps, options.Nx, options.Ny, options.Nz, options);
@@ -1,4 +1,4 @@
-function [pz] = computeImplementation23(options, Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx, NSinos, NSlices, size_x, zmax, ...
+function [pz, objektiivi, prof] = computeImplementation23(options, Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx, NSinos, NSlices, size_x, zmax, ...
     LL, pseudot, det_per_ring, TOF, sigma_x, TOFCenter, dec, device, use_raw_data, normalization, pituus, attenuation_correction, ...
     normalization_correction, Niter, subsets, epps, lor_a, xy_index, z_index, x_center, y_center, z_center, SinDelayed, ...
     SinM, bmin, bmax, Vmax, V, gaussK, varargin)
@@ -18,6 +18,13 @@ end
 if ~isfield(options,'use_32bit_atomics')
     options.use_32bit_atomics = false;
 end
+if ~isfield(options,'aggregate_backprojection')
+    options.aggregate_backprojection = false;
+end
+options.aggregate_backprojection = double(options.aggregate_backprojection);
+if ~isfield(options,'compact_storage')
+    options.compact_storage = false;
+end
 if isempty(varargin)
     type = 0;
 else
@@ -26,6 +33,10 @@ end
 if options.use_32bit_atomics && options.use_64bit_atomics
     options.use_32bit_atomics = false;
 end
+if ~isfield(options,'local_size')
+    options.local_size = 0;
+end
+prof = [];
 if type <= 0
     rekot = varargin{2};
     if numel(varargin) >= 3 && ~isempty(varargin{3})
@@ -256,14 +267,36 @@ if options.implementation == 2
     if options.verbose
         tStart = tic;
     end
+    if ~isfield(options,'profile')
+        options.profile = false;
+    end
+    if options.profile && options.use_CUDA
+        warning('Profiling is not supported with CUDA')
+        options.profile = false;
+    end
+    if options.profile && (~isfield(options,'profile_file') || isempty(options.profile_file))
+        options.profile_file = [options.machine_name '_' options.name '_trace.json'];
+    end
     if ~options.use_CUDA
-        [pz] = OpenCL_matrixfree( kernel_path, Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy(end), xx(end), NSinos, single(NSlices), size_x, zmax, NSinos, ...
+        % The second output is the profiling data
+        tulos = cell(1, 1 + options.profile);
+        [tulos{:}] = OpenCL_matrixfree( kernel_path, Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy(end), xx(end), NSinos, single(NSlices), size_x, zmax, NSinos, ...
             options.verbose, LL, pseudot, det_per_ring, TOF, TOFSize, sigma_x, TOFCenter, int64(options.TOF_bins), uint32(dec), device, uint8(use_raw_data), ...
             filename, uint32(0), options.use_psf, header_directory, options.vaimennus, normalization, pituus, uint32(attenuation_correction), ...
             uint32(normalization_correction), uint32(Niter), uint32(subsets), uint8(rekot), single(epps), lor_a, xy_index, z_index, any(n_rekos), tube_width_xy, ...
             crystal_size_z, x_center, y_center, z_center, SinDelayed, randoms, uint32(options.projector_type), options.precompute_lor, n_rays, n_rays3D, ...
             dc_z, options, SinM, uint32(options.partitions), logical(options.use_64bit_atomics), n_rekos, n_rekos_mlem, reko_type, reko_type_mlem, ...
             options.global_correction_factor, bmin, bmax, Vmax, V, gaussK);
+        pz = tulos{1};
+        % The trace is not saved if the caller uses the profiling data
+        % (e.g. tuneKernelParameters)
+        if options.profile
+            prof = mergeProfilingData([], tulos{2}, 0);
+            if nargout < 3
+                saveProfilingTrace(prof, options.profile_file, options.verbose);
+            end
+        end
+        clear tulos
     else
         header_directory = strrep(header_directory,'"','');
         [pz] = CUDA_matrixfree( kernel_path, Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy(end), xx(end), NSinos, single(NSlices), size_x, zmax, NSinos, ...
@@ -278,6 +311,15 @@ if options.implementation == 2
         toc(tStart)
     end
     
+    % The log-likelihood values are stored in the last row
+    if options.compute_objective && ~options.use_CUDA && ~isempty(pz{end,1})
+        objektiivi = zeros(Niter, size(pz{end,1}, 2), size(pz, 2));
+        for ll = 1 : size(pz, 2)
+            objektiivi(:,:,ll) = pz{end,ll};
+        end
+    else
+        objektiivi = [];
+    end
     pz(end,:) = [];
 else
     
@@ -328,6 +370,7 @@ else
         end
         clear tz
     end
+    objektiivi = [];
 end
 
 end
@@ -1,4 +1,4 @@
-function [Summ,rhs] = computeImplementation4(options,use_raw_data,randoms_correction, pituus,osa_iter, normalization_correction,...
+function [Summ,rhs,varargout] = computeImplementation4(options,use_raw_data,randoms_correction, pituus,osa_iter, normalization_correction,...
     Nx, Ny, Nz, dx, dy, dz, bx, by, bz, x, y, z_det, xx, yy, size_x, NSinos, NSlices, zmax, attenuation_correction, pseudot, det_per_ring, ...
     TOF, TOFSize, sigma_x, TOFCenter, dec, nCores, L_input, lor_a_input, xy_index_input, z_index_input, epps, uu, OSEM_apu, no_norm, ...
     x_center, y_center, z_center, bmin, bmax, Vmax, V, scatter_input, norm_input, SinD, dc_z, varargin)
@@ -24,6 +24,15 @@ end
 if ~isfield(options,'CT')
     options.CT = false;
 end
+if ~isfield(options,'voxel_driven_backprojection')
+    options.voxel_driven_backprojection = false;
+end
+if ~isfield(options,'orthogonal_lookup_table')
+    options.orthogonal_lookup_table = false;
+end
+if ~isfield(options,'nBatch')
+    options.nBatch = 1;
+end
 if osa_iter == 0
     koko = pituus;
 else
@@ -47,7 +56,7 @@ end
 if options.projector_type == 1
     if options.CT
         if exist('OCTAVE_VERSION','builtin') == 0
-            [Summ, rhs] = projector_mexCT( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
+            [Summ, rhs, varargout{1:nargout-2}] = projector_mexCT( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
                 norm_input, SinD, koko, attenuation_correction, normalization_correction, randoms_correction,...
                 options.scatter, scatter_input, options.global_correction_factor, lor_a_input, xy_index_input, z_index_input, NSinos, L_input, pseudot, det_per_ring, ...
                 TOF, TOFSize, sigma_x, TOFCenter, int64(options.TOF_bins), dec, options.verbose, nCores, ...
@@ -55,7 +64,7 @@ if options.projector_type == 1
                 options.n_rays_transaxial, options.n_rays_axial, dc_z, uint32(options.subsets), options.angles, uint32(options.xSize), options.dPitch, ...
                 int64(numel(options.angles)));
         elseif exist('OCTAVE_VERSION','builtin') == 5
-            [Summ, rhs] = projector_octCT( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
+            [Summ, rhs, varargout{1:nargout-2}] = projector_octCT( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
                 norm_input, SinD, koko, attenuation_correction, normalization_correction, randoms_correction,...
                 options.scatter, scatter_input, options.global_correction_factor, lor_a_input, xy_index_input, z_index_input, NSinos, L_input, pseudot, det_per_ring, ...
                 TOF, TOFSize, sigma_x, TOFCenter, int64(options.TOF_bins), dec, options.verbose, nCores, ...
@@ -65,19 +74,19 @@ if options.projector_type == 1
         end
     else
         if exist('OCTAVE_VERSION','builtin') == 0
-            [Summ, rhs] = projector_mex( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
+            [Summ, rhs, varargout{1:nargout-2}] = projector_mex( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
                 norm_input, SinD, koko, attenuation_correction, normalization_correction, randoms_correction,...
                 options.scatter, scatter_input, options.global_correction_factor, lor_a_input, xy_index_input, z_index_input, NSinos, L_input, pseudot, det_per_ring, ...
                 TOF, TOFSize, sigma_x, TOFCenter, int64(options.TOF_bins), dec, options.verbose, nCores, ...
                 (use_raw_data), uint32(1), options.listmode, epps, uu, OSEM_apu, uint32(options.projector_type), no_norm, options.precompute_lor, tyyppi, ...
-                options.n_rays_transaxial, options.n_rays_axial, dc_z);
+                options.n_rays_transaxial, options.n_rays_axial, dc_z, logical(options.voxel_driven_backprojection), uint32(options.nBatch));
         elseif exist('OCTAVE_VERSION','builtin') == 5
-            [Summ, rhs] = projector_oct( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
+            [Summ, rhs, varargout{1:nargout-2}] = projector_oct( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
                 norm_input, SinD, koko, attenuation_correction, normalization_correction, randoms_correction,...
                 options.scatter, scatter_input, options.global_correction_factor, lor_a_input, xy_index_input, z_index_input, NSinos, L_input, pseudot, det_per_ring, ...
                 TOF, TOFSize, sigma_x, TOFCenter, int64(options.TOF_bins), dec, options.verbose, nCores, ...
                 (use_raw_data), uint32(1), options.listmode, epps, uu, OSEM_apu, uint32(options.projector_type), no_norm, options.precompute_lor, tyyppi, ...
-                options.n_rays_transaxial, options.n_rays_axial, dc_z);
+                options.n_rays_transaxial, options.n_rays_axial, dc_z, logical(options.voxel_driven_backprojection), uint32(options.nBatch));
         end
     end
 elseif options.projector_type == 2
@@ -85,25 +94,25 @@ elseif options.projector_type == 2
         error('Unsupported projector!')
     else
         if exist('OCTAVE_VERSION','builtin') == 0
-            [Summ, rhs] = projector_mex( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
+            [Summ, rhs, varargout{1:nargout-2}] = projector_mex( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
                 norm_input, SinD, koko, attenuation_correction, normalization_correction, randoms_correction,...
                 options.scatter, scatter_input, options.global_correction_factor, lor_a_input, xy_index_input, z_index_input, NSinos, L_input, pseudot, det_per_ring, ...
                 TOF, TOFSize, sigma_x, TOFCenter, int64(options.TOF_bins), dec, options.verbose, nCores, ...
                 (use_raw_data), uint32(1), options.listmode, epps, uu, OSEM_apu, uint32(options.projector_type), no_norm, options.precompute_lor, tyyppi, ...
-                options.tube_width_xy, x_center, y_center, z_center, options.tube_width_z);
+                options.tube_width_xy, x_center, y_center, z_center, options.tube_width_z, logical(options.orthogonal_lookup_table));
         elseif exist('OCTAVE_VERSION','builtin') == 5
-            [Summ, rhs] = projector_oct( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
+            [Summ, rhs, varargout{1:nargout-2}] = projector_oct( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
                 norm_input, SinD, koko, attenuation_correction, normalization_correction, randoms_correction,...
                 options.scatter, scatter_input, options.global_correction_factor, lor_a_input, xy_index_input, z_index_input, NSinos, L_input, pseudot, det_per_ring, ...
                 TOF, TOFSize, sigma_x, TOFCenter, int64(options.TOF_bins), dec, options.verbose, nCores, ...
                 (use_raw_data), uint32(1), options.listmode, epps, uu, OSEM_apu, uint32(options.projector_type), no_norm, options.precompute_lor, tyyppi, ...
-                options.tube_width_xy, x_center, y_center, z_center, options.tube_width_z);
+                options.tube_width_xy, x_center, y_center, z_center, options.tube_width_z, logical(options.orthogonal_lookup_table));
         end
     end
 elseif options.projector_type == 3
     if options.CT
         if exist('OCTAVE_VERSION','builtin') == 0
-            [Summ, rhs] = projector_mexCT( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
+            [Summ, rhs, varargout{1:nargout-2}] = projector_mexCT( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
                 norm_input, SinD, koko, attenuation_correction, normalization_correction, randoms_correction,...
                 options.scatter, scatter_input, options.global_correction_factor, lor_a_input, xy_index_input, z_index_input, NSinos, L_input, pseudot, det_per_ring, ...
                 TOF, TOFSize, sigma_x, TOFCenter, int64(options.TOF_bins), dec, options.verbose, nCores, ...
@@ -111,7 +120,7 @@ elseif options.projector_type == 3
                 x_center, y_center, z_center, bmin, bmax, Vmax, V, uint32(options.subsets), options.angles, uint32(options.xSize), ...
                 options.dPitch, int64(numel(options.angles)));
         elseif exist('OCTAVE_VERSION','builtin') == 5
-            [Summ, rhs] = projector_octCT( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
+            [Summ, rhs, varargout{1:nargout-2}] = projector_octCT( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
                 norm_input, SinD, koko, attenuation_correction, normalization_correction, randoms_correction,...
                 options.scatter, scatter_input, options.global_correction_factor, lor_a_input, xy_index_input, z_index_input, NSinos, L_input, pseudot, det_per_ring, ...
                 TOF, TOFSize, sigma_x, TOFCenter, int64(options.TOF_bins), dec, options.verbose, nCores, ...
@@ -121,14 +130,14 @@ elseif options.projector_type == 3
         end
     else
         if exist('OCTAVE_VERSION','builtin') == 0
-            [Summ, rhs] = projector_mex( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
+            [Summ, rhs, varargout{1:nargout-2}] = projector_mex( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
                 norm_input, SinD, koko, attenuation_correction, normalization_correction, randoms_correction,...
                 options.scatter, scatter_input, options.global_correction_factor, lor_a_input, xy_index_input, z_index_input, NSinos, L_input, pseudot, det_per_ring, ...
                 TOF, TOFSize, sigma_x, TOFCenter, int64(options.TOF_bins), dec, options.verbose, nCores, ...
                 (use_raw_data), uint32(1), options.listmode, epps, uu, OSEM_apu, uint32(options.projector_type), no_norm, options.precompute_lor, tyyppi, ...
                 x_center, y_center, z_center, bmin, bmax, Vmax, V);
         elseif exist('OCTAVE_VERSION','builtin') == 5
-            [Summ, rhs] = projector_oct( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
+            [Summ, rhs, varargout{1:nargout-2}] = projector_oct( Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx , NSinos, NSlices, size_x, zmax, options.vaimennus, ...
                 norm_input, SinD, koko, attenuation_correction, normalization_correction, randoms_correction,...
                 options.scatter, scatter_input, options.global_correction_factor, lor_a_input, xy_index_input, z_index_input, NSinos, L_input, pseudot, det_per_ring, ...
                 TOF, TOFSize, sigma_x, TOFCenter, int64(options.TOF_bins), dec, options.verbose, nCores, ...
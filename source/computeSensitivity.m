@@ -0,0 +1,187 @@
+function f_Summ = computeSensitivity(options, pituus, lor_a, xy_index, z_index, LL, pseudot, det_per_ring, x, y, z_det, xx, yy, Nx, Ny, Nz, ...
+    dx, dy, dz, bx, by, bz, size_x, NSinos, NSlices, zmax, nCores, use_raw_data, attenuation_correction, normalization_correction, ...
+    scatter_input, x_center, y_center, z_center, bmin, bmax, Vmax, V)
+%COMPUTESENSITIVITY Computes or loads the subset sensitivity images
+%   Computes the sensitivity image (the backprojection of the
+%   normalization, attenuation and multiplicative scatter coefficients) of
+%   each subset with implementation 4. The output is an (Nx*Ny*Nz) x
+%   subsets single precision matrix, without the PSF blurring or the
+%   minimum value (epps) limit.
+%
+%   The sensitivity images are saved in the mat-files folder. The filename
+%   includes a hash of the geometry, the subset division (LOR indices),
+%   the projector parameters and the correction data, thus the images are
+%   recomputed only when any of these changes.
+%
+% See also computeACF, geometryHash, md5Hash
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+folder = fileparts(which('computeSensitivity.m'));
+folder = [folder(1:end-6), 'mat-files/'];
+folder = strrep(folder, '\','/');
+
+subsets = numel(pituus) - 1;
+if ~isfield(options,'tube_width_xy')
+    options.tube_width_xy = 0;
+end
+if ~isfield(options,'tube_width_z')
+    options.tube_width_z = 0;
+end
+if ~isfield(options,'global_correction_factor') || isempty(options.global_correction_factor)
+    options.global_correction_factor = 1;
+end
+if ~options.precompute_lor
+    lor_a = uint16(0);
+end
+if ~isfield(options,'tube_radius')
+    options.tube_radius = 0;
+end
+if ~isfield(options,'voxel_radius')
+    options.voxel_radius = 0;
+end
+if ~isfield(options,'orthogonal_lookup_table')
+    options.orthogonal_lookup_table = false;
+end
+if ~isfield(options,'voxel_driven_backprojection')
+    options.voxel_driven_backprojection = false;
+end
+
+% The cache key, any change in the geometry, the subsets (LOR indices),
+% the projector or the correction data results in a new file
+arvot = {geometryHash(options), double(pituus), xy_index, z_index, LL, lor_a};
+if normalization_correction
+    arvot{end + 1} = single(options.normalization(:));
+end
+if attenuation_correction
+    arvot{end + 1} = double(options.vaimennus(:));
+end
+if options.scatter
+    arvot{end + 1} = double(scatter_input(:));
+end
+arvot{end + 1} = double([options.projector_type options.n_rays_transaxial options.n_rays_axial options.tube_width_xy options.tube_width_z ...
+    options.global_correction_factor options.subset_type subsets options.precompute_lor attenuation_correction normalization_correction options.scatter ...
+    options.tube_radius options.voxel_radius options.orthogonal_lookup_table options.voxel_driven_backprojection]);
+% The (derived) volume projector parameters
+if options.projector_type == 3
+    arvot{end + 1} = double([bmin(:); bmax(:); Vmax(:); V(:)]);
+end
+avain = md5Hash(arvot{:});
+sens_file = [folder options.machine_name '_sensitivity_' num2str(Nx) 'x' num2str(Ny) 'x' num2str(Nz) '_' num2str(subsets) 'subsets_' avain '.mat'];
+
+if exist(sens_file, 'file') == 2
+    f_Summ = loadStructFromFile(sens_file, 'f_Summ');
+    if options.verbose
+        disp(['Sensitivity images loaded from ' sens_file])
+    end
+    return
+end
+
+if options.verbose
+    tStart = tic;
+end
+
+options.vaimennus = double(options.vaimennus);
+options.global_correction_factor = double(options.global_correction_factor);
+options.listmode = false;
+options.nBatch = 1;
+options.n_rays_transaxial = uint16(options.n_rays_transaxial);
+options.n_rays_axial = uint16(options.n_rays_axial);
+if use_raw_data
+    xy_index_input = uint32(0);
+    z_index_input = uint32(0);
+else
+    L_input = uint16(0);
+    if isempty(pseudot)
+        pseudot = uint32(0);
+    end
+end
+% Implementation 4 requires double precision
+x = double(x);
+y = double(y);
+z_det = double(z_det);
+xx = double(xx);
+yy = double(yy);
+dx = double(dx);
+dy = double(dy);
+dz = double(dz);
+bx = double(bx);
+by = double(by);
+bz = double(bz);
+zmax = double(zmax);
+x_center = double(x_center);
+y_center = double(y_center);
+z_center = double(z_center);
+bmin = double(bmin);
+bmax = double(bmax);
+Vmax = double(Vmax);
+V = double(V);
+if options.rings > 1
+    dc_z = z_det(2,1) - z_det(1,1);
+else
+    dc_z = options.cr_pz;
+end
+
+f_Summ = zeros(double(Nx) * double(Ny) * double(Nz), subsets, 'single');
+for osa_iter = 1 : subsets
+    koko = pituus(osa_iter + 1) - pituus(osa_iter);
+    if options.subset_type >= 8 && subsets > 1
+        koko = koko * options.Nang * options.Ndist;
+    end
+    if normalization_correction
+        norm_input = single(options.normalization(pituus(osa_iter)+1:pituus(osa_iter + 1)));
+    else
+        norm_input = 0;
+    end
+    if options.scatter
+        scatter_osa = double(scatter_input(pituus(osa_iter)+1:pituus(osa_iter + 1)));
+    else
+        scatter_osa = 0;
+    end
+    if use_raw_data
+        L_input = LL(pituus(osa_iter) * 2 + 1 : pituus(osa_iter + 1) * 2);
+        TOFSize = int64(size(L_input,1));
+    else
+        xy_index_input = xy_index(pituus(osa_iter)+1:pituus(osa_iter + 1));
+        z_index_input = z_index(pituus(osa_iter)+1:pituus(osa_iter + 1));
+        TOFSize = int64(numel(xy_index_input));
+    end
+    if options.precompute_lor
+        lor_a_input = lor_a(pituus(osa_iter)+1:pituus(osa_iter + 1));
+    else
+        lor_a_input = uint16(0);
+    end
+    % Backprojection of ones, the sensitivity image is the normalization
+    % output
+    Summ = computeImplementation4(options, use_raw_data, false, pituus, osa_iter, normalization_correction, Nx, Ny, Nz, dx, dy, dz, bx, by, bz, ...
+        x, y, z_det, xx, yy, size_x, NSinos, NSlices, zmax, attenuation_correction, pseudot, det_per_ring, false, TOFSize, 0, 0, uint32(0), ...
+        nCores, L_input, lor_a_input, xy_index_input, z_index_input, options.epps, ones(koko, 1, 'single'), ones(koko, 1), false, x_center, ...
+        y_center, z_center, bmin, bmax, Vmax, V, scatter_osa, norm_input, single(0), dc_z, uint8(2));
+    f_Summ(:, osa_iter) = single(Summ);
+end
+
+if options.verbose
+    disp(['Sensitivity images computed in ' num2str(toc(tStart)) ' seconds'])
+end
+
+if exist('OCTAVE_VERSION','builtin') == 0
+    save(sens_file, 'f_Summ', '-v7.3')
+else
+    save(sens_file, 'f_Summ', '-v7')
+end
+end
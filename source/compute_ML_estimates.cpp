@@ -41,12 +41,12 @@ void computeMLEstimates(AF_im_vectors& vec, Weighting& w_vec, const RecMethods&
 					w_vec.tr_offsets, w_vec.weights_huber, im_dim, w_vec.huber_delta);
 			}
 			else if (MethodListPrior.L) {
-				dU = L_filter(vec.im_mlem(seq(ee, ee + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.tr_offsets,
-					w_vec.a_L, w_vec.med_no_norm, im_dim);
+				dU = L_filter(vec.im_mlem(seq(ee, ee + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps,
+					w_vec.a_L, w_vec.med_no_norm, im_dim, OpenCLStruct);
 			}
 			else if (MethodListPrior.FMH) {
-				dU = FMH(vec.im_mlem(seq(ee, ee + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.inffi, w_vec.tr_offsets,
-					w_vec.fmh_weights, w_vec.med_no_norm, w_vec.alku_fmh, im_dim);
+				dU = FMH(vec.im_mlem(seq(ee, ee + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.inffi,
+					w_vec.fmh_weights, w_vec.med_no_norm, w_vec.alku_fmh, im_dim, OpenCLStruct);
 			}
 			else if (MethodListPrior.WeightedMean) {
 				dU = Weighted_mean(vec.im_mlem(seq(ee, ee + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.weighted_weights, w_vec.med_no_norm,
@@ -68,7 +68,7 @@ void computeMLEstimates(AF_im_vectors& vec, Weighting& w_vec, const RecMethods&
 				dU = TVprior(Nx, Ny, Nz, data, vec.im_mlem(seq(ee, ee + im_dim - 1u)), epps, 5U, w_vec, w_vec.tr_offsets);
 			}
 			else if (MethodListPrior.TGV) {
-				dU = TGV(vec.im_mlem(seq(ee, ee + im_dim - 1u)), Nx, Ny, Nz, data.NiterTGV, data.TGVAlpha, data.TGVBeta);
+				dU = TGV(vec.im_mlem(seq(ee, ee + im_dim - 1u)), Nx, Ny, Nz, data.NiterTGV, data.TGVAlpha, data.TGVBeta, w_vec.TGVHalf, OpenCLStruct);
 			}
 			else if (MethodListPrior.NLM) {
 				dU = NLM(vec.im_mlem(seq(ee, ee + im_dim - 1u)), w_vec, epps, Nx, Ny, Nz, OpenCLStruct);
@@ -77,7 +77,10 @@ void computeMLEstimates(AF_im_vectors& vec, Weighting& w_vec, const RecMethods&
 				dU = RDP(vec.im_mlem(seq(ee, ee + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, w_vec.weights_RDP, im_dim, w_vec.RDP_gamma, w_vec.tr_offsets, w_vec.inffi);
 			}
 			else if (MethodListPrior.CUSTOM) {
-				dU = w_vec.dU[ll];
+				if (w_vec.customPlugin)
+					dU = customPrior(vec.im_mlem(seq(ee, ee + im_dim - 1u)), epps, Nx, Ny, Nz, OpenCLStruct);
+				else
+					dU = w_vec.dU[ll];
 			}
 			//if (MethodListMAP.OSLMLEM) {
 				vec.im_mlem(seq(ee, ee + im_dim - 1u)) = EM(vec.im_mlem(seq(ee, ee + im_dim - 1u)), OSL(Summ_mlem, dU, beta[ss], epps), vec.rhs_mlem(seq(ee, ee + im_dim - 1u)));
@@ -136,7 +139,7 @@ void computeMLEstimates(AF_im_vectors& vec, Weighting& w_vec, const RecMethods&
 		dd += w_vec.nMAPOS;
 		ss += w_vec.nMAPOS;
 	}
-	if (MethodList.CUSTOM) {
+	if (MethodList.CUSTOM && !w_vec.customPlugin) {
 		break_iter = true;
 	}
 }
@@ -76,56 +76,63 @@ void computeOSEstimatesIter(AF_im_vectors& vec, Weighting& w_vec, const RecMetho
 
 	RecMethods MethodListPrior = MethodList;
 	array dU;
+	// With the custom prior, the priors are computed once all the sub-iterations have been computed, unless the
+	// custom prior kernel is used (all the sub-iterations are then computed in the same call)
+	const bool iterPrior = !MethodList.CUSTOM || w_vec.customPlugin || osa_iter0 == subsets;
 	for (uint32_t kk = 0; kk < w_vec.nPriorsTot; kk++) {
 		RecMethods MethodListMAP = MethodList;
 		for (uint32_t ll = 0; ll < w_vec.nMAPOS; ll++) {
 			// PRIORS
-			if (MethodListPrior.MRP && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && (!MethodList.CUSTOM || (osa_iter0 == subsets && MethodList.CUSTOM))) {
+			if (MethodListPrior.MRP && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && iterPrior) {
 				dU = MRP(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.tr_offsets,
 					w_vec.med_no_norm, im_dim, OpenCLStruct);
 			}
-			else if (MethodListPrior.Quad && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && (!MethodList.CUSTOM || (osa_iter0 == subsets && MethodList.CUSTOM))) {
+			else if (MethodListPrior.Quad && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && iterPrior) {
 				dU = Quadratic_prior(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, w_vec.inffi,
 					w_vec.tr_offsets, w_vec.weights_quad, im_dim);
 			}
-			else if (MethodListPrior.Huber && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && (!MethodList.CUSTOM || (osa_iter0 == subsets && MethodList.CUSTOM))) {
+			else if (MethodListPrior.Huber && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && iterPrior) {
 				dU = Huber_prior(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, w_vec.inffi,
 					w_vec.tr_offsets, w_vec.weights_huber, im_dim, w_vec.huber_delta);
 			}
-			else if (MethodListPrior.L && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && (!MethodList.CUSTOM || (osa_iter0 == subsets && MethodList.CUSTOM))) {
-				dU = L_filter(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.tr_offsets,
-					w_vec.a_L, w_vec.med_no_norm, im_dim);
+			else if (MethodListPrior.L && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && iterPrior) {
+				dU = L_filter(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps,
+					w_vec.a_L, w_vec.med_no_norm, im_dim, OpenCLStruct);
 			}
-			else if (MethodListPrior.FMH && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && (!MethodList.CUSTOM || (osa_iter0 == subsets && MethodList.CUSTOM))) {
-				dU = FMH(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.inffi, w_vec.tr_offsets,
-					w_vec.fmh_weights, w_vec.med_no_norm, w_vec.alku_fmh, im_dim);
+			else if (MethodListPrior.FMH && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && iterPrior) {
+				dU = FMH(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.inffi,
+					w_vec.fmh_weights, w_vec.med_no_norm, w_vec.alku_fmh, im_dim, OpenCLStruct);
 			}
-			else if (MethodListPrior.WeightedMean && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && (!MethodList.CUSTOM || (osa_iter0 == subsets && MethodList.CUSTOM))) {
+			else if (MethodListPrior.WeightedMean && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && iterPrior) {
 				dU = Weighted_mean(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.weighted_weights, w_vec.med_no_norm,
 					im_dim, w_vec.mean_type, w_vec.w_sum);
 			}
-			else if (MethodListPrior.TV && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && (!MethodList.CUSTOM || (osa_iter0 == subsets && MethodList.CUSTOM))) {
+			else if (MethodListPrior.TV && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && iterPrior) {
 				dU = TVprior(Nx, Ny, Nz, data, vec.im_os(seq(yy, yy + im_dim - 1u)), epps, data.TVtype, w_vec, w_vec.tr_offsets);
 			}
-			else if (MethodListPrior.AD && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && (!MethodList.CUSTOM || (osa_iter0 == subsets && MethodList.CUSTOM))) {
+			else if (MethodListPrior.AD && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && iterPrior) {
 				dU = AD(vec.im_os(seq(yy, yy + im_dim - 1u)), Nx, Ny, Nz, epps, w_vec.TimeStepAD, w_vec.KAD, w_vec.NiterAD, w_vec.FluxType,
 					w_vec.DiffusionType, w_vec.med_no_norm);
 			}
-			else if (MethodListPrior.APLS && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && (!MethodList.CUSTOM || (osa_iter0 == subsets && MethodList.CUSTOM))) {
+			else if (MethodListPrior.APLS && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && iterPrior) {
 				dU = TVprior(Nx, Ny, Nz, data, vec.im_os(seq(yy, yy + im_dim - 1u)), epps, 5U, w_vec, w_vec.tr_offsets);
 			}
-			else if (MethodListPrior.TGV && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && (!MethodList.CUSTOM || (osa_iter0 == subsets && MethodList.CUSTOM))) {
-				dU = TGV(vec.im_os(seq(yy, yy + im_dim - 1u)), Nx, Ny, Nz, data.NiterTGV, data.TGVAlpha, data.TGVBeta);
+			else if (MethodListPrior.TGV && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && iterPrior) {
+				dU = TGV(vec.im_os(seq(yy, yy + im_dim - 1u)), Nx, Ny, Nz, data.NiterTGV, data.TGVAlpha, data.TGVBeta, w_vec.TGVHalf, OpenCLStruct);
 			}
-			else if (MethodListPrior.NLM && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && (!MethodList.CUSTOM || (osa_iter0 == subsets && MethodList.CUSTOM))) {
+			else if (MethodListPrior.NLM && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && iterPrior) {
 				dU = NLM(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec, epps, Nx, Ny, Nz, OpenCLStruct);
 			}
-			else if (MethodListPrior.RDP && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && (!MethodList.CUSTOM || (osa_iter0 == subsets && MethodList.CUSTOM))) {
+			else if (MethodListPrior.RDP && (ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && iterPrior) {
 				dU = RDP(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, w_vec.weights_RDP, im_dim, w_vec.RDP_gamma, w_vec.tr_offsets, w_vec.inffi);
 			}
 			else if (MethodListPrior.CUSTOM) {
-				if ((ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && osa_iter0 == subsets)
-					dU = w_vec.dU[oo];
+				if ((ll == w_vec.mIt[0] || ll == w_vec.mIt[1]) && iterPrior) {
+					if (w_vec.customPlugin)
+						dU = customPrior(vec.im_os(seq(yy, yy + im_dim - 1u)), epps, Nx, Ny, Nz, OpenCLStruct);
+					else
+						dU = w_vec.dU[oo];
+				}
 				oo++;
 			}
 
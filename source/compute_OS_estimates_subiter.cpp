@@ -115,6 +115,7 @@ void computeOSEstimates(AF_im_vectors& vec, Weighting& w_vec, const RecMethods&
 			//	mexPrintf("yy = %u\n", yy);
 			//}
 			// PRIORS
+			const double profAlku = profiler().now();
 			if (MethodListPrior.MRP && ll != w_vec.mIt[0] && ll != w_vec.mIt[1]) {
 				dU = MRP(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.tr_offsets,
 					w_vec.med_no_norm, im_dim, OpenCLStruct);
@@ -128,12 +129,12 @@ void computeOSEstimates(AF_im_vectors& vec, Weighting& w_vec, const RecMethods&
 					w_vec.tr_offsets, w_vec.weights_huber, im_dim, w_vec.huber_delta);
 			}
 			else if (MethodListPrior.L && ll != w_vec.mIt[0] && ll != w_vec.mIt[1]) {
-				dU = L_filter(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.tr_offsets,
-					w_vec.a_L, w_vec.med_no_norm, im_dim);
+				dU = L_filter(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps,
+					w_vec.a_L, w_vec.med_no_norm, im_dim, OpenCLStruct);
 			}
 			else if (MethodListPrior.FMH && ll != w_vec.mIt[0] && ll != w_vec.mIt[1]) {
-				dU = FMH(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.inffi, w_vec.tr_offsets,
-					w_vec.fmh_weights, w_vec.med_no_norm, w_vec.alku_fmh, im_dim);
+				dU = FMH(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.inffi,
+					w_vec.fmh_weights, w_vec.med_no_norm, w_vec.alku_fmh, im_dim, OpenCLStruct);
 			}
 			else if (MethodListPrior.WeightedMean && ll != w_vec.mIt[0] && ll != w_vec.mIt[1]) {
 				dU = Weighted_mean(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, epps, w_vec.weighted_weights, w_vec.med_no_norm,
@@ -155,7 +156,7 @@ void computeOSEstimates(AF_im_vectors& vec, Weighting& w_vec, const RecMethods&
 				dU = TVprior(Nx, Ny, Nz, data, vec.im_os(seq(yy, yy + im_dim - 1u)), epps, 5U, w_vec, w_vec.tr_offsets);
 			}
 			else if (MethodListPrior.TGV && ll != w_vec.mIt[0] && ll != w_vec.mIt[1]) {
-				dU = TGV(vec.im_os(seq(yy, yy + im_dim - 1u)), Nx, Ny, Nz, data.NiterTGV, data.TGVAlpha, data.TGVBeta);
+				dU = TGV(vec.im_os(seq(yy, yy + im_dim - 1u)), Nx, Ny, Nz, data.NiterTGV, data.TGVAlpha, data.TGVBeta, w_vec.TGVHalf, OpenCLStruct);
 			}
 			else if (MethodListPrior.NLM && ll != w_vec.mIt[0] && ll != w_vec.mIt[1]) {
 				dU = NLM(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec, epps, Nx, Ny, Nz, OpenCLStruct);
@@ -164,10 +165,19 @@ void computeOSEstimates(AF_im_vectors& vec, Weighting& w_vec, const RecMethods&
 				dU = RDP(vec.im_os(seq(yy, yy + im_dim - 1u)), w_vec.Ndx, w_vec.Ndy, w_vec.Ndz, Nx, Ny, Nz, w_vec.weights_RDP, im_dim, w_vec.RDP_gamma, w_vec.tr_offsets, w_vec.inffi);
 			}
 			else if (MethodListPrior.CUSTOM) {
-				if (ll != w_vec.mIt[0] && ll != w_vec.mIt[1])
-					dU = w_vec.dU[oo];
+				if (ll != w_vec.mIt[0] && ll != w_vec.mIt[1]) {
+					if (w_vec.customPlugin)
+						dU = customPrior(vec.im_os(seq(yy, yy + im_dim - 1u)), epps, Nx, Ny, Nz, OpenCLStruct);
+					else
+						dU = w_vec.dU[oo];
+				}
 				oo++;
 			}
+			if (profiler().enabled) {
+				dU.eval();
+				af::sync();
+				profiler().span("prior", profAlku);
+			}
 
 			if (DEBUG) {
 				mexPrintf("vec.im_os(seq(yy, yy + im_dim - 1u)) = %f\n", af::sum<float>(vec.im_os(seq(yy, yy + im_dim - 1u))));
@@ -289,7 +299,9 @@ void computeOSEstimates(AF_im_vectors& vec, Weighting& w_vec, const RecMethods&
 		}
 		else if (MethodListPrior.CUSTOM) {
 			MethodListPrior.CUSTOM = false;
-			break_iter = true;
+			// Without the custom prior kernel, the gradient is updated by the user after each sub-iteration
+			if (!w_vec.customPlugin)
+				break_iter = true;
 		}
 		dd += w_vec.nMAPML;
 	}
@@ -0,0 +1,53 @@
+/**************************************************************************
+* Example custom prior kernel (options.custom_prior_kernel). Computes the
+* gradient of the quadratic prior with the six nearest neighbors. The
+* optional first parameter (param[0]) is the weight of the axial
+* neighbors (default 1).
+*
+* The kernel needs to be named customPrior and have the inputs below. It
+* is run with a global size of Nx x Ny x Nz. grad is the output gradient,
+* im the current estimate, epps a small constant to prevent division by
+* zero and param the values of options.custom_prior_param (nParam of
+* them).
+*
+* Copyright (C) 2020 Ville-Veikko Wettenhovi
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <https://www.gnu.org/licenses/>.
+***************************************************************************/
+__kernel void customPrior(__global float* grad, const __global float* im, const uint Nx, const uint Ny, const uint Nz,
+	const float epps, __constant float* param, const uint nParam) {
+	const uint xid = get_global_id(0);
+	const uint yid = get_global_id(1);
+	const uint zid = get_global_id(2);
+	if (xid >= Nx || yid >= Ny || zid >= Nz)
+		return;
+	const uint Nxy = Nx * Ny;
+	const uint n = xid + yid * Nx + zid * Nxy;
+	const float uj = im[n];
+	const float wz = nParam > 0 ? param[0] : 1.f;
+	float tulos = 0.f;
+	if (xid > 0)
+		tulos += uj - im[n - 1];
+	if (xid < Nx - 1)
+		tulos += uj - im[n + 1];
+	if (yid > 0)
+		tulos += uj - im[n - Nx];
+	if (yid < Ny - 1)
+		tulos += uj - im[n + Nx];
+	if (zid > 0)
+		tulos += wz * (uj - im[n - Nxy]);
+	if (zid < Nz - 1)
+		tulos += wz * (uj - im[n + Nxy]);
+	grad[n] = tulos;
+}
@@ -3,6 +3,11 @@ function options = custom_prior_reconstruction(options, t, iter, osa_iter)
 % This function is used to compute various reconstructions with the
 % selected methods and the custom prior gradient.
 %
+% If options.custom_prior_kernel is set (implementation 2 only), the
+% gradient is computed on the device with the customPrior kernel of the
+% given OpenCL source file and all the iterations of the time step t are
+% computed with one call (iter and osa_iter should then be 1).
+%
 
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 % Copyright (C) 2020 Ville-Veikko Wettenhovi, Samuli Summala
@@ -49,6 +54,27 @@ end
 if ~isfield(options,'compute_sensitivity_image')
     options.compute_sensitivity_image = false;
 end
+if ~isfield(options,'custom_prior_kernel')
+    options.custom_prior_kernel = '';
+end
+if ~isfield(options,'custom_prior_param')
+    options.custom_prior_param = [];
+end
+plugin = ~isempty(options.custom_prior_kernel);
+if plugin && (options.implementation ~= 2 || options.use_CUDA)
+    error('The custom prior kernel is only supported with implementation 2 and OpenCL')
+end
+if plugin
+    if exist(options.custom_prior_kernel, 'file') ~= 2
+        error(['Custom prior kernel file ' options.custom_prior_kernel ' not found'])
+    end
+    % Full path for the MEX-file
+    apu = which(options.custom_prior_kernel);
+    if ~isempty(apu)
+        options.custom_prior_kernel = apu;
+    end
+end
+options.custom_prior_param = single(options.custom_prior_param(:));
 TOF = options.TOF_bins > 1 && options.projector_type == 1;
 
 if t == 1 && osa_iter == 1 && iter == 1
@@ -144,8 +170,10 @@ else
     
     oo = 1;
     for kk = 1 : numel(varMAP)
-        if isfield(options, ['grad_' varMAP{kk}]) && options.(varMAP{kk})
-            options.(['grad_' varMAP{kk}]) = single(options.(['grad_' varMAP{kk}])(:));
+        if (isfield(options, ['grad_' varMAP{kk}]) || plugin) && options.(varMAP{kk})
+            if ~plugin
+                options.(['grad_' varMAP{kk}]) = single(options.(['grad_' varMAP{kk}])(:));
+            end
             options.(['beta_custom_' varMAP{kk}]) = single(options.(['beta_custom_' varMAP{kk}]));
             options.(['custom_' varMAP{kk} '_apu']) = options.im_vectors.(['custom_' varMAP{kk} '_apu']);
             options.varApu{oo} = ['custom_' varMAP{kk} '_apu'];
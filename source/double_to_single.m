@@ -2,6 +2,9 @@ function options = double_to_single(options)
 %DOUBLE_TO_SINGLE Convert all necessary values in options to single
 %precision
 options.x0 = single(options.x0(:));
+if isfield(options,'mask') && ~isempty(options.mask)
+    options.mask = single(options.mask(:));
+end
 options.Ndx = uint32(options.Ndx);
 options.Ndy = uint32(options.Ndy);
 options.Ndz = uint32(options.Ndz);
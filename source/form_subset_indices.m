@@ -104,8 +104,7 @@ end
 % for the precomputed version, index vectors are needed
 if options.use_raw_data == false && options.precompute_lor
     
-    lor_file = [folder options.machine_name '_lor_pixel_count_' num2str(options.Nx) 'x' num2str(options.Ny) 'x' num2str(options.Nz) '_sino_' num2str(options.Ndist) 'x' ...
-        num2str(options.Nang) 'x' num2str(options.TotSinos) '.mat'];
+    lor_file = lorPixelCountFile(options, false);
     
     if exist(lor_file, 'file') == 2 && exist('lor','var') ~= 1 && ~options.CT
         if options.implementation == 1 || options.implementation == 4
@@ -474,7 +473,7 @@ if options.use_raw_data == false && options.precompute_lor
     clear discard I yt xt xy_index2 index apu
 elseif options.use_raw_data && options.precompute_lor
     
-    lor_file = [folder options.machine_name '_detector_locations_' num2str(options.Nx) 'x' num2str(options.Ny) 'x' num2str(options.Nz) '_raw.mat'];
+    lor_file = lorPixelCountFile(options, true);
     if exist(lor_file, 'file') == 2
         variableInfo = who('-file', lor_file);
         if options.implementation == 1 || options.implementation == 4
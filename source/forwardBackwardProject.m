@@ -432,6 +432,27 @@ classdef forwardBackwardProject
             obj.trans = false;
         end
         
+        function obj = set.OProperties(obj, value)
+            % With implementations 2 and 3, the OpenCL context, the
+            % compiled programs and the geometry and correction data of
+            % each subset are kept on the device between the projections.
+            % Only one object can use the session at a time, see also
+            % releaseSession. Any change to the properties creates a new
+            % session, i.e. copies of the object with different properties
+            % never share the device data.
+            if isstruct(value)
+                if ~isfield(value,'persistent_session')
+                    value.persistent_session = true;
+                end
+                if isfield(value,'implementation') && (value.implementation == 2 || value.implementation == 3) && value.persistent_session
+                    value.fbSession = forwardBackwardProject.newSession();
+                else
+                    value.fbSession = uint32(0);
+                end
+            end
+            obj.OProperties = value;
+        end
+        
         function y = forwardProject(obj, input, varargin)
             %FORWARDPROJECT Computes the forward projection between the
             %object and the input vector.
@@ -446,20 +467,24 @@ classdef forwardBackwardProject
             % Outputs:
             %   y = The result of y = A * input
             
+            % The properties are modified through a copy, as modifying
+            % OProperties would create a new session
+            options = obj.OProperties;
             if nargin >=3 && ~isempty(varargin{1})
                 obj.subset = varargin{1};
-                obj.OProperties.useSubsets = true;
+                options.useSubsets = true;
             elseif obj.OProperties.subsets > 1 && nargin == 2
 %                 error('When using subsets you must specify the current subset number (e.g. y = forwardProject(A, input, subset_number))')
             else
-                obj.OProperties.useSubsets = false;
+                options.useSubsets = false;
                 obj.subset = 1;
             end
             
             if obj.OProperties.use_psf
                 input = computeConvolution(input, obj.OProperties, obj.OProperties.Nx, obj.OProperties.Ny, obj.OProperties.Nz, obj.OProperties.gaussK);
             end
-            y = forward_project(obj.OProperties, obj.index(obj.nn(obj.subset) + 1:obj.nn(obj.subset+1)), obj.nn(obj.subset + 1) - obj.nn(obj.subset), input, [obj.nn(obj.subset) + 1 , obj.nn(obj.subset+1)], ...
+            options.fbSubset = uint32(obj.subset);
+            y = forward_project(options, obj.index(obj.nn(obj.subset) + 1:obj.nn(obj.subset+1)), obj.nn(obj.subset + 1) - obj.nn(obj.subset), input, [obj.nn(obj.subset) + 1 , obj.nn(obj.subset+1)], ...
                 obj.subset, true);
         end
         
@@ -481,25 +506,27 @@ classdef forwardBackwardProject
             %   obj = The modified object. Sensitivity image is stored in
             %   sens. Can be omitted if sensitivity image is not required.
             
+            options = obj.OProperties;
             if nargin >=3 && ~isempty(varargin{1})
                 obj.subset = varargin{1};
-                obj.OProperties.useSubsets = true;
+                options.useSubsets = true;
             elseif obj.OProperties.subsets == 1 || isempty(obj.OProperties.subsets)
                 obj.subset = 1;
-                obj.OProperties.useSubsets = false;
+                options.useSubsets = false;
             else
-                obj.OProperties.useSubsets = true;
+                options.useSubsets = true;
             end
             if nargout >= 2
                 iter = 1;
             else
                 iter = 10;
             end
+            options.fbSubset = uint32(obj.subset);
             if iter == 1
-                [f, norm] = backproject(obj.OProperties, obj.index(obj.nn(obj.subset) + 1:obj.nn(obj.subset+1)), obj.nn(obj.subset + 1) - obj.nn(obj.subset), input, ...
+                [f, norm] = backproject(options, obj.index(obj.nn(obj.subset) + 1:obj.nn(obj.subset+1)), obj.nn(obj.subset + 1) - obj.nn(obj.subset), input, ...
                     [obj.nn(obj.subset) + 1,obj.nn(obj.subset+1)], obj.subset, true);
                 
-                if obj.OProperties.useSubsets
+                if options.useSubsets
                     obj.sens(:,obj.subset) = norm;
                 else
                     obj.sens = norm;
@@ -508,7 +535,7 @@ classdef forwardBackwardProject
                     obj.sens(:,obj.subset) = computeConvolution(obj.sens(:,obj.subset), obj.OProperties, obj.OProperties.Nx, obj.OProperties.Ny, obj.OProperties.Nz, obj.OProperties.gaussK);
                 end
             else
-                f = backproject(obj.OProperties, obj.index(obj.nn(obj.subset) + 1:obj.nn(obj.subset+1)), obj.nn(obj.subset + 1) - obj.nn(obj.subset), input, ...
+                f = backproject(options, obj.index(obj.nn(obj.subset) + 1:obj.nn(obj.subset+1)), obj.nn(obj.subset + 1) - obj.nn(obj.subset), input, ...
                     [obj.nn(obj.subset) + 1,obj.nn(obj.subset+1)], obj.subset, true);
             end
             if obj.OProperties.use_psf
@@ -571,6 +598,30 @@ classdef forwardBackwardProject
         function obj = ctranspose(obj)
             obj.trans = true;
         end
+        function releaseSession(obj)
+            %RELEASESESSION Releases the device memory of the persistent
+            %session (implementations 2 and 3)
+            %   The session is also released when another
+            %   forwardBackwardProject object is used or when the MEX-files
+            %   are cleared (e.g. clear mex).
+            if isfield(obj.OProperties,'fbSession') && obj.OProperties.fbSession > 0 && exist('OpenCL_matrixfree_multi_gpu','file') == 3
+                OpenCL_matrixfree_multi_gpu();
+            end
+        end
+    end
+    
+    methods (Static, Access = private)
+        function id = newSession()
+            % Unique identifier of the persistent session, the starting
+            % value is taken from the clock so that the identifiers differ
+            % even if this class is cleared but the MEX-file is not
+            persistent laskuri
+            if isempty(laskuri)
+                laskuri = uint32(mod(floor(now * 86400), 2^31));
+            end
+            laskuri = laskuri + 1;
+            id = laskuri;
+        end
     end
 end
 
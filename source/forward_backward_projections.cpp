@@ -31,7 +31,7 @@ void f_b_project(const cl_uint& num_devices_context, const float kerroin, const
 	const size_t size_center_y, const size_t size_center_z, const bool precompute, const int32_t dec, const uint32_t projector_type, const uint16_t n_rays, 
 	const uint16_t n_rays3D, const float cr_pz, const mxArray* Sin, const bool atomic_64bit, const bool atomic_32bit, const float global_factor, const float bmin, const float bmax,
 	const float Vmax, const float* V, const size_t size_V, const uint8_t fp, const size_t local_size, const mxArray* options, const uint32_t scatter, const bool TOF,
-	const int64_t TOFSize, const float sigma_x, const float* TOFCenter, const int64_t nBins) {
+	const int64_t TOFSize, const float sigma_x, const float* TOFCenter, const int64_t nBins, const uint32_t nBatch, fbpSession* session) {
 
 	const uint32_t Nxy = Nx * Ny;
 	cl_int status = CL_SUCCESS;
@@ -69,6 +69,8 @@ void f_b_project(const cl_uint& num_devices_context, const float kerroin, const
 		size_output = pituus[0] * nBins;
 	else
 		size_output = static_cast<size_t>(im_dim);
+	// Batched projection, one output per image
+	size_output *= static_cast<size_t>(nBatch);
 
 	const mwSize dimmi[1] = { static_cast<mwSize>(size_output) };
 
@@ -195,6 +197,39 @@ void f_b_project(const cl_uint& num_devices_context, const float kerroin, const
 		d0_Summ.resize(num_devices_context - 1u);
 	}
 
+	// In a session, the geometry and the corrections of the current subset
+	// are created and uploaded only on the first call. The measurement data
+	// (Sino) can differ between the calls and is always uploaded
+	bool newGeometry = true;
+	bool newSubset = true;
+	if (session != nullptr) {
+		if (session->geometry) {
+			newGeometry = false;
+			d_z = session->d_z;
+			d_x = session->d_x;
+			d_y = session->d_y;
+			d_angles = session->d_angles;
+			d_xcenter = session->d_xcenter;
+			d_ycenter = session->d_ycenter;
+			d_zcenter = session->d_zcenter;
+			d_V = session->d_V;
+			d_atten = session->d_atten;
+			d_TOFCenter = session->d_TOFCenter;
+			d_pseudos = session->d_pseudos;
+		}
+		std::map<uint32_t, fbpSubsetBuffers>::const_iterator osa = session->subsets.find(session->subset);
+		if (osa != session->subsets.end()) {
+			newSubset = false;
+			d_sc_ra = osa->second.d_sc_ra;
+			d_norm = osa->second.d_norm;
+			d_scat = osa->second.d_scat;
+			d_lor = osa->second.d_lor;
+			d_xyindex = osa->second.d_xyindex;
+			d_zindex = osa->second.d_zindex;
+			d_L = osa->second.d_L;
+		}
+	}
+
 	// Create the necessary buffers
 	for (cl_uint i = 0U; i < num_devices_context; i++) {
 		d_reko_type[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(cl_uchar), NULL, &status);
@@ -202,62 +237,64 @@ void f_b_project(const cl_uint& num_devices_context, const float kerroin, const
 			getErrorString(status);
 			return;
 		}
-		d_z[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * size_z, NULL, &status);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		d_x[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * numel_x, NULL, &status);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		d_y[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * numel_x, NULL, &status);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		if (CT) {
-			d_angles[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * nProjections, NULL, &status);
+		if (newGeometry) {
+			d_z[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * size_z, NULL, &status);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				return;
+			}
+			d_x[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * numel_x, NULL, &status);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				return;
+			}
+			d_y[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * numel_x, NULL, &status);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				return;
+			}
+			if (CT) {
+				d_angles[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * nProjections, NULL, &status);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+			}
+			d_xcenter[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * size_center_x, NULL, &status);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				return;
+			}
+			d_ycenter[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * size_center_y, NULL, &status);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				return;
+			}
+			d_zcenter[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * size_center_z, NULL, &status);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				return;
+			}
+			d_V[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * size_V, NULL, &status);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				return;
+			}
+			d_TOFCenter[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * nBins, NULL, &status);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				return;
+			}
+			d_atten[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * size_atten, NULL, &status);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				return;
+			}
+			d_pseudos[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint32_t) * prows, NULL, &status);
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return;
 			}
-		}
-		d_xcenter[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * size_center_x, NULL, &status);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		d_ycenter[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * size_center_y, NULL, &status);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		d_zcenter[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * size_center_z, NULL, &status);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		d_V[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * size_V, NULL, &status);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		d_TOFCenter[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * nBins, NULL, &status);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		d_atten[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * size_atten, NULL, &status);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		d_pseudos[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint32_t) * prows, NULL, &status);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
 		}
 		d_rhs[i] = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(float) * size_rhs, NULL, &status);
 		if (status != CL_SUCCESS) {
@@ -336,48 +373,6 @@ void f_b_project(const cl_uint& num_devices_context, const float kerroin, const
 				}
 			}
 		}
-		if (randoms_correction == 1u) {
-			d_sc_ra[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * length[i], NULL, &status);
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
-			}
-		}
-		else {
-			d_sc_ra[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float), NULL, &status);
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
-			}
-		}
-		if (normalization == 1u) {
-			d_norm[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(cl_float) * length[i], NULL, &status);
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
-			}
-		}
-		else {
-			d_norm[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(cl_float), NULL, &status);
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
-			}
-		}
-		if (scatter == 1u) {
-			d_scat[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(cl_float) * length[i], NULL, &status);
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
-			}
-		}
-		else {
-			d_scat[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(cl_float), NULL, &status);
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
-			}
-		}
 		if (listmode != 2)
 			d_Sino[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * length[i] * nBins, NULL, &status);
 		else
@@ -386,48 +381,92 @@ void f_b_project(const cl_uint& num_devices_context, const float kerroin, const
 			getErrorString(status);
 			return;
 		}
-		if (precompute)
-			d_lor[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t) * length[i], NULL, &status);
-		else
-			d_lor[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t) * length[i], NULL, &status);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		if (raw && listmode != 1) {
-			d_xyindex[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint32_t), NULL, &status);
-			d_zindex[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t), NULL, &status);
-			d_L[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t) * length[i] * 2, NULL, &status);
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
+		if (newSubset) {
+			if (randoms_correction == 1u) {
+				d_sc_ra[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float) * length[i], NULL, &status);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
 			}
-		}
-		else if (listmode != 1 && (!CT || subsets > 1)) {
-			d_xyindex[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint32_t) * length[i], NULL, &status);
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
+			else {
+				d_sc_ra[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(float), NULL, &status);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
 			}
-			d_zindex[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t) * length[i], NULL, &status);
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
+			if (normalization == 1u) {
+				d_norm[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(cl_float) * length[i], NULL, &status);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
 			}
-			d_L[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t), NULL, &status);
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
+			else {
+				d_norm[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(cl_float), NULL, &status);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
 			}
-		}
-		else {
-			d_xyindex[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint32_t), NULL, &status);
-			d_zindex[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t), NULL, &status);
-			d_L[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t), NULL, &status);
+			if (scatter == 1u) {
+				d_scat[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(cl_float) * length[i], NULL, &status);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+			}
+			else {
+				d_scat[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(cl_float), NULL, &status);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+			}
+			if (precompute)
+				d_lor[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t) * length[i], NULL, &status);
+			else
+				d_lor[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t) * length[i], NULL, &status);
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return;
 			}
+			if (raw && listmode != 1) {
+				d_xyindex[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint32_t), NULL, &status);
+				d_zindex[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t), NULL, &status);
+				d_L[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t) * length[i] * 2, NULL, &status);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+			}
+			else if (listmode != 1 && (!CT || subsets > 1)) {
+				d_xyindex[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint32_t) * length[i], NULL, &status);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+				d_zindex[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t) * length[i], NULL, &status);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+				d_L[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t), NULL, &status);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+			}
+			else {
+				d_xyindex[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint32_t), NULL, &status);
+				d_zindex[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t), NULL, &status);
+				d_L[i] = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(uint16_t), NULL, &status);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+			}
 		}
 	}
 
@@ -462,139 +501,141 @@ void f_b_project(const cl_uint& num_devices_context, const float kerroin, const
 			getErrorString(status);
 			return;
 		}
-		status = commandQueues[i].enqueueWriteBuffer(d_x[i], CL_FALSE, 0, sizeof(float) * numel_x, x);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		status = commandQueues[i].enqueueWriteBuffer(d_y[i], CL_FALSE, 0, sizeof(float) * numel_x, y);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		if (CT) {
-			status = commandQueues[i].enqueueWriteBuffer(d_angles[i], CL_FALSE, 0, sizeof(float) * nProjections, angles);
+		if (newGeometry) {
+			status = commandQueues[i].enqueueWriteBuffer(d_x[i], CL_FALSE, 0, sizeof(float) * numel_x, x);
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return;
 			}
-		}
-		status = commandQueues[i].enqueueWriteBuffer(d_xcenter[i], CL_FALSE, 0, sizeof(float) * size_center_x, x_center);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		status = commandQueues[i].enqueueWriteBuffer(d_ycenter[i], CL_FALSE, 0, sizeof(float) * size_center_y, y_center);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		status = commandQueues[i].enqueueWriteBuffer(d_zcenter[i], CL_FALSE, 0, sizeof(float) * size_center_z, z_center);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		status = commandQueues[i].enqueueWriteBuffer(d_V[i], CL_FALSE, 0, sizeof(float) * size_V, V);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		status = commandQueues[i].enqueueWriteBuffer(d_z[i], CL_FALSE, 0, sizeof(float) * size_z, z_det);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		status = commandQueues[i].enqueueWriteBuffer(d_TOFCenter[i], CL_FALSE, 0, sizeof(float) * nBins, TOFCenter);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		status = commandQueues[i].enqueueWriteBuffer(d_atten[i], CL_FALSE, 0, sizeof(float) * size_atten, atten);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		status = commandQueues[i].enqueueWriteBuffer(d_pseudos[i], CL_FALSE, 0, sizeof(uint32_t) * prows, pseudos);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		status = commandQueues[i].enqueueWriteBuffer(d_rhs[i], CL_FALSE, 0, sizeof(float) * size_rhs, rhs);
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-		if (TOF && listmode != 2) {
-			for (int64_t to = 0LL; to < nBins; to++) {
-				status = commandQueues[i].enqueueWriteBuffer(d_Sino[i], CL_FALSE, sizeof(float) * length[i] * to, sizeof(float) * length[i], &Sino[cumsum[i] + koko * to]);
+			status = commandQueues[i].enqueueWriteBuffer(d_y[i], CL_FALSE, 0, sizeof(float) * numel_x, y);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				return;
 			}
-		}
-		else if (listmode != 2)
-			status = commandQueues[i].enqueueWriteBuffer(d_Sino[i], CL_FALSE, 0, sizeof(float) * length[i], &Sino[cumsum[i]]);
-		else
-			status = commandQueues[i].enqueueFillBuffer(d_Sino[i], zero, 0, sizeof(cl_float));
-		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			return;
-		}
-
-
-		if (raw && listmode != 1) {
-			status = commandQueues[i].enqueueWriteBuffer(d_xyindex[i], CL_FALSE, 0, sizeof(uint32_t), xy_index);
-			status = commandQueues[i].enqueueWriteBuffer(d_zindex[i], CL_FALSE, 0, sizeof(uint16_t), z_index);
-			status = commandQueues[i].enqueueWriteBuffer(d_L[i], CL_FALSE, 0, sizeof(uint16_t) * length[i] * 2, &L[cumsum[i] * 2]);
+			if (CT) {
+				status = commandQueues[i].enqueueWriteBuffer(d_angles[i], CL_FALSE, 0, sizeof(float) * nProjections, angles);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+			}
+			status = commandQueues[i].enqueueWriteBuffer(d_xcenter[i], CL_FALSE, 0, sizeof(float) * size_center_x, x_center);
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return;
 			}
-		}
-		else if (listmode != 1 && (!CT || subsets > 1)){
-			status = commandQueues[i].enqueueWriteBuffer(d_xyindex[i], CL_FALSE, 0, sizeof(uint32_t) * length[i], &xy_index[cumsum[i]]);
+			status = commandQueues[i].enqueueWriteBuffer(d_ycenter[i], CL_FALSE, 0, sizeof(float) * size_center_y, y_center);
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return;
 			}
-			status = commandQueues[i].enqueueWriteBuffer(d_zindex[i], CL_FALSE, 0, sizeof(uint16_t) * length[i], &z_index[cumsum[i]]);
+			status = commandQueues[i].enqueueWriteBuffer(d_zcenter[i], CL_FALSE, 0, sizeof(float) * size_center_z, z_center);
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return;
 			}
-			status = commandQueues[i].enqueueWriteBuffer(d_L[i], CL_FALSE, 0, sizeof(uint16_t), L);
+			status = commandQueues[i].enqueueWriteBuffer(d_V[i], CL_FALSE, 0, sizeof(float) * size_V, V);
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return;
 			}
-		}
-		else {
-			status = commandQueues[i].enqueueWriteBuffer(d_xyindex[i], CL_FALSE, 0, sizeof(uint32_t), xy_index);
-			status = commandQueues[i].enqueueWriteBuffer(d_zindex[i], CL_FALSE, 0, sizeof(uint16_t), z_index);
-			status = commandQueues[i].enqueueWriteBuffer(d_L[i], CL_FALSE, 0, sizeof(uint16_t), L);
+			status = commandQueues[i].enqueueWriteBuffer(d_z[i], CL_FALSE, 0, sizeof(float) * size_z, z_det);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				return;
+			}
+			status = commandQueues[i].enqueueWriteBuffer(d_TOFCenter[i], CL_FALSE, 0, sizeof(float) * nBins, TOFCenter);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				return;
+			}
+			status = commandQueues[i].enqueueWriteBuffer(d_atten[i], CL_FALSE, 0, sizeof(float) * size_atten, atten);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				return;
+			}
+			status = commandQueues[i].enqueueWriteBuffer(d_pseudos[i], CL_FALSE, 0, sizeof(uint32_t) * prows, pseudos);
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return;
 			}
 		}
-		if (precompute)
-			status = commandQueues[i].enqueueWriteBuffer(d_lor[i], CL_FALSE, 0, sizeof(uint16_t) * length[i], &lor1[cumsum[i]]);
-		else
-			status = commandQueues[i].enqueueWriteBuffer(d_lor[i], CL_FALSE, 0, sizeof(uint16_t), lor1);
+		status = commandQueues[i].enqueueWriteBuffer(d_rhs[i], CL_FALSE, 0, sizeof(float) * size_rhs, rhs);
 		if (status != CL_SUCCESS) {
 			getErrorString(status);
 			return;
 		}
-		if (normalization == 1u) {
-			status = commandQueues[i].enqueueWriteBuffer(d_norm[i], CL_FALSE, 0, sizeof(cl_float) * length[i], norm);
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
+		if (TOF && listmode != 2) {
+			for (int64_t to = 0LL; to < nBins; to++) {
+				status = commandQueues[i].enqueueWriteBuffer(d_Sino[i], CL_FALSE, sizeof(float) * length[i] * to, sizeof(float) * length[i], &Sino[cumsum[i] + koko * to]);
 			}
 		}
-		else {
-			status = commandQueues[i].enqueueWriteBuffer(d_norm[i], CL_FALSE, 0, sizeof(cl_float), norm);
+		else if (listmode != 2)
+			status = commandQueues[i].enqueueWriteBuffer(d_Sino[i], CL_FALSE, 0, sizeof(float) * length[i], &Sino[cumsum[i]]);
+		else
+			status = commandQueues[i].enqueueFillBuffer(d_Sino[i], zero, 0, sizeof(cl_float));
+		if (status != CL_SUCCESS) {
+			getErrorString(status);
+			return;
+		}
+		if (newSubset) {
+			if (raw && listmode != 1) {
+				status = commandQueues[i].enqueueWriteBuffer(d_xyindex[i], CL_FALSE, 0, sizeof(uint32_t), xy_index);
+				status = commandQueues[i].enqueueWriteBuffer(d_zindex[i], CL_FALSE, 0, sizeof(uint16_t), z_index);
+				status = commandQueues[i].enqueueWriteBuffer(d_L[i], CL_FALSE, 0, sizeof(uint16_t) * length[i] * 2, &L[cumsum[i] * 2]);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+			}
+			else if (listmode != 1 && (!CT || subsets > 1)){
+				status = commandQueues[i].enqueueWriteBuffer(d_xyindex[i], CL_FALSE, 0, sizeof(uint32_t) * length[i], &xy_index[cumsum[i]]);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+				status = commandQueues[i].enqueueWriteBuffer(d_zindex[i], CL_FALSE, 0, sizeof(uint16_t) * length[i], &z_index[cumsum[i]]);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+				status = commandQueues[i].enqueueWriteBuffer(d_L[i], CL_FALSE, 0, sizeof(uint16_t), L);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+			}
+			else {
+				status = commandQueues[i].enqueueWriteBuffer(d_xyindex[i], CL_FALSE, 0, sizeof(uint32_t), xy_index);
+				status = commandQueues[i].enqueueWriteBuffer(d_zindex[i], CL_FALSE, 0, sizeof(uint16_t), z_index);
+				status = commandQueues[i].enqueueWriteBuffer(d_L[i], CL_FALSE, 0, sizeof(uint16_t), L);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+			}
+			if (precompute)
+				status = commandQueues[i].enqueueWriteBuffer(d_lor[i], CL_FALSE, 0, sizeof(uint16_t) * length[i], &lor1[cumsum[i]]);
+			else
+				status = commandQueues[i].enqueueWriteBuffer(d_lor[i], CL_FALSE, 0, sizeof(uint16_t), lor1);
 			if (status != CL_SUCCESS) {
 				getErrorString(status);
 				return;
 			}
+			if (normalization == 1u) {
+				status = commandQueues[i].enqueueWriteBuffer(d_norm[i], CL_FALSE, 0, sizeof(cl_float) * length[i], norm);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+			}
+			else {
+				status = commandQueues[i].enqueueWriteBuffer(d_norm[i], CL_FALSE, 0, sizeof(cl_float), norm);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
+			}
 		}
 
 		status = commandQueues[i].finish();
@@ -624,15 +665,15 @@ void f_b_project(const cl_uint& num_devices_context, const float kerroin, const
 	if (num_devices_context > 1u) {
 		if (atomic_64bit) {
 			testi_summ_u.resize(num_devices_context - 1u, std::vector<int64_t>(im_dim));
-			testi_rhs_u.resize(num_devices_context - 1u, std::vector<int64_t>(im_dim));
+			testi_rhs_u.resize(num_devices_context - 1u, std::vector<int64_t>(size_output));
 		}
 		else if (atomic_32bit) {
 			testi_summ_32.resize(num_devices_context - 1u, std::vector<int32_t>(im_dim));
-			testi_rhs_32.resize(num_devices_context - 1u, std::vector<int32_t>(im_dim));
+			testi_rhs_32.resize(num_devices_context - 1u, std::vector<int32_t>(size_output));
 		}
 		else {
 			testi_summ.resize(num_devices_context - 1u, std::vector<float>(im_dim));
-			testi_rhs.resize(num_devices_context - 1u, std::vector<float>(im_dim));
+			testi_rhs.resize(num_devices_context - 1u, std::vector<float>(size_output));
 		}
 	}
 
@@ -741,42 +782,44 @@ void f_b_project(const cl_uint& num_devices_context, const float kerroin, const
 				return;
 			}
 		}
-		if (randoms_correction == 1u) {
-#ifdef MX_HAS_INTERLEAVED_COMPLEX
-			float* S_R = (float*)mxGetSingles(mxGetCell(sc_ra, static_cast<mwIndex>(0)));
-#else
-			float* S_R = (float*)mxGetData(mxGetCell(sc_ra, 0));
-#endif
-			status = commandQueues[i].enqueueWriteBuffer(d_sc_ra[i], CL_FALSE, 0, sizeof(float) * length[i], S_R);
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
+		if (newSubset) {
+			if (randoms_correction == 1u) {
+	#ifdef MX_HAS_INTERLEAVED_COMPLEX
+				float* S_R = (float*)mxGetSingles(mxGetCell(sc_ra, static_cast<mwIndex>(0)));
+	#else
+				float* S_R = (float*)mxGetData(mxGetCell(sc_ra, 0));
+	#endif
+				status = commandQueues[i].enqueueWriteBuffer(d_sc_ra[i], CL_FALSE, 0, sizeof(float) * length[i], S_R);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
 			}
-		}
-		else {
-			status = commandQueues[i].enqueueFillBuffer(d_sc_ra[i], zero, 0, sizeof(cl_float));
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
+			else {
+				status = commandQueues[i].enqueueFillBuffer(d_sc_ra[i], zero, 0, sizeof(cl_float));
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
 			}
-		}
-		if (scatter == 1u) {
-#ifdef MX_HAS_INTERLEAVED_COMPLEX
-			float* scat = (float*)mxGetSingles(mxGetCell(mxGetField(options, 0, "ScatterFB"), static_cast<mwIndex>(0)));
-#else
-			float* scat = (float*)mxGetData(mxGetCell(mxGetField(options, 0, "ScatterFB"), 0));
-#endif
-			status = commandQueues[i].enqueueWriteBuffer(d_scat[i], CL_FALSE, 0, sizeof(float) * length[i], scat);
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
+			if (scatter == 1u) {
+	#ifdef MX_HAS_INTERLEAVED_COMPLEX
+				float* scat = (float*)mxGetSingles(mxGetCell(mxGetField(options, 0, "ScatterFB"), static_cast<mwIndex>(0)));
+	#else
+				float* scat = (float*)mxGetData(mxGetCell(mxGetField(options, 0, "ScatterFB"), 0));
+	#endif
+				status = commandQueues[i].enqueueWriteBuffer(d_scat[i], CL_FALSE, 0, sizeof(float) * length[i], scat);
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
 			}
-		}
-		else {
-			status = commandQueues[i].enqueueFillBuffer(d_scat[i], zero, 0, sizeof(cl_float));
-			if (status != CL_SUCCESS) {
-				getErrorString(status);
-				return;
+			else {
+				status = commandQueues[i].enqueueFillBuffer(d_scat[i], zero, 0, sizeof(cl_float));
+				if (status != CL_SUCCESS) {
+					getErrorString(status);
+					return;
+				}
 			}
 		}
 	}
@@ -789,6 +832,34 @@ void f_b_project(const cl_uint& num_devices_context, const float kerroin, const
 		}
 	}
 
+	// Keep the uploaded buffers for the next calls
+	if (session != nullptr) {
+		if (newGeometry) {
+			session->d_z = d_z;
+			session->d_x = d_x;
+			session->d_y = d_y;
+			session->d_angles = d_angles;
+			session->d_xcenter = d_xcenter;
+			session->d_ycenter = d_ycenter;
+			session->d_zcenter = d_zcenter;
+			session->d_V = d_V;
+			session->d_atten = d_atten;
+			session->d_TOFCenter = d_TOFCenter;
+			session->d_pseudos = d_pseudos;
+			session->geometry = true;
+		}
+		if (newSubset) {
+			fbpSubsetBuffers& osa = session->subsets[session->subset];
+			osa.d_sc_ra = d_sc_ra;
+			osa.d_norm = d_norm;
+			osa.d_scat = d_scat;
+			osa.d_lor = d_lor;
+			osa.d_xyindex = d_xyindex;
+			osa.d_zindex = d_zindex;
+			osa.d_L = d_L;
+		}
+	}
+
 	std::vector<cl_ulong> globals(num_devices_context, 0ULL);
 
 	for (cl_uint i = 0; i < num_devices_context; i++) {
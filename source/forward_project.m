@@ -9,7 +9,8 @@ function varargout = forward_project(options, index, n_meas, f, nn, iternn, vara
 %   index = The indices (LORs) used to compute the system matrix (you can
 %   use index_maker to produce the indices)
 %   n_meas = Number of measurements used
-%   f = The current estimate
+%   f = The current estimate. Several estimates can be forward projected
+%   at once by storing one image per column
 %   nn = The interval from where the measurements are taken (current
 %   subset)
 %   iternn = Current subset and iteration numbers summed minus 1. E.g. this
@@ -18,7 +19,7 @@ function varargout = forward_project(options, index, n_meas, f, nn, iternn, vara
 %   include also zero measurements, then input a vector of ones.
 %
 % OUTPUTS:
-%   fp = The forward projection (fp = A * f)
+%   fp = The forward projection (fp = A * f), one column per input image
 %   options = If randoms, scatter or normalization correction is used, then
 %   they are stored in the options variable at sub-iteration 1
 %
@@ -80,11 +81,55 @@ end
 if ~isfield(options,'CT')
     options.CT = false;
 end
+% The key of the cached geometry data, computed before the geometry
+% parameters are modified (an earlier key is discarded)
+options.geometry_key = '';
+options.geometry_key = geometryHash(options);
 if ~store_matrix && options.implementation == 1 && options.CT
     error('Implementation 1 is not supported for forward/backward projection. Use B = formMatrix(A,subset) instead.')
 end
 
-f = f(:);
+% Several images can be projected at once by storing one image per column
+% of f. Implementation 1 handles these through the (sparse) matrix
+% product, implementations 3 and 4 use the batched projectors when the
+% projector supports them. Otherwise the images are projected one at a
+% time.
+nBatch = 1;
+if ismatrix(f) && size(f,2) > 1 && size(f,1) == options.Nx*options.Ny*options.Nz
+    nBatch = size(f,2);
+    if ~isfield(options,'precompute_lor')
+        options.precompute_lor = false;
+    end
+    if ~isfield(options,'n_rays_transaxial')
+        options.n_rays_transaxial = 1;
+    end
+    if ~isfield(options,'n_rays_axial')
+        options.n_rays_axial = 1;
+    end
+    batch = options.implementation == 1 || (options.projector_type == 1 && ~TOF && ~options.listmode && ~options.CT && ...
+        ((options.implementation == 4 && ~options.precompute_lor) || ((options.implementation == 2 || options.implementation == 3) && ...
+        (options.precompute_lor || options.n_rays_transaxial * options.n_rays_axial == 1))));
+    if ~batch
+        [apu, options] = forward_project(options, index, n_meas, f(:,1), nn, iternn, varargin{:});
+        tulos = zeros(numel(apu), nBatch, class(apu));
+        tulos(:,1) = apu;
+        for kk = 2 : nBatch
+            tulos(:,kk) = forward_project(options, index, n_meas, f(:,kk), nn, iternn, varargin{:});
+        end
+        varargout{1} = tulos;
+        if nargout >= 2
+            varargout{2} = options;
+        end
+        return
+    end
+end
+if nBatch > 1 && options.implementation ~= 1
+    % Voxel-interleaved layout, i.e. the images of the same voxel are
+    % stored consecutively
+    f = reshape(f.', [], 1);
+elseif nBatch == 1
+    f = f(:);
+end
 
 rings = options.rings;
 Nx = options.Nx;
@@ -153,7 +198,7 @@ end
 NSinos = uint32(options.NSinos);
 % TotSinos = int32(options.TotSinos);
 
-if numel(f) ~= Nx*Ny*Nz && ~isempty(f)
+if numel(f) ~= Nx*Ny*Nz*nBatch && ~isempty(f)
     error('Estimate has different amount of elements than the image size')
 end
 
@@ -638,11 +683,15 @@ elseif options.implementation == 4
         TOFSize = int64(numel(xy_index));
     end
     uu = ones(n_meas(end) * options.TOF_bins,1,'single');
+    options.nBatch = nBatch;
     
     [~,rhs] = computeImplementation4(options,use_raw_data,randoms_correction, n_meas(end),0, normalization_correction,...
         Nx, Ny, Nz, dx, dy, dz, bx, by, bz, x, y, z_det, xx, yy, size_x, NSinos, NSlices, zmax, attenuation_correction, pseudot, det_per_ring, ...
         TOF, TOFSize, sigma_x, TOFCenter, dec, nCores, LL, lor_a, xy_index, z_index, epps, uu, f, no_norm, ...
         x_center, y_center, z_center, bmin, bmax, Vmax, V, scatter_input, normalization, SinDelayed, dc_z, true);
+    if nBatch > 1
+        rhs = reshape(rhs, nBatch, []).';
+    end
     
     varargout{1} = rhs;
     if nargout >= 2
@@ -654,6 +703,7 @@ elseif options.implementation == 3 || options.implementation == 2
     options.implementation = 3;
     f = single(f);
     SinM = {ones(n_meas(end) * options.TOF_bins,1,'single')};
+    options.nBatch = nBatch;
     [output] = computeImplementation23(options, Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx, NSinos, NSlices, size_x, zmax, ...
     LL, pseudot, det_per_ring, TOF, sigma_x, TOFCenter, dec, options.use_device, use_raw_data, normalization, n_meas, attenuation_correction, ...
     normalization_correction, 1, 1, 1e-8, lor_a, xy_index, z_index, x_center, y_center, z_center, SinDelayed, ...
@@ -663,6 +713,9 @@ elseif options.implementation == 3 || options.implementation == 2
     else
         varargout{1} = output{1};
     end
+    if nBatch > 1
+        varargout{1} = reshape(varargout{1}, nBatch, []).';
+    end
     if nargout >= 2
         varargout{2} = options;
     end
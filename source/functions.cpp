@@ -242,7 +242,8 @@ void form_data_variables(AF_im_vectors & vec, std::vector<float> & beta, Weighti
 		w_vec.med_no_norm = getScalarBool(mxGetField(options, 0, "med_no_norm"), -27);
 		w_vec.dimmu = (w_vec.Ndx * 2 + 1) * (w_vec.Ndy * 2 + 1) * (w_vec.Ndz * 2 + 1);
 	}
-	if ((MethodList.L || MethodList.FMH || (data.TVtype == 3 && MethodList.TV) || MethodList.RDP) && MethodList.MAP) {
+	// L-filter and FMH are computed directly from the padded image and do not need these
+	if (((data.TVtype == 3 && MethodList.TV) || MethodList.RDP) && MethodList.MAP) {
 		// Index values for the neighborhood
 //#ifdef OPENCL
 #if defined(MX_HAS_INTERLEAVED_COMPLEX) && TARGET_API_VERSION > 700
@@ -423,7 +424,18 @@ void form_data_variables(AF_im_vectors & vec, std::vector<float> & beta, Weighti
 		data.TGVAlpha = getScalarFloat(mxGetField(options, 0, "alphaTGV"), -44);
 		data.TGVBeta = getScalarFloat(mxGetField(options, 0, "betaTGV"), -45);
 		data.NiterTGV = getScalarUInt32(mxGetField(options, 0, "NiterTGV"), -46);
+		const mxArray* tgvHalf = mxGetField(options, 0, "TGV_half");
+		w_vec.TGVHalf = tgvHalf != nullptr && getScalarBool(tgvHalf, -46);
 	}
+	// Support mask, the estimates are multiplied with it after each update
+	const mxArray* mask = mxGetField(options, 0, "mask");
+	w_vec.useMask = mask != nullptr && mxGetNumberOfElements(mask) == im_dim;
+	if (w_vec.useMask)
+#if defined(MX_HAS_INTERLEAVED_COMPLEX) && TARGET_API_VERSION > 700
+		w_vec.mask = af::array(im_dim, (float*)mxGetSingles(mask), afHost);
+#else
+		w_vec.mask = af::array(im_dim, (float*)mxGetData(mask), afHost);
+#endif
 	if (MethodList.NLM && MethodList.MAP) {
 		w_vec.NLM_anatomical = getScalarBool(mxGetField(options, 0, "NLM_use_anatomical"), -47);
 		w_vec.NLTV = getScalarBool(mxGetField(options, 0, "NLTV"), -48);
@@ -446,6 +458,9 @@ void form_data_variables(AF_im_vectors & vec, std::vector<float> & beta, Weighti
 #endif
 	}
 	if (MethodList.CUSTOM) {
+		// With the custom prior kernel the gradient is computed during the reconstruction
+		const mxArray* plugin = mxGetField(options, 0, "custom_prior_kernel");
+		w_vec.customPlugin = plugin != nullptr && mxIsChar(plugin) && mxGetNumberOfElements(plugin) > 0;
 		for (uint32_t kk = 0; kk < vec.imEstimates.size(); kk++) {
 			const char* varTot = mxArrayToString(mxGetCell(mxGetField(options, 0, "varTot"), kk));
 #if defined(MX_HAS_INTERLEAVED_COMPLEX) && TARGET_API_VERSION > 700
@@ -466,10 +481,12 @@ void form_data_variables(AF_im_vectors & vec, std::vector<float> & beta, Weighti
 			const char* varGrad = mxArrayToString(mxGetCell(mxGetField(options, 0, "varGrad"), tt));
 #if defined(MX_HAS_INTERLEAVED_COMPLEX) && TARGET_API_VERSION > 700
 			vec.imEstimates.push_back(af::array(im_dim, (float*)mxGetSingles(mxGetField(options, 0, varApu)), afHost));
-			w_vec.dU.push_back(af::array(im_dim, (float*)mxGetSingles(mxGetField(options, 0, varGrad)), afHost));
+			if (!w_vec.customPlugin)
+				w_vec.dU.push_back(af::array(im_dim, (float*)mxGetSingles(mxGetField(options, 0, varGrad)), afHost));
 #else
 			vec.imEstimates.push_back(af::array(im_dim, (float*)mxGetData(mxGetField(options, 0, varApu)), afHost));
-			w_vec.dU.push_back(af::array(im_dim, (float*)mxGetData(mxGetField(options, 0, varGrad)), afHost));
+			if (!w_vec.customPlugin)
+				w_vec.dU.push_back(af::array(im_dim, (float*)mxGetData(mxGetField(options, 0, varGrad)), afHost));
 #endif
 			beta.push_back(getScalarFloat(mxGetField(options, 0, varBeta), -54));
 			tt++;
@@ -573,6 +590,17 @@ void get_rec_methods(const mxArray * options, RecMethods &MethodList)
 
 	// Custom prior
 	MethodList.CUSTOM = getScalarBool(mxGetField(options, 0, "custom"), -61);
+
+	// Momentum acceleration and the log-likelihood values (optional)
+	const mxArray* apu = mxGetField(options, 0, "momentum");
+	if (apu != NULL && !mxIsEmpty(apu))
+		MethodList.MOMENTUM = (bool)mxGetScalar(apu);
+	apu = mxGetField(options, 0, "momentum_restart");
+	if (apu != NULL && !mxIsEmpty(apu))
+		MethodList.MOMENTUM_RESTART = MethodList.MOMENTUM && (bool)mxGetScalar(apu);
+	apu = mxGetField(options, 0, "compute_objective");
+	if (apu != NULL && !mxIsEmpty(apu))
+		MethodList.OBJECTIVE = (bool)mxGetScalar(apu) || MethodList.MOMENTUM_RESTART;
 }
 
 // Create the MATLAB output
@@ -1198,6 +1226,31 @@ void get_rec_methods(const mxArray * options, RecMethods &MethodList)
 //
 //}
 
+// Nesterov momentum (FISTA-type extrapolation) of each OS reconstruction, computed after each iteration
+// im_prev holds the (unextrapolated) estimates of the previous iteration and objective the log-likelihood values of each
+// iteration and reconstruction. With restart, the momentum of a reconstruction is reset when its log-likelihood decreased.
+void momentumStep(af::array& im_os, af::array& im_prev, std::vector<float>& mom_t, const std::vector<double>& objective, const uint32_t iter,
+	const uint32_t iter0, const uint32_t im_dim, const uint32_t n_rekos2, const bool restart, const float epps, const bool verbose) {
+	for (uint32_t kk = 0U; kk < n_rekos2; kk++) {
+		const af::seq ind(static_cast<double>(kk) * im_dim, static_cast<double>(kk + 1U) * im_dim - 1.);
+		const af::array apu = im_os(ind).copy();
+		// The objective is not computed with e.g. CT data, in which case the momentum is never restarted
+		if (restart && iter > iter0 && !objective.empty() && objective[iter * n_rekos2 + kk] < objective[(iter - 1U) * n_rekos2 + kk]) {
+			mom_t[kk] = 1.f;
+			if (verbose) {
+				mexPrintf("Momentum restarted at iteration %d\n", iter + 1U);
+				mexEvalString("pause(.0001);");
+			}
+		}
+		else {
+			const float t_uusi = (1.f + std::sqrt(1.f + 4.f * mom_t[kk] * mom_t[kk])) / 2.f;
+			im_os(ind) = af::max(apu + ((mom_t[kk] - 1.f) / t_uusi) * (apu - im_prev(ind)), epps);
+			mom_t[kk] = t_uusi;
+		}
+		im_prev(ind) = apu;
+	}
+}
+
 // Transfers the device data to host
 // First transfer the ArrayFire arrays from the device to the host pointers pointing to the mxArrays
 // Transfer the mxArrays to the cell
@@ -1659,29 +1712,70 @@ af::array Huber_prior(const af::array& im, const uint32_t Ndx, const uint32_t Nd
 }
 
 af::array FMH(const af::array &im, const uint32_t Ndx, const uint32_t Ndy, const uint32_t Ndz, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const float epps, const uint32_t inffi,
-	const af::array& offsets, const af::array& fmh_weights, const bool med_no_norm, const uint32_t alku_fmh, const uint32_t im_dim)
+	const af::array& fmh_weights, const bool med_no_norm, const uint32_t alku_fmh, const uint32_t im_dim, const kernelStruct& OpenCLStruct)
 {
-	af::array grad;
-	af::array indeksi1;
-	const af::array padd = af::flat(padding(im, Nx, Ny, Nz, Ndx, Ndy, Ndz));
-	uint32_t luup;
-	if (Nz == 1 || Ndz == 0) {
-		grad = af::constant(0.f, im_dim, 5);
-		luup = 4;
+	// The directional means and the median are computed in the kernel from the padded image, i.e. no neighborhood indices are needed
+	af::array padd = padding(im, Nx, Ny, Nz, Ndx, Ndy, Ndz);
+	const uint32_t nWeights = static_cast<uint32_t>(fmh_weights.dims(0));
+	const af::dim4 dimmi(padd.dims(0), padd.dims(1), padd.dims(2));
+	af::array grad = af::constant(0.f, dimmi);
+	padd = af::flat(padd);
+	grad = af::flat(grad);
+#ifdef OPENCL
+	cl::Kernel kernelFMH(OpenCLStruct.kernelFMH);
+	uint32_t kernelIndFMH = 0U;
+	cl::NDRange global_size(dimmi[0], dimmi[1], dimmi[2]);
+	cl::Buffer d_grad = cl::Buffer(*grad.device<cl_mem>(), true);
+	cl::Buffer d_padd = cl::Buffer(*padd.device<cl_mem>(), true);
+	cl::Buffer d_weights = cl::Buffer(*fmh_weights.device<cl_mem>(), true);
+	af::sync();
+	(*OpenCLStruct.af_queue).finish();
+	kernelFMH.setArg(kernelIndFMH++, d_padd);
+	kernelFMH.setArg(kernelIndFMH++, d_grad);
+	kernelFMH.setArg(kernelIndFMH++, d_weights);
+	kernelFMH.setArg(kernelIndFMH++, Nx);
+	kernelFMH.setArg(kernelIndFMH++, Ny);
+	kernelFMH.setArg(kernelIndFMH++, Nz);
+	kernelFMH.setArg(kernelIndFMH++, alku_fmh);
+	kernelFMH.setArg(kernelIndFMH++, nWeights);
+	cl_int status = (*OpenCLStruct.af_queue).enqueueNDRangeKernel(kernelFMH, cl::NullRange, global_size, cl::NullRange);
+	if (status != CL_SUCCESS) {
+		getErrorString(status);
+		mexPrintf("Failed to launch the FMH kernel\n");
+		mexEvalString("pause(.0001);");
 	}
-	else {
-		grad = af::constant(0.f, im_dim, 14);
-		luup = 13;
-	}
-	for (uint32_t ii = 0; ii < luup; ii++) {
-		indeksi1 = af::flat(offsets(af::span, af::seq(Ndx * ii, offsets.dims(1) - Ndx * (ii) - 1, alku_fmh / Ndx - ii)));
-		af::array apu_pad = af::moddims(padd(indeksi1 + 0), im_dim, fmh_weights.dims(0));
-		//grad(af::span, ii) = af::sum(af::batchFunc(apu_pad, af::transpose(fmh_weights(af::span, ii)), batchMul), 1);
-		grad(af::span, ii) = af::matmul(apu_pad, fmh_weights(af::span, ii));
-	}
-	indeksi1 = offsets.col(alku_fmh);
-	grad(af::span, af::end) = padd(indeksi1 + 0U);
-	grad = af::median(grad, 1);
+	else if (DEBUG) {
+		mexPrintf("FMH kernel launched successfully\n");
+		mexEvalString("pause(.0001);");
+	}
+	status = (*OpenCLStruct.af_queue).finish();
+#else
+	CUresult status = CUDA_SUCCESS;
+	CUdeviceptr* d_grad = grad.device<CUdeviceptr>();
+	CUdeviceptr* d_padd = padd.device<CUdeviceptr>();
+	CUdeviceptr* d_weights = fmh_weights.device<CUdeviceptr>();
+	af::sync();
+	void* args[] = { reinterpret_cast<void*>(&d_padd), reinterpret_cast<void*>(&d_grad), reinterpret_cast<void*>(&d_weights), (void*)&Nx, (void*)&Ny, (void*)&Nz,
+		(void*)&alku_fmh, (void*)&nWeights };
+	status = cuLaunchKernel(OpenCLStruct.kernelFMH, dimmi[0], dimmi[1], dimmi[2], 1, 1, 1, 0, *OpenCLStruct.af_cuda_stream, &args[0], 0);
+	if (status != CUDA_SUCCESS) {
+		std::cerr << getErrorString(status) << std::endl;
+		mexPrintf("Failed to launch the FMH kernel\n");
+		mexEvalString("pause(.0001);");
+	}
+	status = cuCtxSynchronize();
+	if (status != CUDA_SUCCESS) {
+		std::cerr << getErrorString(status) << std::endl;
+		mexPrintf("Queue finish failed after kernel\n");
+		mexEvalString("pause(.0001);");
+	}
+#endif
+	grad.unlock();
+	padd.unlock();
+	fmh_weights.unlock();
+	af::sync();
+	grad = af::moddims(grad, dimmi);
+	grad = af::flat(grad(af::seq(Ndx, Nx + Ndx - 1), af::seq(Ndy, Ny + Ndy - 1), af::seq(Ndz, Nz + Ndz - 1)));
 	if (med_no_norm)
 		grad = im - grad;
 	else
@@ -1690,13 +1784,66 @@ af::array FMH(const af::array &im, const uint32_t Ndx, const uint32_t Ndy, const
 }
 
 af::array L_filter(const af::array & im, const uint32_t Ndx, const uint32_t Ndy, const uint32_t Ndz, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const float epps,
-	const af::array& offsets, const af::array& a_L, const bool med_no_norm, const uint32_t im_dim)
+	const af::array& a_L, const bool med_no_norm, const uint32_t im_dim, const kernelStruct& OpenCLStruct)
 {
-	af::array grad;
-	af::array apu_pad = af::flat(padding(im, Nx, Ny, Nz, Ndx, Ndy, Ndz));
-	apu_pad = apu_pad(af::flat(offsets));
-	apu_pad = af::sort(af::moddims(apu_pad, im_dim, a_L.dims(0)), 1);
-	grad = af::sum(af::batchFunc(apu_pad, af::transpose(a_L), batchMul), 1);
+	// The neighborhood is sorted and weighted in the kernel from the padded image, i.e. no neighborhood indices are needed
+	af::array padd = padding(im, Nx, Ny, Nz, Ndx, Ndy, Ndz);
+	const af::dim4 dimmi(padd.dims(0), padd.dims(1), padd.dims(2));
+	af::array grad = af::constant(0.f, dimmi);
+	padd = af::flat(padd);
+	grad = af::flat(grad);
+#ifdef OPENCL
+	cl::Kernel kernelL(OpenCLStruct.kernelL);
+	uint32_t kernelIndL = 0U;
+	cl::NDRange global_size(dimmi[0], dimmi[1], dimmi[2]);
+	cl::Buffer d_grad = cl::Buffer(*grad.device<cl_mem>(), true);
+	cl::Buffer d_padd = cl::Buffer(*padd.device<cl_mem>(), true);
+	cl::Buffer d_a_L = cl::Buffer(*a_L.device<cl_mem>(), true);
+	af::sync();
+	(*OpenCLStruct.af_queue).finish();
+	kernelL.setArg(kernelIndL++, d_padd);
+	kernelL.setArg(kernelIndL++, d_grad);
+	kernelL.setArg(kernelIndL++, d_a_L);
+	kernelL.setArg(kernelIndL++, Nx);
+	kernelL.setArg(kernelIndL++, Ny);
+	kernelL.setArg(kernelIndL++, Nz);
+	cl_int status = (*OpenCLStruct.af_queue).enqueueNDRangeKernel(kernelL, cl::NullRange, global_size, cl::NullRange);
+	if (status != CL_SUCCESS) {
+		getErrorString(status);
+		mexPrintf("Failed to launch the L-filter kernel\n");
+		mexEvalString("pause(.0001);");
+	}
+	else if (DEBUG) {
+		mexPrintf("L-filter kernel launched successfully\n");
+		mexEvalString("pause(.0001);");
+	}
+	status = (*OpenCLStruct.af_queue).finish();
+#else
+	CUresult status = CUDA_SUCCESS;
+	CUdeviceptr* d_grad = grad.device<CUdeviceptr>();
+	CUdeviceptr* d_padd = padd.device<CUdeviceptr>();
+	CUdeviceptr* d_a_L = a_L.device<CUdeviceptr>();
+	af::sync();
+	void* args[] = { reinterpret_cast<void*>(&d_padd), reinterpret_cast<void*>(&d_grad), reinterpret_cast<void*>(&d_a_L), (void*)&Nx, (void*)&Ny, (void*)&Nz };
+	status = cuLaunchKernel(OpenCLStruct.kernelL, dimmi[0], dimmi[1], dimmi[2], 1, 1, 1, 0, *OpenCLStruct.af_cuda_stream, &args[0], 0);
+	if (status != CUDA_SUCCESS) {
+		std::cerr << getErrorString(status) << std::endl;
+		mexPrintf("Failed to launch the L-filter kernel\n");
+		mexEvalString("pause(.0001);");
+	}
+	status = cuCtxSynchronize();
+	if (status != CUDA_SUCCESS) {
+		std::cerr << getErrorString(status) << std::endl;
+		mexPrintf("Queue finish failed after kernel\n");
+		mexEvalString("pause(.0001);");
+	}
+#endif
+	grad.unlock();
+	padd.unlock();
+	a_L.unlock();
+	af::sync();
+	grad = af::moddims(grad, dimmi);
+	grad = af::flat(grad(af::seq(Ndx, Nx + Ndx - 1), af::seq(Ndy, Ny + Ndy - 1), af::seq(Ndz, Nz + Ndz - 1)));
 	if (med_no_norm)
 		grad = im - grad;
 	else
@@ -2009,8 +2156,73 @@ af::array TVprior(const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const
 	return gradi;
 }
 
-af::array TGV(const af::array & im, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const uint32_t maxits, const float alpha, const float beta)
+af::array TGV(const af::array & im, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const uint32_t maxits, const float alpha, const float beta, const bool TGVHalf,
+	const kernelStruct& OpenCLStruct)
 {
+#ifdef OPENCL
+	// Fused version, each iteration is one dual and one primal kernel and the state is updated in place. Only the primal image (u) is an
+	// ArrayFire array, the rest are plain buffers in either single or half precision
+	const float sigma = 1.f / 16.f;
+	const float tau = 1.f / 8.f;
+	const size_t N = static_cast<size_t>(Nx) * static_cast<size_t>(Ny) * static_cast<size_t>(Nz);
+	const size_t koko = N * (TGVHalf ? sizeof(cl_half) : sizeof(float));
+	const cl::Context context = (*OpenCLStruct.af_queue).getInfo<CL_QUEUE_CONTEXT>();
+	cl_int status = CL_SUCCESS;
+	af::array grad = af::constant(0.f, N, f32);
+	af::array imi = af::flat(im);
+	// ub, v1, v2, v3, vb1, vb2, vb3, p1, p2, p3, q1, q2, q3, q4
+	std::vector<cl::Buffer> d_tila(14);
+	for (size_t kk = 0; kk < d_tila.size(); kk++) {
+		d_tila[kk] = cl::Buffer(context, CL_MEM_READ_WRITE, koko, NULL, &status);
+		if (status != CL_SUCCESS) {
+			getErrorString(status);
+			mexPrintf("Failed to create the TGV buffers\n");
+			return grad;
+		}
+		status = (*OpenCLStruct.af_queue).enqueueFillBuffer(d_tila[kk], static_cast<cl_uchar>(0), 0, koko);
+	}
+	cl::Buffer d_u = cl::Buffer(*grad.device<cl_mem>(), true);
+	cl::Buffer d_im = cl::Buffer(*imi.device<cl_mem>(), true);
+	af::sync();
+	cl::Kernel kernelDual(OpenCLStruct.kernelTGVDual);
+	cl::Kernel kernelPrimal(OpenCLStruct.kernelTGVPrimal);
+	uint32_t kernelInd = 0U;
+	kernelDual.setArg(kernelInd++, d_tila[0]);
+	kernelDual.setArg(kernelInd++, d_im);
+	for (size_t kk = 4; kk < 14; kk++)
+		kernelDual.setArg(kernelInd++, d_tila[kk]);
+	kernelDual.setArg(kernelInd++, Nx);
+	kernelDual.setArg(kernelInd++, Ny);
+	kernelDual.setArg(kernelInd++, Nz);
+	kernelDual.setArg(kernelInd++, sigma);
+	kernelDual.setArg(kernelInd++, alpha);
+	kernelDual.setArg(kernelInd++, beta);
+	kernelInd = 0U;
+	kernelPrimal.setArg(kernelInd++, d_u);
+	for (size_t kk = 0; kk < 14; kk++)
+		kernelPrimal.setArg(kernelInd++, d_tila[kk]);
+	kernelPrimal.setArg(kernelInd++, Nx);
+	kernelPrimal.setArg(kernelInd++, Ny);
+	kernelPrimal.setArg(kernelInd++, Nz);
+	kernelPrimal.setArg(kernelInd++, tau);
+	const cl::NDRange global_size(Nx, Ny, Nz);
+	for (uint32_t kk = 0; kk < maxits; kk++) {
+		status = (*OpenCLStruct.af_queue).enqueueNDRangeKernel(kernelDual, cl::NullRange, global_size, cl::NullRange);
+		if (status == CL_SUCCESS)
+			status = (*OpenCLStruct.af_queue).enqueueNDRangeKernel(kernelPrimal, cl::NullRange, global_size, cl::NullRange);
+		if (status != CL_SUCCESS) {
+			getErrorString(status);
+			mexPrintf("Failed to launch the TGV kernels\n");
+			mexEvalString("pause(.0001);");
+			break;
+		}
+	}
+	status = (*OpenCLStruct.af_queue).finish();
+	grad.unlock();
+	imi.unlock();
+	af::sync();
+	return -grad;
+#else
 	af::array grad = af::constant(0.f, Nx, Ny, Nz, f32);
 	af::array u = grad;
 	grad = af::flat(grad);
@@ -2104,6 +2316,7 @@ af::array TGV(const af::array & im, const uint32_t Nx, const uint32_t Ny, const
 	}
 
 	return -grad;
+#endif
 }
 
 af::array RDP(const af::array& im, const uint32_t Ndx, const uint32_t Ndy, const uint32_t Ndz, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const af::array& weights_RDP, 
@@ -112,6 +112,13 @@ typedef struct Weighting_ {
 	af_diffusion_eq DiffusionType;
 	uint32_t Ndx = 1u, Ndy = 1u, Ndz = 0u, NiterAD = 1u, dimmu, inffi, Nlx = 1u, Nly = 1u, Nlz = 0u;
 	bool med_no_norm = false, MBSREM_prepass = false, NLM_MRP = false, NLTV = false, NLM_anatomical = false, deconvolution = false;
+	// Custom prior gradient computed with the user's OpenCL kernel instead of the input gradient dU
+	bool customPlugin = false;
+	// TGV variables stored in half precision
+	bool TGVHalf = false;
+	// Support mask, the voxels outside it are kept at zero
+	af::array mask;
+	bool useMask = false;
 	uint32_t g_dim_x = 0u, g_dim_y = 0u, g_dim_z = 0u;
 	uint32_t size_y = 0U;
 	int64_t nProjections = 0LL;
@@ -128,6 +135,8 @@ typedef struct RecMethods_ {
 		PKMA = false;
 	bool MAP = false;
 	bool CUSTOM = false;
+	// Nesterov momentum of the OS reconstructions, its adaptive restart and the log-likelihood of each iteration
+	bool MOMENTUM = false, MOMENTUM_RESTART = false, OBJECTIVE = false;
 	uint32_t OSLCOSEM = 0u, MAPCOSEM = 0u;
 } RecMethods;
 
@@ -159,10 +168,19 @@ typedef struct _kernelStruct {
 #ifdef OPENCL
 	cl::Kernel kernelNLM;
 	cl::Kernel kernelMed;
+	cl::Kernel kernelL;
+	cl::Kernel kernelFMH;
+	cl::Kernel kernelTGVDual;
+	cl::Kernel kernelTGVPrimal;
+	cl::Kernel kernelCustom;
+	cl::Buffer d_customParam;
+	uint32_t nCustomParam = 0U;
 	cl::CommandQueue* af_queue;
 #else
 	CUfunction kernelNLM = NULL;
 	CUfunction kernelMed = NULL;
+	CUfunction kernelL = NULL;
+	CUfunction kernelFMH = NULL;
 	CUstream* af_cuda_stream = nullptr;
 #endif
 } kernelStruct;
@@ -246,11 +264,11 @@ af::array Huber_prior(const af::array& im, const uint32_t Ndx, const uint32_t Nd
 	const uint32_t Nz, const uint32_t inffi, const af::array& offsets, const af::array& weights_huber, const uint32_t im_dim, const float delta);
 
 af::array FMH(const af::array &im, const uint32_t Ndx, const uint32_t Ndy, const uint32_t Ndz, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, 
-	const float epps, const uint32_t inffi, const af::array &offsets, const af::array &fmh_weights, const bool med_no_norm, const uint32_t alku_fmh, 
-	const uint32_t im_dim);
+	const float epps, const uint32_t inffi, const af::array &fmh_weights, const bool med_no_norm, const uint32_t alku_fmh, const uint32_t im_dim, 
+	const kernelStruct& OpenCLStruct);
 
 af::array L_filter(const af::array &im, const uint32_t Ndx, const uint32_t Ndy, const uint32_t Ndz, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, 
-	const float epps, const af::array &offsets, const af::array &a_L, const bool med_no_norm, const uint32_t im_dim);
+	const float epps, const af::array &a_L, const bool med_no_norm, const uint32_t im_dim, const kernelStruct& OpenCLStruct);
 
 af::array Weighted_mean(const af::array &im, const uint32_t Ndx, const uint32_t Ndy, const uint32_t Ndz, const uint32_t Nx, const uint32_t Ny, 
 	const uint32_t Nz, const float epps, const af::array &weighted_weights, const bool med_no_norm, const uint32_t im_dim, 
@@ -262,7 +280,8 @@ af::array AD(const af::array &im, const uint32_t Nx, const uint32_t Ny, const ui
 af::array TVprior(const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const TVdata &S, const af::array& im, const float epps, const uint32_t TVtype, 
 	const Weighting & w_vec, const af::array& offsets);
 
-af::array TGV(const af::array &im, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const uint32_t maxits, const float alpha, const float beta);
+af::array TGV(const af::array &im, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const uint32_t maxits, const float alpha, const float beta, const bool TGVHalf,
+	const kernelStruct& OpenCLStruct);
 
 af::array RDP(const af::array& im, const uint32_t Ndx, const uint32_t Ndy, const uint32_t Ndz, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const af::array& weights_RDP,
 	const uint32_t im_dim, const float gamma, const af::array& offsets, const uint32_t inffi);
@@ -320,8 +339,13 @@ void computeOSEstimatesIter(AF_im_vectors& vec, Weighting& w_vec, const RecMetho
 	const uint32_t iter, const uint32_t osa_iter0, const uint32_t subsets, const std::vector<float>& beta, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz,
 	const TVdata& data, const uint32_t n_rekos2, const kernelStruct& OpenCLStruct, const bool saveIter);
 
+void momentumStep(af::array& im_os, af::array& im_prev, std::vector<float>& mom_t, const std::vector<double>& objective, const uint32_t iter,
+	const uint32_t iter0, const uint32_t im_dim, const uint32_t n_rekos2, const bool restart, const float epps, const bool verbose);
+
 void computeMLEstimates(AF_im_vectors& vec, Weighting& w_vec, const RecMethods& MethodList, const uint32_t im_dim, const float epps,
 	const uint32_t iter, const uint32_t subsets, const std::vector<float>& beta, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz,
 	const TVdata& data, const af::array& Summ_mlem, bool& break_iter, const kernelStruct& OpenCLStruct, const bool saveIter);
 
-af::array NLM(const af::array& im, Weighting& w_vec, const float epps, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const kernelStruct& OpenCLStruct);
\ No newline at end of file
+af::array NLM(const af::array& im, Weighting& w_vec, const float epps, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const kernelStruct& OpenCLStruct);
+
+af::array customPrior(const af::array& im, const float epps, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const kernelStruct& OpenCLStruct);
\ No newline at end of file
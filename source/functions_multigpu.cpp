@@ -277,7 +277,7 @@ cl_int ClBuildProgramGetQueues(cl::Program& program, const char* k_path, const c
 	const uint32_t projector_type, const char* header_directory, const float crystal_size_z, const bool precompute, const uint8_t raw, const uint32_t attenuation_correction, 
 	const uint32_t normalization_correction, const int32_t dec, const uint8_t fp, const size_t local_size, const uint16_t n_rays, const uint16_t n_rays3D, 
 	const bool find_lors, const float cr_pz, const float dx, const bool use_psf, const uint32_t scatter, const uint32_t randoms_correction, const bool TOF, 
-	const int64_t nBins, const uint8_t listmode, const bool CT) {
+	const int64_t nBins, const uint8_t listmode, const bool CT, const uint32_t nBatch) {
 	cl_int status = CL_SUCCESS;
 
 
@@ -369,6 +369,9 @@ cl_int ClBuildProgramGetQueues(cl::Program& program, const char* k_path, const c
 		options += " -DLISTMODE";
 	else if (listmode == 2)
 		options += " -DLISTMODE2";
+	// Batched forward/backward projection of voxel-interleaved images
+	if (nBatch > 1U)
+		options += (" -DNBATCH=" + std::to_string(nBatch));
 	//if (projector_type == 1u && use_psf && (precompute || (n_rays * n_rays3D) == 1)) {
 	//	options += " -DORTH";
 	//	options += " -DCRYSTZ";
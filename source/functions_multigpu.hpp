@@ -22,9 +22,49 @@
 #include "precomp.h"
 #include <string>
 #include <cmath>
+#include <map>
 
 #define DEBUG false
 
+// The buffers of one subset that are kept in a forward/backward projection
+// session. The measurement data is not included as it is the input vector of
+// the backprojection (e.g. A' * y) and can change between the calls
+struct fbpSubsetBuffers {
+	std::vector<cl::Buffer> d_sc_ra, d_norm, d_scat, d_lor, d_xyindex, d_zindex, d_L;
+};
+
+// Forward/backward projection session. The context, the programs and the
+// geometry and correction buffers are kept between the MEX-calls, i.e.
+// repeated projections with the same forwardBackwardProject object only
+// transfer the input, measurement and output vectors. The session is
+// identified by options.fbSession, which changes whenever the properties of
+// the object change, and the subset by options.fbSubset.
+struct fbpSession {
+	uint32_t id = 0U;
+	uint32_t subset = 0U;
+	cl::Context context;
+	cl::vector<cl::Device> devices;
+	std::vector<cl::CommandQueue> commandQueues;
+	cl_uint num_devices_context = 0U;
+	int cpu_device = -1;
+	// The forward (0) and backward (1) projection programs
+	bool built[2] = { false, false };
+	bool atomics[2] = { false, false };
+	// The batch size the programs were built with
+	uint32_t nBatch[2] = { 1U, 1U };
+	cl::Program program[2];
+	cl::Kernel kernel[2];
+	cl::Kernel kernel_sum[2];
+	// Buffers that are the same for all subsets
+	bool geometry = false;
+	std::vector<cl::Buffer> d_z, d_x, d_y, d_angles, d_xcenter, d_ycenter, d_zcenter, d_V, d_atten, d_TOFCenter, d_pseudos;
+	std::map<uint32_t, fbpSubsetBuffers> subsets;
+};
+
+fbpSession& fbSession();
+
+void releaseFBSession();
+
 void OSEM_MLEM(const cl_uint& num_devices_context, const float kerroin, const int cpu_device, const cl::Context& context, const std::vector<cl::CommandQueue>& commandQueues,
 	const size_t koko, const uint16_t* lor1, const float* z_det, const float* x, const float* y, const mxArray* Sin, const mxArray* sc_ra, const uint32_t Nx,
 	const uint32_t Ny, const uint32_t Nz, const uint32_t Niter, const mxArray* options, const float dx, const float dy, const float dz, const float bx,
@@ -53,7 +93,7 @@ void f_b_project(const cl_uint& num_devices_context, const float kerroin, const
 	const size_t size_center_y, const size_t size_center_z, const bool precompute, const int32_t dec, const uint32_t projector_type, const uint16_t n_rays, 
 	const uint16_t n_rays3D, const float cr_pz, const mxArray* Sin, const bool atomic_64bit, const bool atomic_32bit, const float global_factor, const float bmin, const float bmax,
 	const float Vmax, const float* V, const size_t size_V, const uint8_t fp, size_t local_size, const mxArray* options, const uint32_t scatter, const bool TOF,
-	const int64_t TOFSize, const float sigma_x, const float* TOFCenter, const int64_t nBins);
+	const int64_t TOFSize, const float sigma_x, const float* TOFCenter, const int64_t nBins, const uint32_t nBatch = 1U, fbpSession* session = nullptr);
 
 cl_int clGetPlatformsContext(const uint32_t device, const float kerroin, cl::Context& context, size_t& size, int& cpu_device,
 	cl_uint& num_devices_context, cl::vector<cl::Device> & devices, bool& atomic_64bit, cl_uchar& compute_norm_matrix, const uint32_t Nxyz, const uint32_t subsets,
@@ -66,7 +106,7 @@ cl_int ClBuildProgramGetQueues(cl::Program& program, const char* k_path, const c
 	const uint32_t projector_type, const char* header_directory, const float crystal_size_z, const bool precompute, const uint8_t raw, const uint32_t attenuation_correction, 
 	const uint32_t normalization_correction, const int32_t dec, const uint8_t fp, const size_t local_size, const uint16_t n_rays, const uint16_t n_rays3D, const bool find_lors, 
 	const float dc_z, const float dx, const bool use_psf, const uint32_t scatter, const uint32_t randoms_correction, const bool TOF, const int64_t nBins, const uint8_t listmode = 0, 
-	const bool CT = false);
+	const bool CT = false, const uint32_t nBatch = 1U);
 
 void reconstruction_multigpu(const size_t koko, const uint16_t* lor1, const float* z_det, const float* x, const float* y, const mxArray* Sin,
 	const mxArray* sc_ra, const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const uint32_t Niter, const mxArray* options, const float dx,
@@ -0,0 +1,279 @@
+/**************************************************************************
+* Reads the selected columns of a GATE ASCII coincidence (or delayed
+* coincidence) file. The file is memory mapped and split into chunks at
+* the line boundaries, the chunks are then parsed in parallel. Only the
+* selected columns are converted and stored, i.e. the memory use depends
+* only on the number of selected columns.
+*
+* Lines that do not have the same number of columns as the first line
+* (e.g. corrupted or truncated lines) are skipped.
+*
+* The file can also be read in parts (chunks). The loader reads and
+* histograms one chunk at a time, i.e. the memory use does not depend on the
+* size of the file.
+*
+* Inputs:
+* File name and the (one-based) indices of the columns to read. If only
+* the file name is input, only the number of columns on the first line is
+* output. The optional third input is the (zero-based, half-open) byte range
+* [start end) of the chunk to read. If the column indices are empty, the
+* third input is instead the maximum size of a chunk (in bytes) and the
+* byte offsets of the line-aligned chunk boundaries are output.
+*
+* Outputs:
+* The selected columns (double precision matrix), the total number of
+* columns in the file and the number of skipped lines.
+*
+* Copyright (C) 2020 Ville-Veikko Wettenhovi
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <https://www.gnu.org/licenses/>.
+***************************************************************************/
+#include "mex.h"
+#include "mappedFile.h"
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static inline bool isSpace(const char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Convert a single field, std::from_chars is used when available
+static inline double parseField(const char* alku, const char* loppu) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+	double arvo;
+	const std::from_chars_result tulos = std::from_chars(alku, loppu, arvo);
+	if (tulos.ec != std::errc())
+		return std::numeric_limits<double>::quiet_NaN();
+	return arvo;
+#else
+	// The mapped data is not null-terminated
+	char puskuri[64];
+	const size_t n = std::min(static_cast<size_t>(loppu - alku), sizeof(puskuri) - 1);
+	std::memcpy(puskuri, alku, n);
+	puskuri[n] = '\0';
+	char* end;
+	const double arvo = std::strtod(puskuri, &end);
+	if (end == puskuri)
+		return std::numeric_limits<double>::quiet_NaN();
+	return arvo;
+#endif
+}
+
+// Number of whitespace separated fields on the line [alku, loppu)
+static inline uint32_t countFields(const char* alku, const char* loppu) {
+	uint32_t n = 0U;
+	bool field = false;
+	for (const char* c = alku; c < loppu; c++) {
+		if (isSpace(*c))
+			field = false;
+		else if (!field) {
+			field = true;
+			n++;
+		}
+	}
+	return n;
+}
+
+// Parse the selected fields of the line into the output matrix (column-
+// major, nRows rows). sarake is the output column of each input column
+// (-1 if not selected).
+static inline void parseLine(const char* alku, const char* loppu, const std::vector<int32_t>& sarake, double* M, const size_t rivi,
+	const size_t nRows) {
+	uint32_t kk = 0U;
+	const char* c = alku;
+	while (c < loppu && kk < sarake.size()) {
+		while (c < loppu && isSpace(*c))
+			c++;
+		const char* f = c;
+		while (c < loppu && !isSpace(*c))
+			c++;
+		if (f == c)
+			break;
+		if (sarake[kk] >= 0)
+			M[rivi + static_cast<size_t>(sarake[kk]) * nRows] = parseField(f, c);
+		kk++;
+	}
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
+	int nrhs, const mxArray*prhs[])
+
+{
+	if (nrhs < 1 || nrhs > 3) {
+		mexErrMsgIdAndTxt("MATLAB:gate_ascii_reader:invalidNumInputs",
+			"1, 2 or 3 input arguments required.");
+	}
+	else if (nlhs > 3) {
+		mexErrMsgIdAndTxt("MATLAB:gate_ascii_reader:maxlhs",
+			"Too many output arguments.");
+	}
+	if (!mxIsChar(prhs[0]))
+		mexErrMsgTxt("Input argument is not char");
+
+	char* tiedosto = mxArrayToString(prhs[0]);
+	mappedFile tiedot;
+	const bool avattu = tiedot.open(tiedosto);
+	mxFree(tiedosto);
+	if (!avattu)
+		mexErrMsgIdAndTxt("MATLAB:gate_ascii_reader:invalidFile",
+			"Error opening file or no file opened");
+	const char* data = tiedot.bytes_ptr();
+	const size_t koko = tiedot.size();
+
+	// The number of columns is determined from the first non-empty line
+	uint32_t nColumns = 0U;
+	size_t ll = 0;
+	while (ll < koko && nColumns == 0U) {
+		const char* rivi = static_cast<const char*>(std::memchr(data + ll, '\n', koko - ll));
+		const size_t loppu = rivi == nullptr ? koko : static_cast<size_t>(rivi - data);
+		nColumns = countFields(data + ll, data + loppu);
+		ll = loppu + 1;
+	}
+
+	if (nrhs == 1) {
+		plhs[0] = mxCreateDoubleScalar(static_cast<double>(nColumns));
+		return;
+	}
+
+	// Boundaries of the chunks, each at most tavut bytes (or a single line)
+	if (nrhs == 3 && mxIsEmpty(prhs[1])) {
+		const size_t tavut = std::max(static_cast<size_t>(mxGetScalar(prhs[2])), static_cast<size_t>(1));
+		std::vector<double> rajat(1, 0.);
+		size_t kohta = 0;
+		while (kohta < koko) {
+			size_t seuraava = kohta + tavut;
+			if (seuraava >= koko)
+				seuraava = koko;
+			else {
+				// Move the boundary to the start of the next line
+				const char* rivi = static_cast<const char*>(std::memchr(data + seuraava - 1, '\n', koko - seuraava + 1));
+				seuraava = rivi == nullptr ? koko : static_cast<size_t>(rivi - data) + 1;
+			}
+			rajat.push_back(static_cast<double>(seuraava));
+			kohta = seuraava;
+		}
+		tiedot.close();
+		plhs[0] = mxCreateNumericMatrix(1, rajat.size(), mxDOUBLE_CLASS, mxREAL);
+		std::copy(rajat.begin(), rajat.end(), mxGetPr(plhs[0]));
+		return;
+	}
+
+	// The byte range to read, the whole file by default
+	size_t alku = 0, loppu = koko;
+	if (nrhs == 3) {
+		if (mxGetNumberOfElements(prhs[2]) != 2)
+			mexErrMsgIdAndTxt("MATLAB:gate_ascii_reader:invalidRange",
+				"The byte range must have two elements");
+		const double* alue = mxGetPr(prhs[2]);
+		alku = std::min(static_cast<size_t>(alue[0]), koko);
+		loppu = std::min(std::max(static_cast<size_t>(alue[1]), alku), koko);
+	}
+
+	const double* sarakkeet = mxGetPr(prhs[1]);
+	const size_t nSelected = mxGetNumberOfElements(prhs[1]);
+	std::vector<int32_t> sarake(nColumns, -1);
+	uint32_t maxSarake = 0U;
+	for (size_t kk = 0; kk < nSelected; kk++) {
+		const int64_t s = static_cast<int64_t>(sarakkeet[kk]) - 1;
+		if (s < 0 || s >= static_cast<int64_t>(nColumns))
+			mexErrMsgIdAndTxt("MATLAB:gate_ascii_reader:invalidColumn",
+				"Selected column exceeds the number of columns in the file");
+		sarake[s] = static_cast<int32_t>(kk);
+		maxSarake = std::max(maxSarake, static_cast<uint32_t>(s + 1));
+	}
+	// No need to tokenize the fields after the last selected column
+	sarake.resize(maxSarake);
+
+#ifdef _OPENMP
+	const int64_t nThreads = static_cast<int64_t>(omp_get_max_threads());
+#else
+	const int64_t nThreads = 1LL;
+#endif
+	// Split the range into parts for the threads at the line boundaries
+	const int64_t nChunks = nThreads * 8LL;
+	const size_t pituus = loppu - alku;
+	std::vector<size_t> alut(nChunks + 1, loppu);
+	alut[0] = alku;
+	for (int64_t kk = 1; kk < nChunks; kk++) {
+		size_t kohta = std::max(alku + static_cast<size_t>(kk) * (pituus / static_cast<size_t>(nChunks)), alut[kk - 1]);
+		const char* rivi = kohta < loppu ? static_cast<const char*>(std::memchr(data + kohta, '\n', loppu - kohta)) : nullptr;
+		alut[kk] = rivi == nullptr ? loppu : static_cast<size_t>(rivi - data) + 1;
+	}
+
+	// First pass, count the valid lines of each chunk
+	std::vector<size_t> rivit(nChunks + 1, 0);
+	std::vector<size_t> ohitetut(nChunks, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int64_t kk = 0; kk < nChunks; kk++) {
+		size_t kohta = alut[kk];
+		while (kohta < alut[kk + 1]) {
+			const char* rivi = static_cast<const char*>(std::memchr(data + kohta, '\n', alut[kk + 1] - kohta));
+			const size_t loppu = rivi == nullptr ? alut[kk + 1] : static_cast<size_t>(rivi - data);
+			const uint32_t n = countFields(data + kohta, data + loppu);
+			if (n == nColumns)
+				rivit[kk + 1]++;
+			else if (n > 0U)
+				ohitetut[kk]++;
+			kohta = loppu + 1;
+		}
+	}
+	size_t nSkipped = 0;
+	for (int64_t kk = 0; kk < nChunks; kk++) {
+		rivit[kk + 1] += rivit[kk];
+		nSkipped += ohitetut[kk];
+	}
+	const size_t nRows = rivit[nChunks];
+
+	plhs[0] = mxCreateNumericMatrix(nRows, nSelected, mxDOUBLE_CLASS, mxREAL);
+	double* M = mxGetPr(plhs[0]);
+
+	// Second pass, parse the selected columns of the valid lines
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int64_t kk = 0; kk < nChunks; kk++) {
+		size_t kohta = alut[kk];
+		size_t r = rivit[kk];
+		while (kohta < alut[kk + 1]) {
+			const char* rivi = static_cast<const char*>(std::memchr(data + kohta, '\n', alut[kk + 1] - kohta));
+			const size_t loppu = rivi == nullptr ? alut[kk + 1] : static_cast<size_t>(rivi - data);
+			if (countFields(data + kohta, data + loppu) == nColumns) {
+				parseLine(data + kohta, data + loppu, sarake, M, r, nRows);
+				r++;
+			}
+			kohta = loppu + 1;
+		}
+	}
+	tiedot.close();
+
+	if (nlhs > 1)
+		plhs[1] = mxCreateDoubleScalar(static_cast<double>(nColumns));
+	if (nlhs > 2)
+		plhs[2] = mxCreateDoubleScalar(static_cast<double>(nSkipped));
+	return;
+}
@@ -1,6 +1,7 @@
 /**************************************************************************
 * This file loads the LMF binary data and converts it into the detector
-* pair numbers. 
+* pair numbers. The file is memory mapped and decoded blockwise, the
+* coincidences of each block are histogrammed in parallel.
 *
 * Copyright (C) 2020 Ville-Veikko Wettenhovi
 *
@@ -17,13 +18,41 @@
 * You should have received a copy of the GNU General Public License
 * along with this program. If not, see <https://www.gnu.org/licenses/>.
 ***************************************************************************/
-#include <fstream>
+#include <cstring>
+#include <vector>
 #include "mex.h"
 #include "dIndices.h"
 #include "saveSinogram.h"
+#include "mappedFile.h"
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#define lmfSwap16 _byteswap_ushort
+#define lmfSwap32 _byteswap_ulong
+#define lmfSwap64 _byteswap_uint64
+#else
+#define lmfSwap16 __builtin_bswap16
+#define lmfSwap32 __builtin_bswap32
+#define lmfSwap64 __builtin_bswap64
+#endif
 
+// The LMF data is big-endian, the records are not necessarily aligned
+static inline uint64_t lmfRead64(const char* p) {
+	uint64_t arvo;
+	std::memcpy(&arvo, p, sizeof(uint64_t));
+	return lmfSwap64(arvo);
+}
 
-FILE *streami;
+static inline uint32_t lmfRead32(const char* p) {
+	uint32_t arvo;
+	std::memcpy(&arvo, p, sizeof(uint32_t));
+	return lmfSwap32(arvo);
+}
+
+static inline uint16_t lmfRead16(const char* p) {
+	uint16_t arvo;
+	std::memcpy(&arvo, p, sizeof(uint16_t));
+	return lmfSwap16(arvo);
+}
 
 
 void histogram(uint16_t * LL1, uint16_t * LL2, uint64_t * tpoints, char *argv, const double vali, const double alku, const double loppu, const size_t outsize2, 
@@ -36,51 +65,33 @@ void histogram(uint16_t * LL1, uint16_t * LL2, uint64_t * tpoints, char *argv, c
 	uint16_t* SinoT, uint16_t* SinoC, uint16_t* SinoR, const int32_t detWPseudo, const int32_t nPseudos)
 {
 
-	unsigned char ew1[8];
-	static int tag;
-
-	int i1 = -1;
-	int64_t i = 1;
-	int ll = -1;
-
-	uint64_t ms = 0;
-	uint64_t ms2 = 0;
-
-#if (defined(WIN32) || defined(_WIN32) || (defined(__WIN32) && !defined(__CYGWIN__)) || defined(_WIN64)) && defined(_MSC_VER)
-	fopen_s(&streami, argv, "rb");
-#else
-	streami = fopen(argv, "rb");
-#endif
-	if (streami == NULL) {
+	// The whole file is memory mapped, the singles are decoded blockwise
+	mappedFile tiedot;
+	if (!tiedot.open(argv)) {
 		mexErrMsgIdAndTxt("MATLAB:gate_lmf_matlab:invalidFile",
 			"Error opening file");
 	}
-
-	bool warning = false;
-	uint32_t R; // R-sector 1
-	uint32_t M; // Module 1 
-	uint32_t Sm; // Submodule 1
-	uint32_t C; // Crystal 1
-	uint32_t R2; // R-sector 2
-	uint32_t M2; // Module  
-	uint32_t Sm2; // Submodule 2
-	uint32_t C2; // Crystal 2
-	uint64_t time = 0;
-	uint32_t eventID1;
-	uint32_t eventID2;
-	uint8_t n_ComptonP1;
-	uint8_t n_ComptonP2;
-	int oo = 0;
-	data_bytes = data_bytes - 8;
+	const char* data = tiedot.bytes_ptr();
+	const int64_t n_singles = tiedot.size() > static_cast<size_t>(header_bytes) ? static_cast<int64_t>((tiedot.size() - header_bytes) / data_bytes) : 0LL;
+
+	const bool eventIDs = obtain_trues || store_randoms || store_scatter;
+	const bool compton = obtain_trues || store_scatter;
+	// Byte offsets of the fields inside a single record
+	const int64_t off_id = 8LL;
+	const int64_t off_event = off_id + 2LL;
+	const int64_t off_source = off_event + (eventIDs ? 4LL : 0LL);
+	const int64_t off_compton = off_source + (source ? 6LL : 0LL);
+
+	int64_t i1 = -1;
+	int64_t ll = -1;
 	double aika = alku;
 	bool begin = false;
 	if (outsize2 > 1)
 		begin = true;
 	int pa = 0;
-	int jj = 0;
+	size_t jj = 0;
 	tpoints[jj] = 0;
 	jj++;
-	uint64_t num;
 	const bool no_modules = M_bits <= 1;
 	const bool no_submodules = S_bits <= 1;
 	const bool pseudoD = detWPseudo > det_per_ring;
@@ -90,242 +101,214 @@ void histogram(uint16_t * LL1, uint16_t * LL2, uint64_t * tpoints, char *argv, c
 		gapSize = rings / (nPseudos + 1);
 	}
 
-	uint64_t window = static_cast<uint64_t>(coincidence_window);
-	fseek(streami, header_bytes, SEEK_SET);
-	while ((i = fread(&ew1, 1, 8, streami)) != 0) {
-
-		i1++;
-		ll++;
-
-		int bytes_left = data_bytes;
-
-
-		num = (uint64_t)ew1[7] | (uint64_t)ew1[6] << 8 | (uint64_t)ew1[5] << 16 | (uint64_t)ew1[4] << 24 | (uint64_t)ew1[3] << 32 | (uint64_t)ew1[2] << 40 | (uint64_t)ew1[1] << 48 | (uint64_t)ew1[0] << 56;
-		//uint64_t num = (uint64_t)ew1[0] | (uint64_t)ew1[1] << 8 | (uint64_t)ew1[2] << 16 | (uint64_t)ew1[3] << 24 | (uint64_t)ew1[4] << 32 | (uint64_t)ew1[5] << 40 | (uint64_t)ew1[6] << 48 | (uint64_t)ew1[7] << 56;
-
-		tag = ((num << (63)) & 1);
-
-
-
-		if (tag != 0 && warning == false) {
-			mexPrintf("Tag %d\n", tag);
+	const uint64_t window = static_cast<uint64_t>(coincidence_window);
+	// Number of singles decoded at a time
+	const int64_t LMF_BLOCK = 4194304LL;
+	const char* alkuData = data + header_bytes;
+	// Time stamps of the current block (structure-of-arrays) and the
+	// coincidences (record indices of both singles) found in the block
+	std::vector<uint64_t> ms(std::min(n_singles, LMF_BLOCK));
+	std::vector<int64_t> pari1, pari2;
+	bool warning = false;
+	bool loppui = false;
+	// The first single of the (possible) coincidence
+	uint64_t ms1 = 0ULL;
+
+	for (int64_t blokki = 0; blokki < n_singles && !loppui; blokki += LMF_BLOCK) {
+		const int64_t koko = std::min(LMF_BLOCK, n_singles - blokki);
+		bool tagged = false;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(||:tagged)
+#endif
+		for (int64_t kk = 0; kk < koko; kk++) {
+			ms[kk] = lmfRead64(alkuData + (blokki + kk) * data_bytes);
+			tagged = tagged || (ms[kk] >> 63) != 0ULL;
+		}
+		if (tagged && warning == false) {
 			mexWarnMsgTxt("Tag bit not zero, make sure header and data bytes are correct");
 			warning = true;
 		}
 
-		int16_t X, Y, Z;
-		
-		if (tag == 0) {
+		// Pair the singles into coincidences, this depends on the
+		// previous single and is thus done serially
+		pari1.clear();
+		pari2.clear();
+		for (int64_t kk = 0; kk < koko; kk++) {
+			i1 = blokki + kk;
+			const uint64_t ms2 = ms[kk];
+			if ((ms2 >> 63) != 0ULL)
+				continue;
 			// First single
-			if (ll == 0) {
-				// Time
-				ms = (num & 0xFFFFFFFFFFFFFFFF);
+			if (ll < 0) {
 				// Continue if the time is less than the start time
-				if ((static_cast<double>(ms) * time_step) < alku) {
-					ll = -1;
-					i = fread(&ew1, 1, data_bytes, streami);
+				if ((static_cast<double>(ms2) * time_step) < alku)
 					continue;
-				}
 				// Stop if the time is more than the end time
-				else if ((static_cast<double>(ms) * time_step) > loppu)
+				else if ((static_cast<double>(ms2) * time_step) > loppu) {
+					loppui = true;
 					break;
-				//i = fread(&ew1, 1, data_bytes, streami);
-				i = fread(&ew1, 1, 2, streami);
-				bytes_left -= 2;
-				//if (data_bytes == 8)
-					//num = (uint64_t)ew1[7] | (uint64_t)ew1[6] << 8 | (uint64_t)ew1[5] << 16 | (uint64_t)ew1[4] << 24 | (uint64_t)ew1[3] << 32 | (uint64_t)ew1[2] << 40 | (uint64_t)ew1[1] << 48 | (uint64_t)ew1[0] << 56;
-				num = (uint64_t)ew1[1] | (uint64_t)ew1[0] << 8;
-				R = ((num >> (16 - R_bits)) & R_length);
-				M = (num >> (16 - R_bits - M_bits)) & M_length;
-				Sm = (num >> (16 - R_bits - M_bits - S_bits)) & S_length;
-				C = (num >> (16 - R_bits - M_bits - S_bits - C_bits)) & C_length;
-				if (obtain_trues || store_randoms || store_scatter) {
-					i = fread(&ew1, 1, 4, streami);
-					eventID1 = (uint32_t)ew1[3] | (uint32_t)ew1[2] << 8 | (uint32_t)ew1[1] << 16 | (uint32_t)ew1[0] << 24;
-					bytes_left -= 4;
 				}
-				if (source) {
-					i = fread(&ew1, 1, 6, streami);
-					num = (uint64_t)ew1[5] | (uint64_t)ew1[4] << 8 | (uint64_t)ew1[3] << 16 | (uint64_t)ew1[2] << 24 | (uint64_t)ew1[1] << 32 | (uint64_t)ew1[0] << 40;
-					X = (num >> 32) & 0xFFFF;
-					Y = (num >> 16) & 0xFFFF;
-					Z = num & 0xFFFF;
-					bytes_left -= 6;
+				ll = i1;
+				ms1 = ms2;
+			}
+			// If within coincidence, form a coincidence event
+			else if (ms2 - ms1 <= window) {
+				pari1.emplace_back(ll);
+				pari2.emplace_back(i1);
+				if (outsize2 == 1) {
+					int_loc[0] = pa;
 				}
-				if (store_scatter || obtain_trues) {
-					i = fread(&ew1, 1, 1, streami);
-					n_ComptonP1 = (uint8_t)ew1[0];
-					bytes_left -= 1;
+				else {
+					if (begin) {
+						while ((static_cast<double>(ms2) * time_step) >= time_intervals[pa])
+							pa++;
+						begin = false;
+						aika = time_intervals[pa];
+						int_loc[0] = pa;
+					}
+					if ((static_cast<double>(ms2) * time_step) >= aika && jj <= outsize2) {
+						tpoints[jj++] = i1;
+						aika = time_intervals[++pa];
+					}
 				}
-				if (bytes_left > 0)
-					i = fread(&ew1, 1, bytes_left, streami);
+				ll = -1;
 			}
-			// If a single has already been detected, check the second single
+			// Otherwise discard the earlier single and replace it with this one
 			else {
-				ms2 = (num & 0xFFFFFFFFFFFFFFFF);
-				i = fread(&ew1, 1, 2, streami);
-				bytes_left -= 2;
-				num = (uint64_t)ew1[1] | (uint64_t)ew1[0] << 8;
-				// If within coincidence, form a coincidence event
-				if (ms2 - ms <= window) {
-					bool event_true = true;
-					bool event_scattered = false;
-					R2 = ((num >> (16 - R_bits)) & R_length);
-					M2 = (num >> (16 - R_bits - M_bits)) & M_length;
-					Sm2 = (num >> (16 - R_bits - M_bits - S_bits)) & S_length;
-					C2 = (num >> (16 - R_bits - M_bits - S_bits - C_bits)) & C_length;
-					uint32_t ring_number1 = 0, ring_number2 = 0, ring_pos1 = 0, ring_pos2 = 0;
-					uint64_t bins = 0;
-					detectorIndices(ring_number1, ring_number2, ring_pos1, ring_pos2, blocks_per_ring, linear_multip, no_modules, no_submodules, M, M2, Sm,
-						Sm2, R, R2, C, C2, cryst_per_block, cryst_per_block_z, transaxial_multip, rings);
-					if (obtain_trues || store_randoms || store_scatter) {
-						i = fread(&ew1, 1, 4, streami);
-						bytes_left -= 4;
-						eventID2 = (uint32_t)ew1[3] | (uint32_t)ew1[2] << 8 | (uint32_t)ew1[1] << 16 | (uint32_t)ew1[0] << 24;
-					}
-					if (source) {
-						i = fread(&ew1, 1, 6, streami);
-						bytes_left -= 6;
-						num = (uint64_t)ew1[5] | (uint64_t)ew1[4] << 8 | (uint64_t)ew1[3] << 16 | (uint64_t)ew1[2] << 24 | (uint64_t)ew1[1] << 32 | (uint64_t)ew1[0] << 40;
-						S[i1] = X;
-						S[i1 + pituus] = Y;
-						S[i1 + pituus * 2] = Z;
-						S[i1 + pituus * 3] = (num >> 32) & 0xFFFF;
-						S[i1 + pituus * 4] = (num >> 16) & 0xFFFF;
-						S[i1 + pituus * 5] = num & 0xFFFF;
-					}
-					if (obtain_trues || store_scatter) {
-						i = fread(&ew1, 1, 1, streami);
-						n_ComptonP2 = (uint8_t)ew1[0];
-						bytes_left -= 1;
-					}
-					if (obtain_trues || store_randoms || store_scatter) {
-						event_true = (eventID1 == eventID2 && n_ComptonP1 == 0 && n_ComptonP2 == 0);
-						event_scattered = (eventID1 == eventID2 && (n_ComptonP1 > 0 || n_ComptonP2 > 0));
-						if (source && (outsize2 == 1ULL || !storeRawData)) {
-							if (event_true && obtain_trues)
-								trues_loc[i1] = true;
-						}
-					}
-					if (storeRawData) {
-						uint32_t L1 = ring_number1 * det_per_ring + ring_pos1;
-						uint32_t L2 = ring_number2 * det_per_ring + ring_pos2;
-						if (L2 > L1) {
-							const uint32_t L3 = L1;
-							L1 = L2;
-							L2 = L3;
-						}
-						if (outsize2 == 1 && store_randoms) {
-							if (eventID1 != eventID2)
-								Lrandoms[L1 * detectors + L2] = Lrandoms[L1 * detectors + L2] + static_cast<uint16_t>(1);
-						}
-						else if (store_randoms) {
-							if (eventID1 != eventID2)
-								Lrandoms[i1] = 1;
-						}
-						if (outsize2 == 1) {
-							if (obtain_trues && event_true) {
-								Ltrues[L1 * detectors + L2] = Ltrues[L1 * detectors + L2] + static_cast<uint16_t>(1);
-							}
-							else if (store_scatter && event_scattered)
-								Lscatter[L1 * detectors + L2] = Lscatter[L1 * detectors + L2] + static_cast<uint16_t>(1);
-						}
-						else {
-							if (obtain_trues && event_true)
-								Ltrues[i1] = 1;
-							else if (store_scatter && event_scattered)
-								Lscatter[i1] = 1;
-						}
-						if (outsize2 == 1)
-							LL1[L1 * detectors + L2] = LL1[L1 * detectors + L2] + static_cast<uint16_t>(1);
-						else {
-							LL1[i1] = static_cast<uint16_t>(L1 + 1);
-							LL2[i1] = static_cast<uint16_t>(L2 + 1);
-						}
-					}
-					if (pseudoD) {
-						ring_pos1 += ring_pos1 / cryst_per_block;
-						ring_pos2 += ring_pos2 / cryst_per_block;
-					}
-					if (pseudoR) {
-						ring_number1 += ring_number1 / gapSize;
-						ring_number2 += ring_number2 / gapSize;
-					}
-					bool swap = false;
-					const int64_t sinoIndex = saveSinogram(ring_pos1, ring_pos2, ring_number1, ring_number2, sinoSize, Ndist, Nang, ringDifference, span, seg, time, NT, TOFSize,
-						vali, alku, detWPseudo, rings, bins, nDistSide, swap);
-					if (sinoIndex >= 0) {
-						Sino[sinoIndex]++;
-						if ((event_true && obtain_trues) || (event_scattered && store_scatter)) {
-							if (event_true && obtain_trues)
-								SinoT[sinoIndex]++;
-							else if (event_scattered && store_scatter)
-								SinoC[sinoIndex]++;
-						}
-						else if (!event_true && store_randoms)
-							SinoR[sinoIndex]++;
+				ll = i1;
+				ms1 = ms2;
+			}
+		}
+
+		// Detector indices, trues/scatter/randoms and sinogram bins of the
+		// coincidences
+		const int64_t n_pairs = static_cast<int64_t>(pari1.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int64_t kk = 0; kk < n_pairs; kk++) {
+			const char* single1 = alkuData + pari1[kk] * data_bytes;
+			const char* single2 = alkuData + pari2[kk] * data_bytes;
+			const int64_t ind = pari2[kk];
+			const uint32_t num = static_cast<uint32_t>(lmfRead16(single1 + off_id));
+			const uint32_t num2 = static_cast<uint32_t>(lmfRead16(single2 + off_id));
+			const uint32_t R = ((num >> (16 - R_bits)) & R_length);
+			const uint32_t M = (num >> (16 - R_bits - M_bits)) & M_length;
+			const uint32_t Sm = (num >> (16 - R_bits - M_bits - S_bits)) & S_length;
+			const uint32_t C = (num >> (16 - R_bits - M_bits - S_bits - C_bits)) & C_length;
+			const uint32_t R2 = ((num2 >> (16 - R_bits)) & R_length);
+			const uint32_t M2 = (num2 >> (16 - R_bits - M_bits)) & M_length;
+			const uint32_t Sm2 = (num2 >> (16 - R_bits - M_bits - S_bits)) & S_length;
+			const uint32_t C2 = (num2 >> (16 - R_bits - M_bits - S_bits - C_bits)) & C_length;
+			uint32_t ring_number1 = 0, ring_number2 = 0, ring_pos1 = 0, ring_pos2 = 0;
+			const uint64_t bins = 0;
+			detectorIndices(ring_number1, ring_number2, ring_pos1, ring_pos2, blocks_per_ring, linear_multip, no_modules, no_submodules, M, M2, Sm,
+				Sm2, R, R2, C, C2, cryst_per_block, cryst_per_block_z, transaxial_multip, rings);
+			bool event_true = true;
+			bool event_scattered = false;
+			uint32_t eventID1 = 0U, eventID2 = 0U;
+			if (eventIDs) {
+				eventID1 = lmfRead32(single1 + off_event);
+				eventID2 = lmfRead32(single2 + off_event);
+			}
+			if (source && static_cast<size_t>(ind) < pituus) {
+				for (int64_t uu = 0; uu < 3LL; uu++) {
+					S[ind + pituus * uu] = static_cast<int16_t>(lmfRead16(single1 + off_source + uu * 2LL));
+					S[ind + pituus * (uu + 3LL)] = static_cast<int16_t>(lmfRead16(single2 + off_source + uu * 2LL));
+				}
+			}
+			if (eventIDs) {
+				uint8_t n_ComptonP1 = 0U, n_ComptonP2 = 0U;
+				if (compton) {
+					n_ComptonP1 = static_cast<uint8_t>(single1[off_compton]);
+					n_ComptonP2 = static_cast<uint8_t>(single2[off_compton]);
+				}
+				event_true = (eventID1 == eventID2 && n_ComptonP1 == 0 && n_ComptonP2 == 0);
+				event_scattered = (eventID1 == eventID2 && (n_ComptonP1 > 0 || n_ComptonP2 > 0));
+				if (source && (outsize2 == 1ULL || !storeRawData)) {
+					if (event_true && obtain_trues)
+						trues_loc[ind] = true;
+				}
+			}
+			if (storeRawData) {
+				uint32_t L1 = ring_number1 * det_per_ring + ring_pos1;
+				uint32_t L2 = ring_number2 * det_per_ring + ring_pos2;
+				if (L2 > L1) {
+					const uint32_t L3 = L1;
+					L1 = L2;
+					L2 = L3;
+				}
+				const uint64_t Lind = static_cast<uint64_t>(L1) * static_cast<uint64_t>(detectors) + static_cast<uint64_t>(L2);
+				if (outsize2 == 1) {
+					if (store_randoms && eventID1 != eventID2) {
+#pragma omp atomic
+						Lrandoms[Lind]++;
 					}
-					if (outsize2 == 1) {
-						int_loc[0] = pa;
+					if (obtain_trues && event_true) {
+#pragma omp atomic
+						Ltrues[Lind]++;
 					}
-					else {
-						if (begin) {
-							while ((static_cast<double>(ms2) * time_step) >= time_intervals[pa])
-								pa++;
-							//pa--;
-							begin = false;
-							aika = time_intervals[pa];
-							int_loc[0] = pa;
-						}
-						if ((static_cast<double>(ms2) * time_step) >= aika) {
-							tpoints[jj++] = i1;
-							aika = time_intervals[++pa];
-						}
+					else if (store_scatter && event_scattered) {
+#pragma omp atomic
+						Lscatter[Lind]++;
 					}
-					ll = -1;
-					if (bytes_left > 0)
-						i = fread(&ew1, 1, bytes_left, streami);
+#pragma omp atomic
+					LL1[Lind]++;
 				}
-				// Otherwise discard the earlier single and replace it with this one
 				else {
-					R = ((num >> (16 - R_bits)) & R_length);
-					M = (num >> (16 - R_bits - M_bits)) & M_length;
-					C = (num >> (16 - R_bits - M_bits - S_bits - C_bits)) & C_length;
-					if (obtain_trues || store_randoms || store_scatter) {
-						i = fread(&ew1, 1, 4, streami);
-						eventID1 = (uint32_t)ew1[3] | (uint32_t)ew1[2] << 8 | (uint32_t)ew1[1] << 16 | (uint32_t)ew1[0] << 24;
-						bytes_left -= 4;
-					}
-					if (source) {
-						i = fread(&ew1, 1, 6, streami);
-						bytes_left -= 6;
-						num = (uint64_t)ew1[5] | (uint64_t)ew1[4] << 8 | (uint64_t)ew1[3] << 16 | (uint64_t)ew1[2] << 24 | (uint64_t)ew1[1] << 32 | (uint64_t)ew1[0] << 40;
-					}
-					if (obtain_trues || store_scatter) {
-						bytes_left -= 1;
-						i = fread(&ew1, 1, 1, streami);
-						n_ComptonP1 = (uint8_t)ew1[0];
+					if (store_randoms && eventID1 != eventID2)
+						Lrandoms[ind] = 1;
+					if (obtain_trues && event_true)
+						Ltrues[ind] = 1;
+					else if (store_scatter && event_scattered)
+						Lscatter[ind] = 1;
+					LL1[ind] = static_cast<uint16_t>(L1 + 1);
+					LL2[ind] = static_cast<uint16_t>(L2 + 1);
+				}
+			}
+			if (pseudoD) {
+				ring_pos1 += ring_pos1 / cryst_per_block;
+				ring_pos2 += ring_pos2 / cryst_per_block;
+			}
+			if (pseudoR) {
+				ring_number1 += ring_number1 / gapSize;
+				ring_number2 += ring_number2 / gapSize;
+			}
+			// The time step is determined from the first single, which is
+			// always inside the time window
+			double time = static_cast<double>(lmfRead64(single1)) * time_step;
+			if (NT > 1 && static_cast<uint64_t>(std::floor((time - alku) / vali)) >= NT)
+				time = alku + vali * static_cast<double>(NT - 1);
+			bool swap = false;
+			const int64_t sinoIndex = saveSinogram(ring_pos1, ring_pos2, ring_number1, ring_number2, sinoSize, Ndist, Nang, ringDifference, span, seg, time, NT, TOFSize,
+				vali, alku, detWPseudo, rings, bins, nDistSide, swap);
+			if (sinoIndex >= 0) {
+#pragma omp atomic
+				Sino[sinoIndex]++;
+				if ((event_true && obtain_trues) || (event_scattered && store_scatter)) {
+					if (event_true && obtain_trues) {
+#pragma omp atomic
+						SinoT[sinoIndex]++;
 					}
-					if (source) {
-						X = (num >> 32) & 0xFFFF;
-						Y = (num >> 16) & 0xFFFF;
-						Z = num & 0xFFFF;
+					else if (event_scattered && store_scatter) {
+#pragma omp atomic
+						SinoC[sinoIndex]++;
 					}
-					if (bytes_left > 0)
-						i = fread(&ew1, 1, bytes_left, streami);
-					ms = ms2;
 				}
-				time = ms2;
+				else if (!event_true && store_randoms) {
+#pragma omp atomic
+					SinoR[sinoIndex]++;
+				}
 			}
 		}
 	}
 	int_loc[1] = pa;
-	tpoints[jj] = i1;
+	tpoints[jj] = i1 < 0 ? 0ULL : static_cast<uint64_t>(i1);
 	if (begin) {
 		int_loc[0] = 0;
 		int_loc[1] = 0;
 	}
-	fclose(streami);
+	tiedot.close();
 	return;
 }
 
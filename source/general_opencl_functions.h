@@ -40,6 +40,23 @@
 #define CC 1e3f
 #endif
 #define TRAPZ_BINS 5.f
+// Compact device storage of the measurements, the counts are stored as
+// uint16 and the normalization, scatter and randoms as half precision
+// floats. The values are converted to float when they are read.
+#ifdef COMPACT_SINO
+#define SINO_T ushort
+#define SINO(d_data, idx) convert_float(d_data[idx])
+#else
+#define SINO_T float
+#define SINO(d_data, idx) d_data[idx]
+#endif
+#ifdef COMPACT_CORR
+#define CORR_T half
+#define CORR(d_data, idx) vload_half(idx, d_data)
+#else
+#define CORR_T float
+#define CORR(d_data, idx) d_data[idx]
+#endif
 
 // This function was taken from: https://streamhpc.com/blog/2016-02-09/atomic-operations-for-floats-in-opencl-improved/
 // Computes the atomic_add for floats
@@ -58,6 +75,120 @@ void atomicAdd_g_f(volatile __global float *addr, float val) {
 }
 #endif
 
+// Atomic add (of the selected atomic type) to a global backprojection buffer
+void atomicAddGlobal(__global CAST* d_output, const uint local_ind, const float val) {
+#ifdef ATOMIC
+	atom_add(&d_output[local_ind], convert_long(val * TH));
+#elif defined(ATOMIC32)
+	atomic_add(&d_output[local_ind], convert_int(val * TH));
+#else
+	atomicAdd_g_f(&d_output[local_ind], val);
+#endif
+}
+
+#ifdef LOCAL_BP
+// Work-group aggregated backprojection
+// Each work-group keeps a small open-addressed hash table of voxel bins in
+// local memory. Backprojected values are first accumulated into the bins
+// with (cheap) local atomics and only the combined values are added to the
+// global buffers once all the work-items of the group have finished. If a
+// voxel does not fit into the table, the value is added directly to the
+// global memory. rhs-values use the voxel index (+ image offset) as the
+// key while the sensitivity image uses the index with the highest bit set.
+#ifndef LOCAL_BINS
+#define LOCAL_BINS 1024
+#endif
+#ifndef LOCAL_PROBES
+#define LOCAL_PROBES 4
+#endif
+#define LBP_EMPTY 0xFFFFFFFFu
+#define LBP_SUMM 0x80000000u
+#define LBP_PARAMS , __local uint* lbp_key, __local float* lbp_val
+#define LBP_ARGS , lbp_key, lbp_val
+// All kernel exits need to go through the flush, otherwise the barrier is not reached by every work-item
+#define KERNEL_RETURN goto lbp_flush
+
+// Same as atomicAdd_g_f, but for local memory
+void atomicAdd_l_f(volatile __local float* addr, float val) {
+	union {
+		unsigned int u32;
+		float        f32;
+	} next, expected, current;
+	current.f32 = *addr;
+	do {
+		expected.f32 = current.f32;
+		next.f32 = expected.f32 + val;
+		current.u32 = atomic_cmpxchg((volatile __local unsigned int*)addr, expected.u32, next.u32);
+	} while (current.u32 != expected.u32);
+}
+
+// Empty the voxel bins, called by all work-items before the first barrier
+void localBinInit(__local uint* lbp_key, __local float* lbp_val) {
+	for (uint ii = get_local_id(0); ii < LOCAL_BINS; ii += LOCAL_SIZE) {
+		lbp_key[ii] = LBP_EMPTY;
+		lbp_val[ii] = 0.f;
+	}
+}
+
+// Add the value to the bin of the key, returns false if no free bin was found
+bool localBinAdd(__local uint* lbp_key, __local float* lbp_val, const uint key, const float val) {
+	uint hh = key & (LOCAL_BINS - 1u);
+#pragma unroll LOCAL_PROBES
+	for (uint ii = 0u; ii < LOCAL_PROBES; ii++) {
+		const uint old = atomic_cmpxchg(&lbp_key[hh], LBP_EMPTY, key);
+		if (old == LBP_EMPTY || old == key) {
+			atomicAdd_l_f(&lbp_val[hh], val);
+			return true;
+		}
+		hh = (hh + 1u) & (LOCAL_BINS - 1u);
+	}
+	return false;
+}
+
+// Write the aggregated bins to the global buffers, called by all work-items after the final barrier
+void localBinFlush(__local uint* lbp_key, __local float* lbp_val, __global CAST* d_rhs, __global CAST* d_Summ) {
+	for (uint ii = get_local_id(0); ii < LOCAL_BINS; ii += LOCAL_SIZE) {
+		const uint key = lbp_key[ii];
+		if (key == LBP_EMPTY || lbp_val[ii] == 0.f)
+			continue;
+		if (key & LBP_SUMM)
+			atomicAddGlobal(d_Summ, key & ~LBP_SUMM, lbp_val[ii]);
+		else
+			atomicAddGlobal(d_rhs, key, lbp_val[ii]);
+	}
+}
+#else
+#define LBP_PARAMS
+#define LBP_ARGS
+#define KERNEL_RETURN return
+#endif
+
+// Data term of the Poisson log-likelihood (y * log(y_bar)) of each LOR and reconstruction, computed from the forward projection
+// before it is replaced by the ratio. The linear term (sum of y_bar) is computed on the host from the sensitivity image.
+#ifdef LOGL
+#define LOGL_PARAMS , __global float* d_logl
+#define LOGL_ARGS , d_logl
+#else
+#define LOGL_PARAMS
+#define LOGL_ARGS
+#endif
+
+// Backprojection (rhs) atomic add
+void atomicAddRHS(__global CAST* d_rhs, const uint local_ind, const float val LBP_PARAMS) {
+#ifdef LOCAL_BP
+	if (!localBinAdd(lbp_key, lbp_val, local_ind, val))
+#endif
+	atomicAddGlobal(d_rhs, local_ind, val);
+}
+
+// Sensitivity image atomic add
+void atomicAddSumm(__global CAST* d_Summ, const uint local_ind, const float val LBP_PARAMS) {
+#ifdef LOCAL_BP
+	if (!localBinAdd(lbp_key, lbp_val, local_ind | LBP_SUMM, val))
+#endif
+	atomicAddGlobal(d_Summ, local_ind, val);
+}
+
 #ifdef AF
 // Computes the forward projection
 void forwardProject(const float local_ele, float* ax, const uint kk, const uint local_ind, const __global float* d_OSEM) {
@@ -114,12 +245,24 @@ void denominator(float local_ele, float* ax, uint local_ind, const uint d_N, con
 #endif
 }
 
+#ifdef LOGL
+void logLikelihood(const float* ax, const float d_Sino, const float d_epps, const float temp, const float local_rand, const size_t idx,
+	__global float* d_logl) {
+#pragma unroll N_REKOS
+	for (uint kk = 0; kk < N_REKOS; kk++)
+		d_logl[idx * N_REKOS + kk] = (d_Sino > 0.f) ? d_Sino * log(fmax(ax[kk] * temp, d_epps) + local_rand) : 0.f;
+}
+#endif
+
 // Nominator (backprojection) in MLEM
 void nominator(__constant uchar* MethodList, float* ax, const float d_Sino, const float d_epsilon_mramla, const float d_epps, 
-	const float temp, const __global float* d_sc_ra, const size_t idx) {
+	const float temp, const __global CORR_T* d_sc_ra, const size_t idx LOGL_PARAMS) {
 	float local_rand = 0.f;
 #ifdef RANDOMS
-	local_rand = d_sc_ra[idx];
+	local_rand = CORR(d_sc_ra, idx);
+#endif
+#ifdef LOGL
+	logLikelihood(ax, d_Sino, d_epps, temp, local_rand, idx, d_logl);
 #endif
 #ifdef NREKOS1
 #ifndef CT
@@ -201,7 +344,7 @@ void nominator(__constant uchar* MethodList, float* ax, const float d_Sino, cons
 
 #ifdef MBSREM
 // Nominator (backprojection), COSEM
-void nominator_cosem(float* axCOSEM, const float local_sino, const float d_epps, const float temp, const __global float* d_sc_ra,
+void nominator_cosem(float* axCOSEM, const float local_sino, const float d_epps, const float temp, const __global CORR_T* d_sc_ra,
 	const size_t idx) {
 #ifndef CT
 	* axCOSEM *= temp;
@@ -209,7 +352,7 @@ void nominator_cosem(float* axCOSEM, const float local_sino, const float d_epps,
 		*axCOSEM = d_epps;
 #endif
 #ifdef RANDOMS
-	* axCOSEM += d_sc_ra[idx];
+	* axCOSEM += CORR(d_sc_ra, idx);
 #endif
 #ifdef CT
 	* axCOSEM = native_exp(-*axCOSEM) / local_sino;
@@ -222,37 +365,17 @@ void nominator_cosem(float* axCOSEM, const float local_sino, const float d_epps,
 #ifndef MBSREM
 // Compute the backprojection
 void rhs(__constant uchar* MethodList, const float local_ele, const float* ax, const uint local_ind,
-	const uint d_N, __global CAST* d_rhs_OSEM) {
+	const uint d_N, __global CAST* d_rhs_OSEM LBP_PARAMS) {
 #ifdef NREKOS1
-#ifdef ATOMIC
-	atom_add(&d_rhs_OSEM[local_ind], convert_long(local_ele * ax[0] * TH));
-#elif defined(ATOMIC32)
-	atomic_add(&d_rhs_OSEM[local_ind], convert_int(local_ele * ax[0] * TH));
-#else
-	atomicAdd_g_f(&d_rhs_OSEM[local_ind], (local_ele * ax[0]));
-#endif
+	atomicAddRHS(d_rhs_OSEM, local_ind, (local_ele * ax[0]) LBP_ARGS);
 #elif defined(NREKOS2)
-#ifdef ATOMIC
-	atom_add(&d_rhs_OSEM[local_ind], convert_long(local_ele * ax[0] * TH));
-	atom_add(&d_rhs_OSEM[local_ind + d_N], convert_long(local_ele * ax[1] * TH));
-#elif defined(ATOMIC32)
-	atomic_add(&d_rhs_OSEM[local_ind], convert_int(local_ele * ax[0] * TH));
-	atom_atomic_addadd(&d_rhs_OSEM[local_ind + d_N], convert_int(local_ele * ax[1] * TH));
-#else
-	atomicAdd_g_f(&d_rhs_OSEM[local_ind], (local_ele * ax[0]));
-	atomicAdd_g_f(&d_rhs_OSEM[local_ind + d_N], (local_ele * ax[1]));
-#endif
+	atomicAddRHS(d_rhs_OSEM, local_ind, (local_ele * ax[0]) LBP_ARGS);
+	atomicAddRHS(d_rhs_OSEM, local_ind + d_N, (local_ele * ax[1]) LBP_ARGS);
 #else
 	uint yy = local_ind;
 #pragma unroll N_REKOS
 	for (uint kk = 0; kk < N_REKOS; kk++) {
-#ifdef ATOMIC
-		atom_add(&d_rhs_OSEM[yy], convert_long(local_ele * ax[kk] * TH));
-#elif defined(ATOMIC32)
-		atomic_add(&d_rhs_OSEM[yy], convert_int(local_ele * ax[kk] * TH));
-#else
-		atomicAdd_g_f(&d_rhs_OSEM[yy], (local_ele * ax[kk]));
-#endif
+		atomicAddRHS(d_rhs_OSEM, yy, (local_ele * ax[kk]) LBP_ARGS);
 		yy += d_N;
 	}
 #endif
@@ -262,7 +385,7 @@ void rhs(__constant uchar* MethodList, const float local_ele, const float* ax, c
 #else
 
 // Nominator (backprojection), multi-GPU version
-void nominator_multi(float* axOSEM, const float d_Sino, const float d_epps, const float temp, const __global float* d_sc_ra, 
+void nominator_multi(float* axOSEM, const float d_Sino, const float d_epps, const float temp, const __global CORR_T* d_sc_ra, 
 	const size_t idx) {
 #ifndef CT
 	*axOSEM *= temp;
@@ -272,7 +395,7 @@ void nominator_multi(float* axOSEM, const float d_Sino, const float d_epps, cons
 #endif
 #endif
 #ifdef RANDOMS
-		* axOSEM += d_sc_ra[idx];
+		* axOSEM += CORR(d_sc_ra, idx);
 #endif
 #ifdef BP
 #ifdef CT
@@ -291,6 +414,33 @@ void denominator_multi(const float local_ele, float* axOSEM, const __global floa
 }
 #endif
 
+#if defined(NBATCH) && !defined(AF) && !defined(MBSREM)
+// Batched forward/backward projection, multi-GPU version
+// The NBATCH images (or measurement vectors) are voxel-interleaved, i.e.
+// the values of the same voxel (LOR) are consecutive. The LOR is traced
+// only once and the same element is applied to all the images.
+void denominator_batch(const float local_ele, float* axOSEM, const uint local_ind, const __global float* d_OSEM) {
+	const uint ind = local_ind * NBATCH;
+#pragma unroll NBATCH
+	for (uint kk = 0; kk < NBATCH; kk++)
+		axOSEM[kk] += (local_ele * d_OSEM[ind + kk]);
+}
+
+void nominator_batch(float* axOSEM, const float d_Sino, const float d_epps, const float temp, const __global CORR_T* d_sc_ra,
+	const size_t idx) {
+#pragma unroll NBATCH
+	for (uint kk = 0; kk < NBATCH; kk++)
+		nominator_multi(&axOSEM[kk], d_Sino, d_epps, temp, d_sc_ra, idx);
+}
+
+void rhs_batch(const float local_ele, const float* axOSEM, const uint local_ind, __global CAST* d_rhs_OSEM LBP_PARAMS) {
+	const uint ind = local_ind * NBATCH;
+#pragma unroll NBATCH
+	for (uint kk = 0; kk < NBATCH; kk++)
+		atomicAddRHS(d_rhs_OSEM, ind + kk, (local_ele * axOSEM[kk]) LBP_ARGS);
+}
+#endif
+
 #ifdef CT
 void get_detector_coordinates_CT(const __global float* x, const __global float* y, const __global float* z, const uint size_x, const size_t idx, const uint subsets,
 	__constant float* angles, const __global uint* d_xyindex, const __global ushort* d_zindex, const uint size_z, const float dPitch, const long nProjections,
@@ -547,7 +697,7 @@ int perpendicular_start(const float d_b, const float d, const float d_d, const u
 // Compute the probability for the perpendicular elements
 void perpendicular_elements(const float d_b, const float d_d1, const uint d_N1, const float d, const float d_d2, const uint d_N2, 
 	const __global float* d_atten, float* templ_ijk, uint* tempk, const uint z_loop, const uint d_N, const uint d_NN, 
-	const __global float* d_norm, const size_t idx, const float global_factor, const __global float* d_scat) {
+	const __global CORR_T* d_norm, const size_t idx, const float global_factor, const __global CORR_T* d_scat) {
 	int apu = perpendicular_start(d_b, d, d_d1, d_N1);
 	*tempk = convert_uint_sat(apu) * d_N + z_loop * d_N1 * d_N2;
 #ifdef CT
@@ -564,10 +714,10 @@ void perpendicular_elements(const float d_b, const float d_d1, const uint d_N1,
 		temp *= native_exp(jelppi);
 #endif
 #ifdef NORM
-		temp *= d_norm[idx];
+		temp *= CORR(d_norm, idx);
 #endif
 #ifdef SCATTER
-		temp *= d_scat[idx];
+		temp *= CORR(d_scat, idx);
 #endif
 	temp *= global_factor;
 	*templ_ijk = temp * d_d2;
@@ -1002,11 +1152,22 @@ void denominatorTOF(float* ax, const float element, const __global float* d_OSEM
 
 
 // Nominator (y for backprojection)
-void nominatorTOF(__constant uchar* MethodList, float* ax, const __global float* d_Sino, const float d_epsilon_mramla, const float d_epps,
-	const float temp, const __global float* d_sc_ra, const size_t idx, const long TOFSize, const float local_sino) {
+void nominatorTOF(__constant uchar* MethodList, float* ax, const __global SINO_T* d_Sino, const float d_epsilon_mramla, const float d_epps,
+	const float temp, const __global CORR_T* d_sc_ra, const size_t idx, const long TOFSize, const float local_sino LOGL_PARAMS) {
 	float local_rand = 0.f;
 #ifdef RANDOMS
-	local_rand = d_sc_ra[idx];
+	local_rand = CORR(d_sc_ra, idx);
+#endif
+#ifdef LOGL
+	// Summed over the TOF bins
+#pragma unroll N_REKOS
+	for (uint kk = 0; kk < N_REKOS; kk++) {
+		float logl = 0.f;
+#pragma unroll NBINS
+		for (long to = 0L; to < NBINS; to++)
+			logl += SINO(d_Sino, idx + to * TOFSize) * log(fmax(ax[to + NBINS * kk] * temp, d_epps) + local_rand);
+		d_logl[idx * N_REKOS + kk] = logl;
+	}
 #endif
 #if defined(AF) && !defined(MBSREM)
 	uint ll = NBINS;
@@ -1026,16 +1187,16 @@ void nominatorTOF(__constant uchar* MethodList, float* ax, const __global float*
 #endif
 #if defined(AF) && defined(MRAMLA) && !defined(MBSREM)
 		if (MethodList[kk] != 1u)
-			ax[to + ii] = d_Sino[idx + to * TOFSize] / ax[to + ii];
+			ax[to + ii] = SINO(d_Sino, idx + to * TOFSize) / ax[to + ii];
 		else if (MethodList[kk] == 1u) { // MRAMLA/MBSREM
 			if (ax[to + ii] <= d_epsilon_mramla && local_rand == 0.f && local_sino > 0.f)
-				ax[to + ii] = d_Sino[idx + to * TOFSize] / d_epsilon_mramla - (d_Sino[idx + to * TOFSize] / native_powr(d_epsilon_mramla, 2)) * (ax[to + ii] - d_epsilon_mramla);
+				ax[to + ii] = SINO(d_Sino, idx + to * TOFSize) / d_epsilon_mramla - (SINO(d_Sino, idx + to * TOFSize) / native_powr(d_epsilon_mramla, 2)) * (ax[to + ii] - d_epsilon_mramla);
 			else
-				ax[to + ii] = d_Sino[idx + to * TOFSize] / ax[to + ii];
+				ax[to + ii] = SINO(d_Sino, idx + to * TOFSize) / ax[to + ii];
 		}
 #else
 #if defined(AF) || defined(BP)
-		ax[to + ii] = d_Sino[idx + to * TOFSize] / ax[to + ii];
+		ax[to + ii] = SINO(d_Sino, idx + to * TOFSize) / ax[to + ii];
 #endif
 #endif
 	}
@@ -1054,7 +1215,7 @@ void backprojectTOF(const uint local_ind, const float local_ele, const uint tid,
 	, const RecMethodsOpenCL MethodListOpenCL, const uint d_alku, const uchar MBSREM_prepass, float* minimi, float* axACOSEM, const __global float* d_OSEM, 
 	__global float* d_E, __global CAST* d_co, __global CAST* d_aco, const float local_sino, const size_t idx, const long TOFSize
 #else
-	, __global CAST* d_rhs, const uchar no_norm, const uint d_N
+	, __global CAST* d_rhs, const uchar no_norm, const uint d_N LBP_PARAMS
 #endif
 	) {
 	uint yy = local_ind;
@@ -1124,20 +1285,8 @@ void backprojectTOF(const uint local_ind, const float local_ele, const uint tid,
 	}
 #else
 	if (no_norm == 0u && ii == 0)
-#ifdef ATOMIC
-		atom_add(&d_Summ[local_ind], convert_long(val * TH));
-#elif defined(ATOMIC32)
-		atomic_add(&d_Summ[local_ind], convert_int(val * TH));
-#else
-		atomicAdd_g_f(&d_Summ[local_ind], val);
-#endif
-#ifdef ATOMIC
-	atom_add(&d_rhs[yy], convert_long(yaxTOF * TH));
-#elif defined(ATOMIC32)
-	atomic_add(&d_rhs[yy], convert_int(yaxTOF * TH));
-#else
-	atomicAdd_g_f(&d_rhs[yy], (yaxTOF));
-#endif
+		atomicAddSumm(d_Summ, local_ind, val LBP_ARGS);
+	atomicAddRHS(d_rhs, yy, yaxTOF LBP_ARGS);
 #endif
 
 #if defined(AF) && !defined(MBSREM)
@@ -1159,7 +1308,7 @@ void sensTOF(const uint local_ind, const float local_ele, const uint tid, const
 	const RecMethodsOpenCL MethodListOpenCL, const uint d_alku, const uchar MBSREM_prepass, float* minimi, float* axACOSEM, const __global float* d_OSEM,
 	__global float* d_E, const size_t idx, const long TOFSize,
 #endif
-	const uchar no_norm) {
+	const uchar no_norm LBP_PARAMS) {
 	float val = 0.f;
 #ifndef DEC
 	const float dX = element / (TRAPZ_BINS - 1.f);
@@ -1194,13 +1343,7 @@ void sensTOF(const uint local_ind, const float local_ele, const uint tid, const
 #endif
 #else
 	if (no_norm == 0u)
-#ifdef ATOMIC
-		atom_add(&d_Summ[local_ind], convert_long(val * TH));
-#elif defined(ATOMIC32)
-		atomic_add(&d_Summ[local_ind], convert_int(val * TH));
-#else
-		atomicAdd_g_f(&d_Summ[local_ind], val);
-#endif
+		atomicAddSumm(d_Summ, local_ind, val LBP_ARGS);
 #endif
 
 #ifndef DEC
@@ -0,0 +1,60 @@
+function avain = geometryHash(options)
+%GEOMETRYHASH Computes a hash of the scanner geometry and the image grid
+%   Returns the MD5 hash of all the scanner, sinogram and image parameters
+%   that affect the detector coordinates and the LOR/voxel intersections.
+%   The hash is used in the filenames of the precomputed LOR pixel counts
+%   so that any change in the geometry (e.g. a different detector pitch
+%   with the same machine name) results in a new file instead of silently
+%   loading outdated data.
+%
+%   Only the user-facing scanner and image grid inputs are hashed, the
+%   detector coordinates (x, y, z_det) and the pseudo ring positions are
+%   derived from these and are overwritten during the reconstruction. The
+%   entry functions (reconstructions_main, forward_project, backproject)
+%   compute the hash before modifying options and store it in
+%   options.geometry_key, which is then returned as-is, i.e. the same key is
+%   used when the LOR counts are saved and when they are loaded.
+%
+% Example:
+%   avain = geometryHash(options)
+%
+% See also lorPixelCountFile, md5Hash, lor_pixel_count_prepass
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+if isfield(options, 'geometry_key') && ~isempty(options.geometry_key)
+    avain = options.geometry_key;
+    return
+end
+% The span 1 case always uses all the ring pairs
+if isfield(options, 'span') && isfield(options, 'rings') && options.span == 1
+    options.TotSinos = options.rings^2;
+    options.NSinos = options.TotSinos;
+end
+kentat = {'diameter', 'cr_p', 'cr_pz', 'det_per_ring', 'det_w_pseudo', 'rings', 'cryst_per_block', 'blocks_per_ring', ...
+    'transaxial_multip', 'DOI', 'FOVa_x', 'FOVa_y', 'axial_fov', 'Nx', 'Ny', 'Nz', 'Ndist', 'Nang', 'NSinos', 'TotSinos', 'span', ...
+    'ring_difference', 'segment_table', 'ndist_side', 'sampling', 'sampling_raw', 'arc_correction', 'offangle', 'flip_image', 'CT'};
+arvot = cell(numel(kentat), 1);
+for kk = 1 : numel(kentat)
+    if isfield(options, kentat{kk}) && ~isempty(options.(kentat{kk}))
+        arvot{kk} = double(options.(kentat{kk}));
+    else
+        arvot{kk} = NaN;
+    end
+end
+avain = md5Hash(arvot{:});
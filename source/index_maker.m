@@ -209,8 +209,7 @@ if use_raw_data == false && subsets > 1
         if options.CT
             [lor, ~, ~, lor_orth] = lor_pixel_count_prepass(options, false);
         elseif ~options.CT
-            lor_file = [folder machine_name '_lor_pixel_count_' num2str(Nx) 'x' num2str(Ny) 'x' num2str(Nz) '_sino_' num2str(Ndist) 'x' ...
-                num2str(Nang) 'x' num2str(TotSinos) '.mat'];
+            lor_file = lorPixelCountFile(options, false);
             if exist(lor_file, 'file') == 2
                 if options.implementation == 1 || options.implementation == 4
                     variableInfo = who('-file', lor_file);
@@ -291,7 +290,7 @@ if use_raw_data == false && subsets > 1
 elseif subsets > 1
     % For raw data
     if options.precompute_lor
-        lor_file = [folder machine_name '_detector_locations_' num2str(Nx) 'x' num2str(Ny) 'x' num2str(Nz) '_raw.mat'];
+        lor_file = lorPixelCountFile(options, true);
         if exist(lor_file, 'file') == 2
             if options.implementation == 1 || options.implementation == 4
                 variableInfo = who('-file', lor_file);
@@ -472,10 +471,9 @@ elseif subsets > 1
     end
 elseif subsets == 1 && options.precompute_lor
     if use_raw_data
-        lor_file = [folder machine_name '_detector_locations_' num2str(Nx) 'x' num2str(Ny) 'x' num2str(Nz) '_raw.mat'];
+        lor_file = lorPixelCountFile(options, true);
     else
-        lor_file = [folder machine_name '_lor_pixel_count_' num2str(Nx) 'x' num2str(Ny) 'x' num2str(Nz) '_sino_' num2str(Ndist) 'x' ...
-            num2str(Nang) 'x' num2str(TotSinos) '.mat'];
+        lor_file = lorPixelCountFile(options, false);
     end
     if exist(lor_file, 'file') == 2
         if options.implementation == 1 || options.implementation == 4
@@ -102,7 +102,7 @@ for kk = 1 : numel(varMAP)
         elseif strcmp(varPrior{ll},'APLS') && (strcmp(varMAP{kk},'BSREM') || strcmp(varMAP{kk},'ROSEM_MAP'))
             grad = TVpriorFinal(im_vectors.([varPrior{ll} '_' varapu{kk}]), [], options.Nx, options.Ny, options.Nz, true, options, 5);
         elseif strcmp(varPrior{ll},'TGV') && (strcmp(varMAP{kk},'BSREM') || strcmp(varMAP{kk},'ROSEM_MAP'))
-            grad = TGV(im_vectors.([varPrior{ll} '_' varapu{kk}]),options.NiterTGV,options.alphaTGV,options.betaTGV, options.Nx, options.Ny, options.Nz);
+            grad = TGV(im_vectors.([varPrior{ll} '_' varapu{kk}]),options.NiterTGV,options.alphaTGV,options.betaTGV, options.Nx, options.Ny, options.Nz, options.TGV_half);
         elseif strcmp(varPrior{ll},'NLM') && (strcmp(varMAP{kk},'BSREM') || strcmp(varMAP{kk},'ROSEM_MAP'))
             grad = NLM(im_vectors.([varPrior{ll} '_' varapu{kk}]), options.Ndx, options.Ndy, options.Ndz, options.Nlx, options.Nly, options.Nlz, ...
                 options.sigma, options.epps, options.Nx, options.Ny, options.Nz, options);
@@ -396,6 +396,18 @@ if exist('OCTAVE_VERSION','builtin') == 0
             warning('NLM support for implementations 1 and 4 built WITHOUT OpenMP (parallel) support. Use install_mex(1) to see compiler error.')
         end
     end
+    try
+        mex(compiler, complexFlag, '-outdir', folder, compflags, cxxflags, ['-I ' folder], ['-L' OMPPath], OMPh, OMPLib, LPLib, ldflags, ...
+            [folder '/TGV_func.cpp'], [folder '/mexFunktio.cpp'])
+    catch ME
+        mex(compiler, '-largeArrayDims', '-outdir', folder, ['-I ' folder], [folder '/TGV_func.cpp'], [folder '/mexFunktio.cpp'])
+        if verbose
+            warning('TGV support for implementations 1 and 4 built WITHOUT OpenMP (parallel) support. Compiler error: ')
+            disp(ME.message);
+        else
+            warning('TGV support for implementations 1 and 4 built WITHOUT OpenMP (parallel) support. Use install_mex(1) to see compiler error.')
+        end
+    end
     try
         if verLessThan('matlab','9.4')
             mex(compiler, complexFlag, '-outdir', folder, compflags, cxxflags, ['-L' OMPPath], OMPh, OMPLib, LPLib, ['-I ' folder], ldflags, ...
@@ -417,16 +429,87 @@ if exist('OCTAVE_VERSION','builtin') == 0
             warning('ASCII sinogram creation built WITHOUT OpenMP (parallel) support. Use install_mex(1) to see compiler error.')
         end
     end
+    try
+        mex(compiler, '-largeArrayDims', '-outdir', folder, compflags, cxxflags, ['-L' OMPPath], OMPh, OMPLib, LPLib, ['-I ' folder], ldflags, ...
+            [folder '/gate_ascii_reader.cpp'])
+    catch ME
+        try
+            mex(compiler, '-largeArrayDims', '-outdir', folder, ['-I ' folder], [folder '/gate_ascii_reader.cpp'])
+            warning('Native ASCII coincidence parser built WITHOUT OpenMP (parallel) support.')
+        catch
+            if verbose
+                warning('Native ASCII coincidence parser not enabled. Compiler error: ')
+                disp(ME.message);
+            else
+                warning('Native ASCII coincidence parser not enabled. Use install_mex(1) to see compiler error.')
+            end
+        end
+    end
     %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% LMF support %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
     try
-        mex(compiler, '-largeArrayDims', '-outdir', folder, [folder '/gate_lmf_matlab.cpp'])
+        mex(compiler, '-largeArrayDims', '-outdir', folder, compflags, cxxflags, ['-L' OMPPath], OMPh, OMPLib, LPLib, ['-I ' folder], ldflags, ...
+            [folder '/gate_lmf_matlab.cpp'])
         disp('LMF support enabled')
+    catch ME
+        try
+            mex(compiler, '-largeArrayDims', '-outdir', folder, ['-I ' folder], [folder '/gate_lmf_matlab.cpp'])
+            warning('LMF support built WITHOUT OpenMP (parallel) support.')
+        catch
+            if verbose
+                warning('LMF support not enabled. Compiler error: ')
+                disp(ME.message);
+            else
+                warning('LMF support not enabled. Use install_mex(1) to see compiler error.')
+            end
+        end
+    end
+    
+    %%%%%%%%%%%%%%%%%%%%%%%%%%%%% Biograph support %%%%%%%%%%%%%%%%%%%%%%%%%%%%
+    try
+        mex(compiler, '-largeArrayDims', '-outdir', folder, compflags, cxxflags, ['-L' OMPPath], OMPh, OMPLib, LPLib, ['-I ' folder], ldflags, ...
+            [folder '/petlink_list2sinogram.cpp'])
+        disp('Biograph 32-bit list-mode support enabled')
+    catch ME
+        try
+            mex(compiler, '-largeArrayDims', '-outdir', folder, ['-I ' folder], [folder '/petlink_list2sinogram.cpp'])
+            warning('Biograph 32-bit list-mode support built WITHOUT OpenMP (parallel) support.')
+        catch
+            if verbose
+                warning('Biograph 32-bit list-mode support not enabled. Compiler error: ')
+                disp(ME.message);
+            else
+                warning('Biograph 32-bit list-mode support not enabled. Use install_mex(1) to see compiler error.')
+            end
+        end
+    end
+    try
+        mex(compiler, '-largeArrayDims', '-outdir', folder, compflags, cxxflags, ['-L' OMPPath], OMPh, OMPLib, LPLib, ['-I ' folder], ldflags, ...
+            [folder '/ptd_sinogram_reader.cpp'])
+        disp('Biograph native sinogram loader enabled')
+    catch ME
+        try
+            mex(compiler, '-largeArrayDims', '-outdir', folder, ['-I ' folder], [folder '/ptd_sinogram_reader.cpp'])
+            warning('Biograph native sinogram loader built WITHOUT OpenMP (parallel) support.')
+        catch
+            if verbose
+                warning('Biograph native sinogram loader not enabled. Compiler error: ')
+                disp(ME.message);
+            else
+                warning('Biograph native sinogram loader not enabled. Use install_mex(1) to see compiler error.')
+            end
+        end
+    end
+    
+    %%%%%%%%%%%%%%%%%%%%%%%%%%%% Out-of-core reader %%%%%%%%%%%%%%%%%%%%%%%%%%%
+    try
+        mex(compiler, '-largeArrayDims', '-outdir', folder, ['-I ' folder], [folder '/out_of_core_subset.cpp'])
+        disp('Out-of-core reconstruction support enabled')
     catch ME
         if verbose
-            warning('LMF support not enabled. Compiler error: ')
+            warning('Out-of-core reconstruction support not enabled. Compiler error: ')
             disp(ME.message);
         else
-            warning('LMF support not enabled. Use install_mex(1) to see compiler error.')
+            warning('Out-of-core reconstruction support not enabled. Use install_mex(1) to see compiler error.')
         end
     end
     
@@ -790,6 +873,29 @@ else
         setenv('CXXFLAGS',cxxflags);
     end
     setenv('LDFLAGS','-fopenmp');
+    [~, sys] = mkoctfile(['-I ' folder], OMPlib, [folder '/TGV_oct.cpp']);
+    setenv('CXXFLAGS',joku);
+    setenv('LDFLAGS',jokuL);
+    if sys == 0
+        movefile('TGV_oct.oct', [folder '/TGV_oct.oct'],'f');
+    else
+        [~, sys] = mkoctfile(['-I ' folder], [folder '/TGV_oct.cpp']);
+        if sys == 0
+            movefile('TGV_oct.oct', [folder '/TGV_oct.oct'],'f');
+            warning('TGV support built WITHOUT OpenMP (parallel) support.')
+        else
+            if verbose
+                warning('TGV support for implementations 1 and 4 not enabled, using the MATLAB/Octave version. Compiler error: ')
+            else
+                warning('TGV support for implementations 1 and 4 not enabled, using the MATLAB/Octave version. Use install_mex(1) to see compiler error.')
+            end
+        end
+    end
+    if ~any(strfind(joku,'-fopenmp'))
+        cxxflags = [cxxflags ' ', joku];
+        setenv('CXXFLAGS',cxxflags);
+    end
+    setenv('LDFLAGS','-fopenmp');
     [~, sys] = mkoctfile(['-I' folder], OMPlib, [folder '/createSinogramASCIIOct.cpp']);
     setenv('CXXFLAGS',joku);
     setenv('LDFLAGS',jokuL);
@@ -808,10 +914,89 @@ else
             end
         end
     end
+    if ~any(strfind(joku,'-fopenmp'))
+        setenv('CXXFLAGS',cxxflags);
+    end
+    setenv('LDFLAGS','-fopenmp');
+    [~, sys] = mkoctfile('--mex', ['-I' folder], OMPlib, [folder '/gate_ascii_reader.cpp']);
+    setenv('CXXFLAGS',joku);
+    setenv('LDFLAGS',jokuL);
+    if sys ~= 0
+        [~, sys] = mkoctfile('--mex', ['-I' folder], [folder '/gate_ascii_reader.cpp']);
+        if sys == 0
+            warning('Native ASCII coincidence parser built WITHOUT OpenMP (parallel) support.')
+        end
+    end
+    if sys == 0
+        movefile('gate_ascii_reader.mex', [folder '/gate_ascii_reader.mex'],'f');
+    end
     %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% LMF support %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
-    mkoctfile('--mex', [folder '/gate_lmf_matlab.cpp'])
-    movefile('gate_lmf_matlab.mex', [folder '/gate_lmf_matlab.mex'],'f');
-    disp('LMF support enabled')
+    if ~any(strfind(joku,'-fopenmp'))
+        setenv('CXXFLAGS',cxxflags);
+    end
+    setenv('LDFLAGS','-fopenmp');
+    [~, sys] = mkoctfile('--mex', ['-I' folder], OMPlib, [folder '/gate_lmf_matlab.cpp']);
+    setenv('CXXFLAGS',joku);
+    setenv('LDFLAGS',jokuL);
+    if sys ~= 0
+        [~, sys] = mkoctfile('--mex', ['-I' folder], [folder '/gate_lmf_matlab.cpp']);
+        if sys == 0
+            warning('LMF support built WITHOUT OpenMP (parallel) support.')
+        end
+    end
+    if sys == 0
+        movefile('gate_lmf_matlab.mex', [folder '/gate_lmf_matlab.mex'],'f');
+        disp('LMF support enabled')
+    end
+    
+    %%%%%%%%%%%%%%%%%%%%%%%%%%%%% Biograph support %%%%%%%%%%%%%%%%%%%%%%%%%%%%
+    if ~any(strfind(joku,'-fopenmp'))
+        setenv('CXXFLAGS',cxxflags);
+    end
+    setenv('LDFLAGS','-fopenmp');
+    [~, sys] = mkoctfile('--mex', ['-I' folder], OMPlib, [folder '/petlink_list2sinogram.cpp']);
+    setenv('CXXFLAGS',joku);
+    setenv('LDFLAGS',jokuL);
+    if sys ~= 0
+        [~, sys] = mkoctfile('--mex', ['-I' folder], [folder '/petlink_list2sinogram.cpp']);
+        if sys == 0
+            warning('Biograph 32-bit list-mode support built WITHOUT OpenMP (parallel) support.')
+        end
+    end
+    if sys == 0
+        movefile('petlink_list2sinogram.mex', [folder '/petlink_list2sinogram.mex'],'f');
+        disp('Biograph 32-bit list-mode support enabled')
+    else
+        warning('Biograph 32-bit list-mode support not enabled.')
+    end
+    if ~any(strfind(joku,'-fopenmp'))
+        setenv('CXXFLAGS',cxxflags);
+    end
+    setenv('LDFLAGS','-fopenmp');
+    [~, sys] = mkoctfile('--mex', ['-I' folder], OMPlib, [folder '/ptd_sinogram_reader.cpp']);
+    setenv('CXXFLAGS',joku);
+    setenv('LDFLAGS',jokuL);
+    if sys ~= 0
+        [~, sys] = mkoctfile('--mex', ['-I' folder], [folder '/ptd_sinogram_reader.cpp']);
+        if sys == 0
+            warning('Biograph native sinogram loader built WITHOUT OpenMP (parallel) support.')
+        end
+    end
+    if sys == 0
+        movefile('ptd_sinogram_reader.mex', [folder '/ptd_sinogram_reader.mex'],'f');
+        disp('Biograph native sinogram loader enabled')
+    else
+        warning('Biograph native sinogram loader not enabled.')
+    end
+    
+    %%%%%%%%%%%%%%%%%%%%%%%%%%%% Out-of-core reader %%%%%%%%%%%%%%%%%%%%%%%%%%%
+    [~, sys] = mkoctfile('--mex', ['-I' folder], [folder '/out_of_core_subset.cpp']);
+    if sys == 0
+        movefile('out_of_core_subset.mex', [folder '/out_of_core_subset.mex'],'f');
+        disp('Out-of-core reconstruction support enabled')
+    else
+        warning('Out-of-core reconstruction support not enabled.')
+    end
     
     %%%%%%%%%%%%%%%%%%%%%%%%%%%%%% Inveon support %%%%%%%%%%%%%%%%%%%%%%%%%%%%%
     mkoctfile('--mex', [folder '/inveon_list2matlab.cpp'])
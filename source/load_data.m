@@ -567,6 +567,9 @@ elseif options.use_machine == 0
     elseif options.use_ASCII
         %% ASCII data
         [ascii_ind, mSize] = get_ascii_indices(options.coincidence_mask);
+        % The native parser reads only the selected columns
+        native_ascii = exist('gate_ascii_reader','file') == 3;
+        ascii_ind_full = ascii_ind;
         rsector_ind1 = ascii_ind.rsector_ind1;
         rsector_ind2 = ascii_ind.rsector_ind2;
         crs_ind1 = ascii_ind.crs_ind1;
@@ -630,6 +633,21 @@ elseif options.use_machine == 0
                     error('No ASCII (.dat) delayed coincidence files were found. Check your filepath (options.fpath) or current folder.')
                 end
             end
+            % Only the delayed coincidence files that have a corresponding
+            % prompt file are used
+            delay_names = delay_names(1 : min(end, length(fnames)));
+        else
+            delay_names = [];
+        end
+        % The native parser reads and histograms the files in chunks of at
+        % most options.ASCII_chunk_size bytes, i.e. the memory use does not
+        % depend on the file size
+        if native_ascii
+            if ~isfield(options,'ASCII_chunk_size')
+                options.ASCII_chunk_size = 128 * 1024^2;
+            end
+            fnames = chunkGATEASCII(fpath, fnames, options.ASCII_chunk_size);
+            delay_names = chunkGATEASCII(fpath, delay_names, options.ASCII_chunk_size);
         end
         li = 1;
         
@@ -640,8 +658,21 @@ elseif options.use_machine == 0
         % Go through all the files
         for lk = 1:length(fnames)
             
-            % Use readmatrix if newer MATLAB is used, otherwise importdata
-            if exist('OCTAVE_VERSION','builtin') == 0 && verLessThan('matlab','9.6') || exist('OCTAVE_VERSION','builtin') == 5
+            % Use the native parser if available, otherwise readmatrix if
+            % newer MATLAB is used, otherwise importdata
+            if native_ascii
+                if gate_ascii_reader([fpath fnames(lk).name]) == mSize - 6
+                    [ascii_ind_full, mSize] = get_ascii_indices(options.coincidence_mask, true);
+                end
+                [M, ascii_ind] = readGATEASCII([fpath fnames(lk).name], ascii_ind_full, fnames(lk).alue);
+                rsector_ind1 = ascii_ind.rsector_ind1;
+                rsector_ind2 = ascii_ind.rsector_ind2;
+                crs_ind1 = ascii_ind.crs_ind1;
+                crs_ind2 = ascii_ind.crs_ind2;
+                time_index = ascii_ind.time_index;
+                source_index1 = ascii_ind.source_index1;
+                source_index2 = ascii_ind.source_index2;
+            elseif exist('OCTAVE_VERSION','builtin') == 0 && verLessThan('matlab','9.6') || exist('OCTAVE_VERSION','builtin') == 5
                 M = importdata([fpath fnames(lk).name]);
                 % Check for corrupted data
                 if any(any(isnan(M))) > 0
@@ -676,7 +707,11 @@ elseif options.use_machine == 0
                     end
                 end
             end
-            if mSize - 6 == size(M,2)
+            % A chunk can contain only empty or corrupted lines
+            if isempty(M)
+                continue
+            end
+            if ~native_ascii && mSize - 6 == size(M,2)
                 [ascii_ind, mSize] = get_ascii_indices(options.coincidence_mask, true);
             end
             % If no module indices are present (i.e. ECAT data or submodules are used)
@@ -1076,12 +1111,19 @@ elseif options.use_machine == 0
                 end
             end
             
-            if options.verbose
+            if options.verbose && (~native_ascii || fnames(lk).viimeinen)
                 disp(['File ' fnames(lk).name ' loaded'])
             end
             
-            if options.randoms_correction && length(delay_names) >= lk
-                if exist('OCTAVE_VERSION','builtin') == 0 && verLessThan('matlab','9.6') || exist('OCTAVE_VERSION','builtin') == 5
+        end
+        
+        % Go through the delayed coincidence files
+        for lk = 1:length(delay_names)
+            
+            if options.randoms_correction
+                if native_ascii
+                    M = readGATEASCII([fpath delay_names(lk).name], ascii_ind_full, delay_names(lk).alue);
+                elseif exist('OCTAVE_VERSION','builtin') == 0 && verLessThan('matlab','9.6') || exist('OCTAVE_VERSION','builtin') == 5
                     M = importdata([fpath delay_names(lk).name]);
                     % Check for corrupted data
                     if any(any(isnan(M))) > 0
@@ -1117,6 +1159,9 @@ elseif options.use_machine == 0
                         end
                     end
                 end
+                if isempty(M)
+                    continue
+                end
                 
                 if partitions > 1
                     if isempty(find(M(:,time_index) > time_intervals(1),1,'last'))
@@ -1251,7 +1296,7 @@ elseif options.use_machine == 0
                 end
                 
                 
-                if options.verbose
+                if options.verbose && (~native_ascii || delay_names(lk).viimeinen)
                     disp(['File ' delay_names(lk).name ' loaded'])
                 end
             end
@@ -1959,4 +2004,51 @@ end
         disp('Measurements loaded and saved')
         toc
     end
-end
\ No newline at end of file
+end
+
+function [M, ascii_ind] = readGATEASCII(tiedosto, ascii_ind, alue)
+% Reads only the columns of the GATE ASCII file that are selected in
+% ascii_ind. The indices in ascii_ind are changed to correspond to the
+% columns of the output matrix. If alue is input, only the lines in the
+% byte range alue = [start end) are read (see chunkGATEASCII)
+kentat = fieldnames(ascii_ind);
+sarakkeet = [];
+for kk = 1 : numel(kentat)
+    if ascii_ind.(kentat{kk}) > 0
+        sarakkeet = [sarakkeet, ascii_ind.(kentat{kk})];
+        % Coordinates have three columns
+        if any(strcmp(kentat{kk}, {'source_index1','source_index2','world_index1','world_index2'}))
+            sarakkeet = [sarakkeet, ascii_ind.(kentat{kk}) + 1, ascii_ind.(kentat{kk}) + 2];
+        end
+    end
+end
+sarakkeet = unique(sarakkeet);
+if nargin >= 3
+    [M, ~, ohitetut] = gate_ascii_reader(tiedosto, sarakkeet, alue);
+else
+    [M, ~, ohitetut] = gate_ascii_reader(tiedosto, sarakkeet);
+end
+if ohitetut > 0
+    warning([num2str(ohitetut) ' corrupted lines skipped in ' tiedosto])
+end
+for kk = 1 : numel(kentat)
+    if ascii_ind.(kentat{kk}) > 0
+        ascii_ind.(kentat{kk}) = find(sarakkeet == ascii_ind.(kentat{kk}));
+    end
+end
+end
+
+function osat = chunkGATEASCII(fpath, tiedostot, tavut)
+% Splits the GATE ASCII files into line-aligned chunks of at most tavut
+% bytes. alue is the byte range of the chunk and viimeinen is true for the
+% last chunk of each file
+osat = struct('name', {}, 'alue', {}, 'viimeinen', {});
+for kk = 1 : numel(tiedostot)
+    rajat = gate_ascii_reader([fpath tiedostot(kk).name], [], tavut);
+    for ll = 1 : numel(rajat) - 1
+        osat(end + 1).name = tiedostot(kk).name;
+        osat(end).alue = rajat(ll : ll + 1);
+        osat(end).viimeinen = ll == numel(rajat) - 1;
+    end
+end
+end
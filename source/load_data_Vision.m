@@ -339,8 +339,17 @@ else
         error('No file was selected!')
     end
     nimi = [fpath file];
-    fid = fopen(nimi);
-    if any(strfind(file, '.ptd'))
+    if exist('ptd_sinogram_reader','file') == 3
+        % Memory mapped native loader
+        [Sino, delayed_coincidences] = ptd_sinogram_reader(nimi, options.Ndist, options.Nang, options.TotSinos, options.partitions, options.TOF_bins > 1);
+        Sino = squeeze(Sino);
+        if isempty(delayed_coincidences)
+            clear delayed_coincidences
+        else
+            delayed_coincidences = squeeze(delayed_coincidences);
+        end
+    elseif any(strfind(file, '.ptd'))
+        fid = fopen(nimi);
         Sino = fread(fid, inf, 'char=>char');
         Sinot = Sino(end-20000:end)';
         idx = strfind(Sinot,'data offset in bytes[1]:=');
@@ -365,9 +374,12 @@ else
         else
             Sino = squeeze(sum(Sino,4));
         end
+        fclose(fid);
     else
+        fid = fopen(nimi);
         Sino = fread(fid, inf, 'int16=>int16');
         if any(Sino < 0)
+            fclose(fid);
             fid = fopen(nimi);
             Sino = fread(fid, inf, 'single=>single');
         end
@@ -383,8 +395,8 @@ else
             Sino = squeeze(sum(Sino,4));
         end
         Sino(Sino < 0) = 0;
+        fclose(fid);
     end
-    fclose(fid);
     if options.partitions > 1
         raw_SinM = cell(options.partitions,1);
         for kk = 1 : options.partitions
@@ -343,9 +343,41 @@ if options.use_machine == 1 || options.use_machine == 3
             end
         end
         
-        [raw_SinM, SinDelayed] = list2sinogram(nimi, uint64(vali), uint64(alku), uint64(loppu), logical(options.randoms_correction), v_size, options.store_raw_data, ...
-            uint32(options.det_w_pseudo), sinoSize, uint32(options.Ndist), uint32(options.Nang), uint32(options.ring_difference), uint32(options.span), uint32(options.segment_table), ...
-            uint64(options.partitions), sinoSize * uint64(options.TOF_bins), int32(options.ndist_side), pseudoD, pseudoR, type);
+        if ~isfield(options, 'save_packed_listmode')
+            options.save_packed_listmode = false;
+        end
+        % The bin addresses of the events refer to the native mCT
+        % sinogram (400x168x621, span 11, maximum ring difference 49, 13
+        % TOF bins). The multithreaded source version uses them directly
+        % as the sinogram indices and is thus used only when the sinogram
+        % properties match these
+        natiivi = options.Ndist == 400 && options.Nang == 168 && options.det_w_pseudo == 672 && options.span == 11 && ...
+            options.ring_difference == 49 && isequal(options.segment_table(:)', [109 97 97 75 75 53 53 31 31]) && options.ndist_side == 1 ...
+            && any(options.TOF_bins == [1 13]);
+        if exist('petlink_list2sinogram','file') == 3 && ~natiivi && exist('list2sinogram','file') ~= 3
+            error(['The sinogram properties do not match the native mCT sinogram (Ndist = 400, Nang = 168, span = 11, ring_difference = 49, ' ...
+                'ndist_side = 1, TOF_bins = 1 or 13) required by petlink_list2sinogram and list2sinogram was not found'])
+        end
+        if exist('petlink_list2sinogram','file') == 3 && natiivi
+            if options.store_raw_data
+                warning('Raw list-mode data is not stored with petlink_list2sinogram, only the sinograms are formed')
+            end
+            if options.save_packed_listmode
+                packed_file = [folder machine_name '_' name '_packed_listmode.bin'];
+            else
+                packed_file = '';
+            end
+            [raw_SinM, SinDelayed] = petlink_list2sinogram(nimi, vali, alku, loppu, logical(options.randoms_correction), sinoSize, ...
+                sinoSize * uint64(options.TOF_bins), uint64(options.partitions), int32(0), packed_file);
+        else
+            if options.save_packed_listmode
+                warning(['Packed list-mode data is saved only with petlink_list2sinogram (built by install_mex) and with the native mCT ' ...
+                    'sinogram properties, packed list-mode data will not be saved.'])
+            end
+            [raw_SinM, SinDelayed] = list2sinogram(nimi, uint64(vali), uint64(alku), uint64(loppu), logical(options.randoms_correction), v_size, options.store_raw_data, ...
+                uint32(options.det_w_pseudo), sinoSize, uint32(options.Ndist), uint32(options.Nang), uint32(options.ring_difference), uint32(options.span), uint32(options.segment_table), ...
+                uint64(options.partitions), sinoSize * uint64(options.TOF_bins), int32(options.ndist_side), pseudoD, pseudoR, type);
+        end
         clear mex
         
         if partitions == 1
@@ -513,8 +545,17 @@ else
         error('No file was selected!')
     end
     nimi = [fpath file];
-    fid = fopen(nimi);
-    if any(strfind(file, '.ptd'))
+    if exist('ptd_sinogram_reader','file') == 3
+        % Memory mapped native loader
+        [Sino, SinDelayed] = ptd_sinogram_reader(nimi, options.Ndist, options.Nang, options.TotSinos, options.partitions, options.TOF_bins > 1);
+        Sino = squeeze(Sino);
+        if isempty(SinDelayed)
+            clear SinDelayed
+        else
+            SinDelayed = squeeze(SinDelayed);
+        end
+    elseif any(strfind(file, '.ptd'))
+        fid = fopen(nimi);
         Sino = fread(fid, inf, 'char=>char');
         Sinot = Sino(end-20000:end)';
         idx = strfind(Sinot,'data offset in bytes[1]:=');
@@ -539,9 +580,12 @@ else
         else
             Sino = squeeze(sum(Sino,4));
         end
+        fclose(fid);
     else
+        fid = fopen(nimi);
         Sino = fread(fid, inf, 'int16=>int16');
         if any(Sino < 0)
+            fclose(fid);
             fid = fopen(nimi);
             Sino = fread(fid, inf, 'single=>single');
         end
@@ -557,8 +601,8 @@ else
             Sino = squeeze(sum(Sino,4));
         end
         Sino(Sino < 0) = 0;
+        fclose(fid);
     end
-    fclose(fid);
     if options.partitions > 1
         raw_SinM = cell(options.partitions,1);
         for kk = 1 : options.partitions
@@ -0,0 +1,78 @@
+function [x1, y1, z1, x2, y2, z2] = lorEndpoints(options, index, x, y, z, varargin)
+%LORENDPOINTS Detector coordinates of both ends of the selected LORs
+%   Computes the coordinates of the two detectors of each LOR in index, in
+%   the same way as the detector coordinates are selected in the
+%   projectors. For sinogram data index is the linear index of the
+%   sinogram bin, for raw data the row of the detector pair matrix (when
+%   options.precompute_lor = true, of the pairs that go through the FOV).
+%
+% Example:
+%   [x1, y1, z1, x2, y2, z2] = lorEndpoints(options, index, x, y, z_det, lor_a)
+% INPUTS:
+%   options = The use_raw_data, precompute_lor and the scanner properties
+%   are needed
+%   index = The LORs whose endpoints are computed
+%   x, y, z = The detector coordinates (get_coordinates)
+%   lor_a = The number of voxels each LOR traverses as output by
+%   index_maker (required only for raw data with precompute_lor = true)
+%
+% See also sortSubsetLORs, maskLORs
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+x = double(x);
+y = double(y);
+z = double(z);
+if options.use_raw_data
+    det_per_ring = double(options.det_per_ring);
+    if ~options.precompute_lor
+        det_per_ring = det_per_ring * options.sampling_raw;
+    end
+    LL = form_detector_pairs_raw(options.rings, det_per_ring);
+    if options.precompute_lor
+        LL = LL(varargin{1} > 0,:);
+    end
+    LL = double(LL(index,:));
+    apu = mod(LL - 1, det_per_ring) + 1;
+    renkaat = floor((LL - 1) / det_per_ring) + 1;
+    x1 = x(apu(:,1));
+    x2 = x(apu(:,2));
+    y1 = y(apu(:,1));
+    y2 = y(apu(:,2));
+    z1 = z(renkaat(:,1));
+    z2 = z(renkaat(:,2));
+else
+    x = reshape(x, [], 2);
+    y = reshape(y, [], 2);
+    z = reshape(z, [], 2);
+    koko = size(x,1);
+    xy = mod(double(index) - 1, koko) + 1;
+    zz = floor((double(index) - 1) / koko) + 1;
+    x1 = x(xy,1);
+    x2 = x(xy,2);
+    y1 = y(xy,1);
+    y2 = y(xy,2);
+    z1 = z(zz,1);
+    z2 = z(zz,2);
+end
+x1 = x1(:);
+x2 = x2(:);
+y1 = y1(:);
+y2 = y2(:);
+z1 = z1(:);
+z2 = z2(:);
@@ -0,0 +1,52 @@
+function lor_file = lorPixelCountFile(options, varargin)
+%LORPIXELCOUNTFILE The filename of the precomputed LOR pixel counts
+%   Returns the full path of the file (in the mat-files folder) where the
+%   number of voxels intersected by each LOR are stored by
+%   lor_pixel_count_prepass. The filename contains the hash of the scanner
+%   geometry and the image grid, i.e. the file is only loaded when it was
+%   computed with the same geometry.
+%
+%   The optional second input can be used to select the raw data (true) or
+%   the sinogram (false) file. By default options.use_raw_data is used.
+%
+% Example:
+%   lor_file = lorPixelCountFile(options)
+%   lor_file = lorPixelCountFile(options, use_raw_data)
+%
+% See also geometryHash, lor_pixel_count_prepass, form_subset_indices
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+folder = fileparts(which('lorPixelCountFile.m'));
+folder = [folder(1:end-6), 'mat-files/'];
+folder = strrep(folder, '\','/');
+
+if nargin >= 2 && ~isempty(varargin{1})
+    raw = varargin{1};
+else
+    raw = options.use_raw_data;
+end
+
+avain = geometryHash(options);
+if raw
+    lor_file = [folder options.machine_name '_detector_locations_' num2str(options.Nx) 'x' num2str(options.Ny) 'x' num2str(options.Nz) ...
+        '_raw_' avain '.mat'];
+else
+    lor_file = [folder options.machine_name '_lor_pixel_count_' num2str(options.Nx) 'x' num2str(options.Ny) 'x' num2str(options.Nz) '_sino_' ...
+        num2str(options.Ndist) 'x' num2str(options.Nang) 'x' num2str(options.TotSinos) '_' avain '.mat'];
+end
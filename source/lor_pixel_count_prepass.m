@@ -252,7 +252,7 @@ if (options.use_raw_data && (options.implementation == 1 || options.implementati
     end
     clear LL
     % Save the data
-    file_string = [folder machine_name '_detector_locations_' num2str(Nx) 'x' num2str(Ny) 'x' num2str(Nz) '_raw.mat'];
+    file_string = lorPixelCountFile(options, true);
     crystal_size_xy = options.tube_width_xy;
     crystal_size_z = options.tube_width_z;
     if save_file
@@ -373,7 +373,7 @@ if (options.use_raw_data && (options.implementation == 2 || options.implementati
         clear LL
         %     lor = lor(lor > 0);
         % save([folder machine_name '_detector_locations_' num2str(Nx) 'x' num2str(Ny) 'x' num2str(Nz) '_raw.mat'],'lor_opencl','-v7.3','-append')
-        file_string = [folder machine_name '_detector_locations_' num2str(Nx) 'x' num2str(Ny) 'x' num2str(Nz) '_raw.mat'];
+        file_string = lorPixelCountFile(options, true);
         if save_file
             if exist(file_string,'file') == 2
                 if exist('OCTAVE_VERSION', 'builtin') == 0
@@ -511,8 +511,7 @@ if (~options.use_raw_data && (options.implementation == 1 || options.implementat
         end
     end
     
-    file_string = [folder machine_name '_lor_pixel_count_' num2str(Nx) 'x' num2str(Ny) 'x' num2str(Nz) '_sino_' num2str(options.Ndist) 'x' ...
-        num2str(options.Nang) 'x' num2str(options.TotSinos) '.mat'];
+    file_string = lorPixelCountFile(options, false);
     crystal_size_xy = options.tube_width_xy;
     crystal_size_z = options.tube_width_z;
     if save_file
@@ -619,8 +618,7 @@ if (~options.use_raw_data && (options.implementation == 2 || options.implementat
                 filename, uint32(2), true, header_directory, block1, blocks, uint32(options.NSinos), uint16(TotSinos));
         end
         
-        file_string = [folder machine_name '_lor_pixel_count_' num2str(Nx) 'x' num2str(Ny) 'x' num2str(Nz) '_sino_' num2str(options.Ndist) 'x' ...
-            num2str(options.Nang) 'x' num2str(options.TotSinos) '.mat'];
+        file_string = lorPixelCountFile(options, false);
         if save_file
             if exist(file_string,'file') == 2
                 if exist('OCTAVE_VERSION', 'builtin') == 0
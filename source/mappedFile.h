@@ -0,0 +1,171 @@
+/**************************************************************************
+* Read-only memory mapping of a file (POSIX mmap or Windows file mapping).
+* Used by the native list-mode and sinogram loaders so that the data does
+* not need to be read into an intermediate buffer and by the out-of-core
+* subset reader.
+*
+* Copyright (C) 2020 Ville-Veikko Wettenhovi
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <https://www.gnu.org/licenses/>.
+***************************************************************************/
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#if defined(_WIN32) || defined(_WIN64)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a file. data is the file viewed as 32-bit
+// words, i.e. the list-mode packets
+class mappedFile {
+public:
+	const uint32_t* data = nullptr;
+	size_t n_words = 0;
+
+	bool open(const char* fname) {
+#if defined(_WIN32) || defined(_WIN64)
+		file = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER koko;
+		if (!GetFileSizeEx(file, &koko) || koko.QuadPart == 0)
+			return false;
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL)
+			return false;
+		ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (ptr == NULL)
+			return false;
+		bytes = static_cast<size_t>(koko.QuadPart);
+#else
+		fd = ::open(fname, O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0)
+			return false;
+		bytes = static_cast<size_t>(st.st_size);
+		ptr = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (ptr == MAP_FAILED) {
+			ptr = nullptr;
+			return false;
+		}
+		madvise(ptr, bytes, MADV_SEQUENTIAL);
+#endif
+		data = static_cast<const uint32_t*>(ptr);
+		n_words = bytes / sizeof(uint32_t);
+		return true;
+	}
+
+	void close() {
+#if defined(_WIN32) || defined(_WIN64)
+		if (ptr != NULL)
+			UnmapViewOfFile(ptr);
+		if (mapping != NULL)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (ptr != nullptr)
+			munmap(ptr, bytes);
+		if (fd >= 0)
+			::close(fd);
+		fd = -1;
+#endif
+		ptr = nullptr;
+		bytes = 0;
+		data = nullptr;
+		n_words = 0;
+	}
+
+	// The file as bytes
+	const char* bytes_ptr() const {
+		return static_cast<const char*>(ptr);
+	}
+
+	size_t size() const {
+		return bytes;
+	}
+
+	// Ask the OS to read the byte range [offset, offset + len) in the
+	// background, i.e. the call returns immediately
+	void prefetch(const size_t offset, const size_t len) const {
+		if (ptr == nullptr || offset >= bytes)
+			return;
+		size_t alku, koko;
+		pageRange(offset, len, alku, koko);
+#if defined(_WIN32) || defined(_WIN64)
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+		WIN32_MEMORY_RANGE_ENTRY alue;
+		alue.VirtualAddress = static_cast<char*>(ptr) + alku;
+		alue.NumberOfBytes = koko;
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &alue, 0);
+#endif
+#else
+		madvise(static_cast<char*>(ptr) + alku, koko, MADV_WILLNEED);
+#endif
+	}
+
+	// The byte range [offset, offset + len) is not needed anymore, i.e. the
+	// pages can be dropped from the resident memory
+	void release(const size_t offset, const size_t len) const {
+		if (ptr == nullptr || offset >= bytes)
+			return;
+		size_t alku, koko;
+		pageRange(offset, len, alku, koko);
+#if defined(_WIN32) || defined(_WIN64)
+		VirtualUnlock(static_cast<char*>(ptr) + alku, koko);
+#else
+		madvise(static_cast<char*>(ptr) + alku, koko, MADV_DONTNEED);
+#endif
+	}
+
+	~mappedFile() {
+		close();
+	}
+
+private:
+	// Expand the range to whole pages
+	void pageRange(const size_t offset, const size_t len, size_t& alku, size_t& koko) const {
+#if defined(_WIN32) || defined(_WIN64)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		const size_t sivu = static_cast<size_t>(info.dwPageSize);
+#else
+		const size_t sivu = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+		alku = offset - offset % sivu;
+		const size_t loppu = offset + len < bytes ? offset + len : bytes;
+		koko = loppu - alku;
+	}
+
+	void* ptr = nullptr;
+	size_t bytes = 0;
+#if defined(_WIN32) || defined(_WIN64)
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	int fd = -1;
+#endif
+};
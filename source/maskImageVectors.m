@@ -0,0 +1,36 @@
+function im_vectors = maskImageVectors(im_vectors, mask)
+%MASKIMAGEVECTORS Sets the voxels outside the image mask to zero
+%   Applies the support mask (options.mask) to the current estimates (the
+%   _apu fields) of implementations 1 and 4.
+%
+% Example:
+%   im_vectors = maskImageVectors(im_vectors, options.mask)
+%
+% See also maskLORs, form_image_vectors
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+if isempty(mask)
+    return
+end
+nimet = fieldnames(im_vectors);
+for kk = 1 : numel(nimet)
+    if numel(nimet{kk}) > 4 && strcmp(nimet{kk}(end-3:end), '_apu')
+        im_vectors.(nimet{kk})(~mask,:) = 0;
+    end
+end
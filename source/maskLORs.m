@@ -0,0 +1,127 @@
+function [index, pituus, lor_a] = maskLORs(options, index, pituus, lor_a, x, y, z, xx, yy, zz)
+%MASKLORS Removes the LORs that do not intersect the image mask
+%   Removes the LORs that miss the bounding box of the nonzero voxels of
+%   options.mask. Since the voxels outside the mask are kept at zero, these
+%   LORs have no effect on the reconstruction and the measurements and the
+%   corrections are removed with the same indices in form_subset_indices.
+%   The bounding box is enlarged by one voxel and, with the orthogonal and
+%   volume-based projectors, by the width of the tube of response.
+%
+%   With subsets the LORs are removed from the subset indices. Without
+%   subsets the LORs are removed through lor_a (precompute_lor = true)
+%   similarly to the LORs that do not go through the FOV.
+%
+% Example:
+%   [index, pituus, lor_a] = maskLORs(options, index, pituus, lor_a, x, y, z_det, xx, yy, zz)
+% INPUTS:
+%   options = The mask, the image size, the projector and the
+%   scanner/sinogram properties are needed
+%   index = The subset indices (index_maker)
+%   pituus = The number of LORs in each subset
+%   lor_a = The number of voxels each LOR traverses as output by
+%   index_maker (precompute_lor = true)
+%   x, y, z = The detector coordinates (get_coordinates)
+%   xx, yy, zz = The voxel boundaries (computePixelSize)
+%
+% OUTPUTS:
+%   index = The subset indices of the remaining LORs
+%   pituus = The number of remaining LORs in each subset
+%   lor_a = As above, with the removed LORs set to zero when subsets are
+%   not used
+%
+% See also index_maker, form_subset_indices, lorEndpoints
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+xx = double(xx);
+yy = double(yy);
+zz = double(zz);
+[ix, iy, iz] = ind2sub([options.Nx options.Ny options.Nz], find(options.mask));
+if isempty(ix)
+    error('The image mask options.mask has no nonzero voxels')
+end
+% Bounding box of the mask, enlarged by the tube width and one voxel
+reuna = [xx(2) - xx(1), yy(2) - yy(1), zz(2) - zz(1)];
+if options.projector_type == 2
+    reuna(1:2) = reuna(1:2) + options.tube_width_xy;
+    if options.tube_width_z > 0
+        reuna = reuna + options.tube_width_z;
+    end
+elseif options.projector_type == 3
+    reuna = reuna + options.tube_radius;
+end
+if options.n_rays_transaxial > 1 || options.n_rays_axial > 1
+    reuna(1:2) = reuna(1:2) + options.cr_p / 2;
+    reuna(3) = reuna(3) + options.cr_pz / 2;
+end
+alku = [xx(min(ix)), yy(min(iy)), zz(min(iz))] - reuna;
+loppu = [xx(max(ix) + 1), yy(max(iy) + 1), zz(max(iz) + 1)] + reuna;
+
+if numel(pituus) > 1 || iscell(index)
+    if iscell(index)
+        index = cell2mat(index);
+    end
+    osuma = maskHit(options, index, alku, loppu, x, y, z, lor_a);
+    pituus2 = cumsum(double(pituus(:)));
+    for kk = 1 : numel(pituus2)
+        if kk == 1
+            pituus(kk) = int64(sum(osuma(1:pituus2(kk))));
+        else
+            pituus(kk) = int64(sum(osuma(1 + pituus2(kk-1) : pituus2(kk))));
+        end
+    end
+    index = index(osuma);
+elseif options.precompute_lor
+    ind = find(lor_a > 0);
+    if options.use_raw_data
+        osuma = maskHit(options, (1 : numel(ind))', alku, loppu, x, y, z, lor_a);
+    else
+        osuma = maskHit(options, ind, alku, loppu, x, y, z, lor_a);
+    end
+    lor_a(ind(~osuma)) = 0;
+    if numel(index) > 1
+        index = index(lor_a(index) > 0);
+        pituus = int64(numel(index));
+    end
+end
+end
+
+function osuma = maskHit(options, index, alku, loppu, x, y, z, lor_a)
+% Slab test of the LOR segments against the bounding box
+[x1, y1, z1, x2, y2, z2] = lorEndpoints(options, index, x, y, z, lor_a);
+p1 = [x1, y1, z1];
+p2 = [x2, y2, z2];
+clear x1 y1 z1 x2 y2 z2
+tMin = zeros(size(p1,1), 1);
+tMax = ones(size(p1,1), 1);
+for ii = 1 : 3
+    d = p2(:,ii) - p1(:,ii);
+    t1 = (alku(ii) - p1(:,ii)) ./ d;
+    t2 = (loppu(ii) - p1(:,ii)) ./ d;
+    % LORs parallel to the current axis
+    yhdensuuntainen = d == 0;
+    sisalla = p1(:,ii) >= alku(ii) & p1(:,ii) <= loppu(ii);
+    t1(yhdensuuntainen & sisalla) = -Inf;
+    t2(yhdensuuntainen & sisalla) = Inf;
+    t1(yhdensuuntainen & ~sisalla) = Inf;
+    t2(yhdensuuntainen & ~sisalla) = -Inf;
+    tMin = max(tMin, min(t1, t2));
+    tMax = min(tMax, max(t1, t2));
+end
+osuma = tMin <= tMax;
+end
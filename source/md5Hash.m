@@ -0,0 +1,45 @@
+function avain = md5Hash(varargin)
+%MD5HASH Computes the MD5 hash of the input arrays
+%   Returns the MD5 hash, as a hexadecimal string, of the bytes of all the
+%   input (numeric, logical or char) arrays. Used as the cache key for the
+%   precomputed data saved in the mat-files folder.
+%
+% Example:
+%   avain = md5Hash(A, B, C)
+%
+% See also geometryHash, computeACF
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+tavut = [];
+for kk = 1 : nargin
+    apu = varargin{kk};
+    if ischar(apu)
+        apu = uint8(apu);
+    elseif islogical(apu)
+        apu = uint8(apu);
+    end
+    tavut = [tavut; typecast(apu(:), 'uint8')];
+end
+if exist('OCTAVE_VERSION','builtin') == 0
+    md = java.security.MessageDigest.getInstance('MD5');
+    md.update(tavut);
+    avain = sprintf('%02x', typecast(md.digest(), 'uint8'));
+else
+    avain = hash('md5', char(tavut'));
+end
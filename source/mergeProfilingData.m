@@ -0,0 +1,68 @@
+function prof = mergeProfilingData(prof, data, siirto, iter, osa_iter, kesto)
+%MERGEPROFILINGDATA Adds profiling events to the profiling data
+%   prof is a struct with the fields nimet (cell array of the event names)
+%   and M (the events, see profiler.h for the columns). Use an empty array
+%   to create a new struct.
+%
+%   data is either the profiling output of a MEX-file ({names, events}) or
+%   the name of a span measured in MATLAB/Octave. For MEX-file output,
+%   siirto is the time (in microseconds) the MEX-file was called and it is
+%   added to the start times of the events. For a MATLAB/Octave span,
+%   siirto is the start time and kesto the duration (both in
+%   microseconds). Events without iteration or subset number get iter and
+%   osa_iter.
+%
+% See also saveProfilingTrace
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+if isempty(prof)
+    prof = struct('nimet', {{}}, 'M', zeros(0, 8));
+end
+if nargin < 4
+    iter = -1;
+end
+if nargin < 5
+    osa_iter = -1;
+end
+if ischar(data)
+    nimet = {data};
+    M = [1, 0, 0, siirto, kesto, -1, -1, NaN];
+else
+    nimet = data{1}(:);
+    M = double(data{2});
+    if isempty(M)
+        return
+    end
+    M(:,4) = M(:,4) + siirto;
+end
+M(M(:,6) < 0, 6) = iter;
+M(M(:,7) < 0, 7) = osa_iter;
+% Map the names to the merged name list
+ind = zeros(numel(nimet), 1);
+for kk = 1 : numel(nimet)
+    apu = find(strcmp(prof.nimet, nimet{kk}), 1);
+    if isempty(apu)
+        prof.nimet{end + 1, 1} = nimet{kk};
+        apu = numel(prof.nimet);
+    end
+    ind(kk) = apu;
+end
+M(:,1) = ind(M(:,1));
+prof.M = [prof.M; M];
+end
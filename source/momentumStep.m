@@ -0,0 +1,49 @@
+function [im, im_edellinen, t] = momentumStep(im, im_edellinen, t, restart, epps)
+%MOMENTUMSTEP Computes the Nesterov (FISTA-type) extrapolation of the
+%current iterate
+%
+% Example:
+%   [im, im_edellinen, t] = momentumStep(im, im_edellinen, t, restart, epps)
+% INPUTS:
+%   im = The current estimate (after the full iteration)
+%   im_edellinen = The estimate of the previous iteration
+%   t = The momentum parameter of the previous iteration (1 at the start)
+%   restart = If true, the momentum is reset, i.e. no extrapolation is
+%   performed and t is set to 1
+%   epps = Small constant to prevent negative values
+%
+% OUTPUTS:
+%   im = The extrapolated estimate used as the starting point of the next
+%   iteration
+%   im_edellinen = The unextrapolated current estimate, input as the
+%   previous estimate on the next call
+%   t = The updated momentum parameter
+%
+% See also BSREM_iter, OSEM_im, PKMA
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2021 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+apu = im;
+if restart
+    t = 1;
+else
+    t_uusi = (1 + sqrt(1 + 4 * t^2)) / 2;
+    im = im + ((t - 1) / t_uusi) * (im - im_edellinen);
+    im(im < epps) = epps;
+    t = t_uusi;
+end
+im_edellinen = apu;
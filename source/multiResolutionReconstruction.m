@@ -0,0 +1,101 @@
+function pz = multiResolutionReconstruction(options, varargin)
+%MULTIRESOLUTIONRECONSTRUCTION Coarse-to-fine (multi-resolution) reconstruction
+%   Computes the first iterations on coarser image grids. Each value of
+%   options.multi_resolution_factor is one coarse level, e.g. [4 2] first
+%   uses a grid of size [Nx Ny Nz] / 4 and then [Nx Ny Nz] / 2.
+%   options.multi_resolution_iterations is the number of iterations on
+%   each coarse level (scalar or one value per level). The FOV and the
+%   detector geometry do not change, only the number of voxels. The voxel
+%   sizes and the pixel plane vectors are computed for the coarse grid in
+%   reconstructions_main as usual. The last estimate of each level is
+%   interpolated to the next grid and used as its initial value. The last
+%   level is the original grid with options.Niter iterations and its
+%   output is returned.
+%
+%   Only one algorithm can be selected and dynamic data is not supported.
+%   The coarse levels are not saved.
+%
+% Example:
+%   pz = multiResolutionReconstruction(options)
+%
+% See also reconstructions_main, resampleImage
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+kerroin = double(options.multi_resolution_factor(:)');
+if ~isfield(options,'multi_resolution_iterations') || isempty(options.multi_resolution_iterations)
+    options.multi_resolution_iterations = 1;
+end
+iterit = double(options.multi_resolution_iterations(:)');
+if numel(iterit) == 1
+    iterit = repmat(iterit, 1, numel(kerroin));
+end
+if numel(iterit) ~= numel(kerroin)
+    error('options.multi_resolution_iterations has to be a scalar or have the same number of elements as options.multi_resolution_factor')
+end
+if any(kerroin <= 1)
+    error('The multi-resolution factors have to be larger than one')
+end
+if sum(reko_maker(options)) ~= 1
+    error('Multi-resolution reconstruction requires exactly one selected algorithm')
+end
+if options.partitions > 1
+    error('Multi-resolution reconstruction is not supported with dynamic data')
+end
+if (isfield(options,'APLS') && options.APLS) || (isfield(options,'NLM') && options.NLM && options.NLM_use_anatomical) || ...
+        (isfield(options,'TV') && options.TV && options.TV_use_anatomical)
+    error('Multi-resolution reconstruction is not supported with anatomical priors')
+end
+
+koko = double([options.Nx options.Ny options.Nz]);
+if ~isfield(options,'x0') || isempty(options.x0)
+    options.x0 = ones(koko);
+end
+% The grids of each level, the last one is the original
+ruudukot = [max(1, round(bsxfun(@rdivide, koko, kerroin(:)))); koko];
+x = resampleImage(options.x0, koko, ruudukot(1,:));
+
+for ll = 1 : numel(kerroin)
+    apu = options;
+    apu.multi_resolution_factor = [];
+    % The original grid, e.g. the attenuation images are resampled from it
+    apu.multi_resolution_grid = koko;
+    apu.Nx = ruudukot(ll,1);
+    apu.Ny = ruudukot(ll,2);
+    apu.Nz = ruudukot(ll,3);
+    apu.Niter = iterit(ll);
+    apu.save_iter = false;
+    apu.x0 = reshape(x, ruudukot(ll,:));
+    if isfield(apu,'vaimennus') && numel(apu.vaimennus) == prod(koko)
+        apu.vaimennus = resampleImage(apu.vaimennus, koko, ruudukot(ll,:));
+    end
+    % Coarse voxels next to the mask are included
+    if isfield(apu,'mask') && numel(apu.mask) == prod(koko)
+        apu.mask = resampleImage(double(apu.mask ~= 0), koko, ruudukot(ll,:)) > 0;
+    end
+    if options.verbose
+        disp(['Multi-resolution level ' num2str(ll) ', grid ' num2str(apu.Nx) 'x' num2str(apu.Ny) 'x' num2str(apu.Nz)])
+    end
+    tulos = reconstructions_main(apu, varargin{:});
+    kohta = find(~cellfun('isempty', tulos(1:end-1,1)), 1);
+    x = resampleImage(tulos{kohta,1}(:,:,:,end), ruudukot(ll,:), ruudukot(ll + 1,:));
+end
+
+options.multi_resolution_factor = [];
+options.x0 = reshape(x, koko);
+pz = reconstructions_main(options, varargin{:});
@@ -177,6 +177,21 @@ void reconstruction_multigpu(const size_t koko, const uint16_t* lor1, const floa
 	return;
 }
 
+// The forward/backward projection session, kept until released
+fbpSession& fbSession() {
+	static fbpSession session;
+	return session;
+}
+
+// Release the forward/backward projection session (e.g. when the MEX-file
+// is cleared)
+void releaseFBSession() {
+	fbpSession& session = fbSession();
+	for (size_t i = 0; i < session.commandQueues.size(); i++)
+		session.commandQueues[i].finish();
+	session = fbpSession();
+}
+
 // Main reconstruction function, forward/backward projection
 void reconstruction_f_b_proj(const size_t koko, const uint16_t* lor1, const float* z_det, const float* x, const float* y, const float* rhs, const mxArray* sc_ra, 
 	const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const float dx, const float dy, const float dz, const float bx, const float by, const float bz,
@@ -203,8 +218,17 @@ void reconstruction_f_b_proj(const size_t koko, const uint16_t* lor1, const floa
 	cl_uchar compute_norm_matrix = 1u;
 	uint32_t Nxyz = Nx * Ny * Nz;
 
+	// Number of voxel-interleaved images (or measurement vectors) projected
+	// at the same time (improved Siddon only)
+	uint32_t nBatch = 1U;
+	const mxArray* batchField = mxGetField(options, 0, "nBatch");
+	if (batchField != nullptr && mxGetScalar(batchField) > 1.)
+		nBatch = static_cast<uint32_t>(mxGetScalar(batchField));
+	if (nBatch > 1U && (projector_type != 1u || TOF || (!precompute && n_rays * n_rays3D > 1)))
+		mexErrMsgTxt("Batched forward/backward projection is only supported with improved Siddon without TOF or multiple rays");
+
 	// If 1, then the forward projection is computed
-	uint8_t fp = size_rhs == im_dim;
+	uint8_t fp = size_rhs == static_cast<size_t>(im_dim) * static_cast<size_t>(nBatch);
 	if (fp == 0)
 		fp = 2u;
 	if (atomic_64bit && fp == 1)
@@ -218,8 +242,41 @@ void reconstruction_f_b_proj(const size_t koko, const uint16_t* lor1, const floa
 	const bool CT = (bool)mxGetScalar(mxGetField(options, 0, "CT"));
 	const bool atomic_32bit = (bool)mxGetScalar(mxGetField(options, 0, "use_32bit_atomics"));
 
-	status = clGetPlatformsContext(device, kerroin, context, size, cpu_device, num_devices_context, devices, atomic_64bit, compute_norm_matrix, Nxyz, 1u,
-		raw);
+	// Persistent session (forwardBackwardProject), the context, the programs and the buffers are reused
+	fbpSession* session = nullptr;
+	const mxArray* sessionField = mxGetField(options, 0, "fbSession");
+	if (sessionField != nullptr && mxGetScalar(sessionField) > 0.) {
+		session = &fbSession();
+		const uint32_t id = static_cast<uint32_t>(mxGetScalar(sessionField));
+		if (session->id != id) {
+			releaseFBSession();
+			session->id = id;
+		}
+		const mxArray* subsetField = mxGetField(options, 0, "fbSubset");
+		if (subsetField != nullptr)
+			session->subset = static_cast<uint32_t>(mxGetScalar(subsetField));
+		else
+			session->subset = 0U;
+	}
+	// Index of the program (forward or backward projection)
+	const uint8_t pp = fp - 1u;
+
+	if (session != nullptr && session->num_devices_context > 0U) {
+		context = session->context;
+		devices = session->devices;
+		cpu_device = session->cpu_device;
+		num_devices_context = session->num_devices_context;
+	}
+	else {
+		status = clGetPlatformsContext(device, kerroin, context, size, cpu_device, num_devices_context, devices, atomic_64bit, compute_norm_matrix, Nxyz, 1u,
+			raw);
+		if (session != nullptr && status == CL_SUCCESS) {
+			session->context = context;
+			session->devices = devices;
+			session->cpu_device = cpu_device;
+			session->num_devices_context = num_devices_context;
+		}
+	}
 
 	std::string deviceName = devices[0].getInfo<CL_DEVICE_VENDOR>(&status);
 	std::string NV("NVIDIA Corporation");
@@ -235,40 +292,62 @@ void reconstruction_f_b_proj(const size_t koko, const uint16_t* lor1, const floa
 	cl::Program program;
 	std::vector<cl::CommandQueue> commandQueues;
 
-	status = ClBuildProgramGetQueues(program, k_path, context, num_devices_context, devices, verbose, commandQueues, atomic_64bit, atomic_32bit, projector_type, header_directory, crystal_size_z,
-		precompute, raw, attenuation_correction, normalization, dec, fp, local_size, n_rays, n_rays3D, false, cr_pz, dx, use_psf, scatter, randoms_correction, TOF, nBins, listmode, CT);
-
-	if (status != CL_SUCCESS) {
-		mexPrintf("Failed to build programs\n");
-		return;
-	}
-	else if (DEBUG) {
-		mexPrintf("Program created\n");
-		mexEvalString("pause(.0001);");
+	if (session != nullptr && session->built[pp] && session->nBatch[pp] == nBatch) {
+		kernel = session->kernel[pp];
+		kernel_sum = session->kernel_sum[pp];
+		atomic_64bit = session->atomics[pp];
+		commandQueues = session->commandQueues;
 	}
+	else {
+		status = ClBuildProgramGetQueues(program, k_path, context, num_devices_context, devices, verbose, commandQueues, atomic_64bit, atomic_32bit, projector_type, header_directory, crystal_size_z,
+			precompute, raw, attenuation_correction, normalization, dec, fp, local_size, n_rays, n_rays3D, false, cr_pz, dx, use_psf, scatter, randoms_correction, TOF, nBins, listmode, CT, 
+			nBatch);
 
-	if (projector_type == 2u || projector_type == 3u || (projector_type == 1u && ((precompute || (n_rays * n_rays3D) == 1)))) {
-		kernel = cl::Kernel(program, "kernel_multi", &status);
 		if (status != CL_SUCCESS) {
-			getErrorString(status);
-			mexPrintf("Failed to create OpenCL kernel\n");
+			mexPrintf("Failed to build programs\n");
 			return;
 		}
-	}
-	else {
-		kernel = cl::Kernel(program, "siddon_multi", &status);
+		else if (DEBUG) {
+			mexPrintf("Program created\n");
+			mexEvalString("pause(.0001);");
+		}
+
+		if (projector_type == 2u || projector_type == 3u || (projector_type == 1u && ((precompute || (n_rays * n_rays3D) == 1)))) {
+			kernel = cl::Kernel(program, "kernel_multi", &status);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				mexPrintf("Failed to create OpenCL kernel\n");
+				return;
+			}
+		}
+		else {
+			kernel = cl::Kernel(program, "siddon_multi", &status);
+			if (status != CL_SUCCESS) {
+				getErrorString(status);
+				mexPrintf("Failed to create Siddon OpenCL kernel\n");
+				return;
+			}
+		}
+
+		kernel_sum = cl::Kernel(program, "summa", &status);
 		if (status != CL_SUCCESS) {
 			getErrorString(status);
-			mexPrintf("Failed to create Siddon OpenCL kernel\n");
+			mexPrintf("Failed to create sum OpenCL kernel\n");
 			return;
 		}
-	}
-
-	kernel_sum = cl::Kernel(program, "summa", &status);
-	if (status != CL_SUCCESS) {
-		getErrorString(status);
-		mexPrintf("Failed to create sum OpenCL kernel\n");
-		return;
+		if (session != nullptr) {
+			// All the buffers of the session use the same queues
+			if (session->commandQueues.empty())
+				session->commandQueues = commandQueues;
+			else
+				commandQueues = session->commandQueues;
+			session->program[pp] = program;
+			session->kernel[pp] = kernel;
+			session->kernel_sum[pp] = kernel_sum;
+			session->atomics[pp] = atomic_64bit;
+			session->nBatch[pp] = nBatch;
+			session->built[pp] = true;
+		}
 	}
 
 	for (cl_uint i = 0; i < num_devices_context; i++) {
@@ -280,7 +359,7 @@ void reconstruction_f_b_proj(const size_t koko, const uint16_t* lor1, const floa
 		normalization, atten, size_atten, norm, size_norm, pseudos, det_per_ring, prows, L, raw, size_z, im_dim, kernel_sum, kernel, output,  
 		size_rhs, no_norm, numel_x, tube_width, crystal_size_z, x_center, y_center, z_center, size_center_x, size_center_y, size_center_z, precompute, dec, 
 		projector_type, n_rays, n_rays3D, cr_pz, Sin, atomic_64bit, atomic_32bit, global_factor, bmin, bmax, Vmax, V, size_V, fp, local_size, options, scatter, TOF,
-		TOFSize, sigma_x, TOFCenter, nBins);
+		TOFSize, sigma_x, TOFCenter, nBins, nBatch, session);
 
 
 	for (cl_uint i = 0; i < num_devices_context; i++) {
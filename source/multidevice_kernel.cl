@@ -16,7 +16,10 @@
 * includes the precomputation phase where the number of voxels in each LOR
 * are computed. Furthermore the forward-backward projection example uses
 * this same file. 64-bit atomics are also currently included in the same
-* file and used if supported.
+* file and used if supported. With NBATCH (forward-backward projection,
+* improved Siddon without TOF) the forward and backward projections are
+* computed for NBATCH voxel-interleaved images with a single traversal of
+* each LOR.
 *
 * Compiler preprocessing is utilized heavily, for example all the 
 * corrections are implemented as compiler preprocesses. The code for 
@@ -126,21 +129,27 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #ifdef CT
 	const uint d_subsets, __constant float* d_angles, const uint d_sizey, const float d_dPitch, const long d_nProjections, 
 #endif
-	const __global float* restrict d_norm, const __global float* restrict d_scat, __global CAST* restrict d_Summ, const __global ushort* restrict d_lor, 
+	const __global CORR_T* restrict d_norm, const __global CORR_T* restrict d_scat, __global CAST* restrict d_Summ, const __global ushort* restrict d_lor, 
 	const __global uint* restrict d_xyindex, const __global ushort* restrict d_zindex, const __global ushort* restrict d_L, 
-	const __global float* restrict d_Sino, const __global float* restrict d_sc_ra, const __global float* restrict d_OSEM,
+	const __global SINO_T* restrict d_Sino, const __global CORR_T* restrict d_sc_ra, const __global float* restrict d_OSEM,
 #ifndef MBSREM
-	__global CAST* restrict d_rhs_OSEM, const uchar no_norm, const ulong m_size, const ulong cumsum
+	__global CAST* restrict d_rhs_OSEM, const uchar no_norm, const ulong m_size, const ulong cumsum LOGL_PARAMS
 #else
 	const uint d_alku, const uchar MBSREM_prepass, __global float* restrict d_ACOSEM_lhs, __global float* restrict d_Amin, __global CAST* restrict d_co,
 	__global CAST* restrict d_aco, __global float* restrict d_E, const ulong m_size, const RecMethodsOpenCL MethodListOpenCL, const ulong cumsum
 #endif
 ) {
+#endif
+#ifdef LOCAL_BP // Work-group aggregated backprojection
+	__local uint lbp_key[LOCAL_BINS];
+	__local float lbp_val[LOCAL_BINS];
+	localBinInit(lbp_key, lbp_val);
+	barrier(CLK_LOCAL_MEM_FENCE);
 #endif
 	// Get the current global index
 	size_t idx = get_global_id(0);
 	if (idx >= m_size)
-		return;
+		KERNEL_RETURN;
 
 #ifndef FIND_LORS // Not the precomputation phase
 #ifdef TOF
@@ -148,18 +157,18 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #ifndef LISTMODE2
 #pragma unroll NBINS
 	for (long to = 0L; to < NBINS; to++)
-		local_sino += d_Sino[idx + m_size * to];
+		local_sino += SINO(d_Sino, idx + m_size * to);
 #endif
 #else
 #ifdef LISTMODE2
 	const float local_sino = 0.f;
 #else
-	const float local_sino = (d_Sino[idx]);
+	const float local_sino = (SINO(d_Sino, idx));
 #endif
 #endif
 #ifndef MBSREM
 	if (no_norm == 1u && local_sino == 0.f)
-		return;
+		KERNEL_RETURN;
 #else
 	const uchar no_norm = 0u;
 #endif
@@ -198,7 +207,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #endif
 #else // No precomputation
 	if ((y_diff == 0.f && x_diff == 0.f && z_diff == 0.f) || (y_diff == 0.f && x_diff == 0.f))
-		return;
+		KERNEL_RETURN;
 	uint Np = 0u;
 #if !defined(DEC) || defined(TOF) // Intermediate results are not saved
 	uint Np_n = 0u;
@@ -215,7 +224,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 	float local_norm = 0.f;
 
 #ifdef NORM // Normalization included
-	local_norm = d_norm[idx];
+	local_norm = CORR(d_norm, idx);
 #endif
 
 	uint d_N0 = d_Nx;
@@ -265,10 +274,17 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #pragma unroll NBINS
 	for (uint to = 0; to < NBINS; to++)
 		ax[to] = 0.f;
+#else
+#ifdef NBATCH // Batched projection of NBATCH voxel-interleaved images
+	float axOSEM[NBATCH];
+#pragma unroll NBATCH
+	for (uint kk = 0; kk < NBATCH; kk++)
+		axOSEM[kk] = 0.f;
 #else
 	float axOSEM = 0.f;
 #endif
 #endif
+#endif
 
 #ifndef AF
 #ifndef LISTMODE2
@@ -277,6 +293,10 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #pragma unroll NBINS
 		for (uint to = 0; to < NBINS; to++)
 			ax[to] = d_OSEM[idx + to * m_size + cumsum];
+#elif defined(NBATCH)
+#pragma unroll NBATCH
+		for (uint kk = 0; kk < NBATCH; kk++)
+			axOSEM[kk] = d_OSEM[(idx + cumsum) * NBATCH + kk];
 #else
 		axOSEM = d_OSEM[idx + cumsum];
 #endif
@@ -314,14 +334,14 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #ifdef FIND_LORS // Precomputation phase
 		if (fabs(y_diff) < 1e-6f && yd <= d_maxyy && yd >= d_by && ys <= d_maxyy && ys >= d_by) {
 			d_lor[idx] = convert_ushort(d_Nx);
-			return;
+			KERNEL_RETURN;
 		}
 		else if (fabs(x_diff) < 1e-6f && xd <= d_maxxx && xd >= d_bx && xs <= d_maxxx && xs >= d_bx) {
 			d_lor[idx] = convert_ushort(d_Ny);
-			return;
+			KERNEL_RETURN;
 		}
 		else
-			return;
+			KERNEL_RETURN;
 #else // Not the precomputation phase
 
 		tempk = convert_uint((zs - d_bz) / d_dz);
@@ -352,7 +372,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 			d_d2 = d_dy;
 		}
 		else
-			return;
+			KERNEL_RETURN;
 		float templ_ijk = 0.f;
 		uint z_loop = 0u;
 		perpendicular_elements(d_b, d_d, d_N0, dd, d_d2, d_N1, d_atten, &templ_ijk, &z_loop, tempk, d_N2, d_N3,
@@ -380,11 +400,11 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #ifndef AF
 #ifdef FP
 		if (fp == 1) {
-			nominatorTOF(MethodList, ax, d_Sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx, m_size, local_sino);
+			nominatorTOF(MethodList, ax, d_Sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx, m_size, local_sino LOGL_ARGS);
 #pragma unroll NBINS
 			for (long to = 0; to < NBINS; to++)
 				d_rhs_OSEM[idx + to * m_size] = ax[to];
-			return;
+			KERNEL_RETURN;
 		}
 #endif
 #endif
@@ -395,7 +415,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 			local_ele = templ_ijk;
 			local_ind = z_loop;
 #ifdef FP
-			nominatorTOF(MethodList, ax, d_Sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx, m_size, local_sino);
+			nominatorTOF(MethodList, ax, d_Sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx, m_size, local_sino LOGL_ARGS);
 #endif
 			for (uint ii = 0u; ii < d_N1; ii++) {
 #ifndef DEC
@@ -408,7 +428,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #ifdef MBSREM
 					MethodListOpenCL, d_alku, MBSREM_prepass, minimi, axACOSEM, d_OSEM, d_E, d_co, d_aco, local_sino, idx, m_size);
 #else
-					d_rhs_OSEM, no_norm, d_N);
+					d_rhs_OSEM, no_norm, d_N LBP_ARGS);
 #endif
 				local_ind += d_N3;
 			}
@@ -427,7 +447,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #ifdef MBSREM
 					MethodListOpenCL, d_alku, MBSREM_prepass, minimi, axACOSEM, d_OSEM, d_E, idx, m_size,
 #endif
-					no_norm);
+					no_norm LBP_ARGS);
 				local_ind += d_N3;
 			}
 		}
@@ -441,7 +461,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #pragma unroll NBINS
 			for (long to = 0L; to < NBINS; to++) {
 #ifdef RANDOMS
-				axACOSEM[to] += d_sc_ra[idx];
+				axACOSEM[to] += CORR(d_sc_ra, idx);
 #endif
 				d_ACOSEM_lhs[idx + to * m_size] = axACOSEM[to];
 			}
@@ -479,7 +499,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 					axCOSEM = d_epps;
 #endif
 #ifdef RANDOMS
-				axCOSEM += d_sc_ra[idx];
+				axCOSEM += CORR(d_sc_ra, idx);
 #endif
 #ifdef CT
 				axCOSEM = native_exp(-axCOSEM) / local_sino;
@@ -538,7 +558,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 				local_ind += d_N3;
 			}
 #ifdef RANDOMS
-				axACOSEM += d_sc_ra[idx];
+				axACOSEM += CORR(d_sc_ra, idx);
 #endif
 #ifdef CT
 			d_ACOSEM_lhs[idx] = native_exp(-axACOSEM);
@@ -552,12 +572,23 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 			local_ele = templ_ijk;
 			local_ind = z_loop;
 			for (uint ii = 0u; ii < d_N1; ii++) {
+#ifdef NBATCH
+				denominator_batch(local_ele, axOSEM, local_ind, d_OSEM);
+#else
 				denominator_multi(local_ele, &axOSEM, &d_OSEM[local_ind]);
+#endif
 				local_ind += d_N3;
 			}
+#ifdef NBATCH
+			nominator_batch(axOSEM, local_sino, d_epps, 1.f, d_sc_ra, idx);
+#pragma unroll NBATCH
+			for (uint kk = 0; kk < NBATCH; kk++)
+				d_rhs_OSEM[idx * NBATCH + kk] = axOSEM[kk];
+#else
 			nominator_multi(&axOSEM, local_sino, d_epps, 1.f, d_sc_ra, idx);
 			d_rhs_OSEM[idx] = axOSEM;
-			return;
+#endif
+			KERNEL_RETURN;
 		}
 #endif
 		// Calculate the next index and store it as weL as the probability of emission
@@ -573,6 +604,10 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 
 				denominator(local_ele, ax, local_ind, d_N, d_OSEM);
 
+#elif defined(NBATCH) // Implementation 3, batched
+
+				denominator_batch(local_ele, axOSEM, local_ind, d_OSEM);
+
 #else // Implementation 3
 
 				denominator_multi(local_ele, &axOSEM, &d_OSEM[local_ind]);
@@ -582,7 +617,11 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 			}
 #ifdef AF // Implementation 2
 
-			nominator(MethodList, ax, local_sino, d_epsilon_mramla, d_epps, 1.f, d_sc_ra, idx);
+			nominator(MethodList, ax, local_sino, d_epsilon_mramla, d_epps, 1.f, d_sc_ra, idx LOGL_ARGS);
+
+#elif defined(NBATCH) // Implementation 3, batched
+
+			nominator_batch(axOSEM, local_sino, d_epps, 1.f, d_sc_ra, idx);
 
 #else // Implementation 3
 
@@ -597,7 +636,9 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 				if (local_ind >= 1032192)
 					continue;
 #ifdef AF
-				rhs(MethodList, local_ele, ax, local_ind, d_N, d_rhs_OSEM);
+				rhs(MethodList, local_ele, ax, local_ind, d_N, d_rhs_OSEM LBP_ARGS);
+#elif defined(NBATCH)
+				rhs_batch(local_ele, axOSEM, local_ind, d_rhs_OSEM LBP_ARGS);
 #else
 #ifdef ATOMIC // 64-bit atomics
 				atom_add(&d_rhs_OSEM[local_ind], convert_long(local_ele * axOSEM * TH));
@@ -608,13 +649,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #endif
 #endif
 				if (no_norm == 0u)
-#ifdef ATOMIC // 64-bit atomics
-					atom_add(&d_Summ[local_ind], convert_long(local_ele * TH));
-#elif defined(ATOMIC32)
-					atomic_add(&d_Summ[local_ind], convert_int(local_ele* TH));
-#else // 32-bit float atomics
-					atomicAdd_g_f(&d_Summ[local_ind], local_ele);
-#endif
+					atomicAddSumm(d_Summ, local_ind, local_ele LBP_ARGS);
 				local_ind += d_N3;
 			}
 		}
@@ -622,13 +657,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 			local_ele = templ_ijk;
 			local_ind = z_loop;
 			for (uint ii = 0u; ii < d_N1; ii++) {
-#ifdef ATOMIC // 64-bit atomics
-				atom_add(&d_Summ[local_ind], convert_long(local_ele * TH));
-#elif defined(ATOMIC32)
-				atomic_add(&d_Summ[local_ind], convert_int(local_ele* TH));
-#else // 32-bit float atomics
-				atomicAdd_g_f(&d_Summ[local_ind], local_ele);
-#endif
+				atomicAddSumm(d_Summ, local_ind, local_ele LBP_ARGS);
 				local_ind += d_N3;
 			}
 		}
@@ -663,7 +692,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 			d_d = d_dx;
 		}
 		else
-			return;
+			KERNEL_RETURN;
 
 #ifdef CRYST // 2.5D orthogonal
 
@@ -710,7 +739,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 		if (fp == 1) {
 			nominator_multi(&axOSEM, local_sino, d_epps, temp, d_sc_ra, idx);
 			d_rhs_OSEM[idx] = axOSEM;
-			return;
+			KERNEL_RETURN;
 		}
 #endif
 #ifdef MBSREM
@@ -735,7 +764,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #ifdef FP // Forward projection
 
 #ifdef AF
-			nominator(MethodList, ax, local_sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx);
+			nominator(MethodList, ax, local_sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx LOGL_ARGS);
 #else
 			nominator_multi(&axOSEM, local_sino, d_epps, temp, d_sc_ra, idx);
 #endif
@@ -863,7 +892,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 		}
 #ifndef PRECOMPUTE // No precomputation step performed
 		if (skip)
-			return;
+			KERNEL_RETURN;
 #endif
 #ifdef FIND_LORS // Precomputation phase
 		for (uint ii = 0u; ii < Np; ii++) {
@@ -884,7 +913,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 				break;
 		}
 		d_lor[idx] = temp_koko;
-		return;
+		KERNEL_RETURN;
 #else // Not the precomputation phase
 		float temp = 0.f;
 #if defined(SIDDON) || !defined(DEC) // Siddon or no save of intermediate results
@@ -1102,6 +1131,8 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #else // Implementation 3
 #ifdef TOF
 				denominatorTOF(ax, local_ele, d_OSEM, local_ind, TOFSum, store_elements, DD, TOFCenter, sigma_x, &D, ii* NBINS, d_epps, d_N);
+#elif defined(NBATCH)
+				denominator_batch(local_ele, axOSEM, local_ind, d_OSEM);
 #else
 				denominator_multi(local_ele, &axOSEM, &d_OSEM[local_ind]);
 #endif
@@ -1130,7 +1161,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 		temp *= local_norm;
 #endif
 #ifdef SCATTER
-		temp *= d_scat[idx];
+		temp *= CORR(d_scat, idx);
 #endif
 		temp *= global_factor;
 #endif
@@ -1158,9 +1189,9 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 				if (ax[to] < d_epps)
 					ax[to] = d_epps;
 #ifdef RANDOMS
-				ax[to] += d_sc_ra[idx];
+				ax[to] += CORR(d_sc_ra, idx);
 #endif
-				ax[to] = d_Sino[idx + to * m_size] / ax[to];
+				ax[to] = SINO(d_Sino, idx + to * m_size) / ax[to];
 			}
 #else
 #ifndef CT
@@ -1169,7 +1200,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 				axCOSEM = d_epps;
 #endif
 #ifdef RANDOMS
-			axCOSEM += d_sc_ra[idx];
+			axCOSEM += CORR(d_sc_ra, idx);
 #endif
 #ifdef CT
 			axCOSEM = native_exp(-axCOSEM) / local_sino;
@@ -1184,15 +1215,20 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #ifdef FP 
 		if (fp == 1) {
 #ifdef TOF
-			nominatorTOF(MethodList, ax, d_Sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx, m_size, local_sino);
+			nominatorTOF(MethodList, ax, d_Sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx, m_size, local_sino LOGL_ARGS);
 #pragma unroll NBINS
 			for (int to = 0; to < NBINS; to++)
 				d_rhs_OSEM[idx + to * m_size] = ax[to];
+#elif defined(NBATCH)
+			nominator_batch(axOSEM, local_sino, d_epps, temp, d_sc_ra, idx);
+#pragma unroll NBATCH
+			for (uint kk = 0; kk < NBATCH; kk++)
+				d_rhs_OSEM[idx * NBATCH + kk] = axOSEM[kk];
 #else
 			nominator_multi(&axOSEM, local_sino, d_epps, temp, d_sc_ra, idx);
 			d_rhs_OSEM[idx] = axOSEM;
 #endif
-			return;
+			KERNEL_RETURN;
 		}
 #endif
 #endif
@@ -1200,10 +1236,12 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 		if (local_sino != 0.f) {
 #ifdef FP
 #ifdef TOF
-			nominatorTOF(MethodList, ax, d_Sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx, m_size, local_sino);
+			nominatorTOF(MethodList, ax, d_Sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx, m_size, local_sino LOGL_ARGS);
 #else
 #ifdef AF
-			nominator(MethodList, ax, local_sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx);
+			nominator(MethodList, ax, local_sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx LOGL_ARGS);
+#elif defined(NBATCH)
+			nominator_batch(axOSEM, local_sino, d_epps, temp, d_sc_ra, idx);
 #else
 			nominator_multi(&axOSEM, local_sino, d_epps, temp, d_sc_ra, idx);
 #endif
@@ -1226,7 +1264,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 			const uint local_ind = store_indices[ii];
 			if (RHS) {
 #ifdef AF
-				rhs(MethodList, local_ele, ax, local_ind, d_N, d_rhs_OSEM);
+				rhs(MethodList, local_ele, ax, local_ind, d_N, d_rhs_OSEM LBP_ARGS);
 #else
 #ifdef ATOMIC
 				atom_add(&d_rhs_OSEM[local_ind], convert_long(local_ele * axOSEM * TH));
@@ -1342,7 +1380,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 			d_Amin[idx] = minimi;
 		if ((MethodListOpenCL.ACOSEM == 1 || MethodListOpenCL.OSLCOSEM == 1) && d_alku > 0u) {
 #ifdef RANDOMS
-				axACOSEM += d_sc_ra[idx];
+				axACOSEM += CORR(d_sc_ra, idx);
 #endif
 			d_ACOSEM_lhs[idx] = axACOSEM;
 		}
@@ -1373,7 +1411,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #ifdef MBSREM
 					MethodListOpenCL, d_alku, MBSREM_prepass, minimi, axACOSEM, d_OSEM, d_E, d_co, d_aco, local_sino, idx, m_size);
 #else
-					d_rhs_OSEM, no_norm, d_N);
+					d_rhs_OSEM, no_norm, d_N LBP_ARGS);
 #endif
 #else
 #ifdef MBSREM
@@ -1412,16 +1450,12 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 					axACOSEM += (local_ele * d_OSEM[local_ind]);
 #else
 				if (no_norm == 0u)
-#ifdef ATOMIC
-					atom_add(&d_Summ[local_ind], convert_long(local_ele * TH));
-#elif defined(ATOMIC32)
-					atomic_add(&d_Summ[local_ind], convert_int(local_ele* TH));
-#else
-					atomicAdd_g_f(&d_Summ[local_ind], local_ele);
-#endif
+					atomicAddSumm(d_Summ, local_ind, local_ele LBP_ARGS);
 
 #ifdef AF
-				rhs(MethodList, local_ele, ax, local_ind, d_N, d_rhs_OSEM);
+				rhs(MethodList, local_ele, ax, local_ind, d_N, d_rhs_OSEM LBP_ARGS);
+#elif defined(NBATCH)
+				rhs_batch(local_ele, axOSEM, local_ind, d_rhs_OSEM LBP_ARGS);
 #else
 
 #ifdef ATOMIC
@@ -1464,7 +1498,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #ifdef MBSREM
 					MethodListOpenCL, d_alku, MBSREM_prepass, minimi, axACOSEM, d_OSEM, d_E, idx, m_size,
 #endif
-					no_norm);
+					no_norm LBP_ARGS);
 #else
 #ifdef MBSREM
 				if (d_alku == 0u) {
@@ -1485,13 +1519,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 				if ((MethodListOpenCL.ACOSEM == 1 || MethodListOpenCL.OSLCOSEM == 1) && d_alku > 0u)
 					axACOSEM += (local_ele * d_OSEM[local_ind]);
 #else
-#ifdef ATOMIC
-				atom_add(&d_Summ[local_ind], convert_long(local_ele* TH));
-#elif defined(ATOMIC32)
-				atomic_add(&d_Summ[local_ind], convert_int(local_ele* TH));
-#else
-				atomicAdd_g_f(&d_Summ[local_ind], local_ele);
-#endif
+				atomicAddSumm(d_Summ, local_ind, local_ele LBP_ARGS);
 #endif
 #endif
 #if defined(CT) && !defined(FP)
@@ -1509,7 +1537,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 				d_Amin[idx + to * m_size] = minimi[to];
 			if ((MethodListOpenCL.ACOSEM == 1 || MethodListOpenCL.OSLCOSEM == 1) && d_alku > 0u) {
 #ifdef RANDOMS
-				axACOSEM[to] += d_sc_ra[idx];
+				axACOSEM[to] += CORR(d_sc_ra, idx);
 #endif
 				d_ACOSEM_lhs[idx + to * m_size] = axACOSEM[to];
 			}
@@ -1519,7 +1547,7 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 			d_Amin[idx] = minimi;
 		if ((MethodListOpenCL.ACOSEM == 1 || MethodListOpenCL.OSLCOSEM == 1) && d_alku > 0u) {
 #ifdef RANDOMS
-			axACOSEM += d_sc_ra[idx];
+			axACOSEM += CORR(d_sc_ra, idx);
 #endif
 #ifdef CT
 			d_ACOSEM_lhs[idx] = native_exp(-axACOSEM);
@@ -1533,6 +1561,11 @@ void kernel_multi(const float global_factor, const float d_epps, const uint d_N,
 #endif
 //*/
 	}
+#ifdef LOCAL_BP
+lbp_flush:
+	barrier(CLK_LOCAL_MEM_FENCE);
+	localBinFlush(lbp_key, lbp_val, d_rhs_OSEM, d_Summ);
+#endif
 }
 
 
@@ -1866,4 +1899,167 @@ __kernel void medianFilter3D(const __global float* grad, __global float* output,
 	}
 	output[xid + yid * get_global_size(0) + zid * get_global_size(0) * get_global_size(1)] = medianF[koko / 2];
 }
+#endif
+
+#ifdef L_FILTER
+// L-filter computed directly from the padded image, the neighborhood values are sorted while they are read
+__kernel void lFilter3D(const __global float* grad, __global float* output, __constant float* a_L, const uint Nx, const uint Ny, const uint Nz) {
+	int xid = get_global_id(0);
+	int yid = get_global_id(1);
+	int zid = get_global_id(2);
+	if (xid < SEARCH_WINDOW_X || xid >= Nx + SEARCH_WINDOW_X || yid < SEARCH_WINDOW_Y || yid >= Ny + SEARCH_WINDOW_Y || zid < SEARCH_WINDOW_Z || zid >= Nz + SEARCH_WINDOW_Z)
+		return;
+	const int koko = (SEARCH_WINDOW_X * 2 + 1) * (SEARCH_WINDOW_Y * 2 + 1) * (SEARCH_WINDOW_Z * 2 + 1);
+	float arvot[(SEARCH_WINDOW_X * 2 + 1) * (SEARCH_WINDOW_Y * 2 + 1) * (SEARCH_WINDOW_Z * 2 + 1)];
+	int uu = 0;
+	for (int z = -SEARCH_WINDOW_Z; z <= SEARCH_WINDOW_Z; z++) {
+		for (int y = -SEARCH_WINDOW_Y; y <= SEARCH_WINDOW_Y; y++) {
+			for (int x = -SEARCH_WINDOW_X; x <= SEARCH_WINDOW_X; x++) {
+				const float apu = grad[(xid + x) + (yid + y) * get_global_size(0) + (zid + z) * get_global_size(0) * get_global_size(1)];
+				int ll = uu;
+				while (ll > 0 && arvot[ll - 1] > apu) {
+					arvot[ll] = arvot[ll - 1];
+					ll--;
+				}
+				arvot[ll] = apu;
+				uu++;
+			}
+		}
+	}
+	float tulos = 0.f;
+	for (int ll = 0; ll < koko; ll++)
+		tulos += a_L[ll] * arvot[ll];
+	output[xid + yid * get_global_size(0) + zid * get_global_size(0) * get_global_size(1)] = tulos;
+}
+#endif
+
+#ifdef FMH_
+// FMH computed directly from the padded image. Direction ii uses the window elements SEARCH_WINDOW_X * ii + kk * (alku_fmh / SEARCH_WINDOW_X - ii),
+// where the window elements are in x-y-z order (x fastest), i.e. the same elements as in the column ii of the neighborhood indices (tr_offsets)
+__kernel void fmhFilter3D(const __global float* grad, __global float* output, __constant float* fmh_weights, const uint Nx, const uint Ny, const uint Nz, 
+	const uint alku_fmh, const uint nWeights) {
+	int xid = get_global_id(0);
+	int yid = get_global_id(1);
+	int zid = get_global_id(2);
+	if (xid < SEARCH_WINDOW_X || xid >= Nx + SEARCH_WINDOW_X || yid < SEARCH_WINDOW_Y || yid >= Ny + SEARCH_WINDOW_Y || zid < SEARCH_WINDOW_Z || zid >= Nz + SEARCH_WINDOW_Z)
+		return;
+	const int Wx = SEARCH_WINDOW_X * 2 + 1;
+	const int Wy = SEARCH_WINDOW_Y * 2 + 1;
+	const int luup = (SEARCH_WINDOW_Z == 0 || Nz == 1) ? 4 : 13;
+	float arvot[14];
+	for (int ii = 0; ii <= luup; ii++) {
+		float apu = 0.f;
+		if (ii < luup) {
+			const int askel = (int)(alku_fmh / SEARCH_WINDOW_X) - ii;
+			for (int kk = 0; kk < (int)nWeights; kk++) {
+				const int j = SEARCH_WINDOW_X * ii + kk * askel;
+				const int x = j % Wx - SEARCH_WINDOW_X;
+				const int y = (j / Wx) % Wy - SEARCH_WINDOW_Y;
+				const int z = j / (Wx * Wy) - SEARCH_WINDOW_Z;
+				apu += fmh_weights[kk + ii * nWeights] * grad[(xid + x) + (yid + y) * get_global_size(0) + (zid + z) * get_global_size(0) * get_global_size(1)];
+			}
+		}
+		// The center pixel is the last value
+		else
+			apu = grad[xid + yid * get_global_size(0) + zid * get_global_size(0) * get_global_size(1)];
+		int ll = ii;
+		while (ll > 0 && arvot[ll - 1] > apu) {
+			arvot[ll] = arvot[ll - 1];
+			ll--;
+		}
+		arvot[ll] = apu;
+	}
+	const int koko = luup + 1;
+	float tulos = arvot[koko / 2];
+	if (koko % 2 == 0)
+		tulos = (tulos + arvot[koko / 2 - 1]) * 0.5f;
+	output[xid + yid * get_global_size(0) + zid * get_global_size(0) * get_global_size(1)] = tulos;
+}
+#endif
+
+#ifdef TGV_
+#ifdef TGV_HALF
+typedef half tgvType;
+#define TGV_LOAD(ind, p) vload_half(ind, p)
+#define TGV_STORE(arvo, ind, p) vstore_half(arvo, ind, p)
+#else
+typedef float tgvType;
+#define TGV_LOAD(ind, p) p[ind]
+#define TGV_STORE(arvo, ind, p) p[ind] = arvo
+#endif
+// Dual update of TGV, p is projected onto the beta-ball and q onto the alpha-ball. Forward differences with periodic boundaries.
+// Each work item only writes its own p and q, so they are updated in place
+__kernel void TGVDual(const __global tgvType* ub, const __global float* im, const __global tgvType* vb1, const __global tgvType* vb2, 
+	const __global tgvType* vb3, __global tgvType* p1, __global tgvType* p2, __global tgvType* p3, __global tgvType* q1, __global tgvType* q2, 
+	__global tgvType* q3, __global tgvType* q4, const uint Nx, const uint Ny, const uint Nz, const float sigma, const float alpha, const float beta) {
+	const uint x = get_global_id(0);
+	const uint y = get_global_id(1);
+	const uint z = get_global_id(2);
+	if (x >= Nx || y >= Ny || z >= Nz)
+		return;
+	const uint n = x + y * Nx + z * Nx * Ny;
+	const uint nx = (x + 1U) % Nx + y * Nx + z * Nx * Ny;
+	const uint ny = x + ((y + 1U) % Ny) * Nx + z * Nx * Ny;
+	const uint nz = x + y * Nx + ((z + 1U) % Nz) * Nx * Ny;
+	const float u = TGV_LOAD(n, ub) + im[n];
+	const float vb1n = TGV_LOAD(n, vb1);
+	const float vb2n = TGV_LOAD(n, vb2);
+	const float vb3n = TGV_LOAD(n, vb3);
+	float eta1 = TGV_LOAD(n, p1) + sigma * (TGV_LOAD(nx, ub) + im[nx] - u - vb1n);
+	float eta2 = TGV_LOAD(n, p2) + sigma * (TGV_LOAD(ny, ub) + im[ny] - u - vb2n);
+	float eta3 = TGV_LOAD(n, p3) + sigma * (TGV_LOAD(nz, ub) + im[nz] - u - vb3n);
+	float apu = fmax(1.f, native_sqrt(eta1 * eta1 + eta2 * eta2 + eta3 * eta3) / beta);
+	TGV_STORE(eta1 / apu, n, p1);
+	TGV_STORE(eta2 / apu, n, p2);
+	TGV_STORE(eta3 / apu, n, p3);
+	eta1 = TGV_LOAD(n, q1) + sigma * (TGV_LOAD(nx, vb1) - vb1n);
+	eta2 = TGV_LOAD(n, q2) + sigma * (TGV_LOAD(ny, vb2) - vb2n);
+	eta3 = TGV_LOAD(n, q3) + sigma * (TGV_LOAD(nz, vb3) - vb3n);
+	const float eta4 = TGV_LOAD(n, q4) + sigma * (TGV_LOAD(nx, vb2) - vb2n + TGV_LOAD(ny, vb1) - vb1n + TGV_LOAD(nz, vb2) - vb2n + TGV_LOAD(nz, vb1) - vb1n + 
+		TGV_LOAD(nx, vb3) - vb3n + TGV_LOAD(ny, vb3) - vb3n) / 6.f;
+	apu = fmax(1.f, native_sqrt(eta1 * eta1 + eta2 * eta2 + eta3 * eta3 + eta4 * eta4) / alpha);
+	TGV_STORE(eta1 / apu, n, q1);
+	TGV_STORE(eta2 / apu, n, q2);
+	TGV_STORE(eta3 / apu, n, q3);
+	TGV_STORE(eta4 / apu, n, q4);
+}
+
+// Primal update of TGV (u and v) and their leading points (ub and vb). Transposed differences with periodic boundaries
+__kernel void TGVPrimal(__global float* u, __global tgvType* ub, __global tgvType* v1, __global tgvType* v2, __global tgvType* v3, 
+	__global tgvType* vb1, __global tgvType* vb2, __global tgvType* vb3, const __global tgvType* p1, const __global tgvType* p2, 
+	const __global tgvType* p3, const __global tgvType* q1, const __global tgvType* q2, const __global tgvType* q3, const __global tgvType* q4, 
+	const uint Nx, const uint Ny, const uint Nz, const float tau) {
+	const uint x = get_global_id(0);
+	const uint y = get_global_id(1);
+	const uint z = get_global_id(2);
+	if (x >= Nx || y >= Ny || z >= Nz)
+		return;
+	const uint n = x + y * Nx + z * Nx * Ny;
+	const uint mx = (x + Nx - 1U) % Nx + y * Nx + z * Nx * Ny;
+	const uint my = x + ((y + Ny - 1U) % Ny) * Nx + z * Nx * Ny;
+	const uint mz = x + y * Nx + ((z + Nz - 1U) % Nz) * Nx * Ny;
+	const float p1n = TGV_LOAD(n, p1);
+	const float p2n = TGV_LOAD(n, p2);
+	const float p3n = TGV_LOAD(n, p3);
+	const float q4n = TGV_LOAD(n, q4);
+	const float uold = u[n];
+	const float unew = uold - tau * (TGV_LOAD(mx, p1) - p1n + TGV_LOAD(my, p2) - p2n + TGV_LOAD(mz, p3) - p3n);
+	u[n] = unew;
+	TGV_STORE(2.f * unew - uold, n, ub);
+	const float dxq4 = TGV_LOAD(mx, q4) - q4n;
+	const float dyq4 = TGV_LOAD(my, q4) - q4n;
+	const float dzq4 = TGV_LOAD(mz, q4) - q4n;
+	float vold = TGV_LOAD(n, v1);
+	float vnew = vold - tau * (TGV_LOAD(mx, q1) - TGV_LOAD(n, q1) + dyq4 + dzq4 - p1n);
+	TGV_STORE(vnew, n, v1);
+	TGV_STORE(2.f * vnew - vold, n, vb1);
+	vold = TGV_LOAD(n, v2);
+	vnew = vold - tau * (dxq4 + TGV_LOAD(my, q2) - TGV_LOAD(n, q2) + dzq4 - p2n);
+	TGV_STORE(vnew, n, v2);
+	TGV_STORE(2.f * vnew - vold, n, vb2);
+	vold = TGV_LOAD(n, v3);
+	vnew = vold - tau * (dxq4 + TGV_LOAD(mz, q3) - TGV_LOAD(n, q3) + dyq4 - p3n);
+	TGV_STORE(vnew, n, v3);
+	TGV_STORE(2.f * vnew - vold, n, vb3);
+}
 #endif
\ No newline at end of file
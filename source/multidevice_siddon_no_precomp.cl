@@ -88,10 +88,10 @@ void siddon_multi(const float global_factor, const float d_epps, const uint d_N,
 	const float d_zmax, const float d_NSlices, const uint d_size_x, const uint d_TotSinos, const uint d_det_per_ring, const uint d_pRows,
 	const uint d_Nxy, const uchar fp, const float sigma_x, const float dc_z, const ushort n_rays, const float d_epsilon_mramla,
 	__constant float* TOFCenter, const __global float* d_atten, __constant uint* d_pseudos, const __global float* d_x, const __global float* d_y, const __global float* d_zdet,
-	__constant uchar* MethodList, const __global float* d_norm, const __global float* d_scat, __global CAST* d_Summ, const __global ushort* d_lor,
-	const __global uint* d_xyindex, const __global ushort* d_zindex, const __global ushort* d_L, const __global float* d_Sino, const __global float* d_sc_ra, const __global float* d_OSEM,
+	__constant uchar* MethodList, const __global CORR_T* d_norm, const __global CORR_T* d_scat, __global CAST* d_Summ, const __global ushort* d_lor,
+	const __global uint* d_xyindex, const __global ushort* d_zindex, const __global ushort* d_L, const __global SINO_T* d_Sino, const __global CORR_T* d_sc_ra, const __global float* d_OSEM,
 #ifndef MBSREM
-	__global CAST* d_rhs_OSEM, const uchar no_norm, const ulong m_size, const ulong cumsum
+	__global CAST* d_rhs_OSEM, const uchar no_norm, const ulong m_size, const ulong cumsum LOGL_PARAMS
 #else
 	const uint d_alku, const uchar MBSREM_prepass, __global float* d_ACOSEM_lhs, __global float* d_Amin, __global CAST* d_co,
 	__global CAST* d_aco, __global float* d_E, const ulong m_size, const RecMethodsOpenCL MethodListOpenCL, const ulong cumsum
@@ -105,9 +105,9 @@ void siddon_multi(const float global_factor, const float d_epps, const uint d_N,
 	float local_sino = 0.f;
 #pragma unroll NBINS
 	for (long to = 0L; to < NBINS; to++)
-		local_sino += d_Sino[idx + m_size * to];
+		local_sino += SINO(d_Sino, idx + m_size * to);
 #else
-	const float local_sino = (d_Sino[idx]);
+	const float local_sino = (SINO(d_Sino, idx));
 #endif
 #ifndef MBSREM
 	if (no_norm == 1u && local_sino == 0.f)
@@ -398,10 +398,10 @@ void siddon_multi(const float global_factor, const float d_epps, const uint d_N,
 				temp *= native_exp(jelppi / n_r_summa);
 #endif
 #ifdef NORM
-				temp *= d_norm[idx];
+				temp *= CORR(d_norm, idx);
 #endif
 #ifdef SCATTER
-				temp *= d_scat[idx];
+				temp *= CORR(d_scat, idx);
 #endif
 				temp *= global_factor;
 #ifdef FP
@@ -414,9 +414,9 @@ void siddon_multi(const float global_factor, const float d_epps, const uint d_N,
 						if (ax[to] < d_epps)
 							ax[to] = d_epps;
 #ifdef RANDOMS
-						ax[to] += d_sc_ra[idx];
+						ax[to] += CORR(d_sc_ra, idx);
 #endif
-						ax[to] = d_Sino[idx + to * m_size] / ax[to];
+						ax[to] = SINO(d_Sino, idx + to * m_size) / ax[to];
 					}
 #else
 					if (axCOSEM < d_epps)
@@ -424,7 +424,7 @@ void siddon_multi(const float global_factor, const float d_epps, const uint d_N,
 					else
 						axCOSEM *= temp;
 #ifdef RANDOMS
-					axCOSEM += d_sc_ra[idx];
+					axCOSEM += CORR(d_sc_ra, idx);
 #endif
 					axCOSEM = local_sino / axCOSEM;
 #endif
@@ -433,15 +433,15 @@ void siddon_multi(const float global_factor, const float d_epps, const uint d_N,
 #ifdef AF
 				if (RHS) {
 #ifdef TOF
-					nominatorTOF(MethodList, ax, d_Sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx, m_size, local_sino);
+					nominatorTOF(MethodList, ax, d_Sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx, m_size, local_sino LOGL_ARGS);
 #else
-					nominator(MethodList, ax, local_sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx);
+					nominator(MethodList, ax, local_sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx LOGL_ARGS);
 #endif
 				}
 #else
 				if (RHS) {
 #ifdef TOF
-					nominatorTOF(MethodList, ax, d_Sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx, m_size, local_sino);
+					nominatorTOF(MethodList, ax, d_Sino, d_epsilon_mramla, d_epps, temp, d_sc_ra, idx, m_size, local_sino LOGL_ARGS);
 					if (fp == 1) {
 #pragma unroll NBINS
 						for (int to = 0; to < NBINS; to++)
@@ -455,7 +455,7 @@ void siddon_multi(const float global_factor, const float d_epps, const uint d_N,
 						axOSEM *= temp;
 					}
 #ifdef RANDOMS
-					axOSEM += d_sc_ra[idx];
+					axOSEM += CORR(d_sc_ra, idx);
 #endif
 					if (fp == 1)
 						d_rhs_OSEM[idx] = axOSEM;
@@ -850,7 +850,7 @@ void siddon_multi(const float global_factor, const float d_epps, const uint d_N,
 				d_Amin[idx + to * m_size] = minimi[to];
 			if ((MethodListOpenCL.ACOSEM == 1 || MethodListOpenCL.OSLCOSEM == 1) && d_alku > 0u) {
 #ifdef RANDOMS
-				axACOSEM[to] += d_sc_ra[idx];
+				axACOSEM[to] += CORR(d_sc_ra, idx);
 #endif
 				d_ACOSEM_lhs[idx + to * m_size] = axACOSEM[to];
 			}
@@ -860,7 +860,7 @@ void siddon_multi(const float global_factor, const float d_epps, const uint d_N,
 			d_Amin[idx] = minimi;
 		if ((MethodListOpenCL.ACOSEM == 1 || MethodListOpenCL.OSLCOSEM == 1) && d_alku > 0u) {
 #ifdef RANDOMS
-			axACOSEM += d_sc_ra[idx];
+			axACOSEM += CORR(d_sc_ra, idx);
 #endif
 			d_ACOSEM_lhs[idx] = axACOSEM;
 		}
@@ -1118,4 +1118,167 @@ __kernel void medianFilter3D(const __global float* grad, __global float* output,
 	}
 	output[xid + yid * get_global_size(0) + zid * get_global_size(0) * get_global_size(1)] = medianF[koko / 2];
 }
+#endif
+
+#ifdef L_FILTER
+// L-filter computed directly from the padded image, the neighborhood values are sorted while they are read
+__kernel void lFilter3D(const __global float* grad, __global float* output, __constant float* a_L, const uint Nx, const uint Ny, const uint Nz) {
+	int xid = get_global_id(0);
+	int yid = get_global_id(1);
+	int zid = get_global_id(2);
+	if (xid < SEARCH_WINDOW_X || xid >= Nx + SEARCH_WINDOW_X || yid < SEARCH_WINDOW_Y || yid >= Ny + SEARCH_WINDOW_Y || zid < SEARCH_WINDOW_Z || zid >= Nz + SEARCH_WINDOW_Z)
+		return;
+	const int koko = (SEARCH_WINDOW_X * 2 + 1) * (SEARCH_WINDOW_Y * 2 + 1) * (SEARCH_WINDOW_Z * 2 + 1);
+	float arvot[(SEARCH_WINDOW_X * 2 + 1) * (SEARCH_WINDOW_Y * 2 + 1) * (SEARCH_WINDOW_Z * 2 + 1)];
+	int uu = 0;
+	for (int z = -SEARCH_WINDOW_Z; z <= SEARCH_WINDOW_Z; z++) {
+		for (int y = -SEARCH_WINDOW_Y; y <= SEARCH_WINDOW_Y; y++) {
+			for (int x = -SEARCH_WINDOW_X; x <= SEARCH_WINDOW_X; x++) {
+				const float apu = grad[(xid + x) + (yid + y) * get_global_size(0) + (zid + z) * get_global_size(0) * get_global_size(1)];
+				int ll = uu;
+				while (ll > 0 && arvot[ll - 1] > apu) {
+					arvot[ll] = arvot[ll - 1];
+					ll--;
+				}
+				arvot[ll] = apu;
+				uu++;
+			}
+		}
+	}
+	float tulos = 0.f;
+	for (int ll = 0; ll < koko; ll++)
+		tulos += a_L[ll] * arvot[ll];
+	output[xid + yid * get_global_size(0) + zid * get_global_size(0) * get_global_size(1)] = tulos;
+}
+#endif
+
+#ifdef FMH_
+// FMH computed directly from the padded image. Direction ii uses the window elements SEARCH_WINDOW_X * ii + kk * (alku_fmh / SEARCH_WINDOW_X - ii),
+// where the window elements are in x-y-z order (x fastest), i.e. the same elements as in the column ii of the neighborhood indices (tr_offsets)
+__kernel void fmhFilter3D(const __global float* grad, __global float* output, __constant float* fmh_weights, const uint Nx, const uint Ny, const uint Nz, 
+	const uint alku_fmh, const uint nWeights) {
+	int xid = get_global_id(0);
+	int yid = get_global_id(1);
+	int zid = get_global_id(2);
+	if (xid < SEARCH_WINDOW_X || xid >= Nx + SEARCH_WINDOW_X || yid < SEARCH_WINDOW_Y || yid >= Ny + SEARCH_WINDOW_Y || zid < SEARCH_WINDOW_Z || zid >= Nz + SEARCH_WINDOW_Z)
+		return;
+	const int Wx = SEARCH_WINDOW_X * 2 + 1;
+	const int Wy = SEARCH_WINDOW_Y * 2 + 1;
+	const int luup = (SEARCH_WINDOW_Z == 0 || Nz == 1) ? 4 : 13;
+	float arvot[14];
+	for (int ii = 0; ii <= luup; ii++) {
+		float apu = 0.f;
+		if (ii < luup) {
+			const int askel = (int)(alku_fmh / SEARCH_WINDOW_X) - ii;
+			for (int kk = 0; kk < (int)nWeights; kk++) {
+				const int j = SEARCH_WINDOW_X * ii + kk * askel;
+				const int x = j % Wx - SEARCH_WINDOW_X;
+				const int y = (j / Wx) % Wy - SEARCH_WINDOW_Y;
+				const int z = j / (Wx * Wy) - SEARCH_WINDOW_Z;
+				apu += fmh_weights[kk + ii * nWeights] * grad[(xid + x) + (yid + y) * get_global_size(0) + (zid + z) * get_global_size(0) * get_global_size(1)];
+			}
+		}
+		// The center pixel is the last value
+		else
+			apu = grad[xid + yid * get_global_size(0) + zid * get_global_size(0) * get_global_size(1)];
+		int ll = ii;
+		while (ll > 0 && arvot[ll - 1] > apu) {
+			arvot[ll] = arvot[ll - 1];
+			ll--;
+		}
+		arvot[ll] = apu;
+	}
+	const int koko = luup + 1;
+	float tulos = arvot[koko / 2];
+	if (koko % 2 == 0)
+		tulos = (tulos + arvot[koko / 2 - 1]) * 0.5f;
+	output[xid + yid * get_global_size(0) + zid * get_global_size(0) * get_global_size(1)] = tulos;
+}
+#endif
+
+#ifdef TGV_
+#ifdef TGV_HALF
+typedef half tgvType;
+#define TGV_LOAD(ind, p) vload_half(ind, p)
+#define TGV_STORE(arvo, ind, p) vstore_half(arvo, ind, p)
+#else
+typedef float tgvType;
+#define TGV_LOAD(ind, p) p[ind]
+#define TGV_STORE(arvo, ind, p) p[ind] = arvo
+#endif
+// Dual update of TGV, p is projected onto the beta-ball and q onto the alpha-ball. Forward differences with periodic boundaries.
+// Each work item only writes its own p and q, so they are updated in place
+__kernel void TGVDual(const __global tgvType* ub, const __global float* im, const __global tgvType* vb1, const __global tgvType* vb2, 
+	const __global tgvType* vb3, __global tgvType* p1, __global tgvType* p2, __global tgvType* p3, __global tgvType* q1, __global tgvType* q2, 
+	__global tgvType* q3, __global tgvType* q4, const uint Nx, const uint Ny, const uint Nz, const float sigma, const float alpha, const float beta) {
+	const uint x = get_global_id(0);
+	const uint y = get_global_id(1);
+	const uint z = get_global_id(2);
+	if (x >= Nx || y >= Ny || z >= Nz)
+		return;
+	const uint n = x + y * Nx + z * Nx * Ny;
+	const uint nx = (x + 1U) % Nx + y * Nx + z * Nx * Ny;
+	const uint ny = x + ((y + 1U) % Ny) * Nx + z * Nx * Ny;
+	const uint nz = x + y * Nx + ((z + 1U) % Nz) * Nx * Ny;
+	const float u = TGV_LOAD(n, ub) + im[n];
+	const float vb1n = TGV_LOAD(n, vb1);
+	const float vb2n = TGV_LOAD(n, vb2);
+	const float vb3n = TGV_LOAD(n, vb3);
+	float eta1 = TGV_LOAD(n, p1) + sigma * (TGV_LOAD(nx, ub) + im[nx] - u - vb1n);
+	float eta2 = TGV_LOAD(n, p2) + sigma * (TGV_LOAD(ny, ub) + im[ny] - u - vb2n);
+	float eta3 = TGV_LOAD(n, p3) + sigma * (TGV_LOAD(nz, ub) + im[nz] - u - vb3n);
+	float apu = fmax(1.f, native_sqrt(eta1 * eta1 + eta2 * eta2 + eta3 * eta3) / beta);
+	TGV_STORE(eta1 / apu, n, p1);
+	TGV_STORE(eta2 / apu, n, p2);
+	TGV_STORE(eta3 / apu, n, p3);
+	eta1 = TGV_LOAD(n, q1) + sigma * (TGV_LOAD(nx, vb1) - vb1n);
+	eta2 = TGV_LOAD(n, q2) + sigma * (TGV_LOAD(ny, vb2) - vb2n);
+	eta3 = TGV_LOAD(n, q3) + sigma * (TGV_LOAD(nz, vb3) - vb3n);
+	const float eta4 = TGV_LOAD(n, q4) + sigma * (TGV_LOAD(nx, vb2) - vb2n + TGV_LOAD(ny, vb1) - vb1n + TGV_LOAD(nz, vb2) - vb2n + TGV_LOAD(nz, vb1) - vb1n + 
+		TGV_LOAD(nx, vb3) - vb3n + TGV_LOAD(ny, vb3) - vb3n) / 6.f;
+	apu = fmax(1.f, native_sqrt(eta1 * eta1 + eta2 * eta2 + eta3 * eta3 + eta4 * eta4) / alpha);
+	TGV_STORE(eta1 / apu, n, q1);
+	TGV_STORE(eta2 / apu, n, q2);
+	TGV_STORE(eta3 / apu, n, q3);
+	TGV_STORE(eta4 / apu, n, q4);
+}
+
+// Primal update of TGV (u and v) and their leading points (ub and vb). Transposed differences with periodic boundaries
+__kernel void TGVPrimal(__global float* u, __global tgvType* ub, __global tgvType* v1, __global tgvType* v2, __global tgvType* v3, 
+	__global tgvType* vb1, __global tgvType* vb2, __global tgvType* vb3, const __global tgvType* p1, const __global tgvType* p2, 
+	const __global tgvType* p3, const __global tgvType* q1, const __global tgvType* q2, const __global tgvType* q3, const __global tgvType* q4, 
+	const uint Nx, const uint Ny, const uint Nz, const float tau) {
+	const uint x = get_global_id(0);
+	const uint y = get_global_id(1);
+	const uint z = get_global_id(2);
+	if (x >= Nx || y >= Ny || z >= Nz)
+		return;
+	const uint n = x + y * Nx + z * Nx * Ny;
+	const uint mx = (x + Nx - 1U) % Nx + y * Nx + z * Nx * Ny;
+	const uint my = x + ((y + Ny - 1U) % Ny) * Nx + z * Nx * Ny;
+	const uint mz = x + y * Nx + ((z + Nz - 1U) % Nz) * Nx * Ny;
+	const float p1n = TGV_LOAD(n, p1);
+	const float p2n = TGV_LOAD(n, p2);
+	const float p3n = TGV_LOAD(n, p3);
+	const float q4n = TGV_LOAD(n, q4);
+	const float uold = u[n];
+	const float unew = uold - tau * (TGV_LOAD(mx, p1) - p1n + TGV_LOAD(my, p2) - p2n + TGV_LOAD(mz, p3) - p3n);
+	u[n] = unew;
+	TGV_STORE(2.f * unew - uold, n, ub);
+	const float dxq4 = TGV_LOAD(mx, q4) - q4n;
+	const float dyq4 = TGV_LOAD(my, q4) - q4n;
+	const float dzq4 = TGV_LOAD(mz, q4) - q4n;
+	float vold = TGV_LOAD(n, v1);
+	float vnew = vold - tau * (TGV_LOAD(mx, q1) - TGV_LOAD(n, q1) + dyq4 + dzq4 - p1n);
+	TGV_STORE(vnew, n, v1);
+	TGV_STORE(2.f * vnew - vold, n, vb1);
+	vold = TGV_LOAD(n, v2);
+	vnew = vold - tau * (dxq4 + TGV_LOAD(my, q2) - TGV_LOAD(n, q2) + dzq4 - p2n);
+	TGV_STORE(vnew, n, v2);
+	TGV_STORE(2.f * vnew - vold, n, vb2);
+	vold = TGV_LOAD(n, v3);
+	vnew = vold - tau * (dxq4 + TGV_LOAD(mz, q3) - TGV_LOAD(n, q3) + dyq4 - p3n);
+	TGV_STORE(vnew, n, v3);
+	TGV_STORE(2.f * vnew - vold, n, vb3);
+}
 #endif
\ No newline at end of file
@@ -841,4 +841,84 @@ void medianFilter3D(const float* grad, float* output, const unsigned int Nx, con
 	}
 	output[xid + yid * get_global_size[0] + zid * get_global_size[0] * get_global_size[1]] = medianF[koko / 2];
 }
+#endif
+
+#ifdef L_FILTER
+// L-filter computed directly from the padded image, the neighborhood values are sorted while they are read
+extern "C" __global__
+void lFilter3D(const float* grad, float* output, const float* a_L, const unsigned int Nx, const unsigned int Ny, const unsigned int Nz) {
+	int xid = threadIdx.x + blockIdx.x * blockDim.x;
+	int yid = threadIdx.y + blockIdx.y * blockDim.y;
+	int zid = threadIdx.z + blockIdx.z * blockDim.z;
+	unsigned int get_global_size[] = { gridDim.x * blockDim.x, gridDim.y * blockDim.y };
+	if (xid < SEARCH_WINDOW_X || xid >= Nx + SEARCH_WINDOW_X || yid < SEARCH_WINDOW_Y || yid >= Ny + SEARCH_WINDOW_Y || zid < SEARCH_WINDOW_Z || zid >= Nz + SEARCH_WINDOW_Z)
+		return;
+	const int koko = (SEARCH_WINDOW_X * 2 + 1) * (SEARCH_WINDOW_Y * 2 + 1) * (SEARCH_WINDOW_Z * 2 + 1);
+	float arvot[(SEARCH_WINDOW_X * 2 + 1) * (SEARCH_WINDOW_Y * 2 + 1) * (SEARCH_WINDOW_Z * 2 + 1)];
+	int uu = 0;
+	for (int z = -SEARCH_WINDOW_Z; z <= SEARCH_WINDOW_Z; z++) {
+		for (int y = -SEARCH_WINDOW_Y; y <= SEARCH_WINDOW_Y; y++) {
+			for (int x = -SEARCH_WINDOW_X; x <= SEARCH_WINDOW_X; x++) {
+				const float apu = grad[(xid + x) + (yid + y) * get_global_size[0] + (zid + z) * get_global_size[0] * get_global_size[1]];
+				int ll = uu;
+				while (ll > 0 && arvot[ll - 1] > apu) {
+					arvot[ll] = arvot[ll - 1];
+					ll--;
+				}
+				arvot[ll] = apu;
+				uu++;
+			}
+		}
+	}
+	float tulos = 0.f;
+	for (int ll = 0; ll < koko; ll++)
+		tulos += a_L[ll] * arvot[ll];
+	output[xid + yid * get_global_size[0] + zid * get_global_size[0] * get_global_size[1]] = tulos;
+}
+#endif
+
+#ifdef FMH_
+// FMH computed directly from the padded image. Direction ii uses the window elements SEARCH_WINDOW_X * ii + kk * (alku_fmh / SEARCH_WINDOW_X - ii),
+// where the window elements are in x-y-z order (x fastest), i.e. the same elements as in the column ii of the neighborhood indices (tr_offsets)
+extern "C" __global__
+void fmhFilter3D(const float* grad, float* output, const float* fmh_weights, const unsigned int Nx, const unsigned int Ny, const unsigned int Nz, 
+	const unsigned int alku_fmh, const unsigned int nWeights) {
+	int xid = threadIdx.x + blockIdx.x * blockDim.x;
+	int yid = threadIdx.y + blockIdx.y * blockDim.y;
+	int zid = threadIdx.z + blockIdx.z * blockDim.z;
+	unsigned int get_global_size[] = { gridDim.x * blockDim.x, gridDim.y * blockDim.y };
+	if (xid < SEARCH_WINDOW_X || xid >= Nx + SEARCH_WINDOW_X || yid < SEARCH_WINDOW_Y || yid >= Ny + SEARCH_WINDOW_Y || zid < SEARCH_WINDOW_Z || zid >= Nz + SEARCH_WINDOW_Z)
+		return;
+	const int Wx = SEARCH_WINDOW_X * 2 + 1;
+	const int Wy = SEARCH_WINDOW_Y * 2 + 1;
+	const int luup = (SEARCH_WINDOW_Z == 0 || Nz == 1) ? 4 : 13;
+	float arvot[14];
+	for (int ii = 0; ii <= luup; ii++) {
+		float apu = 0.f;
+		if (ii < luup) {
+			const int askel = static_cast<int>(alku_fmh / SEARCH_WINDOW_X) - ii;
+			for (int kk = 0; kk < static_cast<int>(nWeights); kk++) {
+				const int j = SEARCH_WINDOW_X * ii + kk * askel;
+				const int x = j % Wx - SEARCH_WINDOW_X;
+				const int y = (j / Wx) % Wy - SEARCH_WINDOW_Y;
+				const int z = j / (Wx * Wy) - SEARCH_WINDOW_Z;
+				apu += fmh_weights[kk + ii * nWeights] * grad[(xid + x) + (yid + y) * get_global_size[0] + (zid + z) * get_global_size[0] * get_global_size[1]];
+			}
+		}
+		// The center pixel is the last value
+		else
+			apu = grad[xid + yid * get_global_size[0] + zid * get_global_size[0] * get_global_size[1]];
+		int ll = ii;
+		while (ll > 0 && arvot[ll - 1] > apu) {
+			arvot[ll] = arvot[ll - 1];
+			ll--;
+		}
+		arvot[ll] = apu;
+	}
+	const int koko = luup + 1;
+	float tulos = arvot[koko / 2];
+	if (koko % 2 == 0)
+		tulos = (tulos + arvot[koko / 2 - 1]) * 0.5f;
+	output[xid + yid * get_global_size[0] + zid * get_global_size[0] * get_global_size[1]] = tulos;
+}
 #endif
\ No newline at end of file
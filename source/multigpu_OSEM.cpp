@@ -745,29 +745,39 @@ void OSEM_MLEM(const cl_uint& num_devices_context, const float kerroin, const in
 		w_size_z = (int32_t)mxGetScalar(mxGetField(options, 0, "g_dim_z"));
 	}
 
+	// Cached subset sensitivity images (computeSensitivity.m), one image for each subset
+	const mxArray* sensCache = mxGetField(options, 0, "cache_sensitivity");
+	const mxArray* sensImag = mxGetField(options, 0, "Summ");
+	const bool cached_sens = listmode == 0 && compute_norm_matrix == 0u && sensCache != NULL && !mxIsEmpty(sensCache) && (bool)mxGetScalar(sensCache)
+		&& sensImag != NULL && mxGetNumberOfElements(sensImag) == static_cast<size_t>(im_dim) * static_cast<size_t>(subsets);
+
 	// If the normalization constant is only computed during the first iteration, create a sufficiently large buffer and fill it with zeros
 	if (compute_norm_matrix == 0u || (listmode == 1 && computeSensImag)) {
-		if (listmode == 1 && computeSensImag) {
+		if ((listmode == 1 && computeSensImag) || cached_sens) {
 #ifdef MX_HAS_INTERLEAVED_COMPLEX
-			float* apu = (float*)mxGetSingles(mxGetField(options, 0, "Summ"));
+			float* apu0 = (float*)mxGetSingles(mxGetField(options, 0, "Summ"));
 #else
-			float* apu = (float*)mxGetData(mxGetField(options, 0, "Summ"));
+			float* apu0 = (float*)mxGetData(mxGetField(options, 0, "Summ"));
 #endif
 			int64_t* summ_apu;
 			int32_t* summ_apu32;
-			if (atomic_64bit) {
+			if (atomic_64bit)
 				summ_apu = new int64_t[im_dim];
-				for (int64_t aa = 0; aa < im_dim; aa++) {
-					summ_apu[aa] = static_cast<int64_t>(apu[aa] * TH);
-				}
-			}
-			else if (atomic_32bit) {
+			else if (atomic_32bit)
 				summ_apu32 = new int32_t[im_dim];
-				for (int64_t aa = 0; aa < im_dim; aa++) {
-					summ_apu32[aa] = static_cast<int32_t>(apu[aa] * TH32);
-				}
-			}
 			for (uint32_t osa_iter = 0u; osa_iter < subsets; osa_iter++) {
+				// The list-mode sensitivity image is the same for all subsets
+				float* apu = cached_sens ? &apu0[static_cast<size_t>(im_dim) * osa_iter] : apu0;
+				if (atomic_64bit && (cached_sens || osa_iter == 0u)) {
+					for (int64_t aa = 0; aa < im_dim; aa++) {
+						summ_apu[aa] = static_cast<int64_t>(apu[aa] * TH);
+					}
+				}
+				else if (atomic_32bit && (cached_sens || osa_iter == 0u)) {
+					for (int64_t aa = 0; aa < im_dim; aa++) {
+						summ_apu32[aa] = static_cast<int32_t>(apu[aa] * TH32);
+					}
+				}
 				for (cl_uint i = 0u; i < num_devices_context; i++) {
 					if (atomic_64bit)
 						status = commandQueues[i].enqueueWriteBuffer(d_Summ[osa_iter * num_devices_context + i], CL_TRUE, 0, sizeof(cl_long) * im_dim, summ_apu);
@@ -821,7 +831,7 @@ void OSEM_MLEM(const cl_uint& num_devices_context, const float kerroin, const in
 	// Time steps
 	for (uint32_t tt = 0u; tt < Nt; tt++) {
 
-		if ((tt > 0u && compute_norm_matrix == 0u) || (listmode == 1 && computeSensImag))
+		if ((tt > 0u && compute_norm_matrix == 0u) || (listmode == 1 && computeSensImag) || cached_sens)
 			no_norm = 1u;
 
 		// Measurement data
@@ -330,7 +330,7 @@ void orth_distance_perpendicular_multi_3D(__constant float* center1, const float
 #ifdef MBSREM
 	const RecMethodsOpenCL MethodListOpenCL, const uint d_alku, float* axCOSEM,
 	__global float* d_E, __global CAST* d_co, __global CAST* d_aco, float* minimi, const uchar MBSREM_prepass,
-	const __global float* d_sc_ra, __global float* d_Amin, __global float* d_ACOSEM_lhs, const size_t idx
+	const __global CORR_T* d_sc_ra, __global float* d_Amin, __global float* d_ACOSEM_lhs, const size_t idx
 #else
 	__global CAST* d_rhs_OSEM, const uint im_dim, __constant uchar* MethodList
 #endif
@@ -779,7 +779,7 @@ void orth_distance_perpendicular_multi_3D(__constant float* center1, const float
 			* temp *= d_norm;
 #endif
 #ifdef SCATTER
-			* temp *= d_scat[idx];
+			* temp *= CORR(d_scat, idx);
 #endif
 		*temp *= global_factor;
 #endif
@@ -789,7 +789,7 @@ void orth_distance_perpendicular_multi_3D(__constant float* center1, const float
 			d_Amin[idx] = *minimi;
 		if ((MethodListOpenCL.ACOSEM == 1 || MethodListOpenCL.OSLCOSEM == 1) && d_alku > 0u) {
 #ifdef RANDOMS
-				* ax += d_sc_ra[idx];
+				* ax += CORR(d_sc_ra, idx);
 #endif
 			d_ACOSEM_lhs[idx] = *ax;
 		}
@@ -805,7 +805,7 @@ void orth_distance_perpendicular_multi_3D(__constant float* center1, const float
 			* temp *= d_norm;
 #endif
 #ifdef SCATTER
-			* temp *= d_scat[idx];
+			* temp *= CORR(d_scat, idx);
 #endif
 		*temp *= global_factor;
 	}
@@ -0,0 +1,129 @@
+/**************************************************************************
+* Subset-contiguous file layout used by the out-of-core reconstruction of
+* implementation 4. The file is written by writeOutOfCoreData.m and read
+* one subset at a time through memory mapping.
+*
+* The file begins with the magic bytes "OMEGAOOC", the number of subsets
+* (uint64) and the number of fields (uint64), followed by the byte offset
+* and the number of elements (both uint64) of each field of each subset
+* (subset-major). The data of each field of each subset is aligned to
+* OOC_ALIGN bytes. The fields, in order, are the measurements (single),
+* randoms (single), normalization (single), scatter (double), transaxial
+* indices (uint32), axial indices (uint16), number of voxels of each LOR
+* (uint16) and the detector numbers of raw data (uint16). The fields that
+* are not used have zero elements.
+*
+* This file has no MATLAB/Octave dependencies and can be used as-is in
+* standalone C++ codes.
+*
+* Copyright (C) 2020 Ville-Veikko Wettenhovi
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <https://www.gnu.org/licenses/>.
+***************************************************************************/
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include "mappedFile.h"
+
+#define OOC_FIELDS 8U
+#define OOC_ALIGN 4096ULL
+#define OOC_HEADER 24ULL
+
+// Size of one element of each field in bytes
+static const size_t oocBytes[OOC_FIELDS] = { 4, 4, 4, 8, 4, 2, 2, 2 };
+
+class outOfCoreFile {
+public:
+	std::string nimi;
+	uint64_t nSubsets = 0ULL;
+
+	// Map the file and check the header
+	bool open(const char* fname) {
+		close();
+		if (!tiedosto.open(fname))
+			return false;
+		const char* bytes = tiedosto.bytes_ptr();
+		if (tiedosto.size() < OOC_HEADER || std::memcmp(bytes, "OMEGAOOC", 8) != 0) {
+			tiedosto.close();
+			return false;
+		}
+		uint64_t nFields;
+		std::memcpy(&nSubsets, bytes + 8, sizeof(uint64_t));
+		std::memcpy(&nFields, bytes + 16, sizeof(uint64_t));
+		if (nFields != OOC_FIELDS || tiedosto.size() < OOC_HEADER + nSubsets * OOC_FIELDS * 2ULL * sizeof(uint64_t)) {
+			tiedosto.close();
+			return false;
+		}
+		taulukko = reinterpret_cast<const uint64_t*>(bytes + OOC_HEADER);
+		nimi = fname;
+		return true;
+	}
+
+	void close() {
+		tiedosto.close();
+		taulukko = nullptr;
+		nSubsets = 0ULL;
+		nimi.clear();
+	}
+
+	// Pointer to the field ff of the (zero-based) subset kk, n is the number
+	// of elements
+	const char* field(const uint64_t kk, const uint32_t ff, uint64_t& n) const {
+		const uint64_t* apu = taulukko + (kk * OOC_FIELDS + ff) * 2ULL;
+		n = apu[1];
+		if (n == 0ULL || apu[0] + n * oocBytes[ff] > tiedosto.size()) {
+			n = 0ULL;
+			return nullptr;
+		}
+		return tiedosto.bytes_ptr() + apu[0];
+	}
+
+	// Start reading the subset kk in the background
+	void prefetch(const uint64_t kk) const {
+		if (kk >= nSubsets)
+			return;
+		size_t alku, koko;
+		subsetRange(kk, alku, koko);
+		tiedosto.prefetch(alku, koko);
+	}
+
+	// Drop the subset kk from the resident memory
+	void release(const uint64_t kk) const {
+		if (kk >= nSubsets)
+			return;
+		size_t alku, koko;
+		subsetRange(kk, alku, koko);
+		tiedosto.release(alku, koko);
+	}
+
+private:
+	mappedFile tiedosto;
+	const uint64_t* taulukko = nullptr;
+
+	// The fields of a subset are contiguous in the file
+	void subsetRange(const uint64_t kk, size_t& alku, size_t& koko) const {
+		alku = tiedosto.size();
+		size_t loppu = 0;
+		for (uint32_t ff = 0; ff < OOC_FIELDS; ff++) {
+			const uint64_t* apu = taulukko + (kk * OOC_FIELDS + ff) * 2ULL;
+			if (apu[1] == 0ULL)
+				continue;
+			alku = std::min(alku, static_cast<size_t>(apu[0]));
+			loppu = std::max(loppu, static_cast<size_t>(apu[0] + apu[1] * oocBytes[ff]));
+		}
+		koko = loppu > alku ? loppu - alku : 0;
+	}
+};
@@ -0,0 +1,119 @@
+/**************************************************************************
+* Reads one subset of the out-of-core data file (see outOfCore.h) and
+* starts reading the next subset in the background. The previous subset
+* is dropped from the resident memory, i.e. only about one subset of the
+* file is in memory at a time. The files stay mapped between the calls.
+*
+* Inputs:
+* File name, subset number (one-based, 0 unmaps the file) and optionally
+* whether the next subset is prefetched (default true).
+*
+* Outputs:
+* The measurements (single), randoms (single), normalization (single),
+* scatter (double), transaxial indices (uint32), axial indices (uint16),
+* number of voxels of each LOR (uint16) and the detector numbers of raw
+* data (uint16) of the subset. Fields that are not in the file are output
+* as empty arrays.
+*
+* Copyright (C) 2020 Ville-Veikko Wettenhovi
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <https://www.gnu.org/licenses/>.
+***************************************************************************/
+#include "mex.h"
+#include "outOfCore.h"
+
+// The measurement and the index files are usually open at the same time
+#define OOC_FILES 2
+
+static outOfCoreFile tiedostot[OOC_FILES];
+static uint64_t edellinen[OOC_FILES] = { 0ULL };
+static uint32_t vuoro = 0U;
+
+static void closeFiles() {
+	for (int kk = 0; kk < OOC_FILES; kk++)
+		tiedostot[kk].close();
+}
+
+static const mxClassID luokat[OOC_FIELDS] = { mxSINGLE_CLASS, mxSINGLE_CLASS, mxSINGLE_CLASS, mxDOUBLE_CLASS, mxUINT32_CLASS, mxUINT16_CLASS,
+	mxUINT16_CLASS, mxUINT16_CLASS };
+
+void mexFunction(int nlhs, mxArray *plhs[],
+	int nrhs, const mxArray*prhs[])
+
+{
+	if (nrhs < 2 || nrhs > 3) {
+		mexErrMsgIdAndTxt("MATLAB:out_of_core_subset:invalidNumInputs",
+			"2 or 3 input arguments required.");
+	}
+	else if (nlhs > static_cast<int>(OOC_FIELDS)) {
+		mexErrMsgIdAndTxt("MATLAB:out_of_core_subset:maxlhs",
+			"Too many output arguments.");
+	}
+	if (!mxIsChar(prhs[0]))
+		mexErrMsgTxt("Input argument is not char");
+
+	mexAtExit(closeFiles);
+
+	char* apu = mxArrayToString(prhs[0]);
+	const std::string nimi(apu);
+	mxFree(apu);
+	const uint64_t osa = static_cast<uint64_t>(mxGetScalar(prhs[1]));
+	bool prefetch = true;
+	if (nrhs > 2)
+		prefetch = (bool)mxGetScalar(prhs[2]);
+
+	int ind = -1;
+	for (int kk = 0; kk < OOC_FILES; kk++) {
+		if (tiedostot[kk].nimi == nimi)
+			ind = kk;
+	}
+	if (osa == 0ULL) {
+		if (ind >= 0)
+			tiedostot[ind].close();
+		for (int kk = 0; kk < nlhs; kk++)
+			plhs[kk] = mxCreateNumericMatrix(0, 0, luokat[kk], mxREAL);
+		return;
+	}
+	if (ind < 0) {
+		// Replace the files in turns
+		ind = static_cast<int>(vuoro);
+		vuoro = (vuoro + 1U) % OOC_FILES;
+		if (!tiedostot[ind].open(nimi.c_str()))
+			mexErrMsgIdAndTxt("MATLAB:out_of_core_subset:invalidFile",
+				"Error opening file or the file is not an out-of-core data file");
+		edellinen[ind] = 0ULL;
+	}
+	outOfCoreFile& tiedosto = tiedostot[ind];
+	if (osa > tiedosto.nSubsets)
+		mexErrMsgIdAndTxt("MATLAB:out_of_core_subset:invalidSubset",
+			"Subset number exceeds the number of subsets in the file");
+	const uint64_t kk = osa - 1ULL;
+
+	for (int ff = 0; ff < nlhs; ff++) {
+		uint64_t n;
+		const char* data = tiedosto.field(kk, static_cast<uint32_t>(ff), n);
+		plhs[ff] = mxCreateNumericMatrix(n, n > 0ULL ? 1 : 0, luokat[ff], mxREAL);
+		if (n > 0ULL)
+			std::memcpy(mxGetData(plhs[ff]), data, n * oocBytes[ff]);
+	}
+
+	// The previous subset is not needed anymore, unless the same subset is
+	// read again
+	if (edellinen[ind] > 0ULL && edellinen[ind] != osa)
+		tiedosto.release(edellinen[ind] - 1ULL);
+	edellinen[ind] = osa;
+	if (prefetch)
+		tiedosto.prefetch(osa % tiedosto.nSubsets);
+	return;
+}
@@ -0,0 +1,167 @@
+/**************************************************************************
+* Decoder for the 32-bit PETLINK list-mode format (e.g. Siemens Biograph
+* mCT). The list-mode file is memory mapped and split into chunks at the
+* elapsed time tags so that each chunk can be histogrammed in parallel.
+*
+* Each 32-bit packet is either an event (bit 31 = 0) or a tag (bit 31 = 1).
+* For events, bit 30 is the prompt (1) or delay (0) flag and bits 0-29 the
+* bin address of the event, i.e. the (TOF) sinogram index. For the tags,
+* bits 29-31 equal to 100 denote the elapsed time tag, in which case the
+* bits 0-28 contain the elapsed time in milliseconds.
+*
+* This file has no MATLAB/Octave dependencies and can be used as-is in
+* standalone C++ codes.
+*
+* Copyright (C) 2020 Ville-Veikko Wettenhovi
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <https://www.gnu.org/licenses/>.
+***************************************************************************/
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "mappedFile.h"
+
+#define PETLINK_TAG 0x80000000U
+#define PETLINK_PROMPT 0x40000000U
+#define PETLINK_ADDRESS 0x3FFFFFFFU
+#define PETLINK_TIME 0x1FFFFFFFU
+
+inline bool petlinkTimeTag(const uint32_t word) {
+	return (word >> 29) == 4U;
+}
+
+// Split the packet stream into (at most) n_chunks parts. Apart from the
+// first one, each part begins at an elapsed time tag so that the time of
+// every event in the part is known without reading the preceding parts.
+inline std::vector<size_t> petlinkChunks(const uint32_t* data, const size_t n_words, const size_t n_chunks) {
+	std::vector<size_t> alut(1, 0);
+	const size_t koko = n_words / std::max(n_chunks, static_cast<size_t>(1));
+	for (size_t kk = 1; kk < n_chunks && koko > 0; kk++) {
+		size_t ll = std::max(kk * koko, alut.back() + 1);
+		while (ll < n_words && !petlinkTimeTag(data[ll]))
+			ll++;
+		if (ll >= n_words)
+			break;
+		alut.emplace_back(ll);
+	}
+	alut.emplace_back(n_words);
+	return alut;
+}
+
+// Histogram the prompts (with TOF if TOFSize > sinoSize) and delays (TOF
+// bins combined) of the chunk [alku_i, loppu_i) into the sinograms. Events
+// outside the time window [alku, loppu] (in ms) are discarded. Optionally
+// stores the bin addresses of the accepted prompts and the number of
+// prompts in each time step.
+inline void petlinkHistogramChunk(const uint32_t* data, const size_t alku_i, const size_t loppu_i, const double vali, const double alku,
+	const double loppu, const uint64_t sinoSize, const uint64_t TOFSize, const uint64_t NT, const bool randoms_correction, uint16_t* Sino,
+	uint16_t* SinoD, std::vector<uint32_t>* packed, uint64_t* counts) {
+	// All chunks except the first one begin with a time tag, i.e. the
+	// time is always known before the first event
+	double ms = 0.;
+	for (size_t ll = alku_i; ll < loppu_i; ll++) {
+		const uint32_t word = data[ll];
+		if (word & PETLINK_TAG) {
+			if (petlinkTimeTag(word)) {
+				ms = static_cast<double>(word & PETLINK_TIME);
+				if (ms > loppu)
+					break;
+			}
+			continue;
+		}
+		if (ms < alku)
+			continue;
+		uint64_t tPoint = 0ULL;
+		if (NT > 1ULL)
+			tPoint = std::min(static_cast<uint64_t>(std::floor((ms - alku) / vali)), NT - static_cast<uint64_t>(1));
+		uint64_t osoite = static_cast<uint64_t>(word & PETLINK_ADDRESS);
+		// Non-TOF sinograms, the TOF bins of the prompts are combined
+		if (TOFSize == sinoSize)
+			osoite %= sinoSize;
+		if (osoite >= TOFSize)
+			continue;
+		if (word & PETLINK_PROMPT) {
+#pragma omp atomic
+			Sino[osoite + TOFSize * tPoint]++;
+			if (packed != nullptr) {
+				packed->emplace_back(static_cast<uint32_t>(osoite));
+				counts[tPoint]++;
+			}
+		}
+		else if (randoms_correction) {
+#pragma omp atomic
+			SinoD[osoite % sinoSize + sinoSize * tPoint]++;
+		}
+	}
+}
+
+// Histogram the whole mapped list-mode file using n_threads threads
+inline void petlinkHistogram(const uint32_t* data, const size_t n_words, const double vali, const double alku, const double loppu,
+	const uint64_t sinoSize, const uint64_t TOFSize, const uint64_t NT, const bool randoms_correction, uint16_t* Sino, uint16_t* SinoD,
+	const bool store_packed, std::vector<uint32_t>& packed, std::vector<uint64_t>& counts, int n_threads) {
+#ifdef _OPENMP
+	if (n_threads <= 0)
+		n_threads = omp_get_max_threads();
+#else
+	n_threads = 1;
+#endif
+	// More chunks than threads for better load balancing
+	const std::vector<size_t> alut = petlinkChunks(data, n_words, static_cast<size_t>(n_threads) * 4ULL);
+	const int64_t n_chunks = static_cast<int64_t>(alut.size()) - 1LL;
+	std::vector<std::vector<uint32_t>> packed_c(store_packed ? n_chunks : 0);
+	std::vector<uint64_t> counts_c(store_packed ? n_chunks * NT : 0, 0ULL);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(n_threads)
+#endif
+	for (int64_t kk = 0; kk < n_chunks; kk++) {
+		petlinkHistogramChunk(data, alut[kk], alut[kk + 1], vali, alku, loppu, sinoSize, TOFSize, NT, randoms_correction, Sino, SinoD,
+			store_packed ? &packed_c[kk] : nullptr, store_packed ? &counts_c[kk * NT] : nullptr);
+	}
+	if (store_packed) {
+		// The chunks are in temporal order
+		size_t koko = 0;
+		for (int64_t kk = 0; kk < n_chunks; kk++)
+			koko += packed_c[kk].size();
+		packed.clear();
+		packed.reserve(koko);
+		counts.assign(NT, 0ULL);
+		for (int64_t kk = 0; kk < n_chunks; kk++) {
+			packed.insert(packed.end(), packed_c[kk].begin(), packed_c[kk].end());
+			std::vector<uint32_t>().swap(packed_c[kk]);
+			for (uint64_t tt = 0; tt < NT; tt++)
+				counts[tt] += counts_c[kk * NT + tt];
+		}
+	}
+}
+
+// Save the packed prompts. The file contains the number of time steps
+// (uint64), the number of prompts in each time step (uint64) and the bin
+// addresses of the prompts (uint32) in temporal order.
+inline bool petlinkSavePacked(const char* fname, const std::vector<uint32_t>& packed, const std::vector<uint64_t>& counts) {
+	FILE* fid = std::fopen(fname, "wb");
+	if (fid == NULL)
+		return false;
+	const uint64_t NT = static_cast<uint64_t>(counts.size());
+	bool ok = std::fwrite(&NT, sizeof(uint64_t), 1, fid) == 1;
+	ok = ok && std::fwrite(counts.data(), sizeof(uint64_t), counts.size(), fid) == counts.size();
+	ok = ok && std::fwrite(packed.data(), sizeof(uint32_t), packed.size(), fid) == packed.size();
+	std::fclose(fid);
+	return ok;
+}
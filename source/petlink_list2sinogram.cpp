@@ -0,0 +1,100 @@
+/**************************************************************************
+* Loads the 32-bit PETLINK list-mode data (e.g. Siemens Biograph mCT) and
+* histograms the prompts and (optionally) delays into sinograms. The file
+* is memory mapped and processed in parallel.
+*
+* Inputs:
+* File name, time step length (ms), start time (ms), end time (ms),
+* randoms correction, sinogram size, sinogram size with TOF bins, number
+* of time steps, number of threads (0 = all) and optionally the name of the
+* output file for the packed prompts (see petlinkSavePacked in petlink.h).
+*
+* Outputs:
+* Prompt sinogram (sinogram size with TOF x time steps), delayed sinogram
+* (sinogram size x time steps) and the number of prompts in each time step
+* (only if the packed prompts are saved).
+*
+* Copyright (C) 2020 Ville-Veikko Wettenhovi
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <https://www.gnu.org/licenses/>.
+***************************************************************************/
+#include "mex.h"
+#include "petlink.h"
+
+
+void mexFunction(int nlhs, mxArray *plhs[],
+	int nrhs, const mxArray*prhs[])
+
+{
+	if (nrhs < 9 || nrhs > 10) {
+		mexErrMsgIdAndTxt("MATLAB:petlink_list2sinogram:invalidNumInputs",
+			"9 or 10 input arguments required.");
+	}
+	else if (nlhs > 3) {
+		mexErrMsgIdAndTxt("MATLAB:petlink_list2sinogram:maxlhs",
+			"Too many output arguments.");
+	}
+	if (!mxIsChar(prhs[0]))
+		mexErrMsgTxt("Input argument is not char");
+
+	char* tiedosto = mxArrayToString(prhs[0]);
+	const double vali = (double)mxGetScalar(prhs[1]);
+	const double alku = (double)mxGetScalar(prhs[2]);
+	const double loppu = (double)mxGetScalar(prhs[3]);
+	const bool randoms_correction = (bool)mxGetScalar(prhs[4]);
+	const uint64_t sinoSize = (uint64_t)mxGetScalar(prhs[5]);
+	const uint64_t TOFSize = (uint64_t)mxGetScalar(prhs[6]);
+	const uint64_t NT = std::max((uint64_t)mxGetScalar(prhs[7]), static_cast<uint64_t>(1));
+	const int n_threads = (int)mxGetScalar(prhs[8]);
+	char* packed_file = nullptr;
+	if (nrhs > 9 && mxIsChar(prhs[9]) && mxGetNumberOfElements(prhs[9]) > 0)
+		packed_file = mxArrayToString(prhs[9]);
+
+	mappedFile lista;
+	if (!lista.open(tiedosto)) {
+		mxFree(tiedosto);
+		mexErrMsgIdAndTxt("MATLAB:petlink_list2sinogram:invalidFile",
+			"Error opening file or no file opened");
+	}
+	mxFree(tiedosto);
+
+	plhs[0] = mxCreateNumericMatrix(TOFSize * NT, 1, mxUINT16_CLASS, mxREAL);
+	if (randoms_correction)
+		plhs[1] = mxCreateNumericMatrix(sinoSize * NT, 1, mxUINT16_CLASS, mxREAL);
+	else
+		plhs[1] = mxCreateNumericMatrix(1, 1, mxUINT16_CLASS, mxREAL);
+
+	uint16_t* Sino = (uint16_t*)mxGetData(plhs[0]);
+	uint16_t* SinoD = (uint16_t*)mxGetData(plhs[1]);
+
+	std::vector<uint32_t> packed;
+	std::vector<uint64_t> counts;
+	petlinkHistogram(lista.data, lista.n_words, vali, alku, loppu, sinoSize, TOFSize, NT, randoms_correction, Sino, SinoD, packed_file != nullptr,
+		packed, counts, n_threads);
+	lista.close();
+
+	if (packed_file != nullptr) {
+		const bool ok = petlinkSavePacked(packed_file, packed, counts);
+		mxFree(packed_file);
+		if (!ok)
+			mexErrMsgIdAndTxt("MATLAB:petlink_list2sinogram:invalidFile",
+				"Error writing the packed list-mode file");
+	}
+	if (nlhs > 2) {
+		plhs[2] = mxCreateNumericMatrix(counts.size(), 1, mxUINT64_CLASS, mxREAL);
+		uint64_t* tpoints = (uint64_t*)mxGetData(plhs[2]);
+		std::copy(counts.begin(), counts.end(), tpoints);
+	}
+	return;
+}
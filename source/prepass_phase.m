@@ -43,6 +43,9 @@ end
 if ~isfield(options,'CT')
     options.CT = false;
 end
+if ~isfield(options,'TGV_half')
+    options.TGV_half = false;
+end
 
 if (options.MRP || options.quad || options.Huber || options.TV ||options. FMH || options.L || options.weighted_mean || options.APLS || options.BSREM ...
         || options.RAMLA || options.MBSREM || options.MRAMLA || options.ROSEM || options.DRAMA || options.ROSEM_MAP || options.ECOSEM ...
@@ -439,8 +442,9 @@ if (options.MRP || options.quad || options.Huber || options.TV ||options. FMH ||
         % These values are needed in order to vectorize the calculation of
         % certain priors
         % Specifies the indices of the center pixel and its neighborhood
-        if (options.MRP && ((options.implementation == 2 && options.use_CUDA) || ~license('test', 'image_toolbox'))) || options.L || options.FMH || ...
-                (options.TV && options.TVtype == 3) || (options.RDP)
+        % (implementation 2 computes L-filter and FMH without the indices)
+        if (options.MRP && ((options.implementation == 2 && options.use_CUDA) || ~license('test', 'image_toolbox'))) || ...
+                ((options.L || options.FMH) && options.implementation ~= 2) || (options.TV && options.TVtype == 3) || (options.RDP)
             options = computeOffsets(options);
         else
             options.tr_offsets = uint32(0);
@@ -0,0 +1,172 @@
+/**************************************************************************
+* Lightweight profiler for the reconstructions. Collects wall-clock spans
+* (host stages, per-thread CPU projector spans and synchronized device
+* work) and counters (e.g. the number of LORs traced or the bytes
+* uploaded). When the profiler is not enabled, a span costs one branch and
+* nothing is stored.
+*
+* The events are exported as a matrix with one row per event and the
+* columns name index (one-based, into the names vector), process (0 =
+* host, 1 = device), thread, start time (us), duration (us, NaN for the
+* counters), iteration, subset (both -1 if not known) and value (counters
+* only). The MATLAB/Octave side (saveProfilingTrace.m) writes the Chrome
+* trace (Perfetto) JSON file and prints the summary table.
+*
+* This file has no MATLAB/Octave dependencies and can be used as-is in
+* standalone C++ codes.
+*
+* Copyright (C) 2020 Ville-Veikko Wettenhovi
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <https://www.gnu.org/licenses/>.
+***************************************************************************/
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define PROF_COLUMNS 8
+
+struct profEvent {
+	uint32_t nimi;
+	uint32_t pid;
+	uint32_t tid;
+	double alku;
+	double kesto;
+	int32_t iter;
+	int32_t subset;
+	double arvo;
+};
+
+class omegaProfiler {
+public:
+	bool enabled = false;
+	// The current iteration and subset, stored with each event
+	int32_t iter = -1;
+	int32_t subset = -1;
+
+	// Clear the previous events and start the clock
+	void start() {
+		std::lock_guard<std::mutex> lukko(mutex);
+		tapahtumat.clear();
+		nimet.clear();
+		iter = -1;
+		subset = -1;
+		origo = std::chrono::steady_clock::now();
+		enabled = true;
+	}
+
+	void stop() {
+		enabled = false;
+	}
+
+	// Time since start() in microseconds
+	double now() const {
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origo).count();
+	}
+
+	// Add a span that began at alku (from now()) and ends now
+	void span(const char* nimi, const double alku, const uint32_t pid = 0U) {
+		if (!enabled)
+			return;
+		const double loppu = now();
+		add(nimi, pid, thread(), alku, loppu - alku, 0.);
+	}
+
+	// Add to a counter
+	void count(const char* nimi, const double arvo) {
+		if (!enabled)
+			return;
+		add(nimi, 0U, thread(), now(), std::numeric_limits<double>::quiet_NaN(), arvo);
+	}
+
+	size_t size() const {
+		return tapahtumat.size();
+	}
+
+	const std::vector<std::string>& names() const {
+		return nimet;
+	}
+
+	// Copy the events into the column-major matrix M (size() x PROF_COLUMNS)
+	void exportEvents(double* M) const {
+		const size_t n = tapahtumat.size();
+		for (size_t kk = 0; kk < n; kk++) {
+			const profEvent& e = tapahtumat[kk];
+			M[kk] = static_cast<double>(e.nimi + 1U);
+			M[kk + n] = static_cast<double>(e.pid);
+			M[kk + n * 2] = static_cast<double>(e.tid);
+			M[kk + n * 3] = e.alku;
+			M[kk + n * 4] = e.kesto;
+			M[kk + n * 5] = static_cast<double>(e.iter);
+			M[kk + n * 6] = static_cast<double>(e.subset);
+			M[kk + n * 7] = e.arvo;
+		}
+	}
+
+private:
+	std::vector<profEvent> tapahtumat;
+	std::vector<std::string> nimet;
+	std::chrono::steady_clock::time_point origo = std::chrono::steady_clock::now();
+	std::mutex mutex;
+
+	static uint32_t thread() {
+#ifdef _OPENMP
+		return static_cast<uint32_t>(omp_get_thread_num());
+#else
+		return 0U;
+#endif
+	}
+
+	void add(const char* nimi, const uint32_t pid, const uint32_t tid, const double alku, const double kesto, const double arvo) {
+		std::lock_guard<std::mutex> lukko(mutex);
+		uint32_t ind = 0U;
+		while (ind < nimet.size() && nimet[ind] != nimi)
+			ind++;
+		if (ind == nimet.size())
+			nimet.emplace_back(nimi);
+		tapahtumat.push_back({ ind, pid, tid, alku, kesto, iter, subset, arvo });
+	}
+};
+
+// The profiler shared by all the functions of the MEX-file
+inline omegaProfiler& profiler() {
+	static omegaProfiler p;
+	return p;
+}
+
+// Records the span from the construction to the destruction of the object
+class profSpan {
+public:
+	profSpan(const char* nimi, const uint32_t pid = 0U) : nimi(nimi), pid(pid) {
+		if (profiler().enabled)
+			alku = profiler().now();
+	}
+
+	~profSpan() {
+		if (profiler().enabled && alku >= 0.)
+			profiler().span(nimi, alku, pid);
+	}
+
+private:
+	const char* nimi;
+	const uint32_t pid;
+	double alku = -1.;
+};
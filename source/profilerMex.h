@@ -0,0 +1,37 @@
+/**************************************************************************
+* Outputs the events of the profiler (see profiler.h) as a MATLAB cell
+* array. The first cell contains the event names and the second one the
+* event matrix.
+*
+* Copyright (C) 2020 Ville-Veikko Wettenhovi
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <https://www.gnu.org/licenses/>.
+***************************************************************************/
+#pragma once
+#include "mex.h"
+#include "profiler.h"
+
+inline mxArray* profilerOutput() {
+	const omegaProfiler& prof = profiler();
+	const std::vector<std::string>& nimet = prof.names();
+	mxArray* nimiCell = mxCreateCellMatrix(1, nimet.size());
+	for (size_t kk = 0; kk < nimet.size(); kk++)
+		mxSetCell(nimiCell, kk, mxCreateString(nimet[kk].c_str()));
+	mxArray* M = mxCreateNumericMatrix(prof.size(), PROF_COLUMNS, mxDOUBLE_CLASS, mxREAL);
+	prof.exportEvents((double*)mxGetData(M));
+	mxArray* cell = mxCreateCellMatrix(1, 2);
+	mxSetCell(cell, 0, nimiCell);
+	mxSetCell(cell, 1, M);
+	return cell;
+}
@@ -51,6 +51,18 @@ double compute_element_orth_3D(Det detectors, const double xl, const double yl,
 	return (1. - norm(x1, y1, z1) / crystal_size_z);
 }
 
+// The table is normalized with the tube width, i.e. the same table is used
+// for all values of tube_width_xy and tube_width_z
+const double* orth_weight_table() {
+	static const std::vector<double> taulukko = [] {
+		std::vector<double> apu(ORTH_TABLE_SIZE + 1);
+		for (int32_t kk = 0; kk <= ORTH_TABLE_SIZE; kk++)
+			apu[kk] = 1. - std::sqrt(static_cast<double>(kk) / static_cast<double>(ORTH_TABLE_SIZE));
+		return apu;
+	}();
+	return taulukko.data();
+}
+
 // Gaussian weight
 // Compute the orthogonal distance between a point and a line (in 3D)
 //double compute_element_orth_3D(Det detectors, const double xl, const double yl, const double zl, const double crystal_size_z,
@@ -1279,7 +1291,7 @@ void orth_distance_3D_full(int32_t tempi, const uint32_t Nx, const uint32_t Nz,
 	const bool no_norm, const bool RHS, const bool SUMMA, const bool OMP, const bool PRECOMP, const bool DISCARD, double* rhs, double* Summ, size_t* indices,
 	std::vector<double>& elements, std::vector<uint32_t>& v_indices, size_t& idx, const uint32_t Ny, const uint32_t N1, const int start,
 	const int32_t iu, const int32_t ju, const int loppu, std::vector<double>& store_elements, std::vector<uint32_t>& store_indices,
-	const uint32_t tid, uint32_t& ind, uint64_t N2, uint64_t N22) {
+	const uint32_t tid, uint32_t& ind, uint64_t N2, uint64_t N22, const double* orth_table) {
 
 	// Use the stored intersection lengths and voxel indices to compute the final probabilities
 	if (RHS || SUMMA) {
@@ -1303,6 +1315,9 @@ void orth_distance_3D_full(int32_t tempi, const uint32_t Nx, const uint32_t Nz,
 		bool breikki2 = false;
 		bool breikki3 = false;
 		bool breikki4 = false;
+		// Distance between adjacent voxel centers on a row
+		const double dxc = Nx > 1U ? x_center[1] - x_center[0] : 0.;
+		orthRow rivi;
 		// Increasing axial case
 		for (int zz = tempk; zz < start; zz++) {
 			yy1 = 0;
@@ -1321,9 +1336,12 @@ void orth_distance_3D_full(int32_t tempi, const uint32_t Nx, const uint32_t Nz,
 				int xx = 0;
 				int incr = 0;
 				double prev_local = 1.;
-				for (xx = alku_x1; xx < Nx; xx++) {
+				// The first voxel of the row can be outside the image, hence x_center[0]
+				rivi.init(detectors, x_diff, y_diff, z_diff, kerroin, x_center[0] + static_cast<double>(alku_x1) * dxc, y_center[yy1], z_center[zz],
+					dxc, orth_table);
+				for (xx = alku_x1; xx < Nx; xx++, rivi.next()) {
 					// Compute the normalized orthogonal distance <= 1
-					double local_ele = compute_element_orth_3D(detectors, x_diff, y_diff, z_diff, kerroin, x_center[xx], y_center[yy1], z_center[zz]);
+					double local_ele = rivi.weight();
 					// Always compute at least one additional orthogonal distance
 					// determine if the voxel is further away from the ray than the previous one
 					// Break the loop if the voxel distance increases
@@ -1357,8 +1375,10 @@ void orth_distance_3D_full(int32_t tempi, const uint32_t Nx, const uint32_t Nz,
 				xx = 0;
 				incr = 0;
 				prev_local = 1.;
-				for (xx = alku_x2; xx >= 0; xx--) {
-					double local_ele = compute_element_orth_3D(detectors, x_diff, y_diff, z_diff, kerroin, x_center[xx], y_center[yy1], z_center[zz]);
+				rivi.init(detectors, x_diff, y_diff, z_diff, kerroin, x_center[0] + static_cast<double>(alku_x2) * dxc, y_center[yy1], z_center[zz],
+					-dxc, orth_table);
+				for (xx = alku_x2; xx >= 0; xx--, rivi.next()) {
+					double local_ele = rivi.weight();
 					if (local_ele <= THR && incr > 0 && prev_local > local_ele) {
 						if (xx == alku_x2 - 1) {
 							breikki2 = true;
@@ -1417,8 +1437,10 @@ void orth_distance_3D_full(int32_t tempi, const uint32_t Nx, const uint32_t Nz,
 				int xx = 0;
 				int incr = 0;
 				double prev_local = 1.;
-				for (xx = alku_x1; xx < Nx; xx++) {
-					double local_ele = compute_element_orth_3D(detectors, x_diff, y_diff, z_diff, kerroin, x_center[xx], y_center[yy2], z_center[zz]);
+				rivi.init(detectors, x_diff, y_diff, z_diff, kerroin, x_center[0] + static_cast<double>(alku_x1) * dxc, y_center[yy2], z_center[zz],
+					dxc, orth_table);
+				for (xx = alku_x1; xx < Nx; xx++, rivi.next()) {
+					double local_ele = rivi.weight();
 					if (local_ele <= THR && incr > 0 && prev_local > local_ele) {
 						if (xx == alku_x1 + 1) {
 							breikki1 = true;
@@ -1446,8 +1468,10 @@ void orth_distance_3D_full(int32_t tempi, const uint32_t Nx, const uint32_t Nz,
 				xx = 0;
 				incr = 0;
 				prev_local = 1.;
-				for (xx = alku_x2; xx >= 0; xx--) {
-					double local_ele = compute_element_orth_3D(detectors, x_diff, y_diff, z_diff, kerroin, x_center[xx], y_center[yy2], z_center[zz]);
+				rivi.init(detectors, x_diff, y_diff, z_diff, kerroin, x_center[0] + static_cast<double>(alku_x2) * dxc, y_center[yy2], z_center[zz],
+					-dxc, orth_table);
+				for (xx = alku_x2; xx >= 0; xx--, rivi.next()) {
+					double local_ele = rivi.weight();
 					if (local_ele <= THR && incr > 0 && prev_local > local_ele) {
 						if (xx == alku_x2 - 1) {
 							breikki2 = true;
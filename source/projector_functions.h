@@ -24,8 +24,10 @@
 #include <cmath>
 #include <algorithm>
 #include <numeric>
+#include <limits>
 #include <time.h>
 #include "mexFunktio.h"
+#include "profiler.h"
 #include <thread>
 #include <chrono>
 #ifdef _OPENMP
@@ -54,6 +56,56 @@ double norm(const double x, const double y, const double z);
 double compute_element_orth_3D(Det detectors, const double xl, const double yl, const double zl, const double crystal_size_z,
 	const double xp, const double yp, const double zp);
 
+// Number of samples in the orthogonal distance lookup table
+#define ORTH_TABLE_SIZE 8192
+
+// Lookup table of 1 - sqrt(u), u = (distance / crystal_size_z)^2 in [0,1]
+const double* orth_weight_table();
+
+// The orthogonal distance of the voxels on a single row, the cross product is
+// updated incrementally when moving to the next voxel on the row. If table is
+// not null, the weights are interpolated from orth_weight_table()
+struct orthRow {
+	double x1, y1, z1, dy1, dz1, inv_kerroin, inv_kerroin2;
+	const double* table;
+
+	void init(const Det& detectors, const double xl, const double yl, const double zl, const double kerroin, const double xp, const double yp,
+		const double zp, const double dxp, const double* orth_table) {
+		const double x0 = xp - detectors.xs;
+		const double y0 = yp - detectors.ys;
+		const double z0 = zp - detectors.zs;
+		x1 = yl * z0 - zl * y0;
+		y1 = zl * x0 - xl * z0;
+		z1 = xl * y0 - yl * x0;
+		dy1 = zl * dxp;
+		dz1 = -yl * dxp;
+		inv_kerroin = 1. / kerroin;
+		inv_kerroin2 = inv_kerroin * inv_kerroin;
+		table = orth_table;
+	}
+
+	void next() {
+		y1 += dy1;
+		z1 += dz1;
+	}
+
+	double weight() const {
+		const double r2 = x1 * x1 + y1 * y1 + z1 * z1;
+		if (table == nullptr)
+			return 1. - std::sqrt(r2) * inv_kerroin;
+		const double u = r2 * inv_kerroin2 * static_cast<double>(ORTH_TABLE_SIZE);
+		// Outside the tube, only the sign and monotonicity matter
+		if (u >= static_cast<double>(ORTH_TABLE_SIZE))
+			return 1. - u / static_cast<double>(ORTH_TABLE_SIZE);
+		const int32_t k = static_cast<int32_t>(u);
+		// Linear interpolation is inaccurate near the line
+		if (k == 0)
+			return 1. - std::sqrt(r2) * inv_kerroin;
+		const double t = u - static_cast<double>(k);
+		return table[k] + t * (table[k + 1] - table[k]);
+	}
+};
+
 void computeIndices(const bool RHS, const bool SUMMA, const bool OMP, const bool PRECOMP, const bool DISCARD, double local_ele, double& temp, double& ax,
 	const bool no_norm, double* Summ, double* rhs, const double local_sino, const double* osem_apu, const uint64_t N2, size_t* indices,
 	std::vector<double>& elements, std::vector<uint32_t>& v_indices, size_t& idx, const uint32_t local_ind, const uint64_t N22);
@@ -183,7 +235,7 @@ void orth_distance_3D_full(int32_t tempi, const uint32_t Nx, const uint32_t Nz,
 	const bool no_norm, const bool RHS, const bool SUMMA, const bool OMP, const bool PRECOMP, const bool DISCARD, double* rhs, double* Summ, size_t* indices,
 	std::vector<double>& elements, std::vector<uint32_t>& v_indices, size_t& idx, const uint32_t Ny, const uint32_t N1, const int start,
 	const int32_t iu, const int32_t ju, const int loppu, std::vector<double>& store_elements, std::vector<uint32_t>& store_indices,
-	const uint32_t dec_v, uint32_t& ind, uint64_t N2 = 0ULL, uint64_t N22 = 0ULL);
+	const uint32_t dec_v, uint32_t& ind, uint64_t N2 = 0ULL, uint64_t N22 = 0ULL, const double* orth_table = nullptr);
 
 #endif
 
@@ -280,7 +332,7 @@ int improved_siddon_no_precompute(const int64_t loop_var_par, const uint32_t siz
 	const double bz, const uint32_t* index, const bool attenuation_correction, const bool normalization, const bool raw, const uint32_t det_per_ring, 
 	const uint32_t blocks, const uint32_t block1, const uint16_t* L, const uint32_t* pseudos, const uint32_t pRows, const double global_factor, 
 	const bool scatter, const double* scatter_coef, const uint32_t subsets, const double* angles, const uint32_t* xy_index, const uint16_t* z_index, 
-	const uint32_t size_y, const double dPitch, const int64_t nProjections, const uint8_t list_mode = 0);
+	const uint32_t size_y, const double dPitch, const int64_t nProjections, const uint8_t list_mode = 0, const uint32_t nCores = 1U);
 
 int original_siddon_no_precompute(const int64_t loop_var_par, const uint32_t size_x, const double zmax, const uint32_t TotSinos, std::vector<uint32_t>& indices,
 	std::vector<double>& elements, uint16_t* lor, const double maxyy, const double maxxx, const std::vector<double>& xx_vec, const double dy,
@@ -309,7 +361,8 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 	const double epps, const float* Sino, double* osem_apu, const uint16_t* L, const uint32_t* pseudos, const uint32_t pRows, const uint32_t det_per_ring,
 	const bool raw, const bool no_norm, const double global_factor, const uint8_t fp, const bool scatter, const double* scatter_coef, const bool TOF,
 	const int64_t TOFSize, const double sigma_x, const double* TOFCenter, const int64_t nBins, const uint32_t dec_v, const uint32_t subsets,
-	const double* angles, const uint32_t size_y, const double dPitch, const int64_t nProjections, const uint32_t nCores = 1U);
+	const double* angles, const uint32_t size_y, const double dPitch, const int64_t nProjections, const uint32_t nCores = 1U, const bool voxel_driven = false,
+	double* logl = nullptr);
 
 void sequential_improved_siddon_no_precompute(const int64_t loop_var_par, const uint32_t size_x, const double zmax, double* Summ, double* rhs, const double maxyy,
 	const double maxxx, const std::vector<double>& xx_vec, const double dy, const std::vector<double>& yy_vec, const double* atten, const float* norm_coef,
@@ -320,7 +373,7 @@ void sequential_improved_siddon_no_precompute(const int64_t loop_var_par, const
 	const double cr_pz, const bool no_norm, const uint16_t n_rays, const uint16_t n_rays3D, const double global_factor, const uint8_t fp, const uint8_t list_mode_format,
 	const bool scatter, const double* scatter_coef, const bool TOF, const int64_t TOFSize, const double sigma_x, const double* TOFCenter,
 	const int64_t nBins, const uint32_t dec_v, const uint32_t subsets, const double* angles, const uint32_t size_y, const double dPitch, const int64_t nProjections, 
-	const uint32_t nCores = 1U);
+	const uint32_t nCores = 1U, const uint32_t nBatch = 1U, double* logl = nullptr);
 
 #ifndef CT
 
@@ -331,7 +384,8 @@ void sequential_orth_siddon(const int64_t loop_var_par, const uint32_t size_x, c
 	const bool randoms_correction, const uint16_t* lor1, const uint32_t* xy_index, const uint16_t* z_index, const uint32_t TotSinos, const double epps, 
 	const float* Sino, double* osem_apu, const uint16_t* L, const uint32_t* pseudos, const uint32_t pRows, const uint32_t det_per_ring, const bool raw,
 	const double crystal_size_xy, double* x_center, double* y_center, const double* z_center, const double crystal_size_z, const bool no_norm, 
-	const uint32_t dec_v, const double global_factor, const uint8_t fp, const bool scatter, const double* scatter_coef, const uint32_t nCores = 1U);
+	const uint32_t dec_v, const double global_factor, const uint8_t fp, const bool scatter, const double* scatter_coef, const uint32_t nCores = 1U,
+	const bool orth_lookup = false);
 
 void sequential_orth_siddon_no_precomp(const int64_t loop_var_par, const uint32_t size_x, const double zmax, double* Summ, double* rhs, const double maxyy,
 	const double maxxx, const std::vector<double>& xx_vec, const double dy, const std::vector<double>& yy_vec, const double* atten, const float* norm_coef,
@@ -341,7 +395,7 @@ void sequential_orth_siddon_no_precomp(const int64_t loop_var_par, const uint32_
 	const float* Sino, double* osem_apu, const uint16_t* L, const uint32_t* pseudos, const uint32_t pRows, const uint32_t det_per_ring, const bool raw, 
 	const double crystal_size_xy, double* x_center, double* y_center, const double* z_center, const double crystal_size_z, const bool no_norm, 
 	const uint32_t dec_v, const double global_factor, const uint8_t fp, const uint8_t list_mode_format, const bool scatter, const double* scatter_coef, 
-	const uint32_t nCores = 1U);
+	const uint32_t nCores = 1U, const bool orth_lookup = false);
 
 #endif
 
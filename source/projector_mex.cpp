@@ -35,6 +35,7 @@
 * along with this program. If not, see <https://www.gnu.org/licenses/>.
 ***************************************************************************/
 #include "projector_functions.h"
+#include "profilerMex.h"
  
 using namespace std;
 
@@ -49,8 +50,8 @@ void mexFunction(int nlhs, mxArray* plhs[],
 	else if (nrhs > 65)
 		mexErrMsgTxt("Too many input arguments. There can be at most 65.");
 
-	if (nlhs > 3 || nlhs < 1)
-		mexErrMsgTxt("Invalid number of output arguments. There can be at most three.");
+	if (nlhs > 4 || nlhs < 1)
+		mexErrMsgTxt("Invalid number of output arguments. There can be at most four.");
 
 	int ind = 0;
 	// Load the input arguments
@@ -637,8 +638,8 @@ void mexFunction(int nlhs, mxArray* plhs[],
 		else if (nrhs > 65)
 			mexErrMsgTxt("Too many input arguments.  There can be at most 65.");
 
-		if (nlhs != 2)
-			mexErrMsgTxt("Invalid number of output arguments. There has to be two.");
+		if (nlhs < 2)
+			mexErrMsgTxt("Invalid number of output arguments. There has to be two, three or four.");
 
 		// Small constant to prevent division by zero
 		const double epps = getScalarDouble(prhs[ind], ind);
@@ -670,6 +671,8 @@ void mexFunction(int nlhs, mxArray* plhs[],
 		const bool precompute = getScalarBool(prhs[ind], ind);
 		ind++;
 
+		// 0 = forward and backward projection, 1 = forward projection only, 2 = backprojection only,
+		// 3 = attenuation correction factors only (improved Siddon)
 		const uint8_t fp = getScalarUInt8(prhs[ind], ind);
 		ind++;
 
@@ -691,7 +694,7 @@ void mexFunction(int nlhs, mxArray* plhs[],
 		double* Summ = (double*)mxGetData(plhs[0]);
 #endif
 
-		if (fp == 1)
+		if (fp == 1 || fp == 3)
 			plhs[1] = mxCreateNumericMatrix(pituus, 1, mxDOUBLE_CLASS, mxREAL);
 		else
 			plhs[1] = mxCreateNumericMatrix(N, 1, mxDOUBLE_CLASS, mxREAL);
@@ -706,6 +709,18 @@ void mexFunction(int nlhs, mxArray* plhs[],
 		//clock_t time = clock();
 		//std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
 
+		// The profiling events are output as the fourth output
+		const bool profiling = nlhs > 3;
+		if (profiling)
+			profiler().start();
+		const double profAlku = profiler().now();
+
+		// The data term of the Poisson log-likelihood (sum of y * log(y_bar)) is output as the third output
+		// Only the improved Siddon computes it, with the other projectors the output is NaN
+		vector<double> logl;
+		if (nlhs > 2 && projector_type == 1u && fp == 0)
+			logl.resize(loop_var_par, 0.);
+
 		// Orthogonal
 		if (projector_type == 2u) {
 
@@ -744,18 +759,25 @@ void mexFunction(int nlhs, mxArray* plhs[],
 			const double crystal_size_z = getScalarDouble(prhs[ind], ind);
 			ind++;
 
+			// Interpolate the orthogonal distances from a lookup table (optional)
+			bool orth_lookup = false;
+			if (nrhs > ind) {
+				orth_lookup = getScalarBool(prhs[ind], ind);
+				ind++;
+			}
+
 #ifndef CT
 			if (precompute) {
 				sequential_orth_siddon(loop_var_par, size_x, zmax, Summ, rhs, maxyy, maxxx, xx_vec, dy, yy_vec, atten, norm_coef, randoms, x, y, z_det, 
 					NSlices, Nx, Ny, Nz, d, dz,	bx, by, bz, attenuation_correction, normalization, randoms_correction, lor1, xy_index, z_index, 
 					TotSinos, epps, Sino, osem_apu, L, pseudos, pRows, det_per_ring, raw, crystal_size, x_center, y_center, z_center, crystal_size_z, 
-					no_norm, dec_v, global_factor, fp, scatter, scatter_coef, nCores);
+					no_norm, dec_v, global_factor, fp, scatter, scatter_coef, nCores, orth_lookup);
 			}
 			else {
 				sequential_orth_siddon_no_precomp(loop_var_par, size_x, zmax, Summ, rhs, maxyy, maxxx, xx_vec, dy, yy_vec, atten, norm_coef, randoms,
 					x, y, z_det, NSlices, Nx, Ny, Nz, d, dz, bx, by, bz, attenuation_correction, normalization, randoms_correction, xy_index, z_index, 
 					TotSinos, epps, Sino, osem_apu, L, pseudos, pRows, det_per_ring, raw, crystal_size, x_center, y_center, z_center, crystal_size_z, 
-					no_norm, dec_v, global_factor, fp, list_mode_format, scatter, scatter_coef, nCores);
+					no_norm, dec_v, global_factor, fp, list_mode_format, scatter, scatter_coef, nCores, orth_lookup);
 			}
 #endif
 		}
@@ -804,17 +826,47 @@ void mexFunction(int nlhs, mxArray* plhs[],
 			const int64_t nProjections = 0LL;
 #endif
 
+			// Voxel-driven (gather) backprojection (optional)
+			bool voxel_driven = false;
+			if (nrhs > ind) {
+				voxel_driven = getScalarBool(prhs[ind], ind);
+				ind++;
+			}
+
+			// Number of voxel-interleaved images (fp = 1) or measurement vectors (fp = 2) projected with
+			// a single traversal of each LOR (optional)
+			uint32_t nBatch = 1U;
+			if (nrhs > ind) {
+				nBatch = getScalarUInt32(prhs[ind], ind);
+				ind++;
+			}
+			if (nBatch > 1U) {
+				if (precompute || TOF || list_mode_format > 0 || (fp != 1 && fp != 2))
+					mexErrMsgTxt("Batched projection is only supported for forward or backprojection without precomputation, TOF or list-mode data.");
+				mxDestroyArray(plhs[1]);
+				if (fp == 1)
+					plhs[1] = mxCreateNumericMatrix(pituus * nBatch, 1, mxDOUBLE_CLASS, mxREAL);
+				else
+					plhs[1] = mxCreateNumericMatrix(N * nBatch, 1, mxDOUBLE_CLASS, mxREAL);
+#ifdef MX_HAS_INTERLEAVED_COMPLEX
+				rhs = (double*)mxGetDoubles(plhs[1]);
+#else
+				rhs = (double*)mxGetData(plhs[1]);
+#endif
+			}
+
 			if (precompute) {
 				sequential_improved_siddon(loop_var_par, size_x, zmax, Summ, rhs, maxyy, maxxx, xx_vec, dy, yy_vec, atten, norm_coef, randoms, x, y,
 					z_det, NSlices, Nx, Ny, Nz, d, dz, bx, by, bz, attenuation_correction, normalization, randoms_correction, lor1, xy_index, z_index, 
 					TotSinos, epps, Sino, osem_apu, L, pseudos, pRows, det_per_ring, raw, no_norm, global_factor, fp, scatter, scatter_coef, TOF, TOFSize, 
-					sigma_x, TOFCenter, nBins, dec_v, subsets, angles, size_y, dPitch, nProjections, nCores);
+					sigma_x, TOFCenter, nBins, dec_v, subsets, angles, size_y, dPitch, nProjections, nCores, voxel_driven, logl.empty() ? nullptr : logl.data());
 			}
 			else {
 				sequential_improved_siddon_no_precompute(loop_var_par, size_x, zmax, Summ, rhs, maxyy, maxxx, xx_vec, dy, yy_vec, atten, norm_coef, randoms, x, y,
 					z_det, NSlices, Nx, Ny, Nz, d, dz, bx, by, bz, attenuation_correction, normalization, randoms_correction, xy_index, z_index, TotSinos,
 					epps, Sino, osem_apu, L, pseudos, pRows, det_per_ring, raw, cr_pz, no_norm, n_rays, n_rays3D, global_factor, fp, list_mode_format, 
-					scatter, scatter_coef, TOF, TOFSize, sigma_x, TOFCenter, nBins, dec_v, subsets, angles, size_y, dPitch, nProjections, nCores);
+					scatter, scatter_coef, TOF, TOFSize, sigma_x, TOFCenter, nBins, dec_v, subsets, angles, size_y, dPitch, nProjections, nCores, nBatch,
+					logl.empty() ? nullptr : logl.data());
 			}
 		}
 		else if ((projector_type == 3u)) {
@@ -905,6 +957,17 @@ void mexFunction(int nlhs, mxArray* plhs[],
 					no_norm, dec_v, global_factor, fp, list_mode_format, scatter, scatter_coef, subsets, angles, size_y, dPitch, nProjections, nCores);
 			}
 		}
+		if (profiling) {
+			profiler().span("projector", profAlku);
+			profiler().count("LORs traced", static_cast<double>(loop_var_par));
+			// The number of voxels of each LOR is only known with precomputed data
+			if (precompute)
+				profiler().count("voxels visited", std::accumulate(lor1, lor1 + loop_var_par, 0.));
+			plhs[3] = profilerOutput();
+			profiler().stop();
+		}
+		if (nlhs > 2)
+			plhs[2] = mxCreateDoubleScalar(logl.empty() ? mxGetNaN() : std::accumulate(logl.begin(), logl.end(), 0.));
 	}
 	// Implementation 1, precomputed_lor = false
 	else if (type == 2u) {
@@ -1043,7 +1106,7 @@ void mexFunction(int nlhs, mxArray* plhs[],
 			lj = improved_siddon_no_precompute(loop_var_par, size_x, zmax, TotSinos, indices, elements, lor, maxyy, maxxx, xx_vec, dy,
 				yy_vec, atten, norm_coef, x, y, z_det, NSlices, Nx, Ny, Nz, d, dz, bx, by, bz, index, attenuation_correction, normalization, raw, 
 				det_per_ring, blocks, block1, L, pseudos, pRows, global_factor, scatter, scatter_coef, subsets, angles, xy_index, z_index, size_y, 
-				dPitch, nProjections, list_mode_format);
+				dPitch, nProjections, list_mode_format, nCores);
 		}
 		else if (projector_type == 2u) {
 
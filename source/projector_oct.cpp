@@ -607,7 +607,7 @@ DEFUN_DLD(projector_oct, prhs, nargout, "projector_oct") {
 		double* Summ = Summ_.fortran_vec();
 
 		NDArray rhs_;
-		if (fp == 1)
+		if (fp == 1 || fp == 3)
 			rhs_.resize(dim_vector(pituus, 1));
 		else
 			rhs_.resize(dim_vector(N, 1));
@@ -619,7 +619,7 @@ DEFUN_DLD(projector_oct, prhs, nargout, "projector_oct") {
 				Summ[ll] = 0.;
 			}
 		}
-		if (fp == 1) {
+		if (fp == 1 || fp == 3) {
 			for (int64_t ll = 0LL; ll < pituus; ll++) {
 				rhs[ll] = 0.;
 			}
@@ -633,6 +633,18 @@ DEFUN_DLD(projector_oct, prhs, nargout, "projector_oct") {
 		//clock_t time = clock();
 		//std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
 
+		// The profiling events are output as the fourth output
+		const bool profiling = nargout > 3;
+		if (profiling)
+			profiler().start();
+		const double profAlku = profiler().now();
+
+		// The data term of the Poisson log-likelihood (sum of y * log(y_bar)) is output as the third output
+		// Only the improved Siddon computes it, with the other projectors the output is NaN
+		std::vector<double> logl;
+		if (nargout > 2 && projector_type == 1u && fp == 0)
+			logl.resize(loop_var_par, 0.);
+
 		// Orthogonal
 		if (projector_type == 2u) {
 
@@ -665,18 +677,25 @@ DEFUN_DLD(projector_oct, prhs, nargout, "projector_oct") {
 			const double crystal_size_z = prhs(ind).scalar_value();
 			ind++;
 
+			// Interpolate the orthogonal distances from a lookup table (optional)
+			bool orth_lookup = false;
+			if (prhs.length() > ind) {
+				orth_lookup = prhs(ind).bool_value();
+				ind++;
+			}
+
 #ifndef CT
 			if (precompute) {
 				sequential_orth_siddon(loop_var_par, size_x, zmax, Summ, rhs, maxyy, maxxx, xx_vec, dy, yy_vec, atten, norm_coef, randoms, x, y, z_det, 
 					NSlices, Nx, Ny, Nz, d, dz,	bx, by, bz, attenuation_correction, normalization, randoms_correction, lor1, xy_index, z_index, 
 					TotSinos, epps, Sino, osem_apu, L, pseudos, pRows, det_per_ring, raw, crystal_size, x_center, y_center, z_center, crystal_size_z, 
-					no_norm, dec_v, global_factor, fp, scatter, scatter_coef, nCores);
+					no_norm, dec_v, global_factor, fp, scatter, scatter_coef, nCores, orth_lookup);
 			}
 			else {
 				sequential_orth_siddon_no_precomp(loop_var_par, size_x, zmax, Summ, rhs, maxyy, maxxx, xx_vec, dy, yy_vec, atten, norm_coef, randoms,
 					x, y, z_det, NSlices, Nx, Ny, Nz, d, dz, bx, by, bz, attenuation_correction, normalization, randoms_correction, xy_index, z_index,
 					TotSinos, epps, Sino, osem_apu, L, pseudos, pRows, det_per_ring, raw, crystal_size, x_center, y_center, z_center, crystal_size_z,
-					no_norm, dec_v, global_factor, fp, list_mode_format, scatter, scatter_coef, nCores);
+					no_norm, dec_v, global_factor, fp, list_mode_format, scatter, scatter_coef, nCores, orth_lookup);
 			}
 #endif
 		}
@@ -724,17 +743,42 @@ DEFUN_DLD(projector_oct, prhs, nargout, "projector_oct") {
 			const int64_t nProjections = 0LL;
 #endif
 
+			// Voxel-driven (gather) backprojection (optional)
+			bool voxel_driven = false;
+			if (prhs.length() > ind) {
+				voxel_driven = prhs(ind).bool_value();
+				ind++;
+			}
+
+			// Number of voxel-interleaved images (fp = 1) or measurement vectors (fp = 2) projected with
+			// a single traversal of each LOR (optional)
+			uint32_t nBatch = 1U;
+			if (prhs.length() > ind) {
+				nBatch = prhs(ind).uint32_scalar_value();
+				ind++;
+			}
+			if (nBatch > 1U) {
+				if (precompute || TOF || list_mode_format > 0 || (fp != 1 && fp != 2))
+					error("Batched projection is only supported for forward or backprojection without precomputation, TOF or list-mode data.");
+				if (fp == 1)
+					rhs_ = NDArray(dim_vector(pituus * nBatch, 1), 0.);
+				else
+					rhs_ = NDArray(dim_vector(N * nBatch, 1), 0.);
+				rhs = rhs_.fortran_vec();
+			}
+
 			if (precompute) {
 				sequential_improved_siddon(loop_var_par, size_x, zmax, Summ, rhs, maxyy, maxxx, xx_vec, dy, yy_vec, atten, norm_coef, randoms, x, y,
 					z_det, NSlices, Nx, Ny, Nz, d, dz, bx, by, bz, attenuation_correction, normalization, randoms_correction, lor1, xy_index, z_index,
 					TotSinos, epps, Sino, osem_apu, L, pseudos, pRows, det_per_ring, raw, no_norm, global_factor, fp, scatter, scatter_coef, TOF, TOFSize,
-					sigma_x, TOFCenter, nBins, dec_v, subsets, angles, size_y, dPitch, nProjections, nCores);
+					sigma_x, TOFCenter, nBins, dec_v, subsets, angles, size_y, dPitch, nProjections, nCores, voxel_driven, logl.empty() ? nullptr : logl.data());
 			}
 			else {
 				sequential_improved_siddon_no_precompute(loop_var_par, size_x, zmax, Summ, rhs, maxyy, maxxx, xx_vec, dy, yy_vec, atten, norm_coef, randoms, x, y,
 					z_det, NSlices, Nx, Ny, Nz, d, dz, bx, by, bz, attenuation_correction, normalization, randoms_correction, xy_index, z_index, TotSinos,
 					epps, Sino, osem_apu, L, pseudos, pRows, det_per_ring, raw, cr_pz, no_norm, n_rays, n_rays3D, global_factor, fp, list_mode_format,
-					scatter, scatter_coef, TOF, TOFSize, sigma_x, TOFCenter, nBins, dec_v, subsets, angles, size_y, dPitch, nProjections, nCores);
+					scatter, scatter_coef, TOF, TOFSize, sigma_x, TOFCenter, nBins, dec_v, subsets, angles, size_y, dPitch, nProjections, nCores, nBatch,
+					logl.empty() ? nullptr : logl.data());
 			}
 		}
 		else if ((projector_type == 3u)) {
@@ -819,6 +863,26 @@ DEFUN_DLD(projector_oct, prhs, nargout, "projector_oct") {
 
 		retval(0) = octave_value(Summ_);
 		retval(1) = octave_value(rhs_);
+		if (profiling) {
+			profiler().span("projector", profAlku);
+			profiler().count("LORs traced", static_cast<double>(loop_var_par));
+			// The number of voxels of each LOR is only known with precomputed data
+			if (precompute)
+				profiler().count("voxels visited", std::accumulate(lor1, lor1 + loop_var_par, 0.));
+			const omegaProfiler& prof = profiler();
+			Cell nimet(dim_vector(1, prof.names().size()));
+			for (size_t kk = 0; kk < prof.names().size(); kk++)
+				nimet(kk) = prof.names()[kk];
+			NDArray M(dim_vector(prof.size(), PROF_COLUMNS));
+			prof.exportEvents(M.fortran_vec());
+			Cell tapahtumat(dim_vector(1, 2));
+			tapahtumat(0) = nimet;
+			tapahtumat(1) = M;
+			retval(3) = octave_value(tapahtumat);
+			profiler().stop();
+		}
+		if (nargout > 2)
+			retval(2) = octave_value(logl.empty() ? std::numeric_limits<double>::quiet_NaN() : std::accumulate(logl.begin(), logl.end(), 0.));
 	}
 	// Implementation 1, precomputed_lor = false
 	else if (type == 2u) {
@@ -940,7 +1004,7 @@ DEFUN_DLD(projector_oct, prhs, nargout, "projector_oct") {
 			lj = improved_siddon_no_precompute(loop_var_par, size_x, zmax, TotSinos, indices, elements, lor, maxyy, maxxx, xx_vec, dy,
 				yy_vec, atten, norm_coef, x, y, z_det, NSlices, Nx, Ny, Nz, d, dz, bx, by, bz, index, attenuation_correction, normalization, raw,
 				det_per_ring, blocks, block1, L, pseudos, pRows, global_factor, scatter, scatter_coef, subsets, angles, xy_index, z_index, size_y,
-				dPitch, nProjections, list_mode_format);
+				dPitch, nProjections, list_mode_format, nCores);
 		}
 		else if (projector_type == 2u) {
 
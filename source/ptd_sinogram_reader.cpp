@@ -0,0 +1,191 @@
+/**************************************************************************
+* Loads Siemens Biograph (mCT/Vision) sinogram data (.ptd or .s). The file
+* is memory mapped, i.e. the data is read only once, directly into the
+* output arrays. For .ptd files the data offset and the number of TOF bins
+* are parsed from the Interfile header at the end of the file.
+*
+* The data is stored as Ndist x Nang x TotSinos x TOF bins x time steps,
+* where the last TOF bin contains the delayed coincidences (if there are
+* more than one TOF bins). The delayed coincidences are output separately
+* and the prompts are either output as-is or summed over the TOF bins.
+*
+* Inputs:
+* File name, Ndist, Nang, TotSinos, number of time steps and whether the
+* TOF bins are kept (true) or summed (false).
+*
+* Outputs:
+* Prompt sinogram, delayed coincidence sinogram (empty if not available)
+* and the number of TOF bins in the file (including the delayed plane).
+*
+* Copyright (C) 2020 Ville-Veikko Wettenhovi
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <https://www.gnu.org/licenses/>.
+***************************************************************************/
+#include "mex.h"
+#include "mappedFile.h"
+#include <cstring>
+#include <string>
+#include <limits>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Parse the integer value of the Interfile key from the header text
+static bool headerValue(const std::string& header, const std::string& key, int64_t& value) {
+	const size_t idx = header.rfind(key);
+	if (idx == std::string::npos)
+		return false;
+	value = std::strtoll(header.c_str() + idx + key.length(), nullptr, 10);
+	return true;
+}
+
+// Copy the prompts (optionally summed over the TOF bins) and the delayed
+// coincidences from the mapped file into the output arrays. Negative
+// prompt values are set to zero if clampNegative is true.
+template <typename T>
+static void splitSinogram(const T* data, T* Sino, T* SinoD, const int64_t sinoSize, const int64_t TOF_timebins, const int64_t NT,
+	const bool keepTOF, const bool clampNegative) {
+	const int64_t nPrompt = TOF_timebins > 1 ? TOF_timebins - 1 : 1;
+	const int64_t nOut = keepTOF ? nPrompt : 1;
+	for (int64_t tt = 0; tt < NT; tt++) {
+		const T* input = data + sinoSize * TOF_timebins * tt;
+		T* output = Sino + sinoSize * nOut * tt;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int64_t ii = 0; ii < sinoSize; ii++) {
+			if (keepTOF) {
+				for (int64_t bb = 0; bb < nPrompt; bb++) {
+					T apu = input[ii + bb * sinoSize];
+					if (clampNegative && apu < static_cast<T>(0))
+						apu = static_cast<T>(0);
+					output[ii + bb * sinoSize] = apu;
+				}
+			}
+			else {
+				// Saturating sum, as in MATLAB/Octave
+				double summa = 0.;
+				for (int64_t bb = 0; bb < nPrompt; bb++)
+					summa += static_cast<double>(input[ii + bb * sinoSize]);
+				if (clampNegative && summa < 0.)
+					summa = 0.;
+				summa = std::min(std::max(summa, static_cast<double>(std::numeric_limits<T>::lowest())), static_cast<double>(std::numeric_limits<T>::max()));
+				output[ii] = static_cast<T>(summa);
+			}
+			if (TOF_timebins > 1)
+				SinoD[ii + sinoSize * tt] = input[ii + nPrompt * sinoSize];
+		}
+	}
+}
+
+void mexFunction(int nlhs, mxArray *plhs[],
+	int nrhs, const mxArray*prhs[])
+
+{
+	if (nrhs != 6) {
+		mexErrMsgIdAndTxt("MATLAB:ptd_sinogram_reader:invalidNumInputs",
+			"6 input arguments required.");
+	}
+	else if (nlhs > 3) {
+		mexErrMsgIdAndTxt("MATLAB:ptd_sinogram_reader:maxlhs",
+			"Too many output arguments.");
+	}
+	if (!mxIsChar(prhs[0]))
+		mexErrMsgTxt("Input argument is not char");
+
+	char* tiedosto = mxArrayToString(prhs[0]);
+	const int64_t Ndist = (int64_t)mxGetScalar(prhs[1]);
+	const int64_t Nang = (int64_t)mxGetScalar(prhs[2]);
+	const int64_t TotSinos = (int64_t)mxGetScalar(prhs[3]);
+	const int64_t NT = std::max((int64_t)mxGetScalar(prhs[4]), static_cast<int64_t>(1));
+	const bool keepTOF = (bool)mxGetScalar(prhs[5]);
+	const int64_t sinoSize = Ndist * Nang * TotSinos;
+
+	const std::string nimi(tiedosto);
+	mxFree(tiedosto);
+	const bool ptd = nimi.size() >= 4 && nimi.compare(nimi.size() - 4, 4, ".ptd") == 0;
+
+	mappedFile tiedot;
+	if (!tiedot.open(nimi.c_str()))
+		mexErrMsgIdAndTxt("MATLAB:ptd_sinogram_reader:invalidFile",
+			"Error opening file or no file opened");
+	const char* bytes = tiedot.bytes_ptr();
+	const size_t koko = tiedot.size();
+
+	int64_t offset = 0;
+	int64_t TOF_timebins = 1;
+	bool isFloat = false;
+	if (ptd) {
+		// The Interfile header is at the end of the file
+		const size_t header_size = std::min(koko, static_cast<size_t>(20001));
+		const std::string header(bytes + koko - header_size, header_size);
+		if (!headerValue(header, "data offset in bytes[1]:=", offset))
+			mexErrMsgIdAndTxt("MATLAB:ptd_sinogram_reader:invalidFile",
+				"Data offset not found from the .ptd header");
+		int64_t bins = 0;
+		if (headerValue(header, "%number of TOF time bins:=", bins))
+			TOF_timebins = bins + 1;
+		if (offset < 0 || static_cast<size_t>(offset + sinoSize * TOF_timebins * NT * 2) > koko)
+			mexErrMsgIdAndTxt("MATLAB:ptd_sinogram_reader:invalidFile",
+				"The sinogram size does not match the .ptd file");
+	}
+	else {
+		// int16 data, unless negative values are found in which case the
+		// data is single precision
+		const int16_t* apu = reinterpret_cast<const int16_t*>(bytes);
+		const int64_t n16 = static_cast<int64_t>(koko / sizeof(int16_t));
+		bool negative = false;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(||:negative)
+#endif
+		for (int64_t ii = 0; ii < n16; ii++)
+			negative = negative || apu[ii] < 0;
+		isFloat = negative;
+		const int64_t n = static_cast<int64_t>(koko / (isFloat ? sizeof(float) : sizeof(int16_t)));
+		if (n % (sinoSize * NT) != 0)
+			mexErrMsgIdAndTxt("MATLAB:ptd_sinogram_reader:invalidFile",
+				"The sinogram size does not match the .s file");
+		TOF_timebins = n / (sinoSize * NT);
+	}
+
+	const int64_t nPrompt = TOF_timebins > 1 ? TOF_timebins - 1 : 1;
+	const mxClassID luokka = isFloat ? mxSINGLE_CLASS : mxINT16_CLASS;
+	if (keepTOF) {
+		const mwSize dim[5] = { static_cast<mwSize>(Ndist), static_cast<mwSize>(Nang), static_cast<mwSize>(TotSinos), static_cast<mwSize>(nPrompt), static_cast<mwSize>(NT) };
+		plhs[0] = mxCreateNumericArray(5, dim, luokka, mxREAL);
+	}
+	else {
+		const mwSize dim[4] = { static_cast<mwSize>(Ndist), static_cast<mwSize>(Nang), static_cast<mwSize>(TotSinos), static_cast<mwSize>(NT) };
+		plhs[0] = mxCreateNumericArray(4, dim, luokka, mxREAL);
+	}
+	if (TOF_timebins > 1) {
+		const mwSize dim[4] = { static_cast<mwSize>(Ndist), static_cast<mwSize>(Nang), static_cast<mwSize>(TotSinos), static_cast<mwSize>(NT) };
+		plhs[1] = mxCreateNumericArray(4, dim, luokka, mxREAL);
+	}
+	else
+		plhs[1] = mxCreateNumericMatrix(0, 0, luokka, mxREAL);
+
+	if (isFloat)
+		splitSinogram(reinterpret_cast<const float*>(bytes), (float*)mxGetData(plhs[0]), (float*)mxGetData(plhs[1]), sinoSize, TOF_timebins, NT,
+			keepTOF, true);
+	else
+		splitSinogram(reinterpret_cast<const int16_t*>(bytes + offset), (int16_t*)mxGetData(plhs[0]), (int16_t*)mxGetData(plhs[1]), sinoSize,
+			TOF_timebins, NT, keepTOF, !ptd);
+	tiedot.close();
+
+	if (nlhs > 2)
+		plhs[2] = mxCreateDoubleScalar(static_cast<double>(TOF_timebins));
+	return;
+}
@@ -61,7 +61,7 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 	uint32_t iter0 = 0u;
 	uint32_t osa_iter0 = 0u;
 
-	// Hard-coded local size
+	// Default local size, can be overridden with options.local_size (e.g. the autotuned value)
 	uint64_t local_size = 64ULL;
 
 	const cl_float zerof = 0.f;
@@ -95,6 +95,18 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 	const bool computeSensImag = (bool)mxGetScalar(mxGetField(options, 0, "compute_sensitivity_image"));
 	const bool CT = (bool)mxGetScalar(mxGetField(options, 0, "CT"));
 	const bool atomic_32bit = (bool)mxGetScalar(mxGetField(options, 0, "use_32bit_atomics"));
+	// Compact device storage of the measurements and corrections (optional)
+	const mxArray* compact = mxGetField(options, 0, "compact_storage");
+	const bool compact_storage = compact != NULL && !mxIsEmpty(compact) && (bool)mxGetScalar(compact);
+	// Work-group aggregated backprojection, either a scalar or a separate value for each device
+	const mxArray* agg_bp = mxGetField(options, 0, "aggregate_backprojection");
+	bool aggregate_bp = false;
+	if (agg_bp != NULL && !mxIsEmpty(agg_bp)) {
+		if (mxGetNumberOfElements(agg_bp) > device)
+			aggregate_bp = static_cast<bool>(mxGetPr(agg_bp)[device]);
+		else
+			aggregate_bp = (bool)mxGetScalar(agg_bp);
+	}
 
 	if (listmode == 2)
 		MethodList.MLEM = true;
@@ -114,6 +126,9 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 	std::string NV("NVIDIA Corporation");
 	if (NV.compare(deviceName) == 0 && projector_type == 1)
 		local_size = 32ULL;
+	const mxArray* lSize = mxGetField(options, 0, "local_size");
+	if (lSize != NULL && !mxIsEmpty(lSize) && mxGetScalar(lSize) > 0.)
+		local_size = static_cast<uint64_t>(mxGetScalar(lSize));
 
 	cl::Program program_os;
 	cl::Program program_ml;
@@ -138,6 +153,23 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 		return;
 	}
 
+	// Number of local memory voxel bins for the aggregated backprojection
+	// Only the improved Siddon kernel (multidevice_kernel.cl) supports this
+	uint32_t local_bins = 0U;
+	if (aggregate_bp && projector_type == 1u && (precompute || (n_rays * n_rays3D) == 1)) {
+		// Use at most half of the local memory, each bin requires 8 bytes
+		local_bins = 2048U;
+		while (local_bins >= 256U && static_cast<cl_ulong>(local_bins) * 8ULL > mem_loc / 2ULL)
+			local_bins /= 2U;
+		if (local_bins < 256U) {
+			local_bins = 0U;
+			if (verbose)
+				mexPrintf("Not enough local memory for aggregated backprojection, using global atomics\n");
+		}
+		else if (verbose)
+			mexPrintf("Using work-group aggregated backprojection with %u local bins\n", local_bins);
+	}
+
 	// Create the MATLAB output arrays
 	//create_matlab_output(ArrayList, dimmi, MethodList, 4);
 
@@ -227,7 +259,7 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 	w_vec.h_ACOSEM_2 = 1.f / w_vec.h_ACOSEM;
 
 	if (MethodList.CUSTOM) {
-		if (w_vec.MBSREM_prepass && osa_iter0 == 0U) {
+		if ((w_vec.MBSREM_prepass && osa_iter0 == 0U) || w_vec.customPlugin) {
 			subsetsUsed = subsets;
 		}
 		else
@@ -254,13 +286,101 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 		size_scat = mxGetNumberOfElements(mxGetCell(mxGetField(options, 0, "ScatterC"), 0));
 	}
 
+	// Compact device storage of the measurement and correction data. The
+	// measurements are stored as uint16 only if all the values are integer
+	// counts and the corrections as half only if they are inside the half
+	// range, otherwise single precision is used. MRAMLA, MBSREM and ACOSEM
+	// read the device buffers directly with ArrayFire and thus use floats.
+	uint8_t sino_format = FORMAT_FLOAT;
+	uint8_t corr_format = FORMAT_FLOAT;
+	if (compact_storage && listmode != 2 && !MethodList.MRAMLA && !MethodList.MBSREM && !MethodList.ACOSEM && !MethodList.OSLCOSEM) {
+		sino_format = FORMAT_UINT16;
+		corr_format = FORMAT_HALF;
+		for (uint32_t tt = 0U; tt < Nt; tt++) {
+#ifdef MX_HAS_INTERLEAVED_COMPLEX
+			const float* apu = (float*)mxGetSingles(mxGetCell(Sin, tt));
+#else
+			const float* apu = (float*)mxGetData(mxGetCell(Sin, tt));
+#endif
+			if (sino_format == FORMAT_UINT16 && !fitsUint16(apu, mxGetNumberOfElements(mxGetCell(Sin, tt))))
+				sino_format = FORMAT_FLOAT;
+			if (randoms_correction) {
+#ifdef MX_HAS_INTERLEAVED_COMPLEX
+				const float* ra_apu = (float*)mxGetSingles(mxGetCell(sc_ra, tt));
+#else
+				const float* ra_apu = (float*)mxGetData(mxGetCell(sc_ra, tt));
+#endif
+				if (!fitsHalf(ra_apu, mxGetNumberOfElements(mxGetCell(sc_ra, tt))))
+					corr_format = FORMAT_FLOAT;
+			}
+			if (scatter == 1U) {
+#ifdef MX_HAS_INTERLEAVED_COMPLEX
+				const float* sc_apu = (float*)mxGetSingles(mxGetCell(mxGetField(options, 0, "ScatterC"), tt));
+#else
+				const float* sc_apu = (float*)mxGetData(mxGetCell(mxGetField(options, 0, "ScatterC"), tt));
+#endif
+				if (!fitsHalf(sc_apu, mxGetNumberOfElements(mxGetCell(mxGetField(options, 0, "ScatterC"), tt))))
+					corr_format = FORMAT_FLOAT;
+			}
+		}
+		if (!fitsHalf(norm, size_norm))
+			corr_format = FORMAT_FLOAT;
+	}
+
+	// TOF data that does not fit the device memory is transferred one subset at a time
+	if (static_cast<double>(mem) * 0.75 < static_cast<double>(koko * nBins * formatBytes(sino_format)) && TOF) {
+		loadTOF = false;
+		sino_format = FORMAT_FLOAT;
+	}
+	if (compact_storage && verbose) {
+		mexPrintf("Measurement data stored as %s, corrections as %s\n", sino_format == FORMAT_UINT16 ? "uint16" : "single",
+			corr_format == FORMAT_HALF ? "half" : "single");
+		mexEvalString("pause(.0001);");
+	}
+
+	// The log-likelihood of the OS reconstructions is accumulated by the OS kernel during the forward projection
+	const bool computeLogL = MethodList.OBJECTIVE && osem_bool && n_rekos2 > 0U && listmode != 2 && !CT;
+
+	double profAlku = profiler().now();
 	status = createProgram(verbose, k_path, af_context, af_device_id, fileName, program_os, program_ml, program_mbsrem, atomic_64bit, atomic_32bit, device, header_directory,
 		projector_type, crystal_size_z, precompute, raw, attenuation_correction, normalization, dec, local_size, n_rays, n_rays3D, false, MethodList, osem_bool, 
-		mlem_bool, n_rekos2, n_rekos_mlem, w_vec, osa_iter0, cr_pz, dx, use_psf, scatter, randoms_correction, TOF, nBins, listmode, CT);
+		mlem_bool, n_rekos2, n_rekos_mlem, w_vec, osa_iter0, cr_pz, dx, use_psf, scatter, randoms_correction, TOF, nBins, listmode, CT, local_bins,
+		sino_format, corr_format, computeLogL);
 	if (status != CL_SUCCESS) {
 		std::cerr << "Error while creating program" << std::endl;
 		return;
 	}
+	profiler().span("kernel build", profAlku);
+
+	// Cached subset sensitivity images (computeSensitivity.m), loaded instead of being computed during the
+	// first iteration. In the compact form, only the sum of the subset images is stored in single precision
+	// and each subset image as its ratio to the sum in half precision. The compact form is also used when
+	// there is not enough memory for all the subset images.
+	const mxArray* sensCache = mxGetField(options, 0, "cache_sensitivity");
+	const mxArray* sensImag = mxGetField(options, 0, "Summ");
+	const bool cached_sens = listmode == 0 && !CT && !MethodList.CUSTOM && sensCache != NULL && !mxIsEmpty(sensCache) && (bool)mxGetScalar(sensCache)
+		&& sensImag != NULL && mxGetNumberOfElements(sensImag) == static_cast<size_t>(im_dim) * static_cast<size_t>(subsets);
+	const mxArray* sensCompact = mxGetField(options, 0, "compact_sensitivity");
+	const bool compact_sens = cached_sens && subsets > 1U && !w_vec.MBSREM_prepass
+		&& ((sensCompact != NULL && !mxIsEmpty(sensCompact) && (bool)mxGetScalar(sensCompact)) || compute_norm_matrix == 1u);
+	array sensFull, sensRatio;
+	const float* sensApu = nullptr;
+	if (cached_sens) {
+#ifdef MX_HAS_INTERLEAVED_COMPLEX
+		sensApu = (float*)mxGetSingles(sensImag);
+#else
+		sensApu = (float*)mxGetData(sensImag);
+#endif
+		if (compact_sens) {
+			compute_norm_matrix = 1u;
+			compactSensitivity(sensApu, im_dim, subsets, sensFull, sensRatio);
+			if (verbose)
+				mexPrintf("Cached sensitivity images stored in compact form (%.1f MB instead of %.1f MB)\n",
+					static_cast<double>(im_dim) * (4. + 2. * subsets) / 1048576., static_cast<double>(im_dim) * 4. * subsets / 1048576.);
+		}
+		else
+			compute_norm_matrix = 0u;
+	}
 
 	std::vector<array> Summ;
 	array Summ_mlem;
@@ -294,7 +414,8 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 	// Create the kernels
 	cl::Kernel kernel_ml, kernel, kernel_mramla;
 
-	status = createKernels(kernel_ml, kernel, kernel_mramla, OpenCLStruct.kernelNLM, OpenCLStruct.kernelMed, osem_bool, program_os, program_ml, program_mbsrem, MethodList, w_vec, projector_type,
+	status = createKernels(kernel_ml, kernel, kernel_mramla, OpenCLStruct.kernelNLM, OpenCLStruct.kernelMed, OpenCLStruct.kernelL, OpenCLStruct.kernelFMH, 
+		OpenCLStruct.kernelTGVDual, OpenCLStruct.kernelTGVPrimal, osem_bool, program_os, program_ml, program_mbsrem, MethodList, w_vec, projector_type,
 		mlem_bool, precompute, n_rays, n_rays3D);
 	if (status != CL_SUCCESS) {
 		mexPrintf("Failed to create kernels\n");
@@ -304,9 +425,37 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 		mexPrintf("OpenCL kernels successfully created\n");
 		mexEvalString("pause(.0001);");
 	}
+	// The work-group size of the kernel can be smaller than the device maximum (e.g. due to register use)
+	if (osem_bool) {
+		const size_t maxLocal = kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(af_device_id);
+		if (local_size > maxLocal) {
+			mexPrintf("Local size %llu exceeds the maximum work-group size (%llu) of the OS kernel\n", static_cast<unsigned long long>(local_size),
+				static_cast<unsigned long long>(maxLocal));
+			return;
+		}
+	}
 
-	if (static_cast<double>(mem) * 0.75 < static_cast<double>(koko * nBins * sizeof(float)) && TOF)
-		loadTOF = false;
+	// Custom prior kernel from the user's OpenCL source file
+	if (w_vec.customPlugin) {
+		char* tiedosto = mxArrayToString(mxGetField(options, 0, "custom_prior_kernel"));
+		const mxArray* param = mxGetField(options, 0, "custom_prior_param");
+		uint32_t nParam = 0U;
+		const float* paramData = nullptr;
+		if (param != nullptr && mxGetNumberOfElements(param) > 0) {
+			nParam = static_cast<uint32_t>(mxGetNumberOfElements(param));
+#ifdef MX_HAS_INTERLEAVED_COMPLEX
+			paramData = (float*)mxGetSingles(param);
+#else
+			paramData = (float*)mxGetData(param);
+#endif
+		}
+		status = createCustomPriorKernel(verbose, tiedosto, paramData, nParam, af_context, OpenCLStruct);
+		mxFree(tiedosto);
+		if (status != CL_SUCCESS) {
+			mexPrintf("Failed to create the custom prior kernel\n");
+			return;
+		}
+	}
 
 	uint32_t TOFsubsets = subsets;
 	if (!loadTOF)
@@ -359,15 +508,21 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 		mexEvalString("pause(.0001);");
 	}
 
+	profAlku = profiler().now();
 	status = createAndWriteBuffers(d_x, d_y, d_z, d_angles, d_lor, d_L, d_zindex, d_xyindex, d_Sino, d_sc_ra, size_x, size_z, TotSinos, size_atten, size_norm, size_scat, prows,
 		length, x, y, z_det, xy_index, z_index, lor1, L, apu, raw, af_context, subsets, pituus, atten, norm, scat, pseudos, V, af_queue, d_atten, d_norm, d_scat, d_pseudos, d_V, 
 		d_xcenter, d_ycenter, d_zcenter, x_center, y_center, z_center, size_center_x, size_center_y, size_center_z, size_of_x, size_V, atomic_64bit, atomic_32bit, randoms_correction,
 		sc_ra, precompute, d_lor_mlem, d_L_mlem, d_zindex_mlem, d_xyindex_mlem, d_Sino_mlem, d_sc_ra_mlem, d_reko_type, d_reko_type_mlem, osem_bool, mlem_bool, koko,
-		reko_type, reko_type_mlem, n_rekos, n_rekos_mlem, d_norm_mlem, d_scat_mlem, angles, TOF, nBins, loadTOF, d_TOFCenter, TOFCenter, subsetsUsed, osa_iter0, listmode, CT);
+		reko_type, reko_type_mlem, n_rekos, n_rekos_mlem, d_norm_mlem, d_scat_mlem, angles, TOF, nBins, loadTOF, d_TOFCenter, TOFCenter, subsetsUsed, osa_iter0, listmode, CT,
+		sino_format, corr_format);
 	if (status != CL_SUCCESS) {
 		mexPrintf("Buffer creation failed\n");
 		return;
 	}
+	if (profiler().enabled) {
+		af_queue.finish();
+		profiler().span("buffer upload", profAlku, 1U);
+	}
 	else if (DEBUG) {
 		mexPrintf("Buffer creation succeeded\n");
 		mexEvalString("pause(.0001);");
@@ -632,6 +787,38 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 				no_norm = 1u;
 			}
 		}
+		// Load the cached subset sensitivity images
+		else if (cached_sens) {
+			if (mlem_bool) {
+				if (compact_sens)
+					Summ_mlem = sensFull;
+				else {
+					Summ_mlem = constant(0.f, im_dim, 1);
+					for (uint32_t osa_iter = 0; osa_iter < subsets; osa_iter++)
+						Summ_mlem += array(im_dim, 1, &sensApu[static_cast<size_t>(im_dim) * osa_iter]);
+				}
+				Summ_mlem(Summ_mlem < epps) = epps;
+				if (use_psf) {
+					Summ_mlem = computeConvolution(Summ_mlem, g, Nx, Ny, Nz, w_vec, 1u);
+					af::sync();
+				}
+				no_norm_mlem = 1u;
+			}
+			if (osem_bool) {
+				// The compact form is expanded separately for each subset
+				if (!compact_sens) {
+					for (uint32_t osa_iter = 0; osa_iter < subsets; osa_iter++) {
+						Summ[osa_iter] = array(im_dim, 1, &sensApu[static_cast<size_t>(im_dim) * osa_iter]);
+						Summ[osa_iter](Summ[osa_iter] < epps) = epps;
+						if (use_psf) {
+							Summ[osa_iter] = computeConvolution(Summ[osa_iter], g, Nx, Ny, Nz, w_vec, 1u);
+							af::sync();
+						}
+					}
+				}
+				no_norm = 1u;
+			}
+		}
 
 		if (listmode == 2)
 			af_queue.enqueueFillBuffer(d_Sino_mlem, zerof, 0, sizeof(cl_float));
@@ -649,15 +836,15 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 						if (!loadTOF && kk == 0) {
 							d_Sino[kk] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * length[kk] * nBins, NULL, &status);
 							for (int64_t to = 0LL; to < nBins; to++)
-								status = af_queue.enqueueWriteBuffer(d_Sino[kk], CL_FALSE, sizeof(float) * length[kk] * to, sizeof(float) * length[kk], &apu[pituus[kk] + koko * to]);
+								status = writeData(af_queue, d_Sino[kk], &apu[pituus[kk] + koko * to], length[kk], length[kk] * to, sino_format);
 						}
 						else if (loadTOF) {
 							for (int64_t to = 0LL; to < nBins; to++)
-								status = af_queue.enqueueWriteBuffer(d_Sino[kk], CL_FALSE, sizeof(float) * length[kk] * to, sizeof(float) * length[kk], &apu[pituus[kk] + koko * to]);
+								status = writeData(af_queue, d_Sino[kk], &apu[pituus[kk] + koko * to], length[kk], length[kk] * to, sino_format);
 						}
 					}
 					else
-						af_queue.enqueueWriteBuffer(d_Sino[kk], CL_TRUE, 0, sizeof(float) * length[kk], &apu[pituus[kk]]);
+						status = writeData(af_queue, d_Sino[kk], &apu[pituus[kk]], length[kk], 0, sino_format, CL_TRUE);
 					if (status != CL_SUCCESS) {
 						getErrorString(status);
 						return;
@@ -668,10 +855,10 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 #else
 						float* ra_apu = (float*)mxGetData(mxGetCell(sc_ra, tt));
 #endif
-						af_queue.enqueueWriteBuffer(d_sc_ra[kk], CL_TRUE, 0, sizeof(float)* length[kk], &ra_apu[pituus[kk]]);
+						status = writeData(af_queue, d_sc_ra[kk], &ra_apu[pituus[kk]], length[kk], 0, corr_format, CL_TRUE);
 					}
 					else
-						af_queue.enqueueWriteBuffer(d_sc_ra[kk], CL_TRUE, 0, sizeof(cl_float), &zerof);
+						status = writeData(af_queue, d_sc_ra[kk], &zerof, 1, 0, corr_format, CL_TRUE);
 						//status = clEnqueueFillBuffer(af_queue, d_sc_ra[kk], &zerof, sizeof(cl_float), 0, sizeof(cl_float), 0, NULL, NULL);
 					if (status != CL_SUCCESS) {
 						getErrorString(status);
@@ -683,7 +870,7 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 #else
 						scat = (float*)mxGetData(mxGetCell(mxGetField(options, 0, "ScatterC"), tt));
 #endif
-						af_queue.enqueueWriteBuffer(d_scat[kk], CL_TRUE, 0, sizeof(float)* length[kk], &scat[pituus[kk]]);
+						status = writeData(af_queue, d_scat[kk], &scat[pituus[kk]], length[kk], 0, corr_format, CL_TRUE);
 						if (status != CL_SUCCESS) {
 							getErrorString(status);
 							return;
@@ -696,7 +883,7 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 				}
 			}
 			if (mlem_bool) {
-				af_queue.enqueueWriteBuffer(d_Sino_mlem, CL_TRUE, 0, sizeof(float) * koko * nBins, apu);
+				status = writeData(af_queue, d_Sino_mlem, apu, koko * nBins, 0, sino_format, CL_TRUE);
 				if (status != CL_SUCCESS) {
 					getErrorString(status);
 					return;
@@ -707,10 +894,10 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 #else
 					float* ra_apu = (float*)mxGetData(mxGetCell(sc_ra, tt));
 #endif
-					af_queue.enqueueWriteBuffer(d_sc_ra_mlem, CL_TRUE, 0, sizeof(float)* koko, ra_apu);
+					status = writeData(af_queue, d_sc_ra_mlem, ra_apu, koko, 0, corr_format, CL_TRUE);
 				}
 				else
-					af_queue.enqueueWriteBuffer(d_sc_ra_mlem, CL_TRUE, 0, sizeof(cl_float), &zerof);
+					status = writeData(af_queue, d_sc_ra_mlem, &zerof, 1, 0, corr_format, CL_TRUE);
 				if (status != CL_SUCCESS) {
 					getErrorString(status);
 					return;
@@ -721,7 +908,7 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 #else
 					scat = (float*)mxGetData(mxGetCell(mxGetField(options, 0, "ScatterC"), tt));
 #endif
-					af_queue.enqueueWriteBuffer(d_scat_mlem, CL_TRUE, 0, sizeof(float)* koko, scat);
+					status = writeData(af_queue, d_scat_mlem, scat, koko, 0, corr_format, CL_TRUE);
 					if (status != CL_SUCCESS) {
 						getErrorString(status);
 						return;
@@ -827,6 +1014,35 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 			mexEvalString("pause(.0001);");
 		}
 
+		// Log-likelihood of each iteration and OS reconstruction, and the momentum states
+		std::vector<double> objective;
+		std::vector<float> mom_t;
+		array im_prev, logl_os;
+		cl::Buffer d_logl;
+		// The expected randoms of each subset, part of the linear term of the log-likelihood (per TOF bin as in implementation 4)
+		std::vector<double> randSum;
+		if (computeLogL) {
+			objective.assign(static_cast<size_t>(Niter) * static_cast<size_t>(n_rekos2), 0.);
+			randSum.assign(subsets, 0.);
+			if (randoms_correction) {
+#ifdef MX_HAS_INTERLEAVED_COMPLEX
+				const float* ra_apu = (float*)mxGetSingles(mxGetCell(sc_ra, tt));
+#else
+				const float* ra_apu = (float*)mxGetData(mxGetCell(sc_ra, tt));
+#endif
+				for (uint32_t kk = 0U; kk < subsets; kk++) {
+					for (int64_t ll = pituus[kk]; ll < pituus[kk + 1U]; ll++)
+						randSum[kk] += static_cast<double>(ra_apu[ll]);
+					if (TOF)
+						randSum[kk] *= static_cast<double>(nBins);
+				}
+			}
+		}
+		if (MethodList.MOMENTUM && osem_bool) {
+			mom_t.assign(n_rekos2, 1.f);
+			im_prev = vec.im_os.copy();
+		}
+
 		// Loop through each iteration
 		for (uint32_t iter = iter0; iter < Niter; iter++) {
 
@@ -839,6 +1055,9 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 				// Loop through the subsets
 				for (uint32_t osa_iter = osa_iter0; osa_iter < subsets; osa_iter++) {
 
+					profiler().iter = static_cast<int32_t>(iter);
+					profiler().subset = static_cast<int32_t>(osa_iter);
+
 					if (osa_iter > osa_iter0 && TOF && !loadTOF) {
 						d_Sino[0] = cl::Buffer(af_context, CL_MEM_READ_ONLY, sizeof(float) * length[osa_iter] * nBins, NULL, &status);
 #ifdef MX_HAS_INTERLEAVED_COMPLEX
@@ -852,9 +1071,19 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 							getErrorString(status);
 							return;
 						}
+						profiler().count("bytes uploaded", static_cast<double>(sizeof(float) * length[osa_iter] * nBins));
 					}
 
-					if (compute_norm_matrix == 1u) {
+					if (compact_sens) {
+						if (atomic_64bit)
+							apu_sum = constant(0LL, 1, 1, s64);
+						else if (atomic_32bit)
+							apu_sum = constant(0, 1, 1, s32);
+						else
+							apu_sum = constant(0.f, 1, 1, f32);
+						d_Summ = cl::Buffer(*apu_sum.device<cl_mem>(), true);
+					}
+					else if (compute_norm_matrix == 1u) {
 						if (atomic_64bit) {
 							Summ[0] = constant(0LL, im_dim, 1, s64);
 						}
@@ -939,8 +1168,14 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 					kernel.setArg(kernelInd_OSEMSubIter++, no_norm);
 					kernel.setArg(kernelInd_OSEMSubIter++, m_size);
 					kernel.setArg(kernelInd_OSEMSubIter++, st);
+					if (computeLogL) {
+						logl_os = constant(0.f, m_size * n_rekos2, 1);
+						d_logl = cl::Buffer(*logl_os.device<cl_mem>(), true);
+						kernel.setArg(kernelInd_OSEMSubIter++, d_logl);
+					}
 					cl::NDRange local(local_size);
 					cl::NDRange global(global_size);
+					profAlku = profiler().now();
 					// Compute the kernel
 					status = af_queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local);
 
@@ -948,7 +1183,7 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 						getErrorString(status);
 						mexPrintf("Failed to launch the OS kernel\n");
 						mexEvalString("pause(.0001);");
-						if (compute_norm_matrix == 1u) {
+						if (compute_norm_matrix == 1u && !compact_sens) {
 							Summ[0].unlock();
 						}
 						else {
@@ -974,7 +1209,7 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 						getErrorString(status);
 						mexPrintf("Queue finish failed after kernel\n");
 						mexEvalString("pause(.0001);");
-						if (compute_norm_matrix == 1u) {
+						if (compute_norm_matrix == 1u && !compact_sens) {
 							Summ[0].unlock();
 						}
 						else {
@@ -991,10 +1226,23 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 						vec.rhs_os.unlock();
 						break;
 					}
+					profiler().span("OS kernel", profAlku, 1U);
+					profiler().count("LORs traced", static_cast<double>(length[osa_iter]));
 					array* testi;
 
 					// Transfer memory control back to ArrayFire (OS-methods)
-					if (compute_norm_matrix == 1u) {
+					if (compact_sens) {
+						apu_sum.unlock();
+						Summ[0] = sensFull * halfToFloat(sensRatio(span, osa_iter));
+						Summ[0](Summ[0] < epps) = epps;
+						if (use_psf) {
+							Summ[0] = computeConvolution(Summ[0], g, Nx, Ny, Nz, w_vec, 1u);
+							af::sync();
+						}
+						testi = &Summ[0];
+						eval(*testi);
+					}
+					else if (compute_norm_matrix == 1u) {
 						Summ[0].unlock();
 						if (atomic_64bit)
 							Summ[0] = Summ[0].as(f32) / TH;
@@ -1057,11 +1305,27 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 						//vec.im_os = vec.rhs_os;
 					}
 
+					// Log-likelihood of the current subset, the sum of the expected counts is obtained from the
+					// sensitivity image and the randoms sum of the subset
+					if (computeLogL) {
+						logl_os.unlock();
+						const array summa = sum(moddims(logl_os, n_rekos2, m_size), 1) - matmulTN(moddims(vec.im_os, im_dim, n_rekos2), *testi);
+						std::vector<float> apu(n_rekos2);
+						summa.host(apu.data());
+						for (uint32_t kk = 0U; kk < n_rekos2; kk++)
+							objective[iter * n_rekos2 + kk] += static_cast<double>(apu[kk]) - randSum[osa_iter];
+					}
+
+					profAlku = profiler().now();
 
 					computeOSEstimates(vec, w_vec, MethodList, im_dim, testi, epps, iter, osa_iter, subsets, beta, Nx, Ny, Nz, data, length, d_Sino, break_iter, pj3,
 						n_rekos2, pituus, d_lor, d_zindex, d_xyindex, program_mbsrem, af_queue, af_context, Summ, kernel_mramla, d_L, raw, MethodListOpenCL, koko, atomic_64bit, atomic_32bit,
 						compute_norm_matrix, OpenCLStruct.kernelNLM, d_sc_ra, kernelInd_MRAMLA, E, d_norm, d_scat, use_psf, g, OpenCLStruct, TOF, loadTOF, Sin, nBins, 
 						randoms_correction, local_size, CT);
+					if (profiler().enabled) {
+						af::sync();
+						profiler().span("OS estimates", profAlku);
+					}
 
 
 					if (DEBUG) {
@@ -1069,6 +1333,8 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 					}
 
 					vec.im_os(vec.im_os < epps) = epps;
+					if (w_vec.useMask)
+						vec.im_os *= af::tile(w_vec.mask, n_rekos2);
 
 					if (verbose) {
 						mexPrintf("Sub-iteration %d complete\n", osa_iter + 1u);
@@ -1085,7 +1351,16 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 				}
 				//vec.im_os = vec.rhs_os;
 
+				profiler().subset = -1;
+				profAlku = profiler().now();
 				computeOSEstimatesIter(vec, w_vec, MethodList, im_dim, epps, iter, osa_iter0, subsets, beta, Nx, Ny, Nz, data, n_rekos2, OpenCLStruct, saveIter);
+				if (profiler().enabled) {
+					af::sync();
+					profiler().span("iteration estimates", profAlku);
+				}
+				// The saved estimates are the unextrapolated ones
+				if (MethodList.MOMENTUM)
+					momentumStep(vec.im_os, im_prev, mom_t, objective, iter, iter0, im_dim, n_rekos2, MethodList.MOMENTUM_RESTART, epps, verbose);
 				
 				//if (use_psf && w_vec.deconvolution && osem_bool && (saveIter || (!saveIter && iter == Niter - 1))) {
 				//	computeDeblur(vec, g, Nx, Ny, Nz, w_vec, MethodList, iter, deblur_iterations, epps, saveIter);
@@ -1105,7 +1380,7 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 
 				// Use previously computed normalization factor if available
 				if (compute_norm_matrix == 0u) {
-					if (osem_bool && no_norm == 1u && iter == 0u) {
+					if (osem_bool && no_norm == 1u && iter == 0u && !cached_sens) {
 						for (uint32_t kk = 0U; kk < subsets; kk++)
 							Summ_mlem += Summ[kk];
 					}
@@ -1177,6 +1452,9 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 				kernel_ml.setArg(kernelInd_MLEMSubIter++, no_norm_mlem);
 				kernel_ml.setArg(kernelInd_MLEMSubIter++, m_size);
 				kernel_ml.setArg(kernelInd_MLEMSubIter++, st);
+				profiler().iter = static_cast<int32_t>(iter);
+				profiler().subset = -1;
+				profAlku = profiler().now();
 				status = af_queue.enqueueNDRangeKernel(kernel_ml, cl::NullRange, global, local);
 
 				if (status != CL_SUCCESS) {
@@ -1196,6 +1474,8 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 					mexEvalString("pause(.0001);");
 					break;
 				}
+				profiler().span("MLEM kernel", profAlku, 1U);
+				profiler().count("LORs traced", static_cast<double>(koko));
 				// Transfer memory control back to ArrayFire (ML-methods)
 				if (no_norm_mlem == 0u) {
 					Summ_mlem.unlock();
@@ -1246,7 +1526,14 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 					vec.imEstimates[0] = Summ_mlem;
 				}
 
+				profAlku = profiler().now();
 				computeMLEstimates(vec, w_vec, MethodList, im_dim, epps, iter, subsets, beta, Nx, Ny, Nz, data, Summ_mlem, break_iter, OpenCLStruct, saveIter);
+				if (w_vec.useMask)
+					vec.im_mlem *= af::tile(w_vec.mask, n_rekos_mlem);
+				if (profiler().enabled) {
+					af::sync();
+					profiler().span("MLEM estimates", profAlku);
+				}
 
 				if (no_norm_mlem == 0u)
 					no_norm_mlem = 1u;
@@ -1275,12 +1562,28 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 
 		// Transfer the device data to host MATLAB cell array
 		device_to_host_cell(MethodList, vec, oo, cell, w_vec, dimmi, 4);
+		// The log-likelihood values (iterations x OS reconstructions) are stored in the last row
+		if (computeLogL) {
+			mxArray* logl = mxCreateNumericMatrix(Niter, n_rekos2, mxDOUBLE_CLASS, mxREAL);
+#if defined(MX_HAS_INTERLEAVED_COMPLEX) && TARGET_API_VERSION > 700
+			double* loglP = (double*)mxGetDoubles(logl);
+#else
+			double* loglP = (double*)mxGetData(logl);
+#endif
+			for (uint32_t kk = 0U; kk < n_rekos2; kk++)
+				for (uint32_t ii = 0U; ii < Niter; ii++)
+					loglP[ii + kk * Niter] = objective[ii * n_rekos2 + kk];
+			mxSetCell(cell, static_cast<mwIndex>(mxGetM(cell) * (tt + 1U) - 1U), logl);
+		}
 
 		if (verbose && listmode != 2) {
 			mexPrintf("Time step %d complete\n", tt + 1u);
 			mexEvalString("pause(.0001);");
 		}
 		w_vec.MBSREM_prepass = false;
+		// With the custom prior kernel, the reconstruction is computed one time step per call
+		if (w_vec.customPlugin)
+			break;
 	}
 
 	// Transfer memory control of all variables that weren't used
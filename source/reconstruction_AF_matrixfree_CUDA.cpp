@@ -239,7 +239,7 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 	CUfunction kernel_mbsrem = NULL;
 	CUmodule moduleOS, moduleML, moduleMB;
 
-	status1 = createKernelsCUDA(verbose, program_os, program_ml, program_mbsrem, kernel_os, kernel_ml, kernel_mbsrem, CUDAStruct.kernelNLM, CUDAStruct.kernelMed, osem_bool, mlem_bool, MethodList, w_vec,
+	status1 = createKernelsCUDA(verbose, program_os, program_ml, program_mbsrem, kernel_os, kernel_ml, kernel_mbsrem, CUDAStruct.kernelNLM, CUDAStruct.kernelMed, CUDAStruct.kernelL, CUDAStruct.kernelFMH, osem_bool, mlem_bool, MethodList, w_vec,
 		precompute, projector_type, n_rays, n_rays3D, moduleOS, moduleML, moduleMB);
 	if (status1 != NVRTC_SUCCESS) {
 		mexPrintf("Failed to create the kernels\n");
@@ -931,6 +931,8 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 						sigma_x, d_TOFCenter, d_angles, CT);
 
 					vec.im_os(vec.im_os < epps) = epps;
+					if (w_vec.useMask)
+						vec.im_os *= af::tile(w_vec.mask, n_rekos2);
 
 					if (verbose) {
 						mexPrintf("Sub-iteration %d complete\n", osa_iter + 1u);
@@ -1136,6 +1138,8 @@ void reconstruction_AF_matrixfree(const size_t koko, const uint16_t* lor1, const
 				}
 
 				computeMLEstimates(vec, w_vec, MethodList, im_dim, epps, iter, subsets, beta, Nx, Ny, Nz, data, Summ_mlem, break_iter, CUDAStruct, saveIter);
+				if (w_vec.useMask)
+					vec.im_mlem *= af::tile(w_vec.mask, n_rekos_mlem);
 
 				if (no_norm_mlem == 0u)
 					no_norm_mlem = 1u;
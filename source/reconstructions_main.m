@@ -64,6 +64,72 @@ end
 if ~isfield(options,'CT')
     options.CT = false;
 end
+if ~isfield(options,'precompute_attenuation_factors')
+    options.precompute_attenuation_factors = false;
+end
+if ~isfield(options,'cache_sensitivity')
+    options.cache_sensitivity = false;
+end
+if ~isfield(options,'compact_sensitivity')
+    options.compact_sensitivity = false;
+end
+if ~isfield(options,'momentum')
+    options.momentum = false;
+end
+if ~isfield(options,'momentum_restart')
+    options.momentum_restart = false;
+end
+if ~isfield(options,'compute_objective')
+    options.compute_objective = false;
+end
+% The adaptive restart is based on the objective function values
+if options.momentum && options.momentum_restart
+    options.compute_objective = true;
+end
+if (options.momentum || options.compute_objective) && options.implementation ~= 2 && options.implementation ~= 4
+    error('Momentum acceleration and objective function values are only supported with implementations 2 and 4')
+end
+if options.compute_objective && options.CT
+    error('Objective function values (and thus momentum restart) are not supported with CT data')
+end
+% Only the improved Siddon computes the log-likelihood with implementation
+% 4, with the other projectors the momentum would never be restarted
+if options.momentum && options.momentum_restart && options.implementation == 4 && options.projector_type ~= 1
+    error('Momentum restart with implementation 4 is only supported with the improved Siddon (projector_type = 1)')
+end
+if ~isfield(options,'out_of_core')
+    options.out_of_core = false;
+end
+if ~isfield(options,'out_of_core_folder')
+    options.out_of_core_folder = '';
+end
+if ~isfield(options,'lor_ordering')
+    options.lor_ordering = 0;
+end
+if ~isfield(options,'multi_resolution_factor')
+    options.multi_resolution_factor = [];
+end
+if ~isfield(options,'mask')
+    options.mask = [];
+end
+if ~isfield(options,'mask_threshold')
+    options.mask_threshold = 0;
+end
+if ~isfield(options,'local_size')
+    options.local_size = 0;
+end
+if ~isfield(options,'autotune')
+    options.autotune = false;
+end
+if ~isfield(options,'profile')
+    options.profile = false;
+end
+if ~isfield(options,'profile_file')
+    options.profile_file = '';
+end
+if options.profile && isempty(options.profile_file)
+    options.profile_file = [options.machine_name '_' options.name '_trace.json'];
+end
 
 if nargin > 1
     tyyppi = varargin{1};
@@ -71,6 +137,17 @@ else
     tyyppi = 0;
 end
 
+% Coarse-to-fine reconstruction, each level is a separate call
+if tyyppi == 0 && ~isempty(options.multi_resolution_factor)
+    pz = multiResolutionReconstruction(options, varargin{:});
+    return
+end
+
+% The key of the cached geometry data, computed before the geometry
+% parameters are modified below (an earlier key is discarded)
+options.geometry_key = '';
+options.geometry_key = geometryHash(options);
+
 options.listmode = false;
 tStart = 0;
 tStart_iter = 0;
@@ -131,6 +208,22 @@ while ll == 0 && kk <= numel(var)
 end
 OS_bool = ll > 0;
 
+% The momentum is applied to the OS estimate after each full iteration and
+% only for the algorithms whose iterates remain valid after extrapolation.
+% All other algorithms, including MLEM and OSL-MLEM, are rejected
+if options.momentum
+    if isfield(options,'use_CUDA') && options.use_CUDA
+        error('Momentum acceleration is not supported with CUDA')
+    end
+    var = [recNames(3);recNames(4)];
+    tuetut = {'OSEM';'OSL_OSEM';'BSREM';'ROSEM_MAP';'PKMA'};
+    for kk = 1 : numel(var)
+        if any(options.(var{kk})) && ~ismember(var{kk}, tuetut)
+            error(['Momentum acceleration is not supported with ' var{kk} '. Supported algorithms are ' strjoin(tuetut', ', ')])
+        end
+    end
+end
+
 if tyyppi < 2
     % Load the measurement data if it does not exist in options.SinM
     % Raw data
@@ -872,6 +965,25 @@ else
     [normalization_correction, randoms_correction, options] = set_up_corrections(options, RandProp, ScatterProp);
 end
 
+% Support mask, the voxels outside it are kept at zero
+if isempty(options.mask) && options.mask_threshold > 0
+    if options.attenuation_correction
+        options.mask = options.vaimennus > options.mask_threshold;
+    else
+        warning('The image mask can be thresholded only from the attenuation image, no mask is used')
+    end
+end
+if ~isempty(options.mask)
+    if numel(options.mask) ~= N
+        error('The image mask options.mask has to be of the same size as the reconstructed image')
+    end
+    options.mask = options.mask(:) ~= 0;
+    options.x0(~options.mask) = 0;
+    if exist('im_vectors','var') == 1
+        im_vectors = maskImageVectors(im_vectors, options.mask);
+    end
+end
+
 % Coordinates of the detectors
 [x, y, z_det, options] = get_coordinates(options, blocks, pseudot);
 
@@ -912,6 +1024,13 @@ else
     options.xSize = 0;
 end
 
+% Remove the LORs that do not intersect the image mask
+if ~isempty(options.mask) && ~list_mode_format && ~options.CT && (subsets > 1 || options.precompute_lor) && ...
+        (options.use_raw_data || options.sampling == 1 || options.precompute_lor)
+    [xx,yy,zz] = computePixelSize(R, FOVax, FOVay, Z, axial_fov, Nx, Ny, Nz, options.implementation);
+    [index, pituus, lor_a] = maskLORs(options, index, pituus, lor_a, x, y, z_det, xx, yy, zz);
+end
+
 if subsets > 1
     pituus = [int64(0);int64(cumsum(pituus))];
     if iscell(index)
@@ -919,6 +1038,12 @@ if subsets > 1
     end
 end
 
+% Reorder the LORs inside each subset, the subsets themselves are not
+% changed
+if subsets > 1 && options.lor_ordering > 0 && ~list_mode_format && ~options.CT
+    index = sortSubsetLORs(options, index, pituus, x, y, z_det, lor_a);
+end
+
 % Compute the necessary indices required for subsets (e.g. the index of
 % the detector coordinates for the current LOR)
 if ~list_mode_format
@@ -1009,6 +1134,54 @@ end
 % Compute PSF kernel
 [gaussK, options] = PSFKernel(options);
 
+% Precompute the attenuation correction factors and include them in the
+% normalization coefficients
+if tyyppi == 0 && attenuation_correction && options.precompute_attenuation_factors && ~options.CT && ~list_mode_format
+    acf = computeACF(options, pituus, lor_a, xy_index, z_index, LL, pseudot, det_per_ring, x, y, z_det, xx, yy, Nx, Ny, Nz, ...
+        dx, dy, dz, bx, by, bz, size_x, NSinos, NSlices, zmax, nCores, use_raw_data);
+    if normalization_correction
+        options.normalization = single(options.normalization(:)) .* acf;
+    else
+        options.normalization = acf;
+        normalization_correction = true;
+    end
+    clear acf
+    attenuation_correction = false;
+    if options.implementation == 2 || options.implementation == 3 || options.implementation == 5
+        options.vaimennus = single(0);
+    else
+        options.vaimennus = 0;
+    end
+end
+
+% Load the subset sensitivity images from the disk cache (or compute and
+% save them)
+sens_cached = false;
+if tyyppi == 0 && options.cache_sensitivity && ~options.CT && ~list_mode_format && ~options.listmode && ~TOF && ~options.out_of_core ...
+        && options.implementation >= 2 && options.implementation <= 4
+    if ~isfield(options, 'scatter')
+        options.scatter = false;
+    end
+    if options.scatter
+        if iscell(options.ScatterC)
+            scatter_input = double(options.ScatterC{1});
+        else
+            scatter_input = double(options.ScatterC);
+        end
+    else
+        scatter_input = 0;
+    end
+    f_Summ_cache = computeSensitivity(options, pituus, lor_a, xy_index, z_index, LL, pseudot, det_per_ring, x, y, z_det, xx, yy, Nx, Ny, Nz, ...
+        dx, dy, dz, bx, by, bz, size_x, NSinos, NSlices, zmax, nCores, use_raw_data, attenuation_correction, normalization_correction, ...
+        scatter_input, x_center, y_center, z_center, bmin, bmax, Vmax, V);
+    clear scatter_input
+    if options.implementation == 2 || options.implementation == 3
+        options.Summ = f_Summ_cache;
+        clear f_Summ_cache
+    end
+    sens_cached = true;
+end
+
 %% This computes a whole observation matrix and uses it to compute the MLEM (no on-the-fly calculations)
 % NOTE: Only attenuation correction is supported
 % This section is largely untested
@@ -1276,6 +1449,111 @@ else
     % Implementations 1, 4 and 5
     if options.implementation ~= 2 && options.implementation ~= 3
         
+        % Out-of-core reconstruction, the subset indices are written only
+        % once as they are the same for all time steps
+        if options.implementation == 4 && options.out_of_core
+            if MLEM_bool || options.CT || list_mode_format || subsets == 1 || exist('out_of_core_subset','file') ~= 3
+                warning(['Out-of-core reconstruction requires subsets > 1 and the out_of_core_subset MEX-file and is not supported with MLEM, ' ...
+                    'CT or list-mode data. Using in-memory data instead.'])
+                options.out_of_core = false;
+            else
+                if isempty(options.out_of_core_folder)
+                    options.out_of_core_folder = tempdir;
+                end
+                ooc_nimi = fullfile(options.out_of_core_folder, [options.machine_name '_' options.name '_']);
+                ooc_index = [ooc_nimi 'index.ooc'];
+                if options.precompute_lor
+                    apu = reshape(lor_a, 1, [], 1);
+                else
+                    apu = [];
+                end
+                if use_raw_data
+                    writeOutOfCoreData(ooc_index, pituus, [], [], [], [], [], [], apu, reshape(LL, 2, [], 1));
+                    LL = uint16(0);
+                else
+                    writeOutOfCoreData(ooc_index, pituus, [], [], [], [], reshape(xy_index, 1, [], 1), reshape(z_index, 1, [], 1), apu, []);
+                    xy_index = uint32(0);
+                    z_index = uint16(0);
+                end
+                lor_a = uint16(0);
+                ooc_pituus = pituus;
+                % The measurement and correction data of each time step,
+                % each time step is released from memory as soon as it
+                % has been written
+                if normalization_correction
+                    apuN = reshape(options.normalization, 1, []);
+                else
+                    apuN = [];
+                end
+                for llo = 1 : partitions
+                    if iscell(options.SinM)
+                        Sino = options.SinM{llo};
+                        options.SinM{llo} = [];
+                    else
+                        Sino = options.SinM;
+                        options.SinM = {[]};
+                    end
+                    if issparse(Sino)
+                        Sino = full(Sino);
+                    end
+                    if randoms_correction
+                        if iscell(options.SinDelayed)
+                            apuD = reshape(options.SinDelayed{llo}, 1, []);
+                            options.SinDelayed{llo} = [];
+                        else
+                            apuD = reshape(options.SinDelayed, 1, []);
+                            options.SinDelayed = {[]};
+                        end
+                    else
+                        apuD = [];
+                    end
+                    if options.scatter_correction && ~options.subtract_scatter
+                        if iscell(options.ScatterC)
+                            if length(options.ScatterC) > 1
+                                apu = reshape(options.ScatterC{llo}, 1, []);
+                                options.ScatterC{llo} = [];
+                            else
+                                apu = reshape(options.ScatterC{1}, 1, []);
+                            end
+                        else
+                            apu = reshape(options.ScatterC, 1, []);
+                        end
+                    else
+                        apu = [];
+                    end
+                    if TOF
+                        Sino = reshape(Sino, 1, [], options.TOF_bins);
+                    else
+                        Sino = reshape(Sino, 1, []);
+                    end
+                    writeOutOfCoreData([ooc_nimi num2str(llo) '.ooc'], pituus, Sino, apuD, apuN, apu, [], [], [], []);
+                    clear Sino apuD apu
+                end
+                clear apuN
+                if randoms_correction
+                    options.SinDelayed = cell(partitions, 1);
+                end
+                if normalization_correction
+                    options.normalization = [];
+                end
+                if options.scatter_correction && ~options.subtract_scatter
+                    options.ScatterC = {[]};
+                end
+            end
+        end
+        % Profiling is supported only by the MEX-files of implementation 4
+        if options.profile && options.implementation ~= 4
+            warning('Profiling is only supported with implementations 2 and 4')
+            options.profile = false;
+        end
+        if options.profile
+            prof = [];
+            tProf = tic;
+        end
+        if options.compute_objective
+            objektiivi = zeros(Niter, partitions);
+        end
+        
         % Loop through all time steps
         for llo = 1 : partitions
             if iscell(options.SinM)
@@ -1304,6 +1582,11 @@ else
                 Sino = (full(Sino));
             end
             
+            % The subset data is read from the out-of-core files
+            if options.implementation == 4 && options.out_of_core
+                ooc_mittaus = [ooc_nimi num2str(llo) '.ooc'];
+            end
+            
             % Implementation 1
             if options.implementation == 1
                 % Upper bound for MRAMLA
@@ -1381,6 +1664,7 @@ else
                         end
                         [im_vectors,C_co,C_aco,C_osl] = computeEstimatesImp1(im_vectors, options, A, uu, Summ, SinD, is_transposed, gaussK, iter, osa_iter, C_co, C_aco,C_osl,...
                             randoms_correction, N, Ndx, Ndy, Ndz, D);
+                        im_vectors = maskImageVectors(im_vectors, options.mask);
                         clear A
                     end
                     im_vectors = init_next_iter(im_vectors, options, iter);
@@ -1485,9 +1769,20 @@ else
                     options.listmode = uint8(1);
                     LL = uint16(0);
                 end
+                %%% CACHED SENSITIVITY IMAGES %%%
+                if sens_cached && llo == 1
+                    f_Summ = double(f_Summ_cache);
+                    if options.use_psf
+                        for kk = 1 : subsets
+                            f_Summ(:,kk) = computeConvolution(f_Summ(:,kk), options, Nx, Ny, Nz, gaussK);
+                        end
+                    end
+                    f_Summ(f_Summ < epps) = epps;
+                    no_norm = true;
+                end
                 %%% PREPASS PHASE %%%
                 if options.COSEM || options.ECOSEM || options.ACOSEM || options.OSL_RBI || options.RBI || options.PKMA || any(options.OSL_COSEM)
-                    if llo == 1 && ~options.compute_sensitivity_image
+                    if llo == 1 && ~options.compute_sensitivity_image && ~sens_cached
                         f_Summ = zeros(Nx*Ny*Nz,subsets);
                     end
                     D = zeros(Nx*Ny*Nz, 1);
@@ -1511,6 +1806,19 @@ else
                         OSEM_apu = im_vectors.OSEM_apu;
                     end
                     for osa_iter = 1 : subsets
+                        if options.out_of_core
+                            % The current subset is read into the same variables as
+                            % the in-memory data, the subset indices start from zero
+                            pituus = ooc_pituus - ooc_pituus(osa_iter);
+                            [Sino, SinD, norm_input, ScatterC] = out_of_core_subset(ooc_mittaus, osa_iter);
+                            [~, ~, ~, ~, xy_index, z_index, lor_a, LL] = out_of_core_subset(ooc_index, osa_iter);
+                            if randoms_correction
+                                options.SinDelayed{llo} = SinD;
+                            end
+                            if normalization_correction
+                                options.normalization = norm_input;
+                            end
+                        end
                         pituusS = pituus;
                         if randoms_correction
                             if iscell(options.SinDelayed)
@@ -1593,7 +1901,7 @@ else
                         elseif options.OSL_COSEM == 2
                             C_osl(:, osa_iter) = im_vectors.OSEM_apu .* rhs;
                         end
-                        if llo == 1 && ~options.compute_sensitivity_image
+                        if llo == 1 && ~options.compute_sensitivity_image && ~sens_cached
                             D = D + Summ;
                             if options.use_psf
                                 Summ = computeConvolution(Summ, options, Nx, Ny, Nz, gaussK);
@@ -1602,7 +1910,7 @@ else
                             f_Summ(:,osa_iter) = Summ;
                         end
                     end
-                    if ~options.compute_sensitivity_image
+                    if ~options.compute_sensitivity_image && ~sens_cached
                         if options.use_psf
                             D = computeConvolution(D, options, Nx, Ny, Nz, gaussK);
                         end
@@ -1614,6 +1922,10 @@ else
                         options.pj3 = D / options.subsets;
                     end
                 end
+                if options.momentum
+                    mom_edellinen = im_vectors.OSEM_apu;
+                    mom_t = 1;
+                end
                 %%% RECONSTRUCTION PHASE %%%
                 for iter = 1 : Niter
                     if OS_bool
@@ -1624,6 +1936,22 @@ else
                             f_Summ = ones(Nx*Ny*Nz,subsets);
                         end
                         for osa_iter = 1 : subsets
+                            if options.profile
+                                profAlku = toc(tProf) * 1e6;
+                            end
+                            if options.out_of_core
+                                % The current subset is read into the same variables as
+                                % the in-memory data, the subset indices start from zero
+                                pituus = ooc_pituus - ooc_pituus(osa_iter);
+                                [Sino, SinD, norm_input, ScatterC] = out_of_core_subset(ooc_mittaus, osa_iter);
+                                [~, ~, ~, ~, xy_index, z_index, lor_a, LL] = out_of_core_subset(ooc_index, osa_iter);
+                                if randoms_correction
+                                    options.SinDelayed{llo} = SinD;
+                                end
+                                if normalization_correction
+                                    options.normalization = norm_input;
+                                end
+                            end
                             if randoms_correction
                                 if iscell(options.SinDelayed)
                                     SinD = single(full(options.SinDelayed{llo}(pituus(osa_iter)+1:pituus(osa_iter + 1))));
@@ -1703,10 +2031,21 @@ else
                             else
                                 OSEM_apu = im_vectors.OSEM_apu;
                             end
-                            [Summ,rhs] = computeImplementation4(options,use_raw_data,randoms_correction, pituus,osa_iter, normalization_correction,...
+                            if options.profile
+                                apu = toc(tProf) * 1e6;
+                                prof = mergeProfilingData(prof, 'subset data', profAlku, iter, osa_iter, apu - profAlku);
+                                profAlku = toc(tProf) * 1e6;
+                            end
+                            % Third output is the data term of the
+                            % log-likelihood, fourth the profiling data
+                            lisa = cell(1, max(double(options.compute_objective), 2 * double(options.profile)));
+                            [Summ,rhs,lisa{:}] = computeImplementation4(options,use_raw_data,randoms_correction, pituus,osa_iter, normalization_correction,...
                                 Nx, Ny, Nz, dx, dy, dz, bx, by, bz, x, y, z_det, xx, yy, size_x, NSinos, NSlices, zmax, attenuation_correction, pseudot, det_per_ring, ...
                                 TOF, TOFSize, sigma_x, TOFCenter, dec, nCores, L_input, lor_a_input, xy_index_input, z_index_input, epps, uu, OSEM_apu, no_norm, ...
                                 x_center, y_center, z_center, bmin, bmax, Vmax, V, scatter_input, norm_input, SinD, dc_z);
+                            if options.profile
+                                prof = mergeProfilingData(prof, lisa{2}, profAlku, iter, osa_iter);
+                            end
                             if list_mode_format
                                 x = apux;
                                 y = apuy;
@@ -1724,11 +2063,25 @@ else
                                 Summ(Summ < epps) = epps;
                                 f_Summ(:,osa_iter) = Summ;
                             end
+                            % Log-likelihood of the current subset, the sum
+                            % of the expected counts is obtained from the
+                            % sensitivity image
+                            if options.compute_objective
+                                summa = double(f_Summ(:,osa_iter))' * double(im_vectors.OSEM_apu) + double(sum(SinD)) * max(1, double(TOF) * options.TOF_bins);
+                                objektiivi(iter, llo) = objektiivi(iter, llo) + lisa{1} - summa;
+                            end
+                            if options.profile
+                                profAlku = toc(tProf) * 1e6;
+                            end
                             [im_vectors,C_co,C_aco,C_osl] = computeEstimatesImp4(im_vectors, options, rhs, uu, f_Summ, SinD, gaussK, iter, osa_iter, C_co, C_aco,C_osl,...
                                 randoms_correction, N, Ndx, Ndy, Ndz, D, tStart, epps, use_raw_data, pituus,normalization_correction,...
                                 Nx, Ny, Nz, dx, dy, dz, bx, by, bz, x, y, z_det, xx, yy, size_x, NSinos, NSlices, zmax, attenuation_correction, pseudot, det_per_ring, ...
                                 TOF, TOFSize, sigma_x, TOFCenter, dec, nCores, L_input, lor_a_input, xy_index_input, z_index_input,  ...
                                 x_center, y_center, z_center, bmin, bmax, Vmax, V, scatter_input, norm_input, dc_z);
+                            im_vectors = maskImageVectors(im_vectors, options.mask);
+                            if options.profile
+                                prof = mergeProfilingData(prof, 'estimates', profAlku, iter, osa_iter, toc(tProf) * 1e6 - profAlku);
+                            end
                             
                             clear Summ rhs
                         end
@@ -1738,6 +2091,15 @@ else
                             iter_n = 1;
                         end
                         im_vectors = computeEstimatesImp4Iter(im_vectors, options, gaussK, iter, iter_n, N, Ndx, Ndy, Ndz, epps, Nx, Ny, Nz, true, tStart_iter);
+                        if options.momentum
+                            % Restart the momentum if the log-likelihood
+                            % decreased
+                            restart = options.momentum_restart && iter > 1 && objektiivi(iter, llo) < objektiivi(iter - 1, llo);
+                            if restart && verbose
+                                disp(['Momentum restarted at iteration ' num2str(iter)])
+                            end
+                            [im_vectors.OSEM_apu, mom_edellinen, mom_t] = momentumStep(im_vectors.OSEM_apu, mom_edellinen, mom_t, restart, epps);
+                        end
                         no_norm = true;
                     end
                     % Are MLEM-methods used?
@@ -1746,7 +2108,7 @@ else
                             tStart = tic;
                         end
                         if iter == 1 && llo == 1
-                            if no_norm && OS_bool
+                            if no_norm && (OS_bool || sens_cached)
                                 f_Summ_ml = sum(f_Summ,2);
                             else
                                 f_Summ_ml = zeros(Nx*Ny*Nz,1);
@@ -1782,10 +2144,19 @@ else
                             MLEM_apu = im_vectors.MLEM_apu;
                         end
                         
-                        [Summ,rhs] = computeImplementation4(options,use_raw_data,randoms_correction, pituus, 1, normalization_correction,...
-                            Nx, Ny, Nz, dx, dy, dz, bx, by, bz, x, y, z_det, xx, yy, size_x, NSinos, NSlices, zmax, attenuation_correction, pseudot, det_per_ring, ...
-                            TOF, TOFSize, sigma_x, TOFCenter, dec, nCores, LL, lor_a, xy_index, z_index, epps, single(full(Sino)), MLEM_apu, no_norm, ...
-                            x_center, y_center, z_center, bmin, bmax, Vmax, V, ScatterC, single(options.normalization), SinD, dc_z);
+                        if options.profile
+                            profAlku = toc(tProf) * 1e6;
+                            [Summ,rhs,~,profData] = computeImplementation4(options,use_raw_data,randoms_correction, pituus, 1, normalization_correction,...
+                                Nx, Ny, Nz, dx, dy, dz, bx, by, bz, x, y, z_det, xx, yy, size_x, NSinos, NSlices, zmax, attenuation_correction, pseudot, det_per_ring, ...
+                                TOF, TOFSize, sigma_x, TOFCenter, dec, nCores, LL, lor_a, xy_index, z_index, epps, single(full(Sino)), MLEM_apu, no_norm, ...
+                                x_center, y_center, z_center, bmin, bmax, Vmax, V, ScatterC, single(options.normalization), SinD, dc_z);
+                            prof = mergeProfilingData(prof, profData, profAlku, iter, 0);
+                        else
+                            [Summ,rhs] = computeImplementation4(options,use_raw_data,randoms_correction, pituus, 1, normalization_correction,...
+                                Nx, Ny, Nz, dx, dy, dz, bx, by, bz, x, y, z_det, xx, yy, size_x, NSinos, NSlices, zmax, attenuation_correction, pseudot, det_per_ring, ...
+                                TOF, TOFSize, sigma_x, TOFCenter, dec, nCores, LL, lor_a, xy_index, z_index, epps, single(full(Sino)), MLEM_apu, no_norm, ...
+                                x_center, y_center, z_center, bmin, bmax, Vmax, V, ScatterC, single(options.normalization), SinD, dc_z);
+                        end
                         
                         if iter == 1 && ~OS_bool && llo == 1
                             if options.use_psf
@@ -1804,6 +2175,7 @@ else
                         end
                         im_vectors = computeEstimatesImp4Iter(im_vectors, options, gaussK, iter, iter_n, N, Ndx, Ndy, Ndz, epps, Nx, Ny, Nz, ...
                             false, tStart, f_Summ_ml, rhs);
+                        im_vectors = maskImageVectors(im_vectors, options.mask);
                         no_norm = true;
                     end
                     if options.use_psf && options.deblurring && (options.save_iter || (~options.save_iter && iter == options.Niter))
@@ -1815,6 +2187,11 @@ else
             if options.implementation ~= 2 && options.implementation ~= 3
                 im_vectors = reshape_vectors(im_vectors, options);
             end
+            if options.implementation == 4 && options.out_of_core
+                out_of_core_subset(ooc_mittaus, 0);
+                delete(ooc_mittaus)
+                pituus = ooc_pituus;
+            end
             pz = images_to_cell(im_vectors, llo, pz, options, rekot);
             if partitions > 1 && options.verbose
                 disp(['Reconstructions for timestep ' num2str(llo) ' completed'])
@@ -1823,6 +2200,13 @@ else
                 im_vectors = form_image_vectors(options, N);
             end
         end
+        if options.implementation == 4 && options.out_of_core
+            out_of_core_subset(ooc_index, 0);
+            delete(ooc_index)
+        end
+        if options.profile
+            saveProfilingTrace(prof, options.profile_file, options.verbose);
+        end
         %% Implementation 2
         % OpenCL matrix free
         % Uses ArrayFire libraries
@@ -1881,7 +2265,17 @@ else
         if ~isfield(options, 'scatter')
             options.scatter = false;
         end
-        [pz] = computeImplementation23(options, Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx, NSinos, NSlices, size_x, zmax, ...
+        % Select the local size and the atomic functions by timing a
+        % synthetic OSEM iteration (or load the earlier selection)
+        if options.autotune && options.implementation == 2 && ~(isfield(options,'use_CUDA') && options.use_CUDA)
+            rekonstruktio = @(opt) computeImplementation23(opt, Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx, NSinos, NSlices, size_x, zmax, ...
+                LL, pseudot, det_per_ring, TOF, sigma_x, TOFCenter, dec, device, use_raw_data, opt.normalization, pituus, attenuation_correction, ...
+                normalization_correction, opt.Niter, subsets, epps, lor_a, xy_index, z_index, x_center, y_center, z_center, opt.SinDelayed, ...
+                opt.SinM, bmin, bmax, Vmax, V, gaussK, 0, reko_maker(opt), pz);
+            options = tuneKernelParameters(options, rekonstruktio);
+            clear rekonstruktio
+        end
+        [pz, objektiivi] = computeImplementation23(options, Ny, Nx, Nz, dx, dz, by, bx, bz, z_det, x, y, dy, yy, xx, NSinos, NSlices, size_x, zmax, ...
             LL, pseudot, det_per_ring, TOF, sigma_x, TOFCenter, dec, device, use_raw_data, options.normalization, pituus, attenuation_correction, ...
             normalization_correction, Niter, subsets, epps, lor_a, xy_index, z_index, x_center, y_center, z_center, options.SinDelayed, ...
             options.SinM, bmin, bmax, Vmax, V, gaussK, 0, rekot, pz);
@@ -1893,5 +2287,11 @@ end
 % Save various image properties, e.g. matrix size, sinogram dimensions, FOV
 % size, regularization parameters, etc.
 pz = save_image_properties(options, pz, subsets);
+% Log-likelihood values of each iteration (rows) and time step (columns),
+% with implementation 2 the second dimension is the algorithm and the third
+% the time step
+if options.compute_objective && tyyppi == 0
+    pz{end}.objective = objektiivi;
+end
 
 end
@@ -0,0 +1,55 @@
+function im = resampleImage(im, koko, uusiKoko)
+%RESAMPLEIMAGE Resamples an image to a different grid with the same FOV
+%   Linearly interpolates the image (column vector or 3D matrix) of size
+%   koko = [Nx Ny Nz] to the grid uusiKoko. Both grids cover the same FOV,
+%   i.e. the voxel centers are at ((1:N) - 0.5) / N of the FOV in each
+%   dimension. Values outside the outermost voxel centers are taken from
+%   the outermost voxels. The output is a column vector.
+%
+% Example:
+%   im = resampleImage(im, [Nx Ny Nz], [Nx/2 Ny/2 Nz/2])
+%
+% See also multiResolutionReconstruction
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+koko = double(koko(:)');
+uusiKoko = double(uusiKoko(:)');
+luokka = class(im);
+im = reshape(double(im), koko);
+% One dimension at a time, the interpolated dimension is always the first
+for dim = 1 : 3
+    if koko(dim) == uusiKoko(dim)
+        continue
+    end
+    jarjestys = [dim setdiff(1:3, dim)];
+    im = permute(im, jarjestys);
+    apuKoko = koko(jarjestys);
+    if koko(dim) == 1
+        im = repmat(reshape(im, 1, []), uusiKoko(dim), 1);
+    else
+        vanha = ((1 : koko(dim))' - 0.5) / koko(dim);
+        uusi = ((1 : uusiKoko(dim))' - 0.5) / uusiKoko(dim);
+        uusi = min(max(uusi, vanha(1)), vanha(end));
+        im = interp1(vanha, reshape(im, koko(dim), []), uusi, 'linear');
+    end
+    apuKoko(1) = uusiKoko(dim);
+    im = ipermute(reshape(im, apuKoko), jarjestys);
+    koko(dim) = uusiKoko(dim);
+end
+im = cast(im(:), luokka);
@@ -0,0 +1,96 @@
+function saveProfilingTrace(prof, tiedosto, verbose)
+%SAVEPROFILINGTRACE Saves the profiling data as a Chrome trace file
+%   Writes the profiling data (see mergeProfilingData) into a JSON file in
+%   the Chrome trace event format. The file can be opened with Perfetto
+%   (ui.perfetto.dev) or chrome://tracing. Spans are saved as complete
+%   events and counters as counter events. Process 0 is the host and
+%   process 1 the device.
+%
+%   If verbose is true (default), the total time of each stage per
+%   iteration (in milliseconds) and the totals of the counters are also
+%   displayed.
+%
+% See also mergeProfilingData
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+if nargin < 3
+    verbose = true;
+end
+M = prof.M;
+nimet = prof.nimet;
+M = sortrows(M, 4);
+% Counters are cumulative in the trace
+summat = zeros(numel(nimet), 1);
+
+fid = fopen(tiedosto, 'w');
+if fid == -1
+    error(['Could not create the trace file ' tiedosto])
+end
+fprintf(fid, '{"traceEvents":[\n');
+fprintf(fid, '{"name":"process_name","ph":"M","pid":0,"args":{"name":"Host"}},\n');
+fprintf(fid, '{"name":"process_name","ph":"M","pid":1,"args":{"name":"Device"}}');
+for kk = 1 : size(M,1)
+    nimi = strrep(nimet{M(kk,1)}, '"', '\"');
+    if isnan(M(kk,5))
+        summat(M(kk,1)) = summat(M(kk,1)) + M(kk,8);
+        fprintf(fid, ',\n{"name":"%s","ph":"C","ts":%.3f,"pid":%d,"tid":%d,"args":{"value":%.17g}}', nimi, M(kk,4), M(kk,2), M(kk,3), ...
+            summat(M(kk,1)));
+    else
+        fprintf(fid, ',\n{"name":"%s","ph":"X","ts":%.3f,"dur":%.3f,"pid":%d,"tid":%d,"args":{"iter":%d,"subset":%d}}', nimi, M(kk,4), M(kk,5), ...
+            M(kk,2), M(kk,3), M(kk,6), M(kk,7));
+    end
+end
+fprintf(fid, '\n]}\n');
+fclose(fid);
+
+if verbose
+    spanit = ~isnan(M(:,5));
+    % The threads of the CPU projector overlap, only the longest thread
+    % counts
+    if any(spanit)
+        iterit = unique(M(spanit,6))';
+        vaiheet = unique(M(spanit,1))';
+        fprintf('%-24s', 'Stage (ms)')
+        for ii = iterit
+            if ii < 0
+                fprintf('%12s', 'setup')
+            else
+                fprintf('%12s', ['iter ' num2str(ii)])
+            end
+        end
+        fprintf('\n')
+        for vv = vaiheet
+            fprintf('%-24s', nimet{vv})
+            for ii = iterit
+                apu = M(spanit & M(:,1) == vv & M(:,6) == ii, :);
+                aika = 0;
+                % Per subset, the maximum over the threads
+                for ss = unique(apu(:,7))'
+                    aika = aika + max(accumarray(apu(apu(:,7) == ss,3) + 1, apu(apu(:,7) == ss,5)));
+                end
+                fprintf('%12.3f', aika / 1e3)
+            end
+            fprintf('\n')
+        end
+    end
+    for vv = find(summat ~= 0)'
+        disp([nimet{vv} ': ' num2str(summat(vv))])
+    end
+end
+end
@@ -38,6 +38,217 @@ const static bool DISCARD = false;
 
 using namespace std;
 
+#ifndef CT
+// Per-thread scratch buffers of the bundle traversal, allocated once per
+// thread and reused for every LOR
+struct bundleScratch {
+	vector<double> zs_r;
+	vector<uint8_t> pass_r;
+	// The lengths of the slices of the current transaxial pixel
+	vector<double> slab;
+	// The voxel lists of the transaxial rays, stored one after another
+	vector<uint32_t> r_ind;
+	vector<double> r_len;
+	vector<uint64_t> r_key;
+	vector<size_t> r_start;
+	vector<uint8_t> r_merge;
+	vector<size_t> r_pos;
+};
+
+// Shared traversal of a multi-ray bundle
+// The axial rays of a single transaxial ray differ only by a constant shift
+// in the z-direction, i.e. they cross exactly the same transaxial (x/y)
+// pixels at the same (relative) distances. The transaxial traversal is thus
+// computed only once for each transaxial ray and the axial rays only
+// distribute the length of each transaxial pixel segment to the slices they
+// cross. The intersection lengths of all the rays are summed to the same
+// voxel indices, i.e. the output is the same as when each ray is traced
+// separately with the improved Siddon's algorithm, but the voxels need to be
+// stepped only once per transaxial ray. Returns the number of rays that
+// intersect the FOV.
+// The axial rays are merged per transaxial pixel. The pixels of each
+// transaxial ray are visited in a monotonic order (in the direction of the
+// ray), thus the voxel lists of the (parallel) transaxial rays are already
+// ordered and are merged without sorting.
+static uint32_t bundle_traversal(const int64_t lo, const uint32_t size_x, const double* x, const double* y, const double* z_det,
+	const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const double dx, const double dy, const double dz, const double bx, const double by,
+	const double bz, const double maxxx, const double maxyy, const uint32_t* xy_index, const uint16_t* z_index, const uint32_t TotSinos,
+	const uint16_t* L, const uint32_t* pseudos, const size_t pRows, const uint32_t det_per_ring, const bool raw, const double dc_z,
+	const uint16_t n_rays, const uint16_t n_rays3D, vector<uint32_t>& b_ind, vector<double>& b_len, bundleScratch& apu) {
+
+	const uint32_t Nyx = Ny * Nx;
+	const double bzb = bz + static_cast<double>(Nz) * dz;
+	uint32_t n_pass = 0U;
+	apu.zs_r.resize(n_rays3D);
+	apu.pass_r.resize(n_rays3D);
+	apu.slab.resize(Nz, 0.);
+	apu.r_ind.clear();
+	apu.r_len.clear();
+	apu.r_key.clear();
+	apu.r_start.clear();
+	apu.r_merge.clear();
+	b_ind.clear();
+	b_len.clear();
+	// The direction of the first intersecting transaxial ray, the lists of the rays with the same direction are merged
+	int32_t iu0 = 0, ju0 = 0;
+
+	for (uint16_t tr = 0u; tr < n_rays; tr++) {
+		Det detectors;
+		// The axial offsets of the rays
+		for (uint16_t r = 0u; r < n_rays3D; r++) {
+			const uint16_t lor = tr * n_rays3D + r + 1u;
+			if (raw)
+				get_detector_coordinates_raw_N(det_per_ring, x, y, z_det, detectors, L, lo, pseudos, pRows, lor, dc_z, n_rays, n_rays3D);
+			else
+				get_detector_coordinates_mr(x, y, z_det, size_x, detectors, xy_index, z_index, TotSinos, lo, lor, dc_z, n_rays, n_rays3D);
+			apu.zs_r[r] = detectors.zs;
+			apu.pass_r[r] = 0u;
+		}
+		const double x_diff = (detectors.xd - detectors.xs);
+		const double y_diff = (detectors.yd - detectors.ys);
+		const double z_diff = (detectors.zd - detectors.zs);
+		if (fabs(x_diff) < 1e-8 && fabs(y_diff) < 1e-8)
+			continue;
+		const double LL = sqrt(x_diff * x_diff + y_diff * y_diff + z_diff * z_diff);
+
+		// Transaxial entry and exit
+		double tmin = -1e8, tmax = 1e8;
+		if (fabs(x_diff) >= 1e-8) {
+			const double t1 = (bx - detectors.xs) / x_diff, t2 = (maxxx - detectors.xs) / x_diff;
+			tmin = std::max(tmin, std::min(t1, t2));
+			tmax = std::min(tmax, std::max(t1, t2));
+		}
+		else if (detectors.xs < bx || detectors.xs > maxxx)
+			continue;
+		if (fabs(y_diff) >= 1e-8) {
+			const double t1 = (by - detectors.ys) / y_diff, t2 = (maxyy - detectors.ys) / y_diff;
+			tmin = std::max(tmin, std::min(t1, t2));
+			tmax = std::min(tmax, std::max(t1, t2));
+		}
+		else if (detectors.ys < by || detectors.ys > maxyy)
+			continue;
+		if (tmin >= tmax)
+			continue;
+
+		// First pixel and the next plane crossings
+		const double t_mid = (tmin + std::min(tmax, tmin + 1e-6)) / 2.;
+		int32_t tempi = static_cast<int32_t>((detectors.xs + t_mid * x_diff - bx) / dx);
+		int32_t tempj = static_cast<int32_t>((detectors.ys + t_mid * y_diff - by) / dy);
+		tempi = std::min(std::max(tempi, 0), static_cast<int32_t>(Nx) - 1);
+		tempj = std::min(std::max(tempj, 0), static_cast<int32_t>(Ny) - 1);
+		const int32_t iu = x_diff > 0. ? 1 : -1;
+		const int32_t ju = y_diff > 0. ? 1 : -1;
+		const double txu = fabs(x_diff) >= 1e-8 ? dx / fabs(x_diff) : 1e8;
+		const double tyu = fabs(y_diff) >= 1e-8 ? dy / fabs(y_diff) : 1e8;
+		double tx0 = fabs(x_diff) >= 1e-8 ? (bx + static_cast<double>(tempi + (iu > 0)) * dx - detectors.xs) / x_diff : 1e8;
+		double ty0 = fabs(y_diff) >= 1e-8 ? (by + static_cast<double>(tempj + (ju > 0)) * dy - detectors.ys) / y_diff : 1e8;
+		double tc = tmin;
+
+		if (iu0 == 0) {
+			iu0 = iu;
+			ju0 = ju;
+		}
+		apu.r_start.emplace_back(apu.r_ind.size());
+		apu.r_merge.emplace_back(static_cast<uint8_t>(iu == iu0 && ju == ju0));
+
+		while (tc < tmax && tempi >= 0 && tempj >= 0 && tempi < static_cast<int32_t>(Nx) && tempj < static_cast<int32_t>(Ny)) {
+			const double tn = std::min(std::min(tx0, ty0), tmax);
+			const double seg = (tn - tc) * LL;
+			if (seg > 0.) {
+				const uint32_t tempij = static_cast<uint32_t>(tempj) * Nx + static_cast<uint32_t>(tempi);
+				uint32_t k_min = Nz, k_max = 0U;
+				// Distribute the segment to the slices crossed by each axial ray
+				for (uint16_t r = 0u; r < n_rays3D; r++) {
+					const double za = apu.zs_r[r] + tc * z_diff;
+					const double zb = apu.zs_r[r] + tn * z_diff;
+					if (fabs(zb - za) < 1e-12) {
+						if (za < bz || za >= bzb)
+							continue;
+						const uint32_t tempk = std::min(static_cast<uint32_t>((za - bz) / dz), Nz - 1U);
+						apu.slab[tempk] += seg;
+						k_min = std::min(k_min, tempk);
+						k_max = std::max(k_max, tempk);
+						apu.pass_r[r] = 1u;
+						continue;
+					}
+					const double zlo = std::max(std::min(za, zb), bz);
+					const double zhi = std::min(std::max(za, zb), bzb);
+					if (zlo >= zhi)
+						continue;
+					const double scale = seg / fabs(zb - za);
+					const uint32_t k0 = std::min(static_cast<uint32_t>((zlo - bz) / dz), Nz - 1U);
+					const uint32_t k1 = std::min(static_cast<uint32_t>((zhi - bz) / dz), Nz - 1U);
+					for (uint32_t kk = k0; kk <= k1; kk++) {
+						const double overlap = std::min(zhi, bz + static_cast<double>(kk + 1U) * dz) - std::max(zlo, bz + static_cast<double>(kk) * dz);
+						if (overlap <= 0.)
+							continue;
+						apu.slab[kk] += overlap * scale;
+						k_min = std::min(k_min, kk);
+						k_max = std::max(k_max, kk);
+						apu.pass_r[r] = 1u;
+					}
+				}
+				// The slices of the pixel in ascending order, the key increases along the ray
+				const uint64_t avain = (static_cast<uint64_t>(ju0 > 0 ? tempj : static_cast<int32_t>(Ny) - 1 - tempj) * Nx
+					+ static_cast<uint64_t>(iu0 > 0 ? tempi : static_cast<int32_t>(Nx) - 1 - tempi)) * Nz;
+				for (uint32_t kk = k_min; kk <= k_max && k_min < Nz; kk++) {
+					if (apu.slab[kk] > 0.) {
+						apu.r_ind.emplace_back(kk * Nyx + tempij);
+						apu.r_len.emplace_back(apu.slab[kk]);
+						apu.r_key.emplace_back(avain + kk);
+						apu.slab[kk] = 0.;
+					}
+				}
+			}
+			tc = tn;
+			if (tx0 <= ty0) {
+				tempi += iu;
+				tx0 += txu;
+			}
+			else {
+				tempj += ju;
+				ty0 += tyu;
+			}
+		}
+		for (uint16_t r = 0u; r < n_rays3D; r++)
+			n_pass += static_cast<uint32_t>(apu.pass_r[r]);
+	}
+
+	// Merge the (ordered) lists of the transaxial rays, the same voxels have the same key
+	const size_t n_lists = apu.r_start.size();
+	apu.r_start.emplace_back(apu.r_ind.size());
+	b_ind.reserve(apu.r_ind.size());
+	b_len.reserve(apu.r_ind.size());
+	apu.r_pos.assign(apu.r_start.begin(), apu.r_start.end() - 1);
+	while (true) {
+		size_t valittu = n_lists;
+		for (size_t ll = 0; ll < n_lists; ll++) {
+			if (apu.r_merge[ll] && apu.r_pos[ll] < apu.r_start[ll + 1] && (valittu == n_lists || apu.r_key[apu.r_pos[ll]] < apu.r_key[apu.r_pos[valittu]]))
+				valittu = ll;
+		}
+		if (valittu == n_lists)
+			break;
+		const size_t ii = apu.r_pos[valittu]++;
+		if (!b_ind.empty() && b_ind.back() == apu.r_ind[ii])
+			b_len.back() += apu.r_len[ii];
+		else {
+			b_ind.emplace_back(apu.r_ind[ii]);
+			b_len.emplace_back(apu.r_len[ii]);
+		}
+	}
+	// Rays in a different direction (nearly axis-aligned rays) are not ordered the same way and are appended as-is
+	for (size_t ll = 0; ll < n_lists; ll++) {
+		if (apu.r_merge[ll])
+			continue;
+		for (size_t ii = apu.r_start[ll]; ii < apu.r_start[ll + 1]; ii++) {
+			b_ind.emplace_back(apu.r_ind[ii]);
+			b_len.emplace_back(apu.r_len[ii]);
+		}
+	}
+	return n_pass;
+}
+#endif
+
 // Improved multi-ray Siddon
 void sequential_improved_siddon_no_precompute(const int64_t loop_var_par, const uint32_t size_x, const double zmax, double* Summ, double* rhs, const double maxyy,
 	const double maxxx,	const vector<double>& xx_vec, const double dy, const vector<double>& yy_vec, const double* atten, const float* norm_coef, 
@@ -48,7 +259,7 @@ void sequential_improved_siddon_no_precompute(const int64_t loop_var_par, const
 	const bool raw, const double cr_pz, const bool no_norm, const uint16_t n_rays, const uint16_t n_rays3D, const double global_factor, const uint8_t fp, 
 	const uint8_t list_mode_format, const bool scatter, const double* scatter_coef, const bool TOF, const int64_t TOFSize, const double sigma_x, const double* TOFCenter,
 	const int64_t nBins, const uint32_t dec_v, const uint32_t subsets, const double* angles, const uint32_t size_y, const double dPitch, const int64_t nProjections, 
-	const uint32_t nCores) {
+	const uint32_t nCores, const uint32_t nBatch, double* logl) {
 
 #ifdef _OPENMP
 	if (nCores == 1U)
@@ -78,11 +289,54 @@ void sequential_improved_siddon_no_precompute(const int64_t loop_var_par, const
 	const size_t nRays = static_cast<size_t>(n_rays) * static_cast<size_t>(n_rays3D);
 	vector<double> TOFVal(nRays * nBins * dec_v * threads, 0.);
 
+	// Shared traversal of the multi-ray bundle (non-TOF sinogram or raw data)
+	// The batched projection uses the same voxel list
+#ifndef CT
+	const bool bundle = (n_rays3D > 1 || nBatch > 1U) && !TOF && list_mode_format == 0;
+#endif
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+	// Per-thread span, stored only when profiling
+	profSpan aika("improved_siddon_no_precompute");
+	// Per-thread batched forward projections, reset for each LOR
+	vector<double> axB(nBatch, 0.);
+#ifndef CT
+	// Per-thread voxel list and scratch buffers of the bundle traversal
+	vector<uint32_t> b_ind;
+	vector<double> b_len;
+	bundleScratch scratch;
+#endif
+	// Per-thread vectors that store the necessary multi-ray information, reset for each LOR
+	vector<int32_t> tempi_a(nRays, 0);
+	vector<int32_t> tempj_a(nRays, 0);
+	vector<int32_t> tempk_a(nRays, 0);
+	vector<int32_t> iu_a(nRays, 0);
+	vector<int32_t> ju_a(nRays, 0);
+	vector<int32_t> ku_a(nRays, 0);
+	vector<double> tx0_a(nRays, 0.);
+	vector<double> ty0_a(nRays, 0.);
+	vector<double> tz0_a(nRays, 0.);
+	vector<double> tc_a(nRays, 0.);
+	vector<double> txu_a(nRays, 0.);
+	vector<double> tyu_a(nRays, 0.);
+	vector<double> tzu_a(nRays, 0.);
+	vector<double> x_diff(nRays, 0.);
+	vector<double> y_diff(nRays, 0.);
+	vector<double> z_diff(nRays, 0.);
+	vector<double> LL(nRays, 0.);
+	vector<double> D_a(nRays, 0.);
+	vector<uint32_t> Np_n(nRays, 0u);
+	vector<bool> pass(nRays, false);
+	vector<double> ax(nBins, 0.);
+	vector<double> yax(nBins, 0.);
 #ifdef _OPENMP
 #if _OPENMP >= 201511 && defined(MATLAB)
-#pragma omp parallel for schedule(monotonic:dynamic, nChunks)
+#pragma omp for schedule(monotonic:dynamic, nChunks) nowait
 #else
-#pragma omp parallel for schedule(dynamic, nChunks)
+#pragma omp for schedule(dynamic, nChunks) nowait
 #endif
 #endif
 	for (int64_t lo = 0LL; lo < loop_var_par; lo++) {
@@ -98,30 +352,8 @@ void sequential_improved_siddon_no_precompute(const int64_t loop_var_par, const
 		if (no_norm && local_sino == 0.)
 			continue;
 
-		// Form vectors that store the necessary multi-ray information
-		vector<int32_t> tempi_a(nRays, 0);
-		vector<int32_t> tempj_a(nRays, 0);
-		vector<int32_t> tempk_a(nRays, 0);
-		vector<int32_t> iu_a(nRays, 0);
-		vector<int32_t> ju_a(nRays, 0);
-		vector<int32_t> ku_a(nRays, 0);
-		vector<double> tx0_a(nRays, 0.);
-		vector<double> ty0_a(nRays, 0.);
-		vector<double> tz0_a(nRays, 0.);
-		vector<double> tc_a(nRays, 0.);
-		vector<double> txu_a(nRays, 0.);
-		vector<double> tyu_a(nRays, 0.);
-		vector<double> tzu_a(nRays, 0.);
-		vector<double> x_diff(nRays, 0.);
-		vector<double> y_diff(nRays, 0.);
-		vector<double> z_diff(nRays, 0.);
-		vector<double> LL(nRays, 0.);
-		vector<double> D_a(nRays, 0.);
-		vector<uint32_t> Np_n(nRays, 0u);
-
-
-		vector<double> ax(nBins, 0.);
-		vector<double> yax(nBins, 0.);
+		std::fill(ax.begin(), ax.end(), 0.);
+		std::fill(yax.begin(), yax.end(), 0.);
 		//vector<double> TOFVal(nRays * nBins, 0.);
 
 		double temp = 0.;
@@ -129,8 +361,6 @@ void sequential_improved_siddon_no_precompute(const int64_t loop_var_par, const
 		double D = 0., DD = 0.;
 		double xI = 0., yI = 0., zI = 0.;
 
-		vector<bool> pass(nRays, false);
-
 #ifndef CT
 		if (fp == 2 && list_mode_format <= 1) {
 			for (int64_t to = 0LL; to < nBins; to++)
@@ -147,6 +377,149 @@ void sequential_improved_siddon_no_precompute(const int64_t loop_var_par, const
 		if (randoms_correction)
 			local_rand = static_cast<double>(randoms[lo]);
 
+#ifndef CT
+		// Multiple axial rays, trace the whole bundle at once
+		if (bundle) {
+			const uint32_t n_pass = bundle_traversal(lo, size_x, x, y, z_det, Nx, Ny, Nz, dx, dy, dz, bx, by, bz, maxxx, maxyy, xy_index, z_index,
+				TotSinos, L, pseudos, pRows, det_per_ring, raw, dc_z, n_rays, n_rays3D, b_ind, b_len, scratch);
+			if (n_pass == 0U)
+				continue;
+			// Batched projection, the nBatch images (fp = 1) or measurement vectors (fp = 2) are
+			// voxel-interleaved and projected with the same voxel list
+			if (nBatch > 1U) {
+				const size_t K = static_cast<size_t>(nBatch);
+				std::fill(axB.begin(), axB.end(), 0.);
+				for (size_t ii = 0; ii < b_ind.size(); ii++) {
+					if (attenuation_correction)
+						jelppi += (b_len[ii] * -atten[b_ind[ii]]);
+					if (fp == 1) {
+						const size_t ind = static_cast<size_t>(b_ind[ii]) * K;
+						for (size_t kk = 0; kk < K; kk++)
+							axB[kk] += (b_len[ii] * osem_apu[ind + kk]);
+					}
+					temp += b_len[ii];
+				}
+				temp = 1. / temp;
+				if (attenuation_correction)
+					temp *= exp(jelppi / static_cast<double>(n_pass));
+				if (normalization)
+					temp *= local_norm;
+				if (scatter)
+					temp *= scatter_coef[lo];
+				temp *= global_factor;
+				if (fp == 1) {
+					for (size_t kk = 0; kk < K; kk++) {
+						if (axB[kk] < epps)
+							axB[kk] = epps;
+						else
+							axB[kk] *= temp;
+						if (randoms_correction)
+							axB[kk] += local_rand;
+						rhs[static_cast<size_t>(lo) * K + kk] = axB[kk];
+					}
+					continue;
+				}
+				for (size_t kk = 0; kk < K; kk++)
+					axB[kk] = osem_apu[static_cast<size_t>(lo) * K + kk];
+				for (size_t ii = 0; ii < b_ind.size(); ii++) {
+					const double val = b_len[ii] * temp;
+					const size_t ind = static_cast<size_t>(b_ind[ii]) * K;
+					for (size_t kk = 0; kk < K; kk++) {
+#pragma omp atomic
+						rhs[ind + kk] += (val * axB[kk]);
+					}
+					if (no_norm == 0 && val > 0.) {
+#pragma omp atomic
+						Summ[b_ind[ii]] += val;
+					}
+				}
+				continue;
+			}
+			for (size_t ii = 0; ii < b_ind.size(); ii++) {
+				if (attenuation_correction)
+					jelppi += (b_len[ii] * -atten[b_ind[ii]]);
+				if (fp != 2)
+					ax[0] += (b_len[ii] * osem_apu[b_ind[ii]]);
+				temp += b_len[ii];
+			}
+			if (fp == 3) {
+				rhs[lo] = attenuation_correction ? exp(jelppi / static_cast<double>(n_pass)) : 1.;
+				continue;
+			}
+			temp = 1. / temp;
+			if (attenuation_correction)
+				temp *= exp(jelppi / static_cast<double>(n_pass));
+			if (normalization)
+				temp *= local_norm;
+			if (scatter)
+				temp *= scatter_coef[lo];
+			temp *= global_factor;
+			if (fp == 1) {
+				if (ax[0] < epps)
+					ax[0] = epps;
+				else
+					ax[0] *= temp;
+				if (randoms_correction)
+					ax[0] += local_rand;
+				rhs[lo] = ax[0];
+				continue;
+			}
+			if (local_sino != 0.) {
+				if (fp != 2) {
+					if (ax[0] < epps)
+						ax[0] = epps;
+					else
+						ax[0] *= temp;
+					if (randoms_correction)
+						ax[0] += local_rand;
+					if (logl)
+						logl[lo] = local_sino * std::log(ax[0]);
+					yax[0] = local_sino / ax[0];
+				}
+				for (size_t ii = 0; ii < b_ind.size(); ii++) {
+					const double val = b_len[ii] * temp;
+#pragma omp atomic
+					rhs[b_ind[ii]] += (val * yax[0]);
+					if (no_norm == 0 && val > 0.) {
+#pragma omp atomic
+						Summ[b_ind[ii]] += val;
+					}
+				}
+			}
+			else if (no_norm == 0) {
+				for (size_t ii = 0; ii < b_ind.size(); ii++) {
+					const double val = b_len[ii] * temp;
+					if (val > 0.) {
+#pragma omp atomic
+						Summ[b_ind[ii]] += val;
+					}
+				}
+			}
+			continue;
+		}
+#endif
+
+		std::fill(tempi_a.begin(), tempi_a.end(), 0);
+		std::fill(tempj_a.begin(), tempj_a.end(), 0);
+		std::fill(tempk_a.begin(), tempk_a.end(), 0);
+		std::fill(iu_a.begin(), iu_a.end(), 0);
+		std::fill(ju_a.begin(), ju_a.end(), 0);
+		std::fill(ku_a.begin(), ku_a.end(), 0);
+		std::fill(tx0_a.begin(), tx0_a.end(), 0.);
+		std::fill(ty0_a.begin(), ty0_a.end(), 0.);
+		std::fill(tz0_a.begin(), tz0_a.end(), 0.);
+		std::fill(tc_a.begin(), tc_a.end(), 0.);
+		std::fill(txu_a.begin(), txu_a.end(), 0.);
+		std::fill(tyu_a.begin(), tyu_a.end(), 0.);
+		std::fill(tzu_a.begin(), tzu_a.end(), 0.);
+		std::fill(x_diff.begin(), x_diff.end(), 0.);
+		std::fill(y_diff.begin(), y_diff.end(), 0.);
+		std::fill(z_diff.begin(), z_diff.end(), 0.);
+		std::fill(LL.begin(), LL.end(), 0.);
+		std::fill(D_a.begin(), D_a.end(), 0.);
+		std::fill(Np_n.begin(), Np_n.end(), 0u);
+		std::fill(pass.begin(), pass.end(), false);
+
 		// Loop through the rays
 		for (uint16_t lor = 0u; lor < nRays; lor++) {
 
@@ -374,6 +747,15 @@ void sequential_improved_siddon_no_precompute(const int64_t loop_var_par, const
 						for (uint16_t ln_r = 0u; ln_r < static_cast<size_t>(n_rays) * static_cast<size_t>(n_rays3D); ln_r++)
 							n_r_summa += static_cast<double>(pass[ln_r]);
 						temp *= exp(jelppi / n_r_summa);
+						// Only the attenuation correction factor
+						if (fp == 3) {
+							rhs[lo] = exp(jelppi / n_r_summa);
+							break;
+						}
+					}
+					else if (fp == 3) {
+						rhs[lo] = 1.;
+						break;
 					}
 					// Include normalization
 					if (normalization)
@@ -419,6 +801,8 @@ void sequential_improved_siddon_no_precompute(const int64_t loop_var_par, const
 									}
 									if (randoms_correction)
 										ax[to] += local_rand;
+									if (logl)
+										logl[lo] += static_cast<double>(Sino[lo + to * TOFSize]) * std::log(ax[to]);
 									yax[to] = Sino[lo + to * TOFSize] / ax[to];
 								}
 							}
@@ -431,6 +815,8 @@ void sequential_improved_siddon_no_precompute(const int64_t loop_var_par, const
 								}
 								if (randoms_correction)
 									ax[0] += local_rand;
+								if (logl)
+									logl[lo] = local_sino * std::log(ax[0]);
 								yax[0] = local_sino / ax[0];
 							}
 						}
@@ -632,6 +1018,7 @@ void sequential_improved_siddon_no_precompute(const int64_t loop_var_par, const
 			}
 		}
 	}
+	}
 }
 
 #ifndef CT
@@ -644,7 +1031,7 @@ void sequential_orth_siddon_no_precomp(const int64_t loop_var_par, const uint32_
 	const double epps, const float* Sino, double* osem_apu, const uint16_t* L, const uint32_t* pseudos, const uint32_t pRows, const uint32_t det_per_ring,
 	const bool raw, const double crystal_size_xy, double* x_center, double* y_center, const double* z_center, const double crystal_size_z,
 	const bool no_norm, const uint32_t dec_v, const double global_factor, const uint8_t fp, const uint8_t list_mode_format, const bool scatter, const double* scatter_coef, 
-	const uint32_t nCores) {
+	const uint32_t nCores, const bool orth_lookup) {
 
 #ifdef _OPENMP
 	if (nCores == 1U)
@@ -653,6 +1040,9 @@ void sequential_orth_siddon_no_precomp(const int64_t loop_var_par, const uint32_
 		omp_set_num_threads(nCores);
 #endif
 
+	// Orthogonal distance lookup table, null if the distances are computed exactly
+	const double* orth_table = orth_lookup ? orth_weight_table() : nullptr;
+
 	const uint32_t Nyx = Ny * Nx;
 
 	const double bzb = bz + static_cast<double>(Nz) * dz;
@@ -671,10 +1061,16 @@ void sequential_orth_siddon_no_precomp(const int64_t loop_var_par, const uint32_
 	std::vector<uint32_t> store_indices(threads * dec_v, 0u);
 
 #ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+	// Per-thread span, stored only when profiling
+	profSpan aika("orth_siddon_no_precomp");
+#ifdef _OPENMP
 #if _OPENMP >= 201511 && defined(MATLAB)
-#pragma omp parallel for schedule(monotonic:dynamic, nChunks)
+#pragma omp for schedule(monotonic:dynamic, nChunks) nowait
 #else
-#pragma omp parallel for schedule(dynamic, nChunks)
+#pragma omp for schedule(dynamic, nChunks) nowait
 #endif
 #endif
 	for (int64_t lo = 0LL; lo < loop_var_par; lo++) {
@@ -935,7 +1331,7 @@ void sequential_orth_siddon_no_precomp(const int64_t loop_var_par, const uint32_
 			}
 			orth_distance_3D_full(tempi, N0, N4, y_diff, x_diff, z_diff, ycenter, xcenter, z_center, temp, N2, tempj, tempk, local_sino, ax,
 				osem_apu, detectors, Nyx, kerroin, no_norm, RHS, SUMMA, OMP, PRECOMPUTE, DISCARD, rhs, Summ, indi, elements, v_indices, idx,
-				N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind);
+				N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind, 0ULL, 0ULL, orth_table);
 
 			// Ray tracing only needed for attenuation
 			for (uint32_t ii = 0u; ii < Np; ii++) {
@@ -964,7 +1360,7 @@ void sequential_orth_siddon_no_precomp(const int64_t loop_var_par, const uint32_
 						loppu = tempk;
 						orth_distance_3D_full(tempi, N0, N4, y_diff, x_diff, z_diff, ycenter, xcenter, z_center, temp, N2, tempj, tempk, local_sino, ax,
 							osem_apu, detectors, Nyx, kerroin, no_norm, RHS, SUMMA, OMP, PRECOMPUTE, DISCARD, rhs, Summ, indi, elements, v_indices, idx,
-							N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind);
+							N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind, 0ULL, 0ULL, orth_table);
 					}
 				}
 				Np_n++;
@@ -987,7 +1383,7 @@ void sequential_orth_siddon_no_precomp(const int64_t loop_var_par, const uint32_
 							}
 							orth_distance_3D_full(tempi, N0, N4, y_diff, x_diff, z_diff, ycenter, xcenter, z_center, temp, N2, tempj, tempk, local_sino, ax,
 								osem_apu, detectors, Nyx, kerroin, no_norm, RHS, SUMMA, OMP, PRECOMPUTE, DISCARD, rhs, Summ, indi, elements, v_indices, idx,
-								N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind);
+								N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind, 0ULL, 0ULL, orth_table);
 						}
 					}
 					break;
@@ -1023,9 +1419,10 @@ void sequential_orth_siddon_no_precomp(const int64_t loop_var_par, const uint32_
 				SUMMA = true;
 			orth_distance_3D_full(tempi, N0, N4, y_diff, x_diff, z_diff, ycenter, xcenter, z_center, temp, N2, tempj, tempk, local_sino, ax,
 				osem_apu, detectors, Nyx, kerroin, no_norm, RHS, SUMMA, OMP, PRECOMPUTE, DISCARD, rhs, Summ, indi, elements, v_indices, idx,
-				N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind);
+				N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind, 0ULL, 0ULL, orth_table);
 		}
 	}
+	}
 }
 #endif
 
@@ -1065,10 +1462,16 @@ void sequential_volume_siddon_no_precomp(const int64_t loop_var_par, const uint3
 	std::vector<uint32_t> store_indices(threads * dec_v, 0u);
 
 #ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+	// Per-thread span, stored only when profiling
+	profSpan aika("volume_siddon_no_precomp");
+#ifdef _OPENMP
 #if _OPENMP >= 201511 && defined(MATLAB)
-#pragma omp parallel for schedule(monotonic:dynamic, nChunks)
+#pragma omp for schedule(monotonic:dynamic, nChunks) nowait
 #else
-#pragma omp parallel for schedule(dynamic, nChunks)
+#pragma omp for schedule(dynamic, nChunks) nowait
 #endif
 #endif
 	for (int64_t lo = 0LL; lo < loop_var_par; lo++) {
@@ -1373,4 +1776,5 @@ void sequential_volume_siddon_no_precomp(const int64_t loop_var_par, const uint3
 				idx, N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind, bmax, bmin, Vmax, V);
 		}
 	}
-}
\ No newline at end of file
+	}
+}
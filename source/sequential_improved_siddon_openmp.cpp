@@ -36,6 +36,265 @@ const static bool DISCARD = false;
 
 using namespace std;
 
+#ifndef CT
+// Index of the voxel (clamped to [0, N - 1]) that contains coordinate v
+static inline int32_t clamped_index(const double v, const double b, const double d, const uint32_t N) {
+	const double apu = std::floor((v - b) / d);
+	if (apu < 0.)
+		return 0;
+	if (apu > static_cast<double>(N - 1U))
+		return static_cast<int32_t>(N - 1U);
+	return static_cast<int32_t>(apu);
+}
+
+// Voxel-driven (gather) backprojection for the improved Siddon's algorithm
+// The image is divided into tiles (axial slabs that are further divided in
+// the y-direction if there are not enough slices), each of which is owned by
+// a single thread. The LORs are binned once to the tiles their bounding box
+// overlaps. Each tile then gathers the contributions of its own LORs by
+// tracing only the part of the LOR inside the tile, with the same
+// intersection lengths as the ray-driven projector. As such, no atomics are
+// needed and the summation order of each voxel is always the same (ascending
+// LOR index), i.e. the results are deterministic regardless of the number of
+// threads.
+// lor_rhs and lor_summ contain the per-LOR multipliers (probability scaling
+// times the measurement ratio and the probability scaling, respectively).
+static void gather_improved_siddon(const int64_t loop_var_par, const uint32_t size_x, const double* x, const double* y, const double* z_det,
+	const uint32_t Nx, const uint32_t Ny, const uint32_t Nz, const double dx, const double dy, const double dz, const double bx, const double by,
+	const double bz, const double maxxx, const double maxyy, const vector<double>& xx_vec, const vector<double>& yy_vec, const uint16_t* lor1,
+	const uint32_t* xy_index, const uint16_t* z_index, const uint32_t TotSinos, const uint16_t* L, const uint32_t* pseudos, const uint32_t pRows,
+	const uint32_t det_per_ring, const bool raw, const bool no_norm, const vector<double>& lor_rhs, const vector<double>& lor_summ, double* Summ,
+	double* rhs, const size_t threads) {
+
+	const uint32_t Nyx = Ny * Nx;
+	const double bzb = bz + static_cast<double>(Nz) * dz;
+
+	// Tiles, at least a few per thread for load balancing
+	const uint32_t nTiles = static_cast<uint32_t>(threads) * 4U;
+	const uint32_t nTz = std::min(Nz, nTiles);
+	const uint32_t nTy = std::min(Ny, (nTiles + nTz - 1U) / nTz);
+
+	// The tile of each slice and row
+	vector<uint32_t> kTile(Nz), jTile(Ny);
+	for (uint32_t tz = 0U; tz < nTz; tz++)
+		for (uint32_t k = tz * Nz / nTz; k < (tz + 1U) * Nz / nTz; k++)
+			kTile[k] = tz;
+	for (uint32_t ty = 0U; ty < nTy; ty++)
+		for (uint32_t j = ty * Ny / nTy; j < (ty + 1U) * Ny / nTy; j++)
+			jTile[j] = ty;
+
+	// The tile range (first z, last z, first y, last y) of each LOR, from the
+	// bounding box of the detector coordinates with a one voxel margin
+	// Empty LORs get an empty range
+	vector<uint32_t> lorTiles(static_cast<size_t>(loop_var_par) * 4ULL);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for (int64_t lo = 0LL; lo < loop_var_par; lo++) {
+		uint32_t* alue = &lorTiles[static_cast<size_t>(lo) * 4ULL];
+		if (lor_summ[lo] == 0. && lor_rhs[lo] == 0.) {
+			alue[0] = 1U;
+			alue[1] = 0U;
+			continue;
+		}
+		Det detectors;
+		if (raw)
+			get_detector_coordinates_raw(det_per_ring, x, y, z_det, detectors, L, lo, pseudos, pRows);
+		else
+			get_detector_coordinates(x, y, z_det, size_x, detectors, xy_index, z_index, TotSinos, lo);
+		const int32_t kMin = std::max(clamped_index(std::min(detectors.zs, detectors.zd), bz, dz, Nz) - 1, 0);
+		const int32_t kMax = std::min(clamped_index(std::max(detectors.zs, detectors.zd), bz, dz, Nz) + 1, static_cast<int32_t>(Nz) - 1);
+		const int32_t jMin = std::max(clamped_index(std::min(detectors.ys, detectors.yd), by, dy, Ny) - 1, 0);
+		const int32_t jMax = std::min(clamped_index(std::max(detectors.ys, detectors.yd), by, dy, Ny) + 1, static_cast<int32_t>(Ny) - 1);
+		alue[0] = kTile[kMin];
+		alue[1] = kTile[kMax];
+		alue[2] = jTile[jMin];
+		alue[3] = jTile[jMax];
+	}
+
+	// LOR lists of each tile in ascending LOR order (CSR)
+	vector<size_t> tileStart(static_cast<size_t>(nTz) * nTy + 1ULL, 0ULL);
+	for (int64_t lo = 0LL; lo < loop_var_par; lo++) {
+		const uint32_t* alue = &lorTiles[static_cast<size_t>(lo) * 4ULL];
+		for (uint32_t tz = alue[0]; tz <= alue[1]; tz++)
+			for (uint32_t ty = alue[2]; ty <= alue[3]; ty++)
+				tileStart[tz * nTy + ty + 1U]++;
+	}
+	for (size_t tt = 1ULL; tt < tileStart.size(); tt++)
+		tileStart[tt] += tileStart[tt - 1ULL];
+	vector<int64_t> tileLORs(tileStart.back());
+	{
+		vector<size_t> paikka(tileStart.begin(), tileStart.end() - 1);
+		for (int64_t lo = 0LL; lo < loop_var_par; lo++) {
+			const uint32_t* alue = &lorTiles[static_cast<size_t>(lo) * 4ULL];
+			for (uint32_t tz = alue[0]; tz <= alue[1]; tz++)
+				for (uint32_t ty = alue[2]; ty <= alue[3]; ty++)
+					tileLORs[paikka[tz * nTy + ty]++] = lo;
+		}
+	}
+	vector<uint32_t>().swap(lorTiles);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+	for (int64_t tt = 0LL; tt < static_cast<int64_t>(nTz * nTy); tt++) {
+		const uint32_t tz = static_cast<uint32_t>(tt) / nTy;
+		const uint32_t ty = static_cast<uint32_t>(tt) % nTy;
+		const int32_t k0 = static_cast<int32_t>(tz * Nz / nTz), k1 = static_cast<int32_t>((tz + 1U) * Nz / nTz);
+		const int32_t j0 = static_cast<int32_t>(ty * Ny / nTy), j1 = static_cast<int32_t>((ty + 1U) * Ny / nTy);
+		const double zLow = bz + static_cast<double>(k0) * dz, zHigh = bz + static_cast<double>(k1) * dz;
+		const double yLow = by + static_cast<double>(j0) * dy, yHigh = by + static_cast<double>(j1) * dy;
+
+		for (size_t ll = tileStart[tt]; ll < tileStart[tt + 1LL]; ll++) {
+			const int64_t lo = tileLORs[ll];
+
+			Det detectors;
+			if (raw)
+				get_detector_coordinates_raw(det_per_ring, x, y, z_det, detectors, L, lo, pseudos, pRows);
+			else
+				get_detector_coordinates(x, y, z_det, size_x, detectors, xy_index, z_index, TotSinos, lo);
+
+			const double y_diff = (detectors.yd - detectors.ys);
+			const double x_diff = (detectors.xd - detectors.xs);
+			const double z_diff = (detectors.zd - detectors.zs);
+			uint32_t Np = static_cast<uint32_t>(lor1[lo]);
+
+			if (fabs(z_diff) < 1e-8 && (fabs(y_diff) < 1e-8 || fabs(x_diff) < 1e-8)) {
+				// Perpendicular LORs, the multipliers already include the (constant) element value
+				const int32_t tempk = static_cast<int32_t>(fabs(detectors.zs - bz) / dz);
+				if (tempk < k0 || tempk >= k1)
+					continue;
+				uint32_t temp_ijk = 0;
+				uint32_t incr = 1U;
+				if (fabs(y_diff) < 1e-8) {
+					if (detectors.yd > maxyy || detectors.yd < by)
+						continue;
+					perpendicular_elements(Ny, detectors.yd, yy_vec, dx, tempk, Nx, Ny, nullptr, 0., false, false, temp_ijk, 1u, lo, 1., false, nullptr);
+					const int32_t tempj = static_cast<int32_t>((temp_ijk - static_cast<uint32_t>(tempk) * Nyx) / Nx);
+					if (tempj < j0 || tempj >= j1)
+						continue;
+				}
+				else {
+					if (detectors.xd > maxxx || detectors.xd < bx)
+						continue;
+					perpendicular_elements(1, detectors.xd, xx_vec, dy, tempk, Ny, Nx, nullptr, 0., false, false, temp_ijk, Nx, lo, 1., false, nullptr);
+					incr = Nx;
+				}
+				for (uint32_t k = 0; k < Np; k++) {
+					const uint32_t ind = temp_ijk + k * incr;
+					if (incr == Nx) {
+						const int32_t tempj = static_cast<int32_t>((ind % Nyx) / Nx);
+						if (tempj < j0 || tempj >= j1)
+							continue;
+					}
+					rhs[ind] += lor_rhs[lo];
+					if (no_norm == 0)
+						Summ[ind] += lor_summ[lo];
+				}
+			}
+			else {
+				int32_t tempi = 0, tempj = 0, tempk = 0, iu = 0, ju = 0, ku = 0;
+				double txu = 0., tyu = 0., tzu = 0., tc = 0., tx0 = 1e8, ty0 = 1e8, tz0 = 1e8;
+
+				if (std::fabs(z_diff) < 1e-8) {
+					tempk = static_cast<int32_t>(fabs(detectors.zs - bz) / dz);
+					if (tempk < k0 || tempk >= k1)
+						continue;
+					siddon_pre_loop_2D(bx, by, x_diff, y_diff, maxxx, maxyy, dx, dy, Nx, Ny, tempi, tempj, txu, tyu, Np, TYPE,
+						detectors.ys, detectors.xs, detectors.yd, detectors.xd, tc, iu, ju, tx0, ty0);
+				}
+				else if (std::fabs(y_diff) < 1e-8) {
+					siddon_pre_loop_2D(bx, bz, x_diff, z_diff, maxxx, bzb, dx, dz, Nx, Nz, tempi, tempk, txu, tzu, Np, TYPE,
+						detectors.zs, detectors.xs, detectors.zd, detectors.xd, tc, iu, ku, tx0, tz0);
+					tempj = perpendicular_start(by, detectors.yd, dy, Ny);
+				}
+				else if (std::fabs(x_diff) < 1e-8) {
+					siddon_pre_loop_2D(by, bz, y_diff, z_diff, maxyy, bzb, dy, dz, Ny, Nz, tempj, tempk, tyu, tzu, Np, TYPE,
+						detectors.zs, detectors.ys, detectors.zd, detectors.yd, tc, ju, ku, ty0, tz0);
+					tempi = perpendicular_start(bx, detectors.xd, dx, Nx);
+				}
+				else {
+					siddon_pre_loop_3D(bx, by, bz, x_diff, y_diff, z_diff, maxxx, maxyy, bzb, dx, dy, dz, Nx, Ny, Nz, tempi, tempj, tempk, tyu, txu, tzu,
+						Np, TYPE, detectors, tc, iu, ju, ku, tx0, ty0, tz0);
+				}
+
+				// Skip the part of the LOR before the tile, the same number of
+				// plane crossings as the ray-driven traversal would make
+				double tEnter = tc;
+				if (std::fabs(z_diff) >= 1e-8)
+					tEnter = std::max(tEnter, std::min((zLow - detectors.zs) / z_diff, (zHigh - detectors.zs) / z_diff));
+				if (std::fabs(y_diff) >= 1e-8)
+					tEnter = std::max(tEnter, std::min((yLow - detectors.ys) / y_diff, (yHigh - detectors.ys) / y_diff));
+				if (tEnter > tc) {
+					const uint32_t nx = tx0 < tEnter ? static_cast<uint32_t>((tEnter - tx0) / txu) + 1U : 0U;
+					const uint32_t ny = ty0 < tEnter ? static_cast<uint32_t>((tEnter - ty0) / tyu) + 1U : 0U;
+					const uint32_t nz = tz0 < tEnter ? static_cast<uint32_t>((tEnter - tz0) / tzu) + 1U : 0U;
+					if (nx + ny + nz >= Np)
+						continue;
+					Np -= (nx + ny + nz);
+					if (nx > 0U) {
+						tempi += iu * static_cast<int32_t>(nx);
+						tx0 += txu * static_cast<double>(nx);
+						tc = std::max(tc, tx0 - txu);
+					}
+					if (ny > 0U) {
+						tempj += ju * static_cast<int32_t>(ny);
+						ty0 += tyu * static_cast<double>(ny);
+						tc = std::max(tc, ty0 - tyu);
+					}
+					if (nz > 0U) {
+						tempk += ku * static_cast<int32_t>(nz);
+						tz0 += tzu * static_cast<double>(nz);
+						tc = std::max(tc, tz0 - tzu);
+					}
+				}
+
+				const double LL = sqrt(x_diff * x_diff + y_diff * y_diff + z_diff * z_diff);
+
+				for (uint32_t ii = 0; ii < Np; ii++) {
+					double element;
+					const int32_t tempj_c = tempj, tempk_c = tempk;
+					const uint32_t tempijk = static_cast<uint32_t>(tempk) * Nyx + static_cast<uint32_t>(tempj) * Nx + static_cast<uint32_t>(tempi);
+					if (tx0 < ty0 && tx0 < tz0) {
+						element = (tx0 - tc) * LL;
+						tc = tx0;
+						tx0 += txu;
+						tempi += iu;
+					}
+					else if (ty0 < tz0) {
+						element = (ty0 - tc) * LL;
+						tc = ty0;
+						ty0 += tyu;
+						tempj += ju;
+					}
+					else {
+						element = (tz0 - tc) * LL;
+						tc = tz0;
+						tz0 += tzu;
+						tempk += ku;
+					}
+					if (tempk_c < k0 || tempk_c >= k1) {
+						// The LOR has already passed through the slab
+						if ((ku > 0 && tempk_c >= k1) || (ku < 0 && tempk_c < k0))
+							break;
+						continue;
+					}
+					if (tempj_c < j0 || tempj_c >= j1) {
+						if ((ju > 0 && tempj_c >= j1) || (ju < 0 && tempj_c < j0))
+							break;
+						continue;
+					}
+					rhs[tempijk] += (element * lor_rhs[lo]);
+					const double val = element * lor_summ[lo];
+					if (no_norm == 0 && val > 0.)
+						Summ[tempijk] += val;
+				}
+			}
+		}
+	}
+}
+#endif
+
 void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_x, const double zmax, double* Summ, double* rhs, const double maxyy,
 	const double maxxx,	const vector<double>& xx_vec, const double dy, const vector<double>& yy_vec, const double* atten, const float* norm_coef, 
 	const float* randoms, const double* x, const double* y, const double* z_det, const uint32_t NSlices, const uint32_t Nx, const uint32_t Ny, 
@@ -44,7 +303,7 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 	const double epps, const float* Sino, double* osem_apu, const uint16_t* L, const uint32_t* pseudos, const uint32_t pRows, const uint32_t det_per_ring, 
 	const bool raw, const bool no_norm, const double global_factor, const uint8_t fp, const bool scatter, const double* scatter_coef, const bool TOF, 
 	const int64_t TOFSize, const double sigma_x, const double* TOFCenter, const int64_t nBins, const uint32_t dec_v, const uint32_t subsets, 
-	const double* angles, const uint32_t size_y, const double dPitch, const int64_t nProjections, const uint32_t nCores) {
+	const double* angles, const uint32_t size_y, const double dPitch, const int64_t nProjections, const uint32_t nCores, const bool voxel_driven, double* logl) {
 
 #ifdef _OPENMP
 	if (nCores == 1U)
@@ -64,13 +323,31 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 #endif
 	vector<double> TOFVal(nBins * dec_v * threads, 0.);
 
+	// Voxel-driven backprojection, only non-TOF PET data is supported
+#ifndef CT
+	const bool gather = voxel_driven && !TOF && (fp == 0 || fp == 2);
+#else
+	const bool gather = false;
+#endif
+	vector<double> lor_rhs, lor_summ;
+	if (gather) {
+		lor_rhs.resize(loop_var_par, 0.);
+		lor_summ.resize(loop_var_par, 0.);
+	}
+
 	//mexPrintf("fp = %u\n", fp);
 
 #ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+	// Per-thread span, stored only when profiling
+	profSpan aika("improved_siddon");
+#ifdef _OPENMP
 #if _OPENMP >= 201511 && defined(MATLAB)
-#pragma omp parallel for schedule(monotonic:dynamic, nChunks)
+#pragma omp for schedule(monotonic:dynamic, nChunks) nowait
 #else
-#pragma omp parallel for schedule(dynamic, nChunks)
+#pragma omp for schedule(dynamic, nChunks) nowait
 #endif
 #endif
 	for (int64_t lo = 0LL; lo < loop_var_par; lo++) {
@@ -145,6 +422,17 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 					const double element = perpendicular_elements(Ny, detectors.yd, yy_vec, dx, tempk, Nx, Ny, atten, local_norm, attenuation_correction,
 						normalization, temp_ijk, 1u, lo, global_factor, scatter, scatter_coef);
 
+#ifndef CT
+					// Only the attenuation correction factor
+					if (fp == 3) {
+						double acf = 1.;
+						if (attenuation_correction)
+							att_corr_scalar(dx, temp_ijk, atten, acf, Ny, 1u);
+						rhs[lo] = acf;
+						continue;
+					}
+#endif
+
 					if (TOF) {
 						xI = (dx * Nx) / 2.;
 						if (x_diff > 0.)
@@ -177,6 +465,8 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 										ax[to] *= temp;
 									if (randoms_correction)
 										ax[to] += local_rand;
+									if (logl)
+										logl[lo] += static_cast<double>(Sino[lo + to * TOFSize]) * std::log(ax[to]);
 									yax[to] = Sino[lo + to * TOFSize] / ax[to];
 								}
 							}
@@ -230,11 +520,18 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 									ax[0] = epps;
 								if (randoms_correction)
 									ax[0] += local_rand;
+								if (logl)
+									logl[lo] = local_sino * std::log(ax[0]);
 								yax[0] = local_sino / ax[0];
 #else
 								yax[0] = (std::exp(-ax[0]) / local_sino);
 #endif
 							}
+							if (gather) {
+								lor_rhs[lo] = element * yax[0];
+								lor_summ[lo] = element;
+								continue;
+							}
 							for (uint32_t k = 0; k < Np; k++) {
 #pragma omp atomic
 								rhs[temp_ijk + k] += (element * yax[0]);
@@ -245,6 +542,10 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 							}
 						}
 						else {
+							if (gather) {
+								lor_summ[lo] = element;
+								continue;
+							}
 							for (uint32_t k = 0; k < Np; k++) {
 								if (no_norm == 0) {
 #pragma omp atomic
@@ -263,6 +564,17 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 					const double element = perpendicular_elements(1, detectors.xd, xx_vec, dy, tempk, Ny, Nx, atten, local_norm, attenuation_correction,
 						normalization, temp_ijk, Nx, lo, global_factor, scatter, scatter_coef);
 
+#ifndef CT
+					// Only the attenuation correction factor
+					if (fp == 3) {
+						double acf = 1.;
+						if (attenuation_correction)
+							att_corr_scalar(dy, temp_ijk, atten, acf, Nx, Nx);
+						rhs[lo] = acf;
+						continue;
+					}
+#endif
+
 					if (TOF) {
 						yI = (dy * Ny) / 2.;
 						if (y_diff > 0.)
@@ -295,6 +607,8 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 										ax[to] *= temp;
 									if (randoms_correction)
 										ax[to] += local_rand;
+									if (logl)
+										logl[lo] += static_cast<double>(Sino[lo + to * TOFSize]) * std::log(ax[to]);
 									yax[to] = Sino[lo + to * TOFSize] / ax[to];
 								}
 							}
@@ -342,11 +656,18 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 									ax[0] = epps;
 								if (randoms_correction)
 									ax[0] += local_rand;
+								if (logl)
+									logl[lo] = local_sino * std::log(ax[0]);
 								yax[0] = local_sino / ax[0];
 #else
 								yax[0] = (std::exp(-ax[0]) / local_sino);
 #endif
 							}
+							if (gather) {
+								lor_rhs[lo] = element * yax[0];
+								lor_summ[lo] = element;
+								continue;
+							}
 							for (uint32_t k = 0; k < Np; k++) {
 #pragma omp atomic
 								rhs[temp_ijk + k * Nx] += (element * yax[0]);
@@ -357,6 +678,10 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 							}
 						}
 						else {
+							if (gather) {
+								lor_summ[lo] = element;
+								continue;
+							}
 							for (uint32_t k = 0; k < Np; k++) {
 								if (no_norm == 0) {
 #pragma omp atomic
@@ -423,6 +748,11 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 			}
 
 #ifndef CT
+			// Only the attenuation correction factor
+			if (fp == 3) {
+				rhs[lo] = exp(jelppi);
+				continue;
+			}
 			temp = 1. / temp;
 			if (attenuation_correction)
 				temp *= exp(jelppi);
@@ -480,6 +810,8 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 							}
 							if (randoms_correction)
 								ax[to] += local_rand;
+							if (logl)
+								logl[lo] += static_cast<double>(Sino[lo + to * TOFSize]) * std::log(ax[to]);
 							yax[to] = Sino[lo + to * TOFSize] / ax[to];
 						}
 					}
@@ -492,12 +824,19 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 						}
 						if (randoms_correction)
 							ax[0] += local_rand;
+						if (logl)
+							logl[lo] = local_sino * std::log(ax[0]);
 						yax[0] = local_sino / ax[0];
 					}
 #else
 					yax[0] = (std::exp(-ax[0]) / local_sino);
 #endif
 				}
+				if (gather) {
+					lor_rhs[lo] = temp * yax[0];
+					lor_summ[lo] = temp;
+					continue;
+				}
 				for (uint32_t ii = 0; ii < Np; ii++) {
 					if (tx0 < ty0 && tx0 < tz0) {
 						backwardProjection(tx0, tc, txu, LL, tempijk, TOF, DD, nBins, TOFVal, TOFCenter, sigma_x, D, yax, epps, temp,
@@ -514,6 +853,10 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 				}
 			}
 			else {
+				if (gather) {
+					lor_summ[lo] = temp;
+					continue;
+				}
 				for (uint32_t ii = 0; ii < Np; ii++) {
 					if (tx0 < ty0 && tx0 < tz0) {
 						sensImage(tx0, tc, txu, LL, tempijk, TOF, DD, nBins, TOFVal, TOFCenter, sigma_x, D, epps, temp,
@@ -531,6 +874,12 @@ void sequential_improved_siddon(const int64_t loop_var_par, const uint32_t size_
 			}
 		}
 	}
+	}
+#ifndef CT
+	if (gather)
+		gather_improved_siddon(loop_var_par, size_x, x, y, z_det, Nx, Ny, Nz, dx, dy, dz, bx, by, bz, maxxx, maxyy, xx_vec, yy_vec, lor1, xy_index,
+			z_index, TotSinos, L, pseudos, pRows, det_per_ring, raw, no_norm, lor_rhs, lor_summ, Summ, rhs, threads);
+#endif
 }
 
 #ifndef CT
@@ -541,7 +890,8 @@ void sequential_orth_siddon(const int64_t loop_var_par, const uint32_t size_x, c
 	const bool normalization, const bool randoms_correction, const uint16_t* lor1, const uint32_t* xy_index, const uint16_t* z_index, const uint32_t TotSinos,
 	const double epps, const float* Sino, double* osem_apu, const uint16_t* L, const uint32_t* pseudos, const uint32_t pRows, const uint32_t det_per_ring,
 	const bool raw, const double crystal_size_xy, double* x_center, double* y_center, const double* z_center, const double crystal_size_z,
-	const bool no_norm, const uint32_t dec_v, const double global_factor, const uint8_t fp, const bool scatter, const double* scatter_coef, const uint32_t nCores) {
+	const bool no_norm, const uint32_t dec_v, const double global_factor, const uint8_t fp, const bool scatter, const double* scatter_coef, const uint32_t nCores,
+	const bool orth_lookup) {
 
 #ifdef _OPENMP
 	if (nCores == 1U)
@@ -550,6 +900,9 @@ void sequential_orth_siddon(const int64_t loop_var_par, const uint32_t size_x, c
 		omp_set_num_threads(nCores);
 #endif
 
+	// Orthogonal distance lookup table, null if the distances are computed exactly
+	const double* orth_table = orth_lookup ? orth_weight_table() : nullptr;
+
 	const uint32_t Nyx = Ny * Nx;
 
 	const double bzb = bz + static_cast<double>(Nz) * dz;
@@ -569,10 +922,16 @@ void sequential_orth_siddon(const int64_t loop_var_par, const uint32_t size_x, c
 	std::vector<uint32_t> store_indices(threads * dec_v, 0u);
 
 #ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+	// Per-thread span, stored only when profiling
+	profSpan aika("orth_siddon");
+#ifdef _OPENMP
 #if _OPENMP >= 201511 && defined(MATLAB)
-#pragma omp parallel for schedule(monotonic:dynamic, nChunks)
+#pragma omp for schedule(monotonic:dynamic, nChunks) nowait
 #else
-#pragma omp parallel for schedule(dynamic, nChunks)
+#pragma omp for schedule(dynamic, nChunks) nowait
 #endif
 #endif
 	for (int64_t lo = 0LL; lo < loop_var_par; lo++) {
@@ -808,7 +1167,7 @@ void sequential_orth_siddon(const int64_t loop_var_par, const uint32_t size_x, c
 			}
 			orth_distance_3D_full(tempi, N0, N4, y_diff, x_diff, z_diff, ycenter, xcenter, z_center, temp, N2, tempj, tempk, local_sino, ax,
 				osem_apu, detectors, Nyx, kerroin, no_norm, RHS, SUMMA, OMP, PRECOMPUTE, DISCARD, rhs, Summ, indi, elements, v_indices, idx,
-				N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind);
+				N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind, 0ULL, 0ULL, orth_table);
 
 			for (uint32_t ii = 0u; ii < Np; ii++) {
 				if (tx0 < ty0 && tx0 < tz0) {
@@ -836,7 +1195,7 @@ void sequential_orth_siddon(const int64_t loop_var_par, const uint32_t size_x, c
 						loppu = tempk;
 						orth_distance_3D_full(tempi, N0, N4, y_diff, x_diff, z_diff, ycenter, xcenter, z_center, temp, N2, tempj, tempk, local_sino, ax,
 							osem_apu, detectors, Nyx, kerroin, no_norm, RHS, SUMMA, OMP, PRECOMPUTE, DISCARD, rhs, Summ, indi, elements, v_indices, idx,
-							N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind);
+							N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind, 0ULL, 0ULL, orth_table);
 					}
 				}
 			}
@@ -858,7 +1217,7 @@ void sequential_orth_siddon(const int64_t loop_var_par, const uint32_t size_x, c
 					}
 					orth_distance_3D_full(tempi, N0, N4, y_diff, x_diff, z_diff, ycenter, xcenter, z_center, temp, N2, tempj, tempk, local_sino, ax,
 						osem_apu, detectors, Nyx, kerroin, no_norm, RHS, SUMMA, OMP, PRECOMPUTE, DISCARD, rhs, Summ, indi, elements, v_indices, idx,
-						N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind);
+						N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind, 0ULL, 0ULL, orth_table);
 				}
 			}
 
@@ -892,9 +1251,10 @@ void sequential_orth_siddon(const int64_t loop_var_par, const uint32_t size_x, c
 
 			orth_distance_3D_full(tempi, N0, N4, y_diff, x_diff, z_diff, ycenter, xcenter, z_center, temp, N2, tempj, tempk, local_sino, ax,
 				osem_apu, detectors, Nyx, kerroin, no_norm, RHS, SUMMA, OMP, PRECOMPUTE, DISCARD, rhs, Summ, indi, elements, v_indices, idx,
-				N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind);
+				N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind, 0ULL, 0ULL, orth_table);
 		}
 	}
+	}
 }
 #endif
 
@@ -933,10 +1293,16 @@ void sequential_volume_siddon(const int64_t loop_var_par, const uint32_t size_x,
 	std::vector<uint32_t> store_indices(threads * dec_v, 0u);
 
 #ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+	// Per-thread span, stored only when profiling
+	profSpan aika("volume_siddon");
+#ifdef _OPENMP
 #if _OPENMP >= 201511 && defined(MATLAB)
-#pragma omp parallel for schedule(monotonic:dynamic, nChunks)
+#pragma omp for schedule(monotonic:dynamic, nChunks) nowait
 #else
-#pragma omp parallel for schedule(dynamic, nChunks)
+#pragma omp for schedule(dynamic, nChunks) nowait
 #endif
 #endif
 	for (int64_t lo = 0LL; lo < loop_var_par; lo++) {
@@ -1235,4 +1601,5 @@ void sequential_volume_siddon(const int64_t loop_var_par, const uint32_t size_x,
 				idx, N1, N3, alku, iu, ju, loppu, store_elements, store_indices, tid, ind, bmax, bmin, Vmax, V);
 		}
 	}
-}
\ No newline at end of file
+	}
+}
@@ -104,6 +104,12 @@ if options.attenuation_correction
             options.vaimennus = options.vaimennus(:) / 10;
             clear data
         end
+        % Coarse grid of a multi-resolution reconstruction, the attenuation
+        % image is on the original grid
+        if isfield(options,'multi_resolution_grid') && numel(options.vaimennus) == prod(options.multi_resolution_grid) && ...
+                numel(options.vaimennus) ~= options.Nx*options.Ny*options.Nz
+            options.vaimennus = resampleImage(options.vaimennus, options.multi_resolution_grid, [options.Nx options.Ny options.Nz]);
+        end
         if size(options.vaimennus,1) ~= options.Nx || size(options.vaimennus,2) ~= options.Ny || size(options.vaimennus,3) ~= options.Nz
             if size(options.vaimennus,1) ~= options.Nx*options.Ny*options.Nz
                 error('Error: Attenuation data is of different size than the reconstructed image')
@@ -0,0 +1,96 @@
+function index = sortSubsetLORs(options, index, pituus, x, y, z, varargin)
+%SORTSUBSETLORS Sorts the LORs inside each subset for better memory
+%locality
+%   Reorders the LORs of each subset without changing which LORs belong to
+%   which subset. This way adjacent work-items (implementations 2 and 3)
+%   and the OpenMP chunks (implementation 4) trace LORs that go through
+%   nearby voxels. The measurements and the corrections are reordered with
+%   the same indices in form_subset_indices.
+%
+%   With options.lor_ordering = 1 the LORs are sorted by their transaxial
+%   angle, then by the radial offset and lastly by the axial position of
+%   the LOR midpoint. With options.lor_ordering = 2 the LORs are sorted in
+%   the Morton (Z-curve) order of the LOR midpoints.
+%
+% Example:
+%   index = sortSubsetLORs(options, index, pituus, x, y, z_det, lor_a)
+% INPUTS:
+%   options = The lor_ordering, use_raw_data, precompute_lor and the
+%   scanner/sinogram properties are needed
+%   index = The subset indices (index_maker)
+%   pituus = The cumulative number of LORs in each subset, beginning with
+%   zero
+%   x, y, z = The detector coordinates (get_coordinates)
+%   lor_a = The number of voxels each LOR traverses as output by
+%   index_maker (required only for raw data with precompute_lor = true)
+%
+% See also index_maker, form_subset_indices, lorEndpoints
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+pituus = double(pituus(:));
+% The endpoints of each LOR
+[x1, y1, z1, x2, y2, z2] = lorEndpoints(options, index, x, y, z, varargin{:});
+if options.use_raw_data
+    det_per_ring = double(options.det_per_ring);
+    if ~options.precompute_lor
+        det_per_ring = det_per_ring * options.sampling_raw;
+    end
+    nKulmat = det_per_ring / 2;
+else
+    nKulmat = double(options.Nang);
+end
+mx = (x1 + x2) / 2;
+my = (y1 + y2) / 2;
+mz = (z1 + z2) / 2;
+
+if options.lor_ordering == 1
+    kulma = mod(atan2(y2 - y1, x2 - x1), pi);
+    % Signed distance of the LOR from the origin
+    sade = mx .* sin(kulma) - my .* cos(kulma);
+    kulma = min(floor(kulma / pi * nKulmat), nKulmat - 1);
+    avain = [kulma, sade, mz];
+    clear kulma sade
+else
+    % Midpoints quantized into 1024 bins per dimension, the bits are then
+    % interleaved
+    q = [mx, my, mz];
+    for ii = 1 : 3
+        alku = min(q(:,ii));
+        vali = max(q(:,ii)) - alku;
+        if vali > 0
+            q(:,ii) = floor((q(:,ii) - alku) / vali * 1023);
+        else
+            q(:,ii) = 0;
+        end
+    end
+    avain = zeros(size(q,1), 1);
+    for b = 0 : 9
+        for ii = 1 : 3
+            avain = avain + mod(floor(q(:,ii) / 2^b), 2) * 2^(3 * b + ii - 1);
+        end
+    end
+    clear q
+end
+clear x1 x2 y1 y2 z1 z2 mx my mz
+
+for kk = 1 : numel(pituus) - 1
+    ind = pituus(kk) + 1 : pituus(kk + 1);
+    [~, I] = sortrows(avain(ind,:));
+    index(ind) = index(ind(I));
+end
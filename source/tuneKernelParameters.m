@@ -0,0 +1,178 @@
+function options = tuneKernelParameters(options, rekonstruktio)
+%TUNEKERNELPARAMETERS Selects the OpenCL local size and the atomic
+%functions by measurement
+%   Times one iteration of OSEM with synthetic measurement data (ones) for
+%   each candidate local size (options.autotune_local_sizes) and atomic
+%   mode (float and 64-bit integer atomics, 32-bit integer atomics only if
+%   options.use_32bit_atomics = true) and selects the combination with the
+%   smallest median OS kernel time per subset. The result is saved in the
+%   mat-files folder. The filename includes a hash of the device list
+%   (driver), the selected device, the geometry and the projector
+%   parameters, thus the timings are repeated only when any of these
+%   changes.
+%
+%   rekonstruktio is a function handle that takes the modified options
+%   struct and computes the implementation 2 reconstruction with it, with
+%   the profiling data as the third output (see computeImplementation23).
+%
+% Example:
+%   options = tuneKernelParameters(options, rekonstruktio)
+% OUTPUTS:
+%   options = The input struct with local_size, use_64bit_atomics and
+%   use_32bit_atomics set to the tuned values
+%
+% See also computeImplementation23, geometryHash, md5Hash
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2021 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+folder = fileparts(which('tuneKernelParameters.m'));
+folder = [folder(1:end-6), 'mat-files/'];
+folder = strrep(folder, '\','/');
+
+if ~isfield(options,'autotune_local_sizes') || isempty(options.autotune_local_sizes)
+    options.autotune_local_sizes = [16 32 64 128 256];
+end
+if ~isfield(options,'use_32bit_atomics')
+    options.use_32bit_atomics = false;
+end
+if ~isfield(options,'n_rays_transaxial')
+    options.n_rays_transaxial = 1;
+end
+if ~isfield(options,'n_rays_axial')
+    options.n_rays_axial = 1;
+end
+koot = double(options.autotune_local_sizes(:));
+% Atomic modes, the columns are use_64bit_atomics and use_32bit_atomics
+% 32-bit atomics can overflow and are thus used only if allowed by the
+% user
+moodit = [false false; true false];
+if options.use_32bit_atomics
+    moodit = [moodit; false true];
+end
+
+% The cache key, the active device is marked in the device list and is
+% thus removed (the selected device is included separately)
+laite = ArrayFire_OpenCL_device_info();
+laite = regexprep(laite, '\[(\d+)\]', '-$1-');
+arvot = {laite, double(options.use_device), geometryHash(options), double([options.projector_type options.n_rays_transaxial ...
+    options.n_rays_axial options.precompute_lor options.use_raw_data options.TOF_bins options.subsets options.attenuation_correction ...
+    options.normalization_correction]), koot, double(moodit)};
+avain = md5Hash(arvot{:});
+tune_file = [folder options.machine_name '_kernel_tuning_' avain '.mat'];
+
+if exist(tune_file, 'file') == 2
+    tuning = loadStructFromFile(tune_file, 'tuning');
+    options.local_size = tuning.local_size;
+    options.use_64bit_atomics = tuning.use_64bit_atomics;
+    options.use_32bit_atomics = tuning.use_32bit_atomics;
+    if options.verbose
+        disp(['Kernel parameters loaded from ' tune_file ' (local size ' num2str(tuning.local_size) ')'])
+    end
+    return
+end
+
+if options.verbose
+    disp('Autotuning the kernel parameters')
+    tStart = tic;
+end
+
+% One OSEM iteration with synthetic data, no randoms/scatter correction,
+% priors, PSF or saved iterations
+opt = options;
+var = recNames();
+for kk = 1 : numel(var)
+    opt.(var{kk}) = false;
+end
+var = recNames(1);
+for kk = 1 : numel(var)
+    opt.(var{kk}) = false;
+end
+opt.OSEM = true;
+opt.MAP = false;
+opt.custom = false;
+opt.Niter = 1;
+opt.partitions = 1;
+opt.save_iter = false;
+opt.use_psf = false;
+opt.verbose = false;
+opt.profile = true;
+opt.compute_objective = false;
+opt.momentum = false;
+opt.momentum_restart = false;
+opt.cache_sensitivity = false;
+opt.randoms_correction = false;
+opt.scatter_correction = false;
+opt.SinDelayed = {single(0)};
+opt.randSize = uint64(1);
+opt.SinM = {ones(size(options.SinM{1}), 'single')};
+
+ajat = inf(numel(koot), size(moodit, 1));
+for ii = 1 : size(moodit, 1)
+    opt.use_64bit_atomics = moodit(ii, 1);
+    opt.use_32bit_atomics = moodit(ii, 2);
+    for kk = 1 : numel(koot)
+        opt.local_size = koot(kk);
+        try
+            [~, ~, prof] = rekonstruktio(opt);
+        catch
+            continue
+        end
+        % Failed builds or too large local sizes produce no kernel events
+        if isempty(prof)
+            continue
+        end
+        ind = find(strcmp(prof.nimet, 'OS kernel'), 1);
+        if isempty(ind)
+            continue
+        end
+        ajat(kk, ii) = median(prof.M(prof.M(:,1) == ind, 5));
+    end
+end
+
+[aika, ind] = min(ajat(:));
+if isinf(aika)
+    warning('Kernel autotuning failed, using the default kernel parameters')
+    return
+end
+[kk, ll] = ind2sub(size(ajat), ind);
+tuning.local_size = koot(kk);
+tuning.use_64bit_atomics = moodit(ll, 1);
+tuning.use_32bit_atomics = moodit(ll, 2);
+tuning.local_sizes = koot;
+tuning.atomic_modes = moodit;
+tuning.times = ajat;
+
+options.local_size = tuning.local_size;
+options.use_64bit_atomics = tuning.use_64bit_atomics;
+options.use_32bit_atomics = tuning.use_32bit_atomics;
+
+if options.verbose
+    nimet = {'float', '64-bit', '32-bit'};
+    for ii = 1 : size(moodit, 1)
+        disp(['Median OS kernel times (ms) with ' nimet{ii} ' atomics: ' num2str(ajat(:, ii)' / 1e3)])
+    end
+    disp(['Autotuning completed in ' num2str(toc(tStart)) ' seconds, using local size ' num2str(tuning.local_size) ' and ' ...
+        nimet{ll} ' atomics'])
+end
+
+if exist('OCTAVE_VERSION','builtin') == 0
+    save(tune_file, 'tuning', '-v7.3')
+else
+    save(tune_file, 'tuning', '-v7')
+end
+end
@@ -0,0 +1,97 @@
+function writeOutOfCoreData(tiedosto, pituus, varargin)
+%WRITEOUTOFCOREDATA Writes the subset data for the out-of-core
+%reconstruction
+%   Writes the input data into a file in a subset-contiguous order, i.e.
+%   all the data of subset 1 is followed by all the data of subset 2 and
+%   so on. The file is read one subset at a time with out_of_core_subset.
+%   See outOfCore.h for the file layout.
+%
+%   The data is input in the order measurements, randoms, normalization,
+%   scatter, transaxial indices, axial indices, number of voxels of each
+%   LOR and detector numbers of raw data. Unused data can be input as
+%   empty arrays. Each input is a K x N x P array, where N is the number of
+%   LORs (the subset indices pituus refer to the second dimension), K the
+%   number of elements per LOR (e.g. 2 for the detector numbers) and P the
+%   number of planes (e.g. TOF bins).
+%
+% Example:
+%   writeOutOfCoreData(tiedosto, pituus, reshape(Sino, 1, [], TOF_bins), reshape(SinD, 1, [], 1), [], [], [], [], [], [])
+%
+% See also out_of_core_subset, reconstructions_main
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% Copyright (C) 2020 Ville-Veikko Wettenhovi
+%
+% This program is free software: you can redistribute it and/or modify
+% it under the terms of the GNU General Public License as published by
+% the Free Software Foundation, either version 3 of the License, or
+% (at your option) any later version.
+%
+% This program is distributed in the hope that it will be useful,
+% but WITHOUT ANY WARRANTY; without even the implied warranty of
+% MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+% GNU General Public License for more details.
+%
+% You should have received a copy of the GNU General Public License
+% along with this program. If not, see <https://www.gnu.org/licenses/>.
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+% The same as in outOfCore.h
+tyypit = {'single';'single';'single';'double';'uint32';'uint16';'uint16';'uint16'};
+tavut = [4;4;4;8;4;2;2;2];
+tasaus = 4096;
+nFields = numel(tyypit);
+if numel(varargin) ~= nFields
+    error(['Eight data inputs are required, got ' num2str(numel(varargin))])
+end
+pituus = double(pituus(:));
+subsets = numel(pituus) - 1;
+
+% Number of elements of each field of each subset
+maarat = zeros(nFields, subsets);
+for ff = 1 : nFields
+    if isempty(varargin{ff})
+        continue
+    end
+    apu = size(varargin{ff});
+    apu(end + 1 : 3) = 1;
+    maarat(ff,:) = apu(1) * diff(pituus)' * prod(apu(3:end));
+end
+
+% Byte offsets, each block is aligned
+alku = ceil((24 + nFields * subsets * 16) / tasaus) * tasaus;
+offsetit = zeros(nFields, subsets);
+kohta = alku;
+for kk = 1 : subsets
+    for ff = 1 : nFields
+        if maarat(ff,kk) == 0
+            continue
+        end
+        offsetit(ff,kk) = kohta;
+        kohta = kohta + ceil(maarat(ff,kk) * tavut(ff) / tasaus) * tasaus;
+    end
+end
+
+fid = fopen(tiedosto, 'w');
+if fid == -1
+    error(['Could not create the out-of-core data file ' tiedosto])
+end
+fwrite(fid, uint8('OMEGAOOC'), 'uint8');
+fwrite(fid, uint64([subsets; nFields]), 'uint64');
+fwrite(fid, uint64([offsetit(:)'; maarat(:)']), 'uint64');
+fwrite(fid, zeros(alku - ftell(fid), 1, 'uint8'), 'uint8');
+for kk = 1 : subsets
+    for ff = 1 : nFields
+        if maarat(ff,kk) == 0
+            continue
+        end
+        data = full(varargin{ff}(:, pituus(kk) + 1 : pituus(kk + 1), :));
+        fwrite(fid, data(:), tyypit{ff});
+        loput = offsetit(ff,kk) + ceil(maarat(ff,kk) * tavut(ff) / tasaus) * tasaus - ftell(fid);
+        if loput > 0
+            fwrite(fid, zeros(loput, 1, 'uint8'), 'uint8');
+        end
+    end
+end
+fclose(fid);
+end